@@ -0,0 +1,211 @@
+#include "AgentGenerator.h"
+#include "ObstacleGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		A region's vertices, split into coordinate arrays for containment tests.
+ */
+struct RegionArrays {
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		region		The vertices of the region.
+	 */
+	RegionArrays(const std::vector<Vector2> & region) : _x(region.size()), _y(region.size()), _min(0.f, 0.f), _max(0.f, 0.f) {
+		for (size_t i = 0; i < region.size(); ++i) {
+			_x[i] = region[i]._x;
+			_y[i] = region[i]._y;
+		}
+		if (!region.empty()) {
+			_min._x = *std::min_element(_x.begin(), _x.end());
+			_min._y = *std::min_element(_y.begin(), _y.end());
+			_max._x = *std::max_element(_x.begin(), _x.end());
+			_max._y = *std::max_element(_y.begin(), _y.end());
+		}
+	}
+
+	/*!
+	 *	@brief		Reports if a point lies inside the region.
+	 */
+	bool contains(const Vector2 & p) const {
+		return p._x >= _min._x && p._x <= _max._x && p._y >= _min._y && p._y <= _max._y &&
+			ObstacleGrid::insidePolygon(&_x[0], &_y[0], _x.size(), p._x, p._y);
+	}
+
+	/// The x-values of the vertices.
+	std::vector<float>	_x;
+
+	/// The y-values of the vertices.
+	std::vector<float>	_y;
+
+	/// The minimum corner of the region's bounding box.
+	Vector2	_min;
+
+	/// The maximum corner of the region's bounding box.
+	Vector2	_max;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Sizes the lattice spanning a region's bounding box.
+ *
+ *	@param		arrays		The region.
+ *	@param		spacing		The distance between the lattice's points.
+ *	@param		columns		The number of columns of points.
+ *	@param		rows		The number of rows of points.
+ *	@returns	False if the lattice would have more than MAX_FILL_POINTS points (columns
+ *				and rows are then undefined).
+ */
+bool sizeLattice(const RegionArrays & arrays, float spacing, size_t & columns, size_t & rows) {
+	// Sized in double precision; a tiny spacing mustn't overflow the counts.
+	const double c = std::floor(((double)arrays._max._x - arrays._min._x) / spacing) + 1.0;
+	const double r = std::floor(((double)arrays._max._y - arrays._min._y) / spacing) + 1.0;
+	if (!(c * r <= (double)MAX_FILL_POINTS)) return false;
+	columns = (size_t)c;
+	rows = (size_t)r;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of agent generation
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t MAX_FILL_POINTS = (size_t)1 << 22;
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool fillLattice(const std::vector<Vector2> & region, float spacing, const ObstacleGrid & obstacles, size_t maxCount, std::vector<Vector2> & positions) {
+	if (region.size() < 3 || !(spacing > 0.f)) return true;
+	const RegionArrays arrays(region);
+	// The lattice is centered in the region's bounding box.
+	size_t columns, rows;
+	if (!sizeLattice(arrays, spacing, columns, rows)) return false;
+	if (maxCount == 0) return true;
+	const size_t COUNT = region.size();
+	std::vector<float> crossings;
+	size_t generated = 0;
+	const float x0 = 0.5f * (arrays._min._x + arrays._max._x - (columns - 1) * spacing);
+	const float y0 = 0.5f * (arrays._min._y + arrays._max._y - (rows - 1) * spacing);
+	for (size_t r = 0; r < rows; ++r) {
+		const float y = y0 + r * spacing;
+		crossings.clear();
+		for (size_t i = 0, j = COUNT - 1; i < COUNT; j = i++) {
+			if ((arrays._y[i] > y) != (arrays._y[j] > y)) {
+				crossings.push_back(arrays._x[i] + (y - arrays._y[i]) * (arrays._x[j] - arrays._x[i]) / (arrays._y[j] - arrays._y[i]));
+			}
+		}
+		std::sort(crossings.begin(), crossings.end());
+		// The row is inside the region between the first and second crossings, the third
+		//	and fourth, etc.
+		for (size_t c = 0; c + 1 < crossings.size(); c += 2) {
+			const float first = std::ceil((crossings[c] - x0) / spacing);
+			const float last = std::floor((crossings[c + 1] - x0) / spacing);
+			for (float k = first > 0.f ? first : 0.f; k <= last; k += 1.f) {
+				const Vector2 p(x0 + k * spacing, y);
+				if (obstacles.contains(p)) continue;
+				positions.push_back(p);
+				if (++generated == maxCount) return true;
+			}
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool fillPoissonDisk(const std::vector<Vector2> & region, float minDist, unsigned int seed, const ObstacleGrid & obstacles, size_t maxCount, std::vector<Vector2> & positions) {
+	if (region.size() < 3 || !(minDist > 0.f)) return true;
+	const RegionArrays arrays(region);
+	// Seeds are taken from a lattice (at the minimum distance) whenever growth stops.  Its
+	//	size also bounds the background grid's, which has about twice as many cells.
+	size_t seedColumns, seedRows;
+	if (!sizeLattice(arrays, minDist, seedColumns, seedRows)) return false;
+	if (maxCount == 0) return true;
+	// The number of candidates tried around a position before it is retired.
+	const int ATTEMPTS = 30;
+
+	// A cell's diagonal is the minimum distance, so a cell holds at most one position.
+	const float cellSize = minDist / std::sqrt(2.f);
+	const float invCellSize = 1.f / cellSize;
+	const int columns = (int)((arrays._max._x - arrays._min._x) * invCellSize) + 1;
+	const int rows = (int)((arrays._max._y - arrays._min._y) * invCellSize) + 1;
+	// The index (in positions) of the position in each cell, or -1.
+	std::vector<int> grid((size_t)columns * rows, -1);
+	const size_t first = positions.size();
+	const float minDistSq = minDist * minDist;
+
+	// Reports if a position is available for an agent and, if so, records it.
+	auto accept = [&](const Vector2 & p) -> bool {
+		if (!arrays.contains(p)) return false;
+		const int col = (int)((p._x - arrays._min._x) * invCellSize);
+		const int row = (int)((p._y - arrays._min._y) * invCellSize);
+		if (col < 0 || col >= columns || row < 0 || row >= rows) return false;
+		const int r0 = row > 2 ? row - 2 : 0;
+		const int r1 = row + 2 < rows ? row + 2 : rows - 1;
+		const int c0 = col > 2 ? col - 2 : 0;
+		const int c1 = col + 2 < columns ? col + 2 : columns - 1;
+		for (int r = r0; r <= r1; ++r) {
+			const int * cells = &grid[(size_t)r * columns];
+			for (int c = c0; c <= c1; ++c) {
+				if (cells[c] >= 0) {
+					const Vector2 d = positions[cells[c]] - p;
+					if (d * d < minDistSq) return false;
+				}
+			}
+		}
+		if (obstacles.contains(p)) return false;
+		grid[(size_t)row * columns + col] = (int)positions.size();
+		positions.push_back(p);
+		return true;
+	};
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	const float TWO_PI = 6.2831853f;
+	std::vector<size_t> active;
+	size_t nextSeed = 0;
+	const size_t SEED_COUNT = seedColumns * seedRows;
+	while (positions.size() - first < maxCount) {
+		if (active.empty()) {
+			while (nextSeed < SEED_COUNT) {
+				const size_t sr = nextSeed / seedColumns;
+				const size_t sc = nextSeed % seedColumns;
+				++nextSeed;
+				const Vector2 p(arrays._min._x + (sc + 0.5f) * minDist, arrays._min._y + (sr + 0.5f) * minDist);
+				if (accept(p)) {
+					active.push_back(positions.size() - 1);
+					break;
+				}
+			}
+			if (active.empty()) break;
+		}
+		const size_t slot = (size_t)(unit(random) * active.size()) % active.size();
+		const Vector2 center = positions[active[slot]];
+		bool grown = false;
+		for (int a = 0; a < ATTEMPTS; ++a) {
+			// Uniformly distributed over the annulus between one and two minimum distances.
+			const float dist = minDist * std::sqrt(1.f + 3.f * unit(random));
+			const float angle = TWO_PI * unit(random);
+			if (accept(Vector2(center._x + dist * std::cos(angle), center._y + dist * std::sin(angle)))) {
+				active.push_back(positions.size() - 1);
+				grown = true;
+				break;
+			}
+		}
+		if (!grown) {
+			active[slot] = active.back();
+			active.pop_back();
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,72 @@
+/*!
+ *	@file		AgentGenerator.h
+ *	@brief		Functions which place agents in a region while avoiding obstacles.
+ */
+
+#ifndef __AGENT_GENERATOR_H__
+#define	__AGENT_GENERATOR_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+// forward declarations
+class ObstacleGrid;
+
+/*!
+ *	@brief		The patterns with which agents fill a region.
+ */
+enum AgentFill {
+	LATTICE_FILL,		/// A square lattice.
+	POISSON_FILL		/// A Poisson-disk distribution (random, but evenly spaced).
+};
+
+/*!
+ *	@brief		The most points a lattice at the agents' spacing may have over a region's
+ *				bounding box; larger regions (or smaller spacings) are rejected rather
+ *				than filled, bounding the time and memory a fill takes.
+ */
+extern const size_t MAX_FILL_POINTS;
+
+/*!
+ *	@brief		Places agents on a square lattice inside a region.  The positions are
+ *				found row by row: the region's edges are intersected with each row and the
+ *				lattice points between pairs of crossings are inside the region.
+ *
+ *	@param		region			The vertices of the region (a simple polygon of either
+ *								winding).
+ *	@param		spacing			The distance between neighboring agents.
+ *	@param		obstacles		The obstacles; positions inside them are rejected.
+ *	@param		maxCount		The most positions to generate (none if zero).
+ *	@param		positions		The positions are appended to this vector.
+ *	@returns	False if the region was rejected for spanning more than MAX_FILL_POINTS
+ *				lattice points.
+ */
+bool fillLattice(const std::vector<Vector2> & region, float spacing, const ObstacleGrid & obstacles, size_t maxCount, std::vector<Vector2> & positions);
+
+/*!
+ *	@brief		Places agents inside a region such that no two agents are closer than
+ *				a minimum distance and there is no room for another agent (a Poisson-disk
+ *				distribution).
+ *
+ *	The positions are generated with Bridson's algorithm: positions are grown outwards
+ *	from the existing ones, and a background grid (with a cell per possible agent) finds
+ *	the neighbors of a candidate in constant time.  Parts of the region which can't be
+ *	reached by growing (e.g., separated by obstacles) are seeded from a lattice.
+ *
+ *	@param		region			The vertices of the region (a simple polygon of either
+ *								winding).
+ *	@param		minDist			The minimum distance between agents.
+ *	@param		seed			The seed of the random number generator; the same seed
+ *								produces the same positions.
+ *	@param		obstacles		The obstacles; positions inside them are rejected.
+ *	@param		maxCount		The most positions to generate (none if zero).
+ *	@param		positions		The positions are appended to this vector.
+ *	@returns	False if the region was rejected for spanning more than MAX_FILL_POINTS
+ *				lattice points at the minimum distance.
+ */
+bool fillPoissonDisk(const std::vector<Vector2> & region, float minDist, unsigned int seed, const ObstacleGrid & obstacles, size_t maxCount, std::vector<Vector2> & positions);
+
+#endif	// __AGENT_GENERATOR_H__
@@ -0,0 +1,267 @@
+#include "AgentPlacementContext.h"
+
+#include "AgentPlacementWidget.hpp"
+#include "AppLogger.hpp"
+#include "EventBus.hpp"
+#include "glwidget.hpp"
+#include "LiveObstacleSet.h"
+#include "MCException.h"
+#include "WorldFrame.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/qfile.h>
+#include <QtCore/QXmlStreamWriter>
+#include <QtGui/QKeyEvent>
+#include <QtGui/QMouseEvent>
+
+#include <gl/GL.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//						Implementation of AgentPlacementContext
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const size_t AgentPlacementContext::MAX_AGENTS = 1000000;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+AgentPlacementContext::AgentPlacementContext(LiveObstacleSet * obstacles) : QtContext(), _obstacles(obstacles), _frame(0x0), _shape(RECTANGLE_REGION), _fill(POISSON_FILL), _spacing(1.f), _seed(1), _region(), _drawing(false), _positions(), _widget(0x0) {
+	setDispatch(0, inputBit(MOUSE_INPUT) | inputBit(KEY_INPUT), TOOL_LAYER);
+	_widget = new AgentPlacementWidget(this);
+	setContextWidget(_widget);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+AgentPlacementContext::~AgentPlacementContext() {
+	EventBus::instance()->withdraw(this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+Menge::SceneGraph::ContextResult AgentPlacementContext::handleMouse(QMouseEvent * evt, GLWidget * view) {
+	Menge::SceneGraph::ContextResult result = QtContext::handleMouse(evt, view);
+
+	if (!result.isHandled() && evt->modifiers() == Qt::NoModifier) {
+		if (evt->type() == QEvent::MouseButtonPress) {
+			if (evt->button() == Qt::LeftButton) {
+				Vector2 p;
+				view->getWorldPos(evt->pos(), p);
+				if (!_drawing) {
+					_region.clear();
+					_positions.clear();
+					_drawing = true;
+				}
+				if (_shape == RECTANGLE_REGION) {
+					_region.assign(4, p);
+				}
+				else {
+					_region.push_back(p);
+				}
+				result.set(true, true);
+			}
+			else if (_drawing && _shape == POLYGON_REGION && evt->button() == Qt::RightButton) {
+				_drawing = false;
+				if (_region.size() < 3) {
+					_region.clear();
+				}
+				else {
+					fillRegion();
+				}
+				result.set(true, true);
+			}
+		}
+		else if (evt->type() == QEvent::MouseMove) {
+			if (_drawing && _shape == RECTANGLE_REGION && (evt->buttons() & Qt::LeftButton)) {
+				Vector2 p;
+				view->getWorldPos(evt->pos(), p);
+				// The first corner is fixed; the opposite corner follows the mouse.
+				_region[1].set(p._x, _region[0]._y);
+				_region[2] = p;
+				_region[3].set(_region[0]._x, p._y);
+				result.set(true, true);
+			}
+		}
+		else if (evt->type() == QEvent::MouseButtonRelease) {
+			if (_drawing && _shape == RECTANGLE_REGION && evt->button() == Qt::LeftButton) {
+				_drawing = false;
+				if (_region[0]._x == _region[2]._x || _region[0]._y == _region[2]._y) {
+					_region.clear();
+				}
+				else {
+					fillRegion();
+				}
+				result.set(true, true);
+			}
+		}
+	}
+
+	if (!result.isHandled()) {
+		// The mouse event is accepted by default -- ignore must be called explicitly to pass it up.
+		evt->ignore();
+	}
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+Menge::SceneGraph::ContextResult AgentPlacementContext::handleKeyboard(QKeyEvent * evt, GLWidget * view) {
+	Menge::SceneGraph::ContextResult result = QtContext::handleKeyboard(evt, view);
+
+	if (!result.isHandled() && evt->type() == QEvent::KeyPress && evt->modifiers() == Qt::NoModifier) {
+		if (evt->key() == Qt::Key_Escape || evt->key() == Qt::Key_Delete) {
+			result.set(true, clear());
+		}
+		else if (evt->key() == Qt::Key_R) {
+			result.set(true, regenerate());
+		}
+	}
+	if (!result.isHandled()) {
+		// The key event is accepted by default -- ignore must be called explicitly to pass it up.
+		//	http://doc.qt.io/qt-5/qkeyevent.html#details
+		evt->ignore();
+	}
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementContext::deactivate() {
+	// An unfinished region is abandoned; the placed agents remain.
+	if (_drawing) {
+		_drawing = false;
+		_region.clear();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementContext::setRegionShape(RegionShape shape) {
+	if (_shape != shape && _drawing) {
+		_drawing = false;
+		_region.clear();
+		EventBus::instance()->post(Event(CONTEXT_CHANGED, this));
+	}
+	_shape = shape;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool AgentPlacementContext::regenerate() {
+	if (_drawing || _region.empty()) return false;
+	fillRegion();
+	EventBus::instance()->post(Event(CONTEXT_CHANGED, this));
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool AgentPlacementContext::clear() {
+	if (_region.empty() && _positions.empty()) return false;
+	_region.clear();
+	_positions.clear();
+	_drawing = false;
+	_widget->updateCount();
+	EventBus::instance()->post(Event(CONTEXT_CHANGED, this));
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementContext::translate(double dx, double dy) {
+	for (Vector2 & p : _region) {
+		p.set(static_cast<float>(p._x + dx), static_cast<float>(p._y + dy));
+	}
+	for (Vector2 & p : _positions) {
+		p.set(static_cast<float>(p._x + dx), static_cast<float>(p._y + dy));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementContext::exportAgents(const QString & fileName) const {
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		throw MCException("Unable to write the agents to " + fileName.toStdString() + ": " + file.errorString().toStdString());
+	}
+	QXmlStreamWriter xml(&file);
+	xml.setAutoFormatting(true);
+	xml.writeStartDocument();
+	xml.writeStartElement("Generator");
+	xml.writeAttribute("type", "explicit");
+	WorldFrame identity;
+	const WorldFrame & frame = _frame != 0x0 ? *_frame : identity;
+	for (size_t i = 0; i < _positions.size(); ++i) {
+		double x, y;
+		frame.toWorld(_positions[i], x, y);
+		xml.writeEmptyElement("Agent");
+		// Enough digits for projected coordinates, which are far from zero.
+		xml.writeAttribute("p_x", QString::number(x, 'g', 10));
+		xml.writeAttribute("p_y", QString::number(y, 'g', 10));
+	}
+	xml.writeEndElement();
+	xml.writeEndDocument();
+	if (xml.hasError()) {
+		throw MCException("Unable to write the agents to " + fileName.toStdString() + ": " + file.errorString().toStdString());
+	}
+	AppLogger::logStream << AppLogger::INFO_MSG << "Exported " << _positions.size();
+	AppLogger::logStream << " agents to " << fileName.toStdString() << AppLogger::END_MSG;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementContext::draw3DGL(bool select) {
+	if (select || _region.empty()) return;
+	glPushAttrib(GL_POINT_BIT | GL_LINE_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+
+	// The region's outline; a polygon is left open while it is being drawn.
+	glColor3f(0.2f, 0.8f, 0.2f);
+	glLineWidth(2.f);
+	glBegin(_drawing && _shape == POLYGON_REGION ? GL_LINE_STRIP : GL_LINE_LOOP);
+	for (size_t i = 0; i < _region.size(); ++i) {
+		glVertex3f(_region[i]._x, _region[i]._y, 0.f);
+	}
+	glEnd();
+
+	if (!_positions.empty()) {
+		glColor3f(1.f, 0.6f, 0.f);
+		glPointSize(4.f);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(2, GL_FLOAT, sizeof(Vector2), &_positions[0]);
+		glDrawArrays(GL_POINTS, 0, (GLsizei)_positions.size());
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+	glPopAttrib();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementContext::fillRegion() {
+	QElapsedTimer timer;
+	timer.start();
+	const ObstacleGrid & grid = _obstacles->getObstacleGrid();
+	_positions.clear();
+	bool filled = true;
+	if (_fill == LATTICE_FILL) {
+		filled = fillLattice(_region, _spacing, grid, MAX_AGENTS, _positions);
+	}
+	else {
+		filled = fillPoissonDisk(_region, _spacing, _seed, grid, MAX_AGENTS, _positions);
+	}
+	if (!filled) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << "The region is too large for a spacing of " << _spacing;
+		AppLogger::logStream << "; it would span more than " << MAX_FILL_POINTS << " agent positions" << AppLogger::END_MSG;
+		_widget->updateCount();
+		return;
+	}
+	AppLogger::logStream << AppLogger::INFO_MSG << "Placed " << _positions.size();
+	AppLogger::logStream << " agents in " << timer.elapsed() << " ms" << AppLogger::END_MSG;
+	if (_positions.size() == MAX_AGENTS) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "The region was only partially filled; at most ";
+		AppLogger::logStream << MAX_AGENTS << " agents are placed" << AppLogger::END_MSG;
+	}
+	_widget->updateCount();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,252 @@
+/*!
+ *	@file		AgentPlacementContext.h
+ *	@brief		The definition of a context for placing agents in regions of the scene.
+ */
+
+#ifndef __AGENT_PLACEMENT_CONTEXT_H__
+#define	__AGENT_PLACEMENT_CONTEXT_H__
+
+#include "AgentGenerator.h"
+#include "QtContext.h"
+
+#include <QtCore/qstring.h>
+
+#include <vector>
+
+// Forward declarations
+class AgentPlacementWidget;
+class LiveObstacleSet;
+class WorldFrame;
+
+/*!
+ *	@brief		Provides a context for filling regions of the scene with agents.
+ *
+ *	The user outlines a region -- a rectangle (by dragging) or a polygon (clicking its
+ *	vertices and right-clicking to close it) -- and the region is filled with agents
+ *	according to the context's fill pattern.  Positions inside the obstacles of the
+ *	obstacle set are rejected.  The positions can be exported as a Menge explicit agent
+ *	generator.
+ */
+class AgentPlacementContext : public QtContext {
+public:
+	/*!
+	 *	@brief		The shapes of the regions the user draws.
+	 */
+	enum RegionShape {
+		RECTANGLE_REGION,		/// An axis-aligned rectangle, drawn by dragging.
+		POLYGON_REGION			/// A polygon, drawn vertex by vertex.
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		obstacles		The obstacles agents must not be placed in.
+	 */
+	AgentPlacementContext(LiveObstacleSet * obstacles);
+
+	/*!
+	 *	@brief		Destructor.
+	 */
+	~AgentPlacementContext();
+
+	/*!
+	 *	@brief		Give the context the opportunity to respond to a mouse
+	 *				event.
+	 *
+	 *	@param		e		The QT event with the mouse event data.
+	 *	@param		view	The view this context is interacting with.
+	 *	@returns	A ContextResult instance reporting if the event was handled and
+	 *				if redrawing is necessary.
+	 */
+	virtual Menge::SceneGraph::ContextResult handleMouse(QMouseEvent * evt, GLWidget * view);
+
+	/*!
+	 *	@brief		Give the context the opportunity to respond to a keyboard
+	 *				event.
+	 *
+	 *	@param		e		The QT event with the keyboard event data.
+	 *	@param		view	The view this context is interacting with.
+	 *	@returns	A ContextResult instance reporting if the event was handled and
+	 *				if redrawing is necessary.
+	 */
+	virtual Menge::SceneGraph::ContextResult handleKeyboard(QKeyEvent * evt, GLWidget * view);
+
+	/*!
+	 *	@brief		Called when the context is deactivated.
+	 */
+	virtual void deactivate();
+
+	/*!
+	 *	@brief		Sets the shape of the regions the user draws.
+	 *
+	 *	@param		shape		The shape.
+	 */
+	void setRegionShape(RegionShape shape);
+
+	/*!
+	 *	@brief		Reports the shape of the regions the user draws.
+	 */
+	RegionShape getRegionShape() const { return _shape; }
+
+	/*!
+	 *	@brief		Sets the pattern with which regions are filled.
+	 *
+	 *	@param		fill		The fill pattern.
+	 */
+	void setFill(AgentFill fill) { _fill = fill; }
+
+	/*!
+	 *	@brief		Reports the pattern with which regions are filled.
+	 */
+	AgentFill getFill() const { return _fill; }
+
+	/*!
+	 *	@brief		Sets the distance between agents (the lattice spacing or the minimum
+	 *				distance of the Poisson-disk distribution).
+	 *
+	 *	@param		spacing		The distance; it must be positive.
+	 */
+	void setSpacing(float spacing) { _spacing = spacing; }
+
+	/*!
+	 *	@brief		Reports the distance between agents.
+	 */
+	float getSpacing() const { return _spacing; }
+
+	/*!
+	 *	@brief		Sets the seed of the Poisson-disk distribution.
+	 *
+	 *	@param		seed		The seed.
+	 */
+	void setSeed(unsigned int seed) { _seed = seed; }
+
+	/*!
+	 *	@brief		Reports the seed of the Poisson-disk distribution.
+	 */
+	unsigned int getSeed() const { return _seed; }
+
+	/*!
+	 *	@brief		Reports the number of agents placed.
+	 */
+	size_t getAgentCount() const { return _positions.size(); }
+
+	/*!
+	 *	@brief		Reports the positions of the placed agents.
+	 */
+	const std::vector<Vector2> & getPositions() const { return _positions; }
+
+	/*!
+	 *	@brief		Fills the current region again with the current settings (e.g., after
+	 *				the settings or the obstacles changed).
+	 *
+	 *	@returns	True if the action requires a redraw, false otherwise.
+	 */
+	bool regenerate();
+
+	/*!
+	 *	@brief		Discards the region and its agents.
+	 *
+	 *	@returns	True if the action requires a redraw, false otherwise.
+	 */
+	bool clear();
+
+	/*!
+	 *	@brief		Shifts the region and the agents (e.g., when the scene's origin moves; see
+	 *				WorldFrame).
+	 *
+	 *	@param		dx		The shift along the x-axis.
+	 *	@param		dy		The shift along the y-axis.
+	 */
+	void translate(double dx, double dy);
+
+	/*!
+	 *	@brief		Sets the frame which relates the agents' positions to world coordinates.
+	 *
+	 *	@param		frame		The frame; the context does *not* own it.  If null, positions
+	 *							are exported as they are.
+	 */
+	void setWorldFrame(const WorldFrame * frame) { _frame = frame; }
+
+	/*!
+	 *	@brief		Writes the agents' positions as a Menge explicit agent generator.  The
+	 *				generator element can be copied into an AgentGroup of a scene
+	 *				specification.  The positions are written in world coordinates.
+	 *
+	 *	@param		fileName		The path of the file to write.
+	 *	@throws		MCException if the file can't be written.
+	 */
+	void exportAgents(const QString & fileName) const;
+
+	/*!
+	 *	@brief		The most agents placed in a region.
+	 */
+	static const size_t MAX_AGENTS;
+
+protected:
+
+	/*!
+	 *	@brief		Draw context elements into the 3D world.
+	 *
+	 *	@param		select		Defines if the drawing is being done for selection
+	 *							purposes (true) or visualization (false).
+	 */
+	virtual void draw3DGL(bool select = false);
+
+	/*!
+	 *	@brief		Fills the region with agents and reports the result to the log and the
+	 *				widget.
+	 */
+	void fillRegion();
+
+	/*!
+	 *	@brief		The obstacles agents must not be placed in.
+	 */
+	LiveObstacleSet * _obstacles;
+
+	/*!
+	 *	@brief		The frame which relates the agents' positions to world coordinates.
+	 */
+	const WorldFrame * _frame;
+
+	/*!
+	 *	@brief		The shape of the regions the user draws.
+	 */
+	RegionShape _shape;
+
+	/*!
+	 *	@brief		The pattern with which regions are filled.
+	 */
+	AgentFill _fill;
+
+	/*!
+	 *	@brief		The distance between agents.
+	 */
+	float _spacing;
+
+	/*!
+	 *	@brief		The seed of the Poisson-disk distribution.
+	 */
+	unsigned int _seed;
+
+	/*!
+	 *	@brief		The vertices of the region.
+	 */
+	std::vector<Vector2> _region;
+
+	/*!
+	 *	@brief		Indicates that the region is being drawn.
+	 */
+	bool _drawing;
+
+	/*!
+	 *	@brief		The positions of the placed agents.
+	 */
+	std::vector<Vector2> _positions;
+
+	/*!
+	 *	@brief		The underlying widget associated with this context.
+	 */
+	AgentPlacementWidget * _widget;
+};
+
+#endif	// __AGENT_PLACEMENT_CONTEXT_H__
@@ -0,0 +1,119 @@
+#include "AgentPlacementWidget.hpp"
+#include "AgentPlacementContext.h"
+#include "AppLogger.hpp"
+#include "MCException.h"
+
+#include <QtGui/QDoubleValidator>
+#include <QtGui/QIntValidator>
+#include <QtWidgets/qcombobox.h>
+#include <QtWidgets/qfiledialog.h>
+#include <QtWidgets/qgridlayout.h>
+#include <QtWidgets/qlabel.h>
+#include <QtWidgets/qlineedit.h>
+#include <QtWidgets/qpushbutton.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//						Implementation of AgentPlacementWidget
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+AgentPlacementWidget::AgentPlacementWidget(AgentPlacementContext * context, QWidget * parent) : QWidget(parent), _context(context), _shapeBox(0x0), _fillBox(0x0), _spacing(0x0), _seed(0x0), _countLabel(0x0) {
+	QGridLayout * layout = new QGridLayout();
+
+	layout->addWidget(new QLabel(tr("Region")), 0, 0, Qt::AlignRight);
+	_shapeBox = new QComboBox();
+	_shapeBox->addItem(tr("Rectangle"), AgentPlacementContext::RECTANGLE_REGION);
+	_shapeBox->addItem(tr("Polygon"), AgentPlacementContext::POLYGON_REGION);
+	_shapeBox->setToolTip(tr("Drag a rectangle, or click the vertices of a polygon and right-click to close it"));
+	layout->addWidget(_shapeBox, 0, 1);
+
+	layout->addWidget(new QLabel(tr("Fill")), 1, 0, Qt::AlignRight);
+	_fillBox = new QComboBox();
+	_fillBox->addItem(tr("Lattice"), LATTICE_FILL);
+	_fillBox->addItem(tr("Poisson disk"), POISSON_FILL);
+	_fillBox->setCurrentIndex(_context->getFill() == LATTICE_FILL ? 0 : 1);
+	layout->addWidget(_fillBox, 1, 1);
+
+	layout->addWidget(new QLabel(tr("Spacing")), 2, 0, Qt::AlignRight);
+	_spacing = new QLineEdit(QString::number(_context->getSpacing()));
+	_spacing->setValidator(new QDoubleValidator(1e-3, 1e6, 3, _spacing));
+	_spacing->setToolTip(tr("The distance between neighboring agents"));
+	layout->addWidget(_spacing, 2, 1);
+
+	layout->addWidget(new QLabel(tr("Seed")), 3, 0, Qt::AlignRight);
+	_seed = new QLineEdit(QString::number(_context->getSeed()));
+	_seed->setValidator(new QIntValidator(0, 2147483647, _seed));
+	_seed->setToolTip(tr("The seed of the Poisson-disk distribution"));
+	layout->addWidget(_seed, 3, 1);
+
+	_countLabel = new QLabel();
+	layout->addWidget(_countLabel, 4, 0, 1, 2);
+	updateCount();
+
+	QPushButton * regenButton = new QPushButton(tr("&Regenerate"));
+	regenButton->setToolTip(tr("Fill the region again with the current settings (R)"));
+	layout->addWidget(regenButton, 5, 0);
+	QPushButton * clearButton = new QPushButton(tr("&Clear"));
+	clearButton->setToolTip(tr("Discard the region and its agents (Esc)"));
+	layout->addWidget(clearButton, 5, 1);
+	QPushButton * exportButton = new QPushButton(tr("&Export XML..."));
+	exportButton->setToolTip(tr("Write the agents as an explicit agent generator"));
+	layout->addWidget(exportButton, 6, 0, 1, 2);
+	layout->setRowStretch(7, 1);
+
+	connect(_shapeBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated), this, [=]() { applySettings(); });
+	connect(_fillBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated), this, [=]() { applySettings(); });
+	connect(_spacing, &QLineEdit::editingFinished, this, &AgentPlacementWidget::applySettings);
+	connect(_seed, &QLineEdit::editingFinished, this, &AgentPlacementWidget::applySettings);
+	connect(regenButton, &QPushButton::clicked, this, &AgentPlacementWidget::regenerate);
+	connect(clearButton, &QPushButton::clicked, this, [=]() { _context->clear(); });
+	connect(exportButton, &QPushButton::clicked, this, &AgentPlacementWidget::exportAgents);
+
+	setLayout(layout);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementWidget::updateCount() {
+	_countLabel->setText(tr("%1 agents placed").arg(_context->getAgentCount()));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementWidget::applySettings() {
+	_context->setRegionShape((AgentPlacementContext::RegionShape)_shapeBox->currentData().toInt());
+	_context->setFill((AgentFill)_fillBox->currentData().toInt());
+	const float spacing = _spacing->text().toFloat();
+	if (spacing > 0.f) {
+		_context->setSpacing(spacing);
+	}
+	else {
+		_spacing->setText(QString::number(_context->getSpacing()));
+	}
+	_context->setSeed(_seed->text().toUInt());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementWidget::regenerate() {
+	applySettings();
+	_context->regenerate();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void AgentPlacementWidget::exportAgents() {
+	if (_context->getAgentCount() == 0) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "There are no agents to export" << AppLogger::END_MSG;
+		return;
+	}
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Export Agents"), QString(), tr("XML files (*.xml)"));
+	if (fileName.isEmpty()) return;
+	try {
+		_context->exportAgents(fileName);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << e.what() << AppLogger::END_MSG;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
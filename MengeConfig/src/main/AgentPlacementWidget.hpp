@@ -0,0 +1,84 @@
+/*!
+ *	@file		AgentPlacementWidget.hpp
+ *	@brief		The widget for interacting with the agent placement context.
+ */
+
+#ifndef __AGENT_PLACEMENT_WIDGET_H__
+#define	__AGENT_PLACEMENT_WIDGET_H__
+
+#include <QtWidgets\qwidget.h>
+
+QT_BEGIN_NAMESPACE
+class QComboBox;
+class QLabel;
+class QLineEdit;
+QT_END_NAMESPACE
+
+class AgentPlacementContext;
+
+class AgentPlacementWidget : public QWidget {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		context			The context this widget interfaces with.
+	 *	@param		parent			The optional parent widget.
+	 */
+	AgentPlacementWidget(AgentPlacementContext * context, QWidget * parent = 0x0);
+
+	/*!
+	 *	@brief		Updates the displayed number of placed agents.
+	 */
+	void updateCount();
+
+protected:
+
+	/*!
+	 *	@brief		Copies the values of the editors into the context.
+	 */
+	void applySettings();
+
+	/*!
+	 *	@brief		Applies the settings and fills the context's region again.
+	 */
+	void regenerate();
+
+	/*!
+	 *	@brief		Asks the user for a file name and exports the placed agents to it.
+	 */
+	void exportAgents();
+
+	/*!
+	 *	@brief		The agent placement context.
+	 */
+	AgentPlacementContext * _context;
+
+	/*!
+	 *	@brief		Selects the shape of the region.
+	 */
+	QComboBox * _shapeBox;
+
+	/*!
+	 *	@brief		Selects the fill pattern.
+	 */
+	QComboBox * _fillBox;
+
+	/*!
+	 *	@brief		The editor for the distance between agents.
+	 */
+	QLineEdit * _spacing;
+
+	/*!
+	 *	@brief		The editor for the random seed.
+	 */
+	QLineEdit * _seed;
+
+	/*!
+	 *	@brief		Displays the number of placed agents.
+	 */
+	QLabel * _countLabel;
+};
+
+#endif	// __AGENT_PLACEMENT_WIDGET_H__
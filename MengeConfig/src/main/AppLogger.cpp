@@ -1,7 +1,9 @@
 #include "AppLogger.hpp"
 
 #include <QtCore/qdatetime.h>
-#include <QtWidgets/Qtextedit.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qurl.h>
+#include <QtWidgets/qtextbrowser.h>
 #include <QtWidgets/qboxlayout.h>
 
 
@@ -23,9 +25,12 @@ AppLogger::AppLogger(QWidget * parent) : QWidget(parent) {
 	logStream.rdbuf(new LogBuffer(this));
 	QVBoxLayout * lyt = new QVBoxLayout(this);
 	lyt->setMargin(0);
-	_editor = new QTextEdit();
+	_editor = new QTextBrowser();
 	_editor->setReadOnly(true);
 	_editor->setAcceptRichText(true);
+	// Links refer to the scene; they are never followed as documents.
+	_editor->setOpenLinks(false);
+	connect(_editor, &QTextBrowser::anchorClicked, this, &AppLogger::openLink);
 
 	_infoColor.setRgb(0, 0, 0);
 	_warnColor.setRgb(255, 128, 0);
@@ -63,6 +68,32 @@ void AppLogger::error(const std::string & msg) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+std::string AppLogger::worldLink(const std::string & text, const Vector2 & minPt, const Vector2 & maxPt) {
+	QString link = QString("<a href=\"world:%1,%2,%3,%4\">%5</a>").arg(minPt._x).arg(minPt._y).arg(maxPt._x).arg(maxPt._y).arg(QString::fromStdString(text).toHtmlEscaped());
+	return link.toStdString();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string AppLogger::stateLink(const std::string & text, size_t state) {
+	QString link = QString("<a href=\"state:%1\">%2</a>").arg((qulonglong)state).arg(QString::fromStdString(text).toHtmlEscaped());
+	return link.toStdString();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AppLogger::openLink(const QUrl & url) {
+	const QStringList values = url.path().split(',');
+	if (url.scheme() == "world" && values.size() == 4) {
+		emit frameRequested(Vector2(values[0].toFloat(), values[1].toFloat()), Vector2(values[2].toFloat(), values[3].toFloat()));
+	}
+	else if (url.scheme() == "state" && values.size() == 1) {
+		emit stateRequested((size_t)values[0].toULongLong());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void AppLogger::message(const std::string & msg) {
 	QDateTime now(QDate::currentDate(), QTime::currentTime());
 	if (msg[msg.size() - 1] == '\n') {
@@ -11,18 +11,27 @@
 #include <iostream>
 #include <sstream>
 
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
 // forward declaration
 QT_BEGIN_NAMESPACE
-class QTextEdit;
+class QTextBrowser;
+class QUrl;
 QT_END_NAMESPACE
 class LogBuffer;
 
 
 /*!
  *	@brief		An implementation of the base logger interface which stores the event
- *				log in a QTextEdit object.
+ *				log in a QTextBrowser object.
+ *
+ *	Messages may contain links to locations in the scene (see worldLink() and
+ *	stateLink()); clicking one requests that the location be shown.
  */
 class AppLogger : public QWidget {
+	Q_OBJECT
+
 public:
 	/*!
 	 *	@brief		Tag to put in the logging stream to indicate an info message.
@@ -92,8 +101,54 @@ public:
 	 */
 	virtual void error(const std::string & msg);
 
+	/*!
+	 *	@brief		Formats a link to a region of the ground plane for inclusion in a
+	 *				message.  A message containing a link is interpreted as rich text.
+	 *
+	 *	@param		text		The text of the link.
+	 *	@param		minPt		The minimum corner of the region.
+	 *	@param		maxPt		The maximum corner of the region.
+	 *	@returns	The link.
+	 */
+	static std::string worldLink(const std::string & text, const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Formats a link to a state of the behavior FSM for inclusion in a
+	 *				message.  A message containing a link is interpreted as rich text.
+	 *
+	 *	@param		text		The text of the link.
+	 *	@param		state		The index of the state.
+	 *	@returns	The link.
+	 */
+	static std::string stateLink(const std::string & text, size_t state);
+
+signals:
+	/*!
+	 *	@brief		Requests that a region of the ground plane be framed in the view (a
+	 *				world link was clicked).
+	 *
+	 *	@param		minPt		The minimum corner of the region.
+	 *	@param		maxPt		The maximum corner of the region.
+	 */
+	void frameRequested(const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Requests that a state of the behavior FSM be shown (a state link was
+	 *				clicked).
+	 *
+	 *	@param		state		The index of the state.
+	 */
+	void stateRequested(size_t state);
+
 protected:
 
+	/*!
+	 *	@brief		Responds to a click on a link in the log.
+	 *
+	 *	@param		url		The link's target.
+	 */
+	void openLink(const QUrl & url);
+
 	/*!
 	 *	@brief		Writes the message to the logger using the current state.
 	 *
@@ -104,7 +159,7 @@ protected:
 	/*!
 	 *	@brief		The text editor to which all logs will be written.
 	 */
-	QTextEdit * _editor;
+	QTextBrowser * _editor;
 
 	/*!
 	 *	@brief		The text color for info.
@@ -0,0 +1,201 @@
+#include "BatchOps.h"
+
+#include <cassert>
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// The batch operations treat an array of vertices as a flat array of floats.
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be three tightly packed floats");
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef MC_USE_SSE2
+
+/*!
+ *	@brief		Loads four consecutive vertices and separates their x- and y-components.
+ *
+ *	@param		p		The address of the first vertex's x-component.
+ *	@param		a		The first four floats: x0, y0, z0, x1.
+ *	@param		b		The second four floats: y1, z1, x2, y2.
+ *	@param		c		The third four floats: z2, x3, y3, z3.
+ *	@param		x		The x-components of the four vertices.
+ *	@param		y		The y-components of the four vertices.
+ */
+inline void loadXY(const float * p, __m128 & a, __m128 & b, __m128 & c, __m128 & x, __m128 & y) {
+	a = _mm_loadu_ps(p);
+	b = _mm_loadu_ps(p + 4);
+	c = _mm_loadu_ps(p + 8);
+	// x = [a0, a3, b2, c1]
+	__m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+	x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+	// y = [a1, b0, b3, c2]
+	__m128 u = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 v = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+	y = _mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Stores the x- and y-components of four consecutive vertices, preserving
+ *				the z-components of the vertices loaded by loadXY.
+ *
+ *	@param		p		The address of the first vertex's x-component.
+ *	@param		a		The first four floats, as loaded.
+ *	@param		b		The second four floats, as loaded.
+ *	@param		c		The third four floats, as loaded.
+ *	@param		x		The new x-components of the four vertices.
+ *	@param		y		The new y-components of the four vertices.
+ */
+inline void storeXY(float * p, __m128 a, __m128 b, __m128 c, __m128 x, __m128 y) {
+	// [x0, y0, z0, x1]
+	__m128 u = _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 v = _mm_shuffle_ps(a, x, _MM_SHUFFLE(1, 1, 2, 2));
+	_mm_storeu_ps(p, _mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0)));
+	// [y1, z1, x2, y2]
+	u = _mm_shuffle_ps(y, b, _MM_SHUFFLE(1, 1, 1, 1));
+	v = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));
+	_mm_storeu_ps(p + 4, _mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0)));
+	// [z2, x3, y3, z3]
+	u = _mm_shuffle_ps(c, x, _MM_SHUFFLE(3, 3, 0, 0));
+	v = _mm_shuffle_ps(y, c, _MM_SHUFFLE(3, 3, 3, 3));
+	_mm_storeu_ps(p + 8, _mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Rounds to the nearest integer, with halfway values rounded away from
+ *				zero (matching the C library's round()).
+ *
+ *	@param		v		The values to round.
+ *	@returns	The rounded values.
+ */
+inline __m128 roundHalfAway(__m128 v) {
+	const __m128 SIGN = _mm_set1_ps(-0.f);
+	const __m128 HALF = _mm_set1_ps(0.5f);
+	const __m128 ONE = _mm_set1_ps(1.f);
+	// Floats this large have no fractional part (and may not fit in an int).
+	const __m128 INTEGRAL = _mm_set1_ps(8388608.f);
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+	__m128 fraction = _mm_andnot_ps(SIGN, _mm_sub_ps(v, truncated));
+	__m128 step = _mm_or_ps(ONE, _mm_and_ps(SIGN, v));
+	__m128 rounded = _mm_add_ps(truncated, _mm_and_ps(_mm_cmpge_ps(fraction, HALF), step));
+	__m128 isIntegral = _mm_cmpge_ps(_mm_andnot_ps(SIGN, v), INTEGRAL);
+	return _mm_or_ps(_mm_and_ps(isIntegral, v), _mm_andnot_ps(isIntegral, rounded));
+}
+
+#endif	// MC_USE_SSE2
+
+///////////////////////////////////////////////////////////////////////////////
+
+void transformPoints(Vector3 * points, size_t count, const Affine2D & xform) {
+	size_t i = 0;
+#ifdef MC_USE_SSE2
+	const __m128 M00 = _mm_set1_ps(xform._m00);
+	const __m128 M01 = _mm_set1_ps(xform._m01);
+	const __m128 M10 = _mm_set1_ps(xform._m10);
+	const __m128 M11 = _mm_set1_ps(xform._m11);
+	const __m128 TX = _mm_set1_ps(xform._tx);
+	const __m128 TY = _mm_set1_ps(xform._ty);
+	for (; i + 4 <= count; i += 4) {
+		float * p = &points[i]._x;
+		__m128 a, b, c, x, y;
+		loadXY(p, a, b, c, x, y);
+		__m128 newX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(M00, x), _mm_mul_ps(M01, y)), TX);
+		__m128 newY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(M10, x), _mm_mul_ps(M11, y)), TY);
+		storeXY(p, a, b, c, newX, newY);
+	}
+#endif
+	for (; i < count; ++i) {
+		Vector3 & v = points[i];
+		const float x = v._x;
+		v._x = xform._m00 * x + xform._m01 * v._y + xform._tx;
+		v._y = xform._m10 * x + xform._m11 * v._y + xform._ty;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void snapPoints(Vector3 * points, size_t count, const Vector2 & origin, float cellSize, bool snapX, bool snapY) {
+	assert(cellSize > 0.f && "Snapping to a grid with non-positive cell size");
+	if (!(snapX || snapY)) return;
+	size_t i = 0;
+#ifdef MC_USE_SSE2
+	const __m128 OX = _mm_set1_ps(origin._x);
+	const __m128 OY = _mm_set1_ps(origin._y);
+	const __m128 CELL = _mm_set1_ps(cellSize);
+	for (; i + 4 <= count; i += 4) {
+		float * p = &points[i]._x;
+		__m128 a, b, c, x, y;
+		loadXY(p, a, b, c, x, y);
+		if (snapX) {
+			x = _mm_add_ps(_mm_mul_ps(roundHalfAway(_mm_div_ps(_mm_sub_ps(x, OX), CELL)), CELL), OX);
+		}
+		if (snapY) {
+			y = _mm_add_ps(_mm_mul_ps(roundHalfAway(_mm_div_ps(_mm_sub_ps(y, OY), CELL)), CELL), OY);
+		}
+		storeXY(p, a, b, c, x, y);
+	}
+#endif
+	for (; i < count; ++i) {
+		Vector3 & v = points[i];
+		if (snapX) v._x = round((v._x - origin._x) / cellSize) * cellSize + origin._x;
+		if (snapY) v._y = round((v._y - origin._y) / cellSize) * cellSize + origin._y;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Affine2D
+///////////////////////////////////////////////////////////////////////////////
+
+Affine2D::Affine2D() : _m00(1.f), _m01(0.f), _m10(0.f), _m11(1.f), _tx(0.f), _ty(0.f) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Affine2D::Affine2D(float m00, float m01, float m10, float m11, float tx, float ty) : _m00(m00), _m01(m01), _m10(m10), _m11(m11), _tx(tx), _ty(ty) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Affine2D Affine2D::translation(const Vector2 & offset) {
+	return Affine2D(1.f, 0.f, 0.f, 1.f, offset._x, offset._y);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Affine2D Affine2D::rotation(const Vector2 & center, float angle) {
+	const float c = cos(angle);
+	const float s = sin(angle);
+	return Affine2D(c, -s, s, c, center._x - (c * center._x - s * center._y),
+		center._y - (s * center._x + c * center._y));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Affine2D Affine2D::scale(const Vector2 & center, float factor) {
+	return Affine2D(factor, 0.f, 0.f, factor, center._x * (1.f - factor), center._y * (1.f - factor));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Affine2D Affine2D::operator*(const Affine2D & xform) const {
+	return Affine2D(_m00 * xform._m00 + _m01 * xform._m10, _m00 * xform._m01 + _m01 * xform._m11,
+		_m10 * xform._m00 + _m11 * xform._m10, _m10 * xform._m01 + _m11 * xform._m11,
+		_m00 * xform._tx + _m01 * xform._ty + _tx, _m10 * xform._tx + _m11 * xform._ty + _ty);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Vector2 Affine2D::apply(const Vector2 & p) const {
+	return Vector2(_m00 * p._x + _m01 * p._y + _tx, _m10 * p._x + _m11 * p._y + _ty);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,144 @@
+/*!
+ *	@file		BatchOps.h
+ *	@brief		Operations which transform contiguous arrays of vertices in bulk.
+ */
+
+#ifndef __BATCH_OPS_H__
+#define	__BATCH_OPS_H__
+
+#include <cstddef>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+/*!
+ *	@brief		An affine transformation of the x-y plane: p' = M * p + t.
+ */
+class Affine2D {
+public:
+	/*!
+	 *	@brief		Constructor -- the identity transformation.
+	 */
+	Affine2D();
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		m00		The upper-left entry of the matrix M.
+	 *	@param		m01		The upper-right entry of the matrix M.
+	 *	@param		m10		The lower-left entry of the matrix M.
+	 *	@param		m11		The lower-right entry of the matrix M.
+	 *	@param		tx		The x-component of the translation t.
+	 *	@param		ty		The y-component of the translation t.
+	 */
+	Affine2D(float m00, float m01, float m10, float m11, float tx, float ty);
+
+	/*!
+	 *	@brief		Creates a translation.
+	 *
+	 *	@param		offset		The translation.
+	 *	@returns	The transformation.
+	 */
+	static Affine2D translation(const Vector2 & offset);
+
+	/*!
+	 *	@brief		Creates a counter-clockwise rotation around a point.
+	 *
+	 *	@param		center		The center of rotation.
+	 *	@param		angle		The angle of rotation (in radians).
+	 *	@returns	The transformation.
+	 */
+	static Affine2D rotation(const Vector2 & center, float angle);
+
+	/*!
+	 *	@brief		Creates a uniform scale around a point.
+	 *
+	 *	@param		center		The center of scaling.
+	 *	@param		factor		The scale factor.
+	 *	@returns	The transformation.
+	 */
+	static Affine2D scale(const Vector2 & center, float factor);
+
+	/*!
+	 *	@brief		Composes two transformations.
+	 *
+	 *	@param		xform		The transformation applied *before* this one.
+	 *	@returns	The transformation equivalent to applying xform then this.
+	 */
+	Affine2D operator*(const Affine2D & xform) const;
+
+	/*!
+	 *	@brief		Transforms a single point.
+	 *
+	 *	@param		p		The point to transform.
+	 *	@returns	The transformed point.
+	 */
+	Vector2 apply(const Vector2 & p) const;
+
+	/*!
+	 *	@brief		Reports the determinant of the matrix; a negative determinant
+	 *				indicates the transformation reverses polygon winding.
+	 */
+	float determinant() const { return _m00 * _m11 - _m01 * _m10; }
+
+	/*!
+	 *	@brief		The upper-left entry of the matrix.
+	 */
+	float	_m00;
+
+	/*!
+	 *	@brief		The upper-right entry of the matrix.
+	 */
+	float	_m01;
+
+	/*!
+	 *	@brief		The lower-left entry of the matrix.
+	 */
+	float	_m10;
+
+	/*!
+	 *	@brief		The lower-right entry of the matrix.
+	 */
+	float	_m11;
+
+	/*!
+	 *	@brief		The x-component of the translation.
+	 */
+	float	_tx;
+
+	/*!
+	 *	@brief		The y-component of the translation.
+	 */
+	float	_ty;
+};
+
+/*!
+ *	@brief		Applies the transformation to the x- and y-components of an array of
+ *				vertices (z is preserved).
+ *
+ *	The array is processed four vertices at a time with SSE2 (when available).
+ *
+ *	@param		points		The vertices to transform.
+ *	@param		count		The number of vertices.
+ *	@param		xform		The transformation.
+ */
+void transformPoints(Vector3 * points, size_t count, const Affine2D & xform);
+
+/*!
+ *	@brief		Snaps the x- and/or y-components of an array of vertices to the nearest
+ *				lines of a regular grid (z is preserved).
+ *
+ *	The array is processed four vertices at a time with SSE2 (when available).  The
+ *	results are identical to snapping each vertex individually (halfway values round
+ *	away from the origin).
+ *
+ *	@param		points		The vertices to snap.
+ *	@param		count		The number of vertices.
+ *	@param		origin		A point through which grid lines pass.
+ *	@param		cellSize	The distance between grid lines.  Must be positive.
+ *	@param		snapX		If true, the x-components are snapped.
+ *	@param		snapY		If true, the y-components are snapped.
+ */
+void snapPoints(Vector3 * points, size_t count, const Vector2 & origin, float cellSize, bool snapX, bool snapY);
+
+#endif	// __BATCH_OPS_H__
@@ -1,5 +1,27 @@
 #include "ContextManager.hpp"
-#include "QtContext.h"
+#include "EventBus.hpp"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Orders contexts by decreasing priority.
+ */
+inline bool higherPriority(const QtContext * a, const QtContext * b) {
+	return a->getPriority() > b->getPriority();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Orders contexts by increasing draw layer.
+ */
+inline bool lowerLayer(const QtContext * a, const QtContext * b) {
+	return a->getDrawLayer() < b->getDrawLayer();
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                    Implementation of ContextManager
@@ -10,7 +32,7 @@ size_t ContextManager::_nextId = 1;
 
 ///////////////////////////////////////////////////////////////////////////////
 
-ContextManager::ContextManager() : _active(0x0), _idToContext(), _contextToId() {
+ContextManager::ContextManager() : _active(0x0), _overlays(), _handlers(), _drawOrder(), _idToContext(), _contextToId() {
 
 }
 
@@ -57,34 +79,104 @@ void ContextManager::unregisterContext(QtContext * ctx) {
 	if (itr != _contextToId.end()) {
 		_idToContext.erase(itr->second);
 		_contextToId.erase(itr);
+		EventBus * bus = EventBus::instance();
+		if (_active == ctx) {
+			_active = 0x0;
+			updateOrders();
+			bus->send(Event(CONTEXT_DEACTIVATED, ctx));
+			bus->send(Event(CONTEXT_STACK_CHANGED, ctx));
+		}
+		else {
+			std::vector<QtContext *>::iterator overlay = std::find(_overlays.begin(), _overlays.end(), ctx);
+			if (overlay != _overlays.end()) {
+				_overlays.erase(overlay);
+				updateOrders();
+				bus->send(Event(CONTEXT_STACK_CHANGED, ctx));
+			}
+		}
+		bus->send(Event(CONTEXT_UNREGISTERED, ctx));
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 size_t ContextManager::activate(QtContext * ctx) {
-	if (_active != 0x0) {
-		size_t id = _contextToId[_active];
-		_active->deactivate();
-		emit deactivated(id);
-		_active = 0x0;
-	}
 	size_t id = 0;
 	if (ctx != 0x0) {
 		std::unordered_map<QtContext *, size_t>::iterator itr = _contextToId.find(ctx);
-		if (itr == _contextToId.end()) {
-			return 0;
+		if (itr != _contextToId.end()) {
+			id = itr->second;
 		}
-		id = itr->second;
-		_active = ctx;
+	}
+	// An overlay can't also be the active context.
+	if (id != 0 && std::find(_overlays.begin(), _overlays.end(), ctx) != _overlays.end()) {
+		id = 0;
+	}
+	QtContext * prev = _active;
+	if (prev != 0x0) {
+		prev->deactivate();
+	}
+	_active = id != 0 ? ctx : 0x0;
+	if (_active != 0x0) {
 		_active->activate();
-		emit activated(id);
+	}
+	updateOrders();
+	EventBus * bus = EventBus::instance();
+	if (prev != 0x0) {
+		bus->send(Event(CONTEXT_DEACTIVATED, prev));
+	}
+	if (_active != 0x0) {
+		bus->send(Event(CONTEXT_ACTIVATED, _active));
+	}
+	if (prev != 0x0 || _active != 0x0) {
+		bus->send(Event(CONTEXT_STACK_CHANGED, _active != 0x0 ? _active : prev));
 	}
 	return id;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool ContextManager::push(QtContext * ctx) {
+	if (ctx == 0x0 || ctx == _active || _contextToId.find(ctx) == _contextToId.end()) return false;
+	if (std::find(_overlays.begin(), _overlays.end(), ctx) != _overlays.end()) return false;
+	_overlays.push_back(ctx);
+	ctx->activate();
+	updateOrders();
+	EventBus::instance()->send(Event(CONTEXT_STACK_CHANGED, ctx));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ContextManager::pop(QtContext * ctx) {
+	std::vector<QtContext *>::iterator itr = std::find(_overlays.begin(), _overlays.end(), ctx);
+	if (itr == _overlays.end()) return false;
+	_overlays.erase(itr);
+	ctx->deactivate();
+	updateOrders();
+	EventBus::instance()->send(Event(CONTEXT_STACK_CHANGED, ctx));
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
+void ContextManager::updateOrders() {
+	// The stack, from the bottom up.
+	_drawOrder.clear();
+	if (_active != 0x0) _drawOrder.push_back(_active);
+	_drawOrder.insert(_drawOrder.end(), _overlays.begin(), _overlays.end());
+
+	// Input goes to the top of the stack first.
+	std::vector<QtContext *> dispatch(_drawOrder.rbegin(), _drawOrder.rend());
+	std::stable_sort(dispatch.begin(), dispatch.end(), higherPriority);
+	for (int t = 0; t < QtContext::INPUT_TYPE_COUNT; ++t) {
+		const unsigned int bit = QtContext::inputBit(QtContext::InputType(t));
+		_handlers[t].clear();
+		for (size_t i = 0; i < dispatch.size(); ++i) {
+			if ((dispatch[i]->getInputMask() & bit) != 0) _handlers[t].push_back(dispatch[i]);
+		}
+	}
+	std::stable_sort(_drawOrder.begin(), _drawOrder.end(), lowerLayer);
+}
 
+///////////////////////////////////////////////////////////////////////////////
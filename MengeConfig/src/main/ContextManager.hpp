@@ -1,20 +1,31 @@
 /*!
  *	@file		ContextManager.hpp
  *	@brief		This manages all contexts and serves as the single point
- *				through which contexts are accessed/activated/etc.
+ *				through which contexts are accessed/activated/etc.  Changes are
+ *				announced through the EventBus.
  */
 
 
 #ifndef __CONTEXT_MANAGER_H__
 #define	__CONTEXT_MANAGER_H__
 
+#include "QtContext.h"
+
 #include <QtCore/qobject.h>
 
 #include <unordered_map>
+#include <vector>
 
-// forward declarations
-class QtContext;
-
+/*!
+ *	@brief		The registry of contexts and the stack of running contexts.
+ *
+ *	The stack holds the active context (the tool, at the bottom) and any number of
+ *	overlay contexts pushed over it.  Input is offered to the contexts on the stack in
+ *	order of decreasing priority (among equal priorities, the most recently pushed first)
+ *	until one handles it, and the contexts are drawn in order of their draw layers.  The
+ *	orders are computed when the stack changes, separately for each input type, so a
+ *	context is never offered an input type it doesn't handle.
+ */
 class ContextManager : public QObject {
 	Q_OBJECT
 
@@ -46,7 +57,10 @@ public:
 	size_t registerContext(QtContext * ctx);
 
 	/*!
-	 *	@brief		Unregisters the given context to the manager.
+	 *	@brief		Unregisters the given context to the manager.  If the context is on
+	 *				the stack it is removed (it is not deactivated; it is assumed to be in
+	 *				the process of being destroyed).  Subscribers
+	 *				to CONTEXT_UNREGISTERED can still access the context.
 	 *
 	 *	@param		ctx		A pointer to the context to remove.
 	 */
@@ -63,21 +77,44 @@ public:
 	 */
 	size_t activate(QtContext * ctx);
 
-signals:
+	/*!
+	 *	@brief		Reports the active context.
+	 *
+	 *	@returns	A pointer to the active context, or null if no context is active.
+	 */
+	QtContext * getActive() const { return _active; }
+
+	/*!
+	 *	@brief		Pushes an overlay context onto the stack; it runs alongside the active
+	 *				context until it is popped.
+	 *
+	 *	@param		ctx		The (registered) context to push.  Pushing a context which is
+	 *						already on the stack has no effect.
+	 *	@returns	True if the context was pushed.
+	 */
+	bool push(QtContext * ctx);
+
+	/*!
+	 *	@brief		Removes an overlay context from the stack.
+	 *
+	 *	@param		ctx		The context to remove.
+	 *	@returns	True if the context was on the stack.
+	 */
+	bool pop(QtContext * ctx);
 
 	/*!
-	 *	@brief		Emits a signal when a context gets activated.
+	 *	@brief		Reports the contexts which handle a type of input, in the order in
+	 *				which the input is offered to them.
 	 *
-	 *	@param		ctxId		The identifier of the activated context.
+	 *	@param		type		The input type.
+	 *	@returns	The contexts.
 	 */
-	void activated(size_t ctxId);
+	const std::vector<QtContext *> & getHandlers(QtContext::InputType type) const { return _handlers[type]; }
 
 	/*!
-	*	@brief		Emits a signal when a context gets deactivated.
-	*
-	*	@param		ctxId		The identifier of the deactivated context.
-	*/
-	void deactivated(size_t ctxId);
+	 *	@brief		Reports the contexts on the stack, in the order in which they are drawn.
+	 */
+	const std::vector<QtContext *> & getDrawOrder() const { return _drawOrder; }
 
 private:
 	/*!
@@ -85,6 +122,11 @@ private:
 	 */
 	ContextManager();
 
+	/*!
+	 *	@brief		Recomputes the dispatch and draw orders after the stack has changed.
+	 */
+	void updateOrders();
+
 	/// The singleton instance
 	static ContextManager * _instance;
 
@@ -94,6 +136,15 @@ private:
 	/// The active context
 	QtContext * _active;
 
+	/// The overlay contexts, in the order they were pushed.
+	std::vector<QtContext *>	_overlays;
+
+	/// The contexts handling each input type, in dispatch order.
+	std::vector<QtContext *>	_handlers[QtContext::INPUT_TYPE_COUNT];
+
+	/// The contexts on the stack, in draw order.
+	std::vector<QtContext *>	_drawOrder;
+
 	/// Maps a context identifier to its context.
 	std::unordered_map<size_t, QtContext *>	_idToContext;
 	
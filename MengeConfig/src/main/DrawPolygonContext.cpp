@@ -20,6 +20,7 @@ using namespace Menge::Math;
 
 DrawPolygonContext::DrawPolygonContext() : QtContext(), _state(WAITING), _polygon(0x0), _dragging(false), _newPolyCB(0x0) {
 	_widget = new DrawPolygonWidget(this);
+	setContextWidget(_widget);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -74,6 +75,7 @@ Menge::SceneGraph::ContextResult DrawPolygonContext::handleMouse(QMouseEvent * e
 					Vector2 v;
 					view->getWorldPos(evt->pos(), v);
 					_polygon->_vertices[_polygon->_vertices.size() - 1] = Vector3(v.x(), v.y(), 0.f);
+					_polygon->invalidateCache();
 					result.set(true, true);
 				}
 			}
@@ -117,12 +119,6 @@ Menge::SceneGraph::ContextResult DrawPolygonContext::handleKeyboard(QKeyEvent *
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-QWidget * DrawPolygonContext::getContextWidget() {
-	return _widget;
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////
-
 bool DrawPolygonContext::reverseWinding() {
 	bool changed = false;
 	if (_polygon && _polygon->_vertices.size() > 1 ) {
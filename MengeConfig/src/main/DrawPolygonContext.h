@@ -75,16 +75,6 @@ public:
 	 */
 	virtual Menge::SceneGraph::ContextResult handleKeyboard(QKeyEvent * evt, GLWidget * view);
 
-	/*!
-	*	@brief		Returns the control widget associated with this context.
-	*
-	*				The main application can choose to populate a tool window with this widget.  It contains
-	*				buttons and settings to interact with or change state in the context.
-	*
-	*	@returns	A pointer to the tool widget for this context.
-	*/
-	virtual QWidget * getContextWidget();
-
 	/*!
 	 *	@brief		Give the context the opportunity to respond to a mouse wheel
 	 *				event.
@@ -126,6 +116,11 @@ public:
 	 */
 	bool deleteActive();
 
+	/*!
+	 *	@brief		Reports if a polygon is being drawn.
+	 */
+	bool isDrawing() const { return _state == DRAWING; }
+
 	/*!
 	 *	@brief		Registers the callback functor to the context.
 	 *
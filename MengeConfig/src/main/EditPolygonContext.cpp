@@ -5,19 +5,44 @@
 #include "LiveObstacleSet.h"
 #include "GLPolygon.h"
 #include "glwidget.hpp"
+#include "ReferenceGrid.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtGui/QCursor>
 
 #include <Math/vector.h>
 using namespace Menge::Math;
 
+#include <algorithm>
 #include <cassert>
+#include <math.h>
 #include <gl/GL.h>
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //						Implementation of EditPolygonContext
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-EditPolygonContext::EditPolygonContext(LiveObstacleSet * polygons) : QtContext(), _obstacleSet(polygons), _activePoly(0x0), _activeVert(), _dragging(false), _mode(VERTEX) {
+/*!
+ *	@brief		The distance (in pixels) from the mouse within which an element can be selected.
+ */
+const int PICK_RADIUS = 15;
+
+/*!
+ *	@brief		The minimum distance (in pixels) between consecutive samples of a lasso.
+ */
+const int LASSO_SPACING = 4;
+
+/*!
+ *	@brief		The minimum size (in pixels) of a selection rectangle; smaller rectangles
+ *				are treated as clicks.
+ */
+const int MIN_BOX_SIZE = 3;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+EditPolygonContext::EditPolygonContext(LiveObstacleSet * polygons) : QtContext(), _obstacleSet(polygons), _activePoly(0x0), _activeVert(), _dragging(false), _mode(VERTEX), _selection(), _gesture(NO_GESTURE), _screenRegion(), _worldRegion() {
 	_widget = new EditPolygonWidget(this);
+	setContextWidget(_widget);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -30,16 +55,35 @@ EditPolygonContext::~EditPolygonContext() {
 
 Menge::SceneGraph::ContextResult EditPolygonContext::handleMouse(QMouseEvent * evt, GLWidget * view) {
 	Menge::SceneGraph::ContextResult result = QtContext::handleMouse(evt, view);
+	if (!result.isHandled() && _gesture != NO_GESTURE) {
+		result = handleGesture(evt, view);
+	}
 	if (!result.isHandled()) {
 		Qt::KeyboardModifiers mods = evt->modifiers();
-		if (mods == Qt::NoModifier) {
+		if (mods == Qt::AltModifier && evt->type() == QEvent::MouseButtonPress &&
+			evt->button() == Qt::LeftButton) {
+			_selection.clear();
+			_gesture = LASSO_SELECT;
+			_screenRegion.assign(1, evt->pos());
+			_worldRegion.clear();
+			Vector2 world;
+			if (view->getWorldPos(evt->pos(), world, true)) _worldRegion.push_back(world);
+			result.set(true, true);
+		}
+		else if (mods == Qt::NoModifier) {
 			Vector2 world;
 			view->getWorldPos(evt->pos(), world, true);
-			float worldDist = view->getWorldScale(15);	// 15 pixel minimum distance to be selectable
 
 			if (evt->type() == QEvent::MouseButtonPress) {
 				if (evt->button() == Qt::LeftButton) {
 					_downPos.set(world);
+					if (!_selection.isEmpty() && isActiveSelected()) {
+						// The element belongs to the selection; the whole selection moves.
+						beginTransform(DRAG_SELECTION, evt->pos(), view);
+						result.set(true, true);
+						return result;
+					}
+					_selection.clear();
 					if (_activePoly) {
 						_downOrigin.set(_activePoly->_vertices[0].x(), _activePoly->_vertices[0].y());
 						_polyVertices.resize(_activePoly->_vertices.size());
@@ -55,8 +99,12 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleMouse(QMouseEvent * e
 						_edgeOffset.set(_activeEdge._v1->x() - _activeEdge._v0->x(),
 							_activeEdge._v1->y() - _activeEdge._v0->y());
 						_dragging = true;
+					} else {
+						// Nothing under the mouse -- start a selection rectangle.
+						_gesture = BOX_SELECT;
+						_screenRegion.assign(2, evt->pos());
 					}
-					result.setHandled(true);
+					result.set(true, true);
 				}
 				else if (evt->button() == Qt::RightButton && _dragging) {
 					if (_activeVert.isValid()) {
@@ -64,6 +112,7 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleMouse(QMouseEvent * e
 							// inserted a vertex -- cancellation requires removal
 							_obstacleSet->removeVertex(_activeVert);
 							_activeVert.clear();
+							_selection.clear();
 						} else {
 							// assume vertex edit mode -- simply reposition the vertex
 							_activeVert.set(_downOrigin.x(), _downOrigin.y(), _activeVert.z());
@@ -79,27 +128,39 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleMouse(QMouseEvent * e
 								_downOrigin.y() + _polyVertices[i].y(), 
 								_activePoly->_vertices[i].z());
 						}
+						_activePoly->invalidateCache();
 					}
 					_dragging = false;
+					view->invalidatePick();
 					result.set(true, true);
 				}
 				else if (evt->button() == Qt::MiddleButton && _activeEdge.isValid()) {
 					_activeVert = _obstacleSet->insertVertex(world, _activeEdge);
+					_selection.clear();
 					_downPos.set(world);
 					_downOrigin.set(world.x(), world.y());
 					_activeEdge.clear();
 					_dragging = true;
+					view->invalidatePick();
 					result.set(true, true);
 				}
 			} 
 			else if (evt->type() == QEvent::MouseButtonRelease) {
 				if (evt->button() == Qt::LeftButton || evt->button() == Qt::MiddleButton) {
+					if (_dragging) {
+						view->invalidatePick();
+						if (_activePoly) _obstacleSet->markDirty(_activePoly);
+						_obstacleSet->markDirty(_activeVert);
+						_obstacleSet->markDirty(_activeEdge);
+					}
 					_dragging = false;
 				}
 			}
 			else if (evt->type() == QEvent::MouseMove) {
 				if (_dragging) {
-					if (_activeVert.isValid()) world = view->snap(world);
+					// The dragged vertex's own polygon is left out for the whole drag; the index
+					//	still holds its edges from before the drag, which would hold it in place.
+					if (_activeVert.isValid()) world = view->snap(world, _activeVert._poly->getId());
 					Vector2 newPos(_downOrigin + (world - _downPos));
 					
 					if (_activeVert.isValid()) {
@@ -116,25 +177,26 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleMouse(QMouseEvent * e
 								newPos.y() + _polyVertices[i].y(), 
 								_activePoly->_vertices[i].z());
 						}
+						_activePoly->invalidateCache();
 					}
 					result.set(true, true);
 				}
 				else if (_mode == VERTEX) {
-					SelectVertex v = _obstacleSet->nearestVertex(world, worldDist);
+					SelectVertex v = _obstacleSet->getPickedVertex(view->pick(evt->pos(), PICK_RADIUS));
 					result.set(true, v != _activeVert);
 					_activeVert = v;
 					_activeEdge.clear();
 					_activePoly = 0x0;
 				}
 				else if (_mode == POLY) {
-					GLPolygon * poly = _obstacleSet->nearestPolygon(world, worldDist);
+					GLPolygon * poly = _obstacleSet->getPickedPolygon(view->pick(evt->pos(), PICK_RADIUS));
 					result.set(true, poly != _activePoly);
 					_activePoly = poly;
 					_activeVert.clear();
 					_activeEdge.clear();
 				}
 				else if (_mode == EDGE) {
-					SelectEdge e = _obstacleSet->nearestEdge(world, worldDist);
+					SelectEdge e = _obstacleSet->getPickedEdge(view->pick(evt->pos(), PICK_RADIUS));
 					result.set(true, e != _activeEdge);
 					_activeEdge = e;
 					_activeVert.clear();
@@ -151,6 +213,18 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleMouse(QMouseEvent * e
 Menge::SceneGraph::ContextResult EditPolygonContext::handleKeyboard(QKeyEvent * evt, GLWidget * view) {
 	Menge::SceneGraph::ContextResult result = QtContext::handleKeyboard(evt, view);
 
+	if (!result.isHandled() && _gesture != NO_GESTURE) {
+		// Nothing may change the geometry while a gesture is in progress.
+		if (evt->type() == QEvent::KeyPress && evt->key() == Qt::Key_Escape) {
+			endGesture(false, view);
+			result.set(true, true);
+		}
+		else {
+			result.setHandled(true);
+		}
+		return result;
+	}
+
 	if (!result.isHandled()) {
 		Qt::KeyboardModifiers mods = evt->modifiers();
 		bool noMods = mods == Qt::NoModifier;
@@ -164,13 +238,65 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleKeyboard(QKeyEvent *
 				
 			}
 			else if (noMods && evt->key() == Qt::Key_P) {
-				result.set(true, setState(_mode = POLY));
+				result.set(true, setState(POLY));
 			}
 			else if (noMods && evt->key() == Qt::Key_R && _activePoly) {
 				_activePoly->reverseWinding();
+				_obstacleSet->markDirty(_activePoly);
+				_selection.clear();
+				result.set(true, true);
+			}
+			else if (noMods && evt->key() == Qt::Key_T) {
+				result.set(true, beginTransform(MOVE_SELECTION, view->mapFromGlobal(QCursor::pos()), view));
+			}
+			else if (noMods && evt->key() == Qt::Key_O) {
+				result.set(true, beginTransform(ROTATE_SELECTION, view->mapFromGlobal(QCursor::pos()), view));
+			}
+			else if (noMods && evt->key() == Qt::Key_S) {
+				result.set(true, beginTransform(SCALE_SELECTION, view->mapFromGlobal(QCursor::pos()), view));
+			}
+			else if (noMods && evt->key() == Qt::Key_G) {
+				const ReferenceGrid * grid = view->getReferenceGrid();
+				if (grid != 0x0) {
+					QElapsedTimer timer;
+					timer.start();
+					size_t count = _obstacleSet->snapAll(*grid);
+					AppLogger::logStream << AppLogger::INFO_MSG << "Snapped " << count;
+					AppLogger::logStream << " vertices to the reference grid in " << timer.elapsed();
+					AppLogger::logStream << " ms" << AppLogger::END_MSG;
+					result.set(true, true);
+				}
+			}
+			else if (noMods && evt->key() == Qt::Key_Escape && !_selection.isEmpty()) {
+				_selection.clear();
 				result.set(true, true);
 			}
+			else if (noMods && evt->key() == Qt::Key_Delete && !_selection.isEmpty()) {
+				// Deletes the polygons which are entirely selected (a whole polygon is a single run).
+				std::vector<GLPolygon *> polys;
+				for (const SelectionSet::Range & r : _selection.getRanges()) {
+					if (r._begin == 0 && r._end == r._poly->getVertexCount()) {
+						polys.push_back(r._poly);
+					}
+				}
+				std::sort(polys.begin(), polys.end());
+				polys.erase(std::unique(polys.begin(), polys.end()), polys.end());
+				if (!polys.empty()) {
+					QElapsedTimer timer;
+					timer.start();
+					_selection.clear();
+					_activePoly = 0x0;
+					_activeVert.clear();
+					_activeEdge.clear();
+					size_t count = _obstacleSet->removePolygons(polys);
+					AppLogger::logStream << AppLogger::INFO_MSG << "Deleted " << count;
+					AppLogger::logStream << " obstacles in " << timer.elapsed() << " ms" << AppLogger::END_MSG;
+					result.set(true, true);
+				}
+			}
 			else if (noMods && evt->key() == Qt::Key_C) {
+				// Removing elements changes the vertex indices the selection refers to.
+				_selection.clear();
 				if (_activePoly) {
 					_obstacleSet->removePolygon(_activePoly);
 					_activePoly = 0x0;
@@ -189,6 +315,10 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleKeyboard(QKeyEvent *
 			}
 		}
 	}
+	if (result.needsRedraw()) {
+		// Every keyboard operation changes the geometry or the selectable elements.
+		view->invalidatePick();
+	}
 	if (!result.isHandled()) {
 		// The key event is accepted by default -- ignore must be called explicitly to pass it up.
 		//	http://doc.qt.io/qt-5/qkeyevent.html#details
@@ -199,12 +329,6 @@ Menge::SceneGraph::ContextResult EditPolygonContext::handleKeyboard(QKeyEvent *
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-QWidget * EditPolygonContext::getContextWidget() {
-	return _widget;
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////
-
 void EditPolygonContext::activate() {
 
 }
@@ -212,7 +336,12 @@ void EditPolygonContext::activate() {
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void EditPolygonContext::deactivate() {
-
+	if (_gesture != NO_GESTURE && _gesture != BOX_SELECT && _gesture != LASSO_SELECT) {
+		_selection.cancelTransform();
+	}
+	_gesture = NO_GESTURE;
+	_screenRegion.clear();
+	_worldRegion.clear();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -231,7 +360,49 @@ bool EditPolygonContext::setState(EditMode mode) {
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+void EditPolygonContext::reset() {
+	_dragging = false;
+	_activePoly = 0x0;
+	_activeVert.clear();
+	_activeEdge.clear();
+	// The selected polygons may no longer exist; the selection can't be transformed back.
+	_selection.clear();
+	_gesture = NO_GESTURE;
+	_screenRegion.clear();
+	_worldRegion.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void EditPolygonContext::releaseEdited(const GeometryEdits & edits) {
+	std::vector<size_t> ids(edits._removed);
+	for (const PolygonRecordPtr & record : edits._replaced) {
+		ids.push_back(record->_id);
+	}
+	const std::vector<SelectionSet::Range> & ranges = _selection.getRanges();
+	for (size_t id : ids) {
+		const GLPolygon * poly = _obstacleSet->findPolygon(id);
+		if (poly == 0x0) continue;
+		bool used = poly == _activePoly || poly == _activeVert._poly || poly == _activeEdge._poly;
+		for (size_t r = 0; !used && r < ranges.size(); ++r) {
+			used = ranges[r]._poly == poly;
+		}
+		if (used) {
+			reset();
+			return;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 void EditPolygonContext::draw3DGL(bool select) {
+	if (select) {
+		_obstacleSet->drawSelectGL(getElementType());
+		return;
+	}
+	_selection.drawGL();
+
 	glPushAttrib(GL_LINE_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_DEPTH_TEST);
@@ -291,9 +462,189 @@ void EditPolygonContext::draw3DGL(bool select) {
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+void EditPolygonContext::drawUIGL(int vWidth, int vHeight, bool select) {
+	if (select || _screenRegion.size() < 2) return;
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, vWidth, 0.0, vHeight, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glPushAttrib(GL_LINE_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_LINE_STIPPLE);
+	glLineStipple(1, 0xF0F0);
+	glLineWidth(1.f);
+	glColor3f(1.f, 0.9f, 0.f);
+	// Screen space has y pointing down; the viewport has y pointing up.
+	glBegin(GL_LINE_LOOP);
+	if (_gesture == BOX_SELECT) {
+		const QPoint & a = _screenRegion[0];
+		const QPoint & b = _screenRegion[1];
+		glVertex2i(a.x(), vHeight - a.y());
+		glVertex2i(b.x(), vHeight - a.y());
+		glVertex2i(b.x(), vHeight - b.y());
+		glVertex2i(a.x(), vHeight - b.y());
+	}
+	else {
+		for (const QPoint & p : _screenRegion) {
+			glVertex2i(p.x(), vHeight - p.y());
+		}
+	}
+	glEnd();
+	glPopAttrib();
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 void EditPolygonContext::setEditMode(EditMode mode) {
 
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+PickBuffer::ElementType EditPolygonContext::getElementType() const {
+	switch (_mode) {
+	case VERTEX:
+		return PickBuffer::VERTEX_ELEMENT;
+	case EDGE:
+		return PickBuffer::EDGE_ELEMENT;
+	case POLY:
+		return PickBuffer::POLYGON_ELEMENT;
+	default:
+		return PickBuffer::NO_ELEMENT;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool EditPolygonContext::isActiveSelected() const {
+	if (_activeVert.isValid()) return _selection.contains(_activeVert);
+	if (_activeEdge.isValid()) return _selection.contains(_activeEdge);
+	if (_activePoly) return _selection.contains(_activePoly);
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+Menge::SceneGraph::ContextResult EditPolygonContext::handleGesture(QMouseEvent * evt, GLWidget * view) {
+	Menge::SceneGraph::ContextResult result(false, false);
+	const bool modal = _gesture == MOVE_SELECTION || _gesture == ROTATE_SELECTION ||
+					   _gesture == SCALE_SELECTION;
+	if (evt->type() == QEvent::MouseMove) {
+		if (_gesture == BOX_SELECT) {
+			_screenRegion[1] = evt->pos();
+		}
+		else if (_gesture == LASSO_SELECT) {
+			if ((evt->pos() - _screenRegion.back()).manhattanLength() >= LASSO_SPACING) {
+				_screenRegion.push_back(evt->pos());
+				Vector2 world;
+				if (view->getWorldPos(evt->pos(), world, true)) _worldRegion.push_back(world);
+			}
+		}
+		else {
+			Vector2 world;
+			if (view->getWorldPos(evt->pos(), world, true)) {
+				if (_gesture == ROTATE_SELECTION) {
+					Vector2 from(_downPos - _pivot);
+					Vector2 to(world - _pivot);
+					_selection.rotate(_pivot, atan2(det(from, to), from * to));
+				}
+				else if (_gesture == SCALE_SELECTION) {
+					float dist = abs(_downPos - _pivot);
+					if (dist > 1e-5f) _selection.scale(_pivot, abs(world - _pivot) / dist);
+				}
+				else {
+					_selection.translate(world - _downPos);
+				}
+			}
+		}
+		result.set(true, true);
+	}
+	else if (evt->type() == QEvent::MouseButtonPress) {
+		if (evt->button() == Qt::RightButton) {
+			endGesture(false, view);
+		}
+		else if (evt->button() == Qt::LeftButton && modal) {
+			endGesture(true, view);
+		}
+		result.set(true, true);
+	}
+	else if (evt->type() == QEvent::MouseButtonRelease) {
+		if (evt->button() == Qt::LeftButton && !modal) {
+			endGesture(true, view);
+		}
+		result.set(true, true);
+	}
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool EditPolygonContext::beginTransform(Gesture gesture, const QPoint & screenPos, GLWidget * view) {
+	if (_selection.isEmpty() || _gesture != NO_GESTURE) return false;
+	Vector2 world;
+	if (!view->getWorldPos(screenPos, world, true)) return false;
+	_downPos.set(world);
+	_pivot = _selection.getCenter();
+	_selection.beginTransform();
+	_gesture = gesture;
+	_dragging = false;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void EditPolygonContext::endGesture(bool accept, GLWidget * view) {
+	if (_gesture == BOX_SELECT || _gesture == LASSO_SELECT) {
+		if (accept) selectRegion(view);
+	}
+	else if (_gesture != NO_GESTURE) {
+		if (accept) {
+			_selection.endTransform();
+			_obstacleSet->markDirty(_selection);
+		}
+		else {
+			_selection.cancelTransform();
+		}
+		view->invalidatePick();
+	}
+	_gesture = NO_GESTURE;
+	_screenRegion.clear();
+	_worldRegion.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void EditPolygonContext::selectRegion(GLWidget * view) {
+	_selection.clear();
+	std::vector<Vector2> region;
+	if (_gesture == BOX_SELECT) {
+		const QPoint & a = _screenRegion[0];
+		const QPoint & b = _screenRegion[1];
+		if (qAbs(b.x() - a.x()) < MIN_BOX_SIZE || qAbs(b.y() - a.y()) < MIN_BOX_SIZE) return;
+		// The corners are projected individually; for oblique views the rectangle covers a
+		//	general quadrilateral on the ground plane.
+		const QPoint corners[4] = { a, QPoint(b.x(), a.y()), b, QPoint(a.x(), b.y()) };
+		for (int i = 0; i < 4; ++i) {
+			Vector2 world;
+			if (!view->getWorldPos(corners[i], world, true)) return;
+			region.push_back(world);
+		}
+	}
+	else {
+		region.swap(_worldRegion);
+	}
+	_obstacleSet->selectRegion(region, getElementType(), _selection);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
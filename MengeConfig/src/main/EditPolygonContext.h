@@ -9,6 +9,8 @@
 #include "QtCOntext.h"
 #include "LiveObstacleSet.h"
 #include "GLPolygon.h"
+#include "ObstacleSnapshot.h"
+#include "SelectionSet.h"
 
 class EditPolygonWidget;
 
@@ -27,6 +29,19 @@ class EditPolygonContext : public QtContext {
 		POLY			///< Editing polygons
 	};
 
+	/*!
+	 *	@brief		The gestures which operate on multiple elements.
+	 */
+	enum Gesture {
+		NO_GESTURE,			///< No gesture is in progress.
+		BOX_SELECT,			///< Dragging a selection rectangle.
+		LASSO_SELECT,		///< Drawing a selection lasso.
+		DRAG_SELECTION,		///< Dragging the selection while the mouse button is held.
+		MOVE_SELECTION,		///< Translating the selection with the mouse (until clicked).
+		ROTATE_SELECTION,	///< Rotating the selection around its center (until clicked).
+		SCALE_SELECTION		///< Scaling the selection around its center (until clicked).
+	};
+
 public:
 
 	/*!
@@ -63,16 +78,6 @@ public:
 	 */
 	virtual Menge::SceneGraph::ContextResult handleKeyboard(QKeyEvent * evt, GLWidget * view);
 
-	/*!
-	*	@brief		Returns the control widget associated with this context.
-	*
-	*				The main application can choose to populate a tool window with this widget.  It contains
-	*				buttons and settings to interact with or change state in the context.
-	*
-	*	@returns	A pointer to the tool widget for this context.
-	*/
-	virtual QWidget * getContextWidget();
-
 	/*!
 	 *	@brief		Called when the context is activated.
 	 */
@@ -91,6 +96,26 @@ public:
 	 */
 	bool setState(EditMode mode);
 
+	/*!
+	 *	@brief		Reports the mode of the context.
+	 */
+	EditMode getState() const { return _mode; }
+
+	/*!
+	 *	@brief		Abandons any edit in progress and forgets the active elements and the
+	 *				selection (e.g., because the contents of the obstacle set were replaced).
+	 */
+	void reset();
+
+	/*!
+	 *	@brief		Resets the context (see reset()) if the active elements or the selection
+	 *				belong to polygons the given edits replace or remove.  The edits change
+	 *				the polygons' vertex counts or destroy them, invalidating any reference
+	 *				to their vertices.
+	 *
+	 *	@param		edits		The edits about to be merged into the obstacle set.
+	 */
+	void releaseEdited(const GeometryEdits & edits);
 
 protected:
 
@@ -102,11 +127,70 @@ protected:
 	 */
 	virtual void draw3DGL(bool select = false);
 
+	/*!
+	 *	@brief		Draw context elements into the screen space.
+	 *
+	 *	@param		vWidth		The width of the viewport (in pixels).
+	 *	@param		vHeight		The height of the viewport (in pixels).
+	 *	@param		select		Defines if the drawing is being done for selection
+	 *							purposes (true) or visualization (false).
+	 */
+	virtual void drawUIGL(int vWidth, int vHeight, bool select = false);
+
 	/*!
 	 *	@brief		Sets the editing mode of the context.
 	 */
 	void setEditMode(EditMode mode);
 
+	/*!
+	 *	@brief		Reports the type of element edited in the current mode.
+	 */
+	PickBuffer::ElementType getElementType() const;
+
+	/*!
+	 *	@brief		Reports if the element under the mouse is part of the selection.
+	 */
+	bool isActiveSelected() const;
+
+	/*!
+	 *	@brief		Handles the mouse event while a multi-element gesture is in progress.
+	 *
+	 *	@param		e		The QT event with the mouse event data.
+	 *	@param		view	The view this context is interacting with.
+	 *	@returns	A ContextResult instance reporting if the event was handled and
+	 *				if redrawing is necessary.
+	 */
+	Menge::SceneGraph::ContextResult handleGesture(QMouseEvent * evt, GLWidget * view);
+
+	/*!
+	 *	@brief		Starts transforming the selection.
+	 *
+	 *	@param		gesture		The transformation gesture (one of DRAG_SELECTION,
+	 *							MOVE_SELECTION, ROTATE_SELECTION or SCALE_SELECTION).
+	 *	@param		screenPos	The position of the mouse when the gesture starts.
+	 *	@param		view		The view this context is interacting with.
+	 *	@returns	True if the gesture started, false otherwise (e.g., the selection is
+	 *				empty).
+	 */
+	bool beginTransform(Gesture gesture, const QPoint & screenPos, GLWidget * view);
+
+	/*!
+	 *	@brief		Ends the current gesture.  The geometry and selectable elements are
+	 *				updated once, regardless of the number of elements involved.
+	 *
+	 *	@param		accept		If true, the gesture is applied, if false, it is cancelled.
+	 *	@param		view		The view this context is interacting with.
+	 */
+	void endGesture(bool accept, GLWidget * view);
+
+	/*!
+	 *	@brief		Replaces the selection with the elements inside the region defined by
+	 *				the selection rectangle or lasso.
+	 *
+	 *	@param		view		The view this context is interacting with.
+	 */
+	void selectRegion(GLWidget * view);
+
 	/*!
 	 *	@brief		The set of polygons to edit.  The class does *not* own this obstacle set.
 	 */
@@ -158,6 +242,32 @@ protected:
 	 */
 	Vector2 _downOrigin;
 
+	/*!
+	 *	@brief		The selected elements.
+	 */
+	SelectionSet _selection;
+
+	/*!
+	 *	@brief		The multi-element gesture currently in progress.
+	 */
+	Gesture _gesture;
+
+	/*!
+	 *	@brief		The points defining the selection region in screen space.  For a
+	 *				rectangle, the two opposite corners, for a lasso, the sampled path.
+	 */
+	std::vector<QPoint> _screenRegion;
+
+	/*!
+	 *	@brief		The points of the lasso projected on the ground plane.
+	 */
+	std::vector<Vector2> _worldRegion;
+
+	/*!
+	 *	@brief		The center of rotation or scaling of the selection.
+	 */
+	Vector2 _pivot;
+
 	/*!
 	 *	@brief		The underlying widget for this context.
 	 */
@@ -0,0 +1,141 @@
+#include "EventBus.hpp"
+
+#include <QtCore/qtimer.h>
+
+#include <cassert>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of EventBus
+///////////////////////////////////////////////////////////////////////////////
+
+EventBus * EventBus::_instance = 0x0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+EventBus::EventBus() : QObject(), _subscriptions(), _pending(), _pendingMask(0), _scheduled(false), _delivering(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+EventBus * EventBus::instance() {
+	if (_instance == 0x0) {
+		_instance = new EventBus();
+	}
+	return _instance;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::subscribe(EventSubscriber * subscriber, unsigned int mask) {
+	assert(subscriber != 0x0 && "Subscribing a null subscriber");
+	for (size_t i = 0; i < _subscriptions.size(); ++i) {
+		if (_subscriptions[i]._subscriber == subscriber) {
+			_subscriptions[i]._mask = mask;
+			return;
+		}
+	}
+	Subscription sub = { subscriber, mask };
+	_subscriptions.push_back(sub);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::unsubscribe(EventSubscriber * subscriber) {
+	for (size_t i = 0; i < _subscriptions.size(); ++i) {
+		if (_subscriptions[i]._subscriber == subscriber) {
+			if (_delivering > 0) {
+				// The subscription is removed once the delivery is complete.
+				_subscriptions[i]._subscriber = 0x0;
+				_subscriptions[i]._mask = 0;
+			}
+			else {
+				_subscriptions.erase(_subscriptions.begin() + i);
+			}
+			return;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::post(const Event & evt) {
+	// A batch holds few distinct events (repeats are the common case); a linear search
+	//	is cheaper than hashing.
+	if ((_pendingMask & evt._type) != 0) {
+		for (size_t i = 0; i < _pending.size(); ++i) {
+			if (_pending[i]._type == evt._type && _pending[i]._source == evt._source) return;
+		}
+	}
+	_pending.push_back(evt);
+	_pendingMask |= evt._type;
+	if (!_scheduled) {
+		_scheduled = true;
+		QTimer::singleShot(0, this, &EventBus::flush);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::send(const Event & evt) {
+	flush();
+	deliver(std::vector<Event>(1, evt), evt._type);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::flush() {
+	_scheduled = false;
+	if (_pending.empty()) return;
+	std::vector<Event> events;
+	events.swap(_pending);
+	const unsigned int mask = _pendingMask;
+	_pendingMask = 0;
+	deliver(events, mask);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::withdraw(const void * source) {
+	size_t kept = 0;
+	_pendingMask = 0;
+	for (size_t i = 0; i < _pending.size(); ++i) {
+		if (_pending[i]._source != source) {
+			_pending[kept++] = _pending[i];
+			_pendingMask |= _pending[i]._type;
+		}
+	}
+	_pending.erase(_pending.begin() + kept, _pending.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EventBus::deliver(const std::vector<Event> & events, unsigned int mask) {
+	++_delivering;
+	std::vector<Event> selected;
+	// Subscriptions made during the delivery don't receive these events.
+	const size_t SUB_COUNT = _subscriptions.size();
+	for (size_t s = 0; s < SUB_COUNT; ++s) {
+		const unsigned int subMask = _subscriptions[s]._mask;
+		if ((subMask & mask) == 0) continue;
+		if ((subMask & mask) == mask) {
+			_subscriptions[s]._subscriber->handleEvents(events);
+		}
+		else {
+			selected.clear();
+			for (size_t e = 0; e < events.size(); ++e) {
+				if ((subMask & events[e]._type) != 0) selected.push_back(events[e]);
+			}
+			_subscriptions[s]._subscriber->handleEvents(selected);
+		}
+	}
+	--_delivering;
+	if (_delivering == 0) {
+		size_t live = 0;
+		for (size_t s = 0; s < _subscriptions.size(); ++s) {
+			if (_subscriptions[s]._subscriber != 0x0) _subscriptions[live++] = _subscriptions[s];
+		}
+		_subscriptions.resize(live);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
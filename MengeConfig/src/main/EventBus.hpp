@@ -0,0 +1,206 @@
+/*!
+ *	@file		EventBus.hpp
+ *	@brief		The publish/subscribe channel through which the application's views learn
+ *				of changes.
+ */
+
+#ifndef __EVENT_BUS_H__
+#define	__EVENT_BUS_H__
+
+#include <QtCore/qobject.h>
+
+#include <vector>
+
+// forward declarations
+class GLWidget;
+class LiveObstacleSet;
+class QtContext;
+class SelectionSet;
+
+/*!
+ *	@brief		The types of events; they are bit flags so a subscriber can select several.
+ */
+enum EventType {
+	CONTEXT_ACTIVATED = 0x1,		/// A context became the active context.
+	CONTEXT_DEACTIVATED = 0x2,		/// A context stopped being the active context.
+	CONTEXT_UNREGISTERED = 0x4,		/// A context is being destroyed.
+	CONTEXT_STACK_CHANGED = 0x8,	/// The stack of running contexts changed.
+	GEOMETRY_CHANGED = 0x10,		/// The obstacles of an obstacle set were edited.
+	SELECTION_CHANGED = 0x20,		/// The contents of a selection changed.
+	CAMERA_MOVED = 0x40,			/// The camera of a view moved.
+	CONTEXT_CHANGED = 0x80,			/// The drawing of a running context changed.
+	ALL_EVENTS = 0xFF				/// Every type of event.
+};
+
+/*!
+ *	@brief		An event: its type and the object it concerns.
+ */
+struct Event {
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		type		The event's type.
+	 *	@param		source		The object the event concerns (its type is determined by the
+	 *							event's type).
+	 */
+	Event(EventType type, void * source) : _type(type), _source(source) {}
+
+	/*!
+	 *	@brief		The event's type.
+	 */
+	EventType	_type;
+
+	/*!
+	 *	@brief		The object the event concerns; the member matching the event's type is
+	 *				the one to read.
+	 */
+	union {
+		/// The context of a CONTEXT_* event.
+		QtContext * _context;
+
+		/// The obstacle set of a GEOMETRY_CHANGED event.
+		LiveObstacleSet * _obstacles;
+
+		/// The selection of a SELECTION_CHANGED event.
+		SelectionSet * _selection;
+
+		/// The view of a CAMERA_MOVED event.
+		GLWidget * _view;
+
+		/// The object, regardless of its type.
+		void * _source;
+	};
+};
+
+/*!
+ *	@brief		The interface for objects which receive events from the EventBus.
+ */
+class EventSubscriber {
+public:
+	/*!
+	 *	@brief		Destructor.
+	 */
+	virtual ~EventSubscriber() {}
+
+	/*!
+	 *	@brief		Delivers a batch of events.  A batch contains each (type, source) pair at
+	 *				most once, in the order in which the pairs were first published.
+	 *
+	 *	@param		events		The events of the types the subscriber selected.
+	 */
+	virtual void handleEvents(const std::vector<Event> & events) = 0;
+};
+
+/*!
+ *	@brief		Distributes events to the subscribers which selected their types.
+ *
+ *	Most events are posted: they are collected and delivered together once control returns
+ *	to the event loop, i.e., once per input event and frame.  Repeats of an event in the
+ *	meantime are dropped, so a burst of edits costs each subscriber one update.  The events
+ *	which transfer responsibility for a context (activation, deactivation, changes to the
+ *	context stack and unregistration) are sent: they are delivered immediately (after any
+ *	posted events) because the context may not outlive the call.
+ *
+ *	Events carry their sources; a subscriber never needs to look them up.  The bus is only
+ *	used from the GUI thread.
+ */
+class EventBus : public QObject {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Retrieves the singleton member.
+	 *
+	 *	@returns	A pointer to the singleton instance.
+	 */
+	static EventBus * instance();
+
+	/*!
+	 *	@brief		Subscribes to events (or changes the events a subscriber receives).
+	 *
+	 *	@param		subscriber		The subscriber.  It must unsubscribe before it is
+	 *								destroyed.
+	 *	@param		mask			The bitwise union of the EventTypes to receive.
+	 */
+	void subscribe(EventSubscriber * subscriber, unsigned int mask);
+
+	/*!
+	 *	@brief		Stops delivering events to a subscriber.  It is safe to call while
+	 *				events are being delivered.
+	 *
+	 *	@param		subscriber		The subscriber.
+	 */
+	void unsubscribe(EventSubscriber * subscriber);
+
+	/*!
+	 *	@brief		Queues an event to be delivered with the current batch.
+	 *
+	 *	@param		evt			The event.
+	 */
+	void post(const Event & evt);
+
+	/*!
+	 *	@brief		Delivers the posted events and then the given event.
+	 *
+	 *	@param		evt			The event.
+	 */
+	void send(const Event & evt);
+
+	/*!
+	 *	@brief		Delivers the posted events.
+	 */
+	void flush();
+
+	/*!
+	 *	@brief		Discards the posted events concerning an object; it is called as the
+	 *				object is destroyed.
+	 *
+	 *	@param		source		The object.
+	 */
+	void withdraw(const void * source);
+
+private:
+	/*!
+	 *	@brief		Private construtor enables static/singleton access.
+	 */
+	EventBus();
+
+	/*!
+	 *	@brief		Delivers events to every subscriber which selected (some of) them.
+	 *
+	 *	@param		events		The events.
+	 *	@param		mask		The union of the events' types.
+	 */
+	void deliver(const std::vector<Event> & events, unsigned int mask);
+
+	/*!
+	 *	@brief		A subscriber and the events it selected.
+	 */
+	struct Subscription {
+		/// The subscriber (null if it unsubscribed during a delivery).
+		EventSubscriber * _subscriber;
+
+		/// The bitwise union of the selected EventTypes.
+		unsigned int _mask;
+	};
+
+	/// The singleton instance
+	static EventBus * _instance;
+
+	/// The subscriptions
+	std::vector<Subscription>	_subscriptions;
+
+	/// The posted events which haven't been delivered.
+	std::vector<Event>	_pending;
+
+	/// The union of the types of the pending events.
+	unsigned int	_pendingMask;
+
+	/// Reports if a flush has been scheduled with the event loop.
+	bool	_scheduled;
+
+	/// The depth of nested deliveries (a subscriber may send events).
+	int		_delivering;
+};
+
+#endif	// __EVENT_BUS_H__
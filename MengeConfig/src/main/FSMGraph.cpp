@@ -0,0 +1,189 @@
+#include "FSMGraph.h"
+#include "MCException.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qxmlstream.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		A transition as it is declared in the behavior file (before the state
+ *				names are resolved).
+ */
+struct TransitionDecl {
+	/*!
+	 *	@brief		The names of the source states.
+	 */
+	QStringList	_from;
+
+	/*!
+	 *	@brief		The names of the destination states.
+	 */
+	QStringList	_to;
+
+	/*!
+	 *	@brief		The type of the transition's condition.
+	 */
+	QString	_condition;
+
+	/*!
+	 *	@brief		The line on which the transition is declared.
+	 */
+	qint64	_line;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Splits a comma-separated list of state names.
+ *
+ *	@param		names		The list of names.
+ *	@returns	The individual names, stripped of surrounding white space.
+ */
+QStringList splitStateNames(const QString & names) {
+	QStringList result;
+	foreach(const QString & name, names.split(',', QString::SkipEmptyParts)) {
+		QString trimmed = name.trimmed();
+		if (!trimmed.isEmpty()) result << trimmed;
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads the body of a <Transition> element.
+ *
+ *	@param		xml			The reader, positioned at the start of the element.
+ *	@param		decl		The declaration to populate.
+ */
+void readTransition(QXmlStreamReader & xml, TransitionDecl & decl) {
+	decl._line = xml.lineNumber();
+	decl._from = splitStateNames(xml.attributes().value("from").toString());
+	if (xml.attributes().hasAttribute("to")) {
+		decl._to = splitStateNames(xml.attributes().value("to").toString());
+	}
+	int depth = 1;
+	bool inTarget = false;
+	while (depth > 0 && !xml.atEnd()) {
+		QXmlStreamReader::TokenType token = xml.readNext();
+		if (token == QXmlStreamReader::StartElement) {
+			++depth;
+			if (depth == 2 && xml.name() == "Condition") {
+				decl._condition = xml.attributes().value("type").toString();
+			}
+			else if (depth == 2 && xml.name() == "Target") {
+				inTarget = true;
+			}
+			else if (depth == 3 && inTarget && xml.name() == "State") {
+				decl._to << xml.attributes().value("name").toString().trimmed();
+			}
+		}
+		else if (token == QXmlStreamReader::EndElement) {
+			--depth;
+			if (depth == 1) inTarget = false;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMGraph
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t FSMGraph::NO_STATE = ~size_t(0);
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraph::clear() {
+	_states.clear();
+	_transitions.clear();
+	_stateIds.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t FSMGraph::addState(const QString & name, bool isFinal) {
+	State state = { name, isFinal };
+	_stateIds.insert(name, _states.size());
+	_states.push_back(state);
+	return _states.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t FSMGraph::addTransition(size_t from, size_t to, const QString & condition) {
+	Transition trans = { from, to, condition };
+	_transitions.push_back(trans);
+	return _transitions.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t FSMGraph::findState(const QString & name) const {
+	QHash<QString, size_t>::const_iterator itr = _stateIds.find(name);
+	return itr == _stateIds.end() ? NO_STATE : itr.value();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraph::loadBehavior(const QString & fileName) {
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw MCException("Unable to open the behavior file " + fileName.toStdString() + ": " + file.errorString().toStdString());
+	}
+	clear();
+
+	// Transitions may refer to states declared after them; they're resolved at the end.
+	std::vector<TransitionDecl> transitions;
+	QXmlStreamReader xml(&file);
+	bool foundRoot = false;
+	while (!xml.atEnd()) {
+		if (xml.readNext() != QXmlStreamReader::StartElement) continue;
+		if (!foundRoot) {
+			if (xml.name() != "BFSM") {
+				throw MCException("The file " + fileName.toStdString() + " is not a behavior file (no BFSM element)");
+			}
+			foundRoot = true;
+		}
+		else if (xml.name() == "State") {
+			QString name = xml.attributes().value("name").toString().trimmed();
+			if (name.isEmpty() || findState(name) != NO_STATE) {
+				throw MCException(QString("Line %1 of %2: states must have unique, non-empty names").arg(xml.lineNumber()).arg(fileName).toStdString());
+			}
+			addState(name, xml.attributes().value("final").toInt() != 0);
+			xml.skipCurrentElement();
+		}
+		else if (xml.name() == "Transition") {
+			transitions.push_back(TransitionDecl());
+			readTransition(xml, transitions.back());
+		}
+		else if (xml.name() != "BFSM") {
+			// Goal sets, velocity modifiers, etc. have no bearing on the graph.
+			xml.skipCurrentElement();
+		}
+	}
+	if (xml.hasError()) {
+		throw MCException(QString("Line %1 of %2: %3").arg(xml.lineNumber()).arg(fileName).arg(xml.errorString()).toStdString());
+	}
+
+	for (const TransitionDecl & decl : transitions) {
+		foreach(const QString & fromName, decl._from) {
+			size_t from = findState(fromName);
+			if (from == NO_STATE) {
+				throw MCException(QString("Line %1 of %2: transition from undefined state \"%3\"").arg(decl._line).arg(fileName).arg(fromName).toStdString());
+			}
+			foreach(const QString & toName, decl._to) {
+				size_t to = findState(toName);
+				if (to == NO_STATE) {
+					throw MCException(QString("Line %1 of %2: transition to undefined state \"%3\"").arg(decl._line).arg(fileName).arg(toName).toStdString());
+				}
+				addTransition(from, to, decl._condition);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
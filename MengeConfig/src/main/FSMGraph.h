@@ -0,0 +1,147 @@
+/*!
+ *	@file		FSMGraph.h
+ *	@brief		The graph of states and transitions of a Menge behavior finite state
+ *				machine.
+ */
+
+#ifndef __FSM_GRAPH_H__
+#define	__FSM_GRAPH_H__
+
+#include <QtCore/qhash.h>
+#include <QtCore/qstring.h>
+
+#include <vector>
+
+/*!
+ *	@brief		The structure of a behavior FSM -- its states and the transitions
+ *				between them -- independent of its presentation.
+ *
+ *	States are identified by their index in the graph.  A transition with multiple
+ *	source states, or a probabilistic target, is expanded into one transition per
+ *	source-target pair.
+ */
+class FSMGraph {
+public:
+	/*!
+	 *	@brief		A state of the FSM.
+	 */
+	struct State {
+		/*!
+		 *	@brief		The state's unique name.
+		 */
+		QString	_name;
+
+		/*!
+		 *	@brief		Reports if the state is a final state.
+		 */
+		bool	_final;
+	};
+
+	/*!
+	 *	@brief		A transition between two states.
+	 */
+	struct Transition {
+		/*!
+		 *	@brief		The index of the source state.
+		 */
+		size_t	_from;
+
+		/*!
+		 *	@brief		The index of the destination state.
+		 */
+		size_t	_to;
+
+		/*!
+		 *	@brief		The type of the transition's condition (e.g., "goal_reached").
+		 */
+		QString	_condition;
+	};
+
+	/*!
+	 *	@brief		Removes all states and transitions.
+	 */
+	void clear();
+
+	/*!
+	 *	@brief		Adds a state to the graph.
+	 *
+	 *	@param		name		The state's name; it must not already be in the graph.
+	 *	@param		isFinal		Reports if the state is a final state.
+	 *	@returns	The index of the new state.
+	 */
+	size_t addState(const QString & name, bool isFinal);
+
+	/*!
+	 *	@brief		Adds a transition to the graph.
+	 *
+	 *	@param		from		The index of the source state.
+	 *	@param		to			The index of the destination state.
+	 *	@param		condition	The type of the transition's condition.
+	 *	@returns	The index of the new transition.
+	 */
+	size_t addTransition(size_t from, size_t to, const QString & condition);
+
+	/*!
+	 *	@brief		Finds a state by name.
+	 *
+	 *	@param		name		The name of the state.
+	 *	@returns	The index of the state, or NO_STATE if there is no such state.
+	 */
+	size_t findState(const QString & name) const;
+
+	/*!
+	 *	@brief		Reports the number of states.
+	 */
+	size_t getStateCount() const { return _states.size(); }
+
+	/*!
+	 *	@brief		Reports the number of transitions.
+	 */
+	size_t getTransitionCount() const { return _transitions.size(); }
+
+	/*!
+	 *	@brief		Returns the indicated state.
+	 */
+	const State & getState(size_t i) const { return _states[i]; }
+
+	/*!
+	 *	@brief		Returns the indicated transition.
+	 */
+	const Transition & getTransition(size_t i) const { return _transitions[i]; }
+
+	/*!
+	 *	@brief		Replaces the graph with the FSM defined in a Menge behavior file.
+	 *
+	 *	Only the structure is read: the <State> elements and the <Transition> elements
+	 *	(including their <Condition> type and <Target> states).  Goal sets, goal selectors,
+	 *	velocity components, actions, etc. are ignored.
+	 *
+	 *	@param		fileName		The path to the behavior XML file.
+	 *	@throws		MCException if the file can't be read or isn't a behavior file.
+	 */
+	void loadBehavior(const QString & fileName);
+
+	/*!
+	 *	@brief		The index reported for states which don't exist.
+	 */
+	static const size_t NO_STATE;
+
+protected:
+
+	/*!
+	 *	@brief		The states.
+	 */
+	std::vector<State>	_states;
+
+	/*!
+	 *	@brief		The transitions.
+	 */
+	std::vector<Transition>	_transitions;
+
+	/*!
+	 *	@brief		Maps state names to state indices.
+	 */
+	QHash<QString, size_t>	_stateIds;
+};
+
+#endif	// __FSM_GRAPH_H__
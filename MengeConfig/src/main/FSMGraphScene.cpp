@@ -0,0 +1,417 @@
+#include "FSMGraphScene.h"
+
+#include "FSMGraph.h"
+
+#include <QtGui/qpainter.h>
+#include <QtWidgets/qstyleoption.h>
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		The level of detail below which arrowheads aren't drawn.
+ */
+const qreal ARROW_DETAIL = 0.3;
+
+/*!
+ *	@brief		The length of an arrowhead (in scene units).
+ */
+const qreal ARROW_SIZE = 10.0;
+
+/*!
+ *	@brief		The radius of the arc drawn for a self-transition.
+ */
+const qreal LOOP_RADIUS = 14.0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Identifies a cell of the bundling grid.
+ */
+typedef std::pair< int, int > BundleCell;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports the bundling cell which contains a point.
+ *
+ *	@param		p		The point.
+ *	@returns	The cell.
+ */
+BundleCell bundleCell(const QPointF & p) {
+	return BundleCell((int)floor(p.x() / FSMGraphScene::BUNDLE_CELL), (int)floor(p.y() / FSMGraphScene::BUNDLE_CELL));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMNodeItem
+///////////////////////////////////////////////////////////////////////////////
+
+const qreal FSMNodeItem::WIDTH = 120.0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const qreal FSMNodeItem::HEIGHT = 40.0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const qreal FSMNodeItem::LABEL_DETAIL = 0.45;
+
+///////////////////////////////////////////////////////////////////////////////
+
+FSMNodeItem::FSMNodeItem(size_t index, const QString & name, bool isFinal) : QGraphicsItem(), _index(index), _name(name), _final(isFinal) {
+	setCacheMode(DeviceCoordinateCache);
+	setFlag(ItemIsSelectable);
+	setZValue(1.0);
+	setToolTip(name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QRectF FSMNodeItem::boundingRect() const {
+	return QRectF(-0.5 * WIDTH - 1.0, -0.5 * HEIGHT - 1.0, WIDTH + 2.0, HEIGHT + 2.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMNodeItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) {
+	const QRectF rect(-0.5 * WIDTH, -0.5 * HEIGHT, WIDTH, HEIGHT);
+	QColor fill = _final ? QColor(240, 200, 160) : QColor(170, 200, 240);
+	if (option->state & QStyle::State_Selected) fill = fill.darker(130);
+	const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod < LABEL_DETAIL) {
+		// Too small to read; a plain block is all that can be seen.
+		painter->fillRect(rect, fill);
+		return;
+	}
+	painter->setPen(QPen(Qt::black, 1.5));
+	painter->setBrush(fill);
+	painter->drawRoundedRect(rect, 8.0, 8.0);
+	if (_final) {
+		painter->setBrush(Qt::NoBrush);
+		painter->drawRoundedRect(rect.adjusted(4.0, 4.0, -4.0, -4.0), 5.0, 5.0);
+	}
+	const QRectF textRect = rect.adjusted(8.0, 0.0, -8.0, 0.0);
+	painter->drawText(textRect, Qt::AlignCenter, painter->fontMetrics().elidedText(_name, Qt::ElideRight, (int)textRect.width()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMEdgeItem
+///////////////////////////////////////////////////////////////////////////////
+
+FSMEdgeItem::FSMEdgeItem(bool loop) : QGraphicsItem(), _start(), _end(), _loop(loop), _bounds() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMEdgeItem::setEndpoints(const QPointF & from, const QPointF & to) {
+	prepareGeometryChange();
+	if (_loop) {
+		// An arc over the top of the state.
+		_start = QPointF(from.x(), from.y() - 0.5 * FSMNodeItem::HEIGHT);
+		_end = _start;
+		_bounds = QRectF(_start.x() - LOOP_RADIUS, _start.y() - 2.0 * LOOP_RADIUS, 2.0 * LOOP_RADIUS, 2.0 * LOOP_RADIUS).adjusted(-1.0, -1.0, 1.0, 1.0);
+		return;
+	}
+	// Clip the segment between the centers to the states' rectangles.
+	const QPointF d = to - from;
+	qreal t = 0.5;
+	if (d.x() != 0.0) t = qMin(t, 0.5 * FSMNodeItem::WIDTH / qAbs(d.x()));
+	if (d.y() != 0.0) t = qMin(t, 0.5 * FSMNodeItem::HEIGHT / qAbs(d.y()));
+	_start = from + t * d;
+	_end = to - t * d;
+	_bounds = QRectF(_start, _end).normalized().adjusted(-ARROW_SIZE, -ARROW_SIZE, ARROW_SIZE, ARROW_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QRectF FSMEdgeItem::boundingRect() const {
+	return _bounds;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMEdgeItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) {
+	QPen pen(QColor(60, 60, 60));
+	pen.setCosmetic(true);
+	painter->setPen(pen);
+	if (_loop) {
+		painter->setBrush(Qt::NoBrush);
+		painter->drawArc(QRectF(_start.x() - LOOP_RADIUS, _start.y() - 2.0 * LOOP_RADIUS, 2.0 * LOOP_RADIUS, 2.0 * LOOP_RADIUS), -30 * 16, 240 * 16);
+		return;
+	}
+	painter->drawLine(_start, _end);
+	if (option->levelOfDetailFromTransform(painter->worldTransform()) < ARROW_DETAIL) return;
+
+	const QPointF d = _end - _start;
+	const qreal len = sqrt(d.x() * d.x() + d.y() * d.y());
+	if (len < ARROW_SIZE) return;
+	const QPointF dir = d / len;
+	const QPointF perp(-dir.y(), dir.x());
+	const QPointF base = _end - ARROW_SIZE * dir;
+	const QPointF head[3] = { _end, base + 0.4 * ARROW_SIZE * perp, base - 0.4 * ARROW_SIZE * perp };
+	painter->setBrush(pen.color());
+	painter->drawPolygon(head, 3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMBundleItem
+///////////////////////////////////////////////////////////////////////////////
+
+FSMBundleItem::FSMBundleItem(const QPointF & from, const QPointF & to, size_t count) : QGraphicsItem(), _from(from), _to(to), _width(1.0 + log((double)count) / log(2.0)) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QRectF FSMBundleItem::boundingRect() const {
+	// The pen is cosmetic; the margin covers its width down to a modest zoom level.
+	const qreal margin = 10.0 * _width;
+	return QRectF(_from, _to).normalized().adjusted(-margin, -margin, margin, margin);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMBundleItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) {
+	QPen pen(QColor(60, 60, 60, 140), _width);
+	pen.setCosmetic(true);
+	pen.setCapStyle(Qt::RoundCap);
+	painter->setPen(pen);
+	painter->drawLine(_from, _to);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMGraphScene
+///////////////////////////////////////////////////////////////////////////////
+
+const qreal FSMGraphScene::BUNDLE_CELL = 800.0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+FSMGraphScene::FSMGraphScene(QObject * parent) : QGraphicsScene(parent), _nodes(), _edges(), _ends(), _stateEdges(), _bundles(), _placedCount(0), _selectedStates(), _detailed(true), _graphBounds() {
+	setItemIndexMethod(BspTreeIndex);
+	connect(this, &QGraphicsScene::selectionChanged, [this]() { trackSelection(); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::setGraph(const FSMGraph & graph) {
+	// Without an index, clearing and re-adding thousands of items doesn't churn the tree.
+	setItemIndexMethod(NoIndex);
+	clear();
+	_nodes.clear();
+	_edges.clear();
+	_ends.clear();
+	_stateEdges.clear();
+	_bundles.clear();
+	_placedCount = 0;
+	_selectedStates.clear();
+	_graphBounds = QRectF();
+
+	_nodes.reserve(graph.getStateCount());
+	_stateEdges.reserve(graph.getStateCount());
+	for (size_t i = 0; i < graph.getStateCount(); ++i) {
+		addStateItem(graph, i);
+	}
+	_edges.reserve(graph.getTransitionCount());
+	_ends.reserve(graph.getTransitionCount());
+	for (size_t i = 0; i < graph.getTransitionCount(); ++i) {
+		addTransitionItem(graph, i);
+	}
+	setItemIndexMethod(BspTreeIndex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::syncGraph(const FSMGraph & graph) {
+	for (size_t i = _nodes.size(); i < graph.getStateCount(); ++i) {
+		addStateItem(graph, i);
+	}
+	for (size_t i = _edges.size(); i < graph.getTransitionCount(); ++i) {
+		addTransitionItem(graph, i);
+		// A transition between positioned states can be drawn right away.
+		const std::pair< size_t, size_t > & ends = _ends.back();
+		if (ends.first < _placedCount && ends.second < _placedCount) {
+			_edges.back()->setEndpoints(_nodes[ends.first]->pos(), _nodes[ends.second]->pos());
+			_edges.back()->setVisible(_detailed);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::setPositions(const std::vector<Vector2> & positions) {
+	if (positions.size() != _nodes.size()) return;
+	// Moving every item would update the tree once per item; it's rebuilt once instead.
+	setItemIndexMethod(NoIndex);
+	_graphBounds = QRectF();
+	for (size_t i = 0; i < _nodes.size(); ++i) {
+		const QPointF p(positions[i].x(), positions[i].y());
+		_nodes[i]->setPos(p);
+		_nodes[i]->setVisible(true);
+		_graphBounds |= _nodes[i]->sceneBoundingRect();
+	}
+	for (size_t i = 0; i < _edges.size(); ++i) {
+		_edges[i]->setEndpoints(_nodes[_ends[i].first]->pos(), _nodes[_ends[i].second]->pos());
+		_edges[i]->setVisible(_detailed);
+	}
+	_placedCount = _nodes.size();
+	buildBundles();
+	setItemIndexMethod(BspTreeIndex);
+	const qreal margin = FSMNodeItem::WIDTH;
+	setSceneRect(_graphBounds.adjusted(-margin, -margin, margin, margin));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::movePositions(const std::vector<Vector2> & positions, const std::vector<size_t> & moved) {
+	if (positions.size() != _nodes.size()) return;
+	// The moved states are the first unpositioned ones, plus some of the positioned ones.
+	std::vector<size_t> edges;
+	for (size_t m = 0; m < moved.size(); ++m) {
+		const size_t i = moved[m];
+		_nodes[i]->setPos(QPointF(positions[i].x(), positions[i].y()));
+		_nodes[i]->setVisible(true);
+		_graphBounds |= _nodes[i]->sceneBoundingRect();
+		_placedCount = qMax(_placedCount, i + 1);
+		edges.insert(edges.end(), _stateEdges[i].begin(), _stateEdges[i].end());
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	for (size_t e = 0; e < edges.size(); ++e) {
+		const std::pair< size_t, size_t > & ends = _ends[edges[e]];
+		if (ends.first < _placedCount && ends.second < _placedCount) {
+			_edges[edges[e]]->setEndpoints(_nodes[ends.first]->pos(), _nodes[ends.second]->pos());
+			_edges[edges[e]]->setVisible(_detailed);
+		}
+	}
+	buildBundles();
+	const qreal margin = FSMNodeItem::WIDTH;
+	setSceneRect(sceneRect() | _graphBounds.adjusted(-margin, -margin, margin, margin));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::getPositions(std::vector<Vector2> & positions) const {
+	positions.resize(_placedCount);
+	for (size_t i = 0; i < _placedCount; ++i) {
+		const QPointF p = _nodes[i]->pos();
+		positions[i].set((float)p.x(), (float)p.y());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::setDetailed(bool detailed) {
+	if (detailed == _detailed) return;
+	_detailed = detailed;
+	if (_placedCount == 0) return;
+	for (size_t i = 0; i < _edges.size(); ++i) {
+		if (_ends[i].first < _placedCount && _ends[i].second < _placedCount) {
+			_edges[i]->setVisible(_detailed);
+		}
+	}
+	for (size_t i = 0; i < _bundles.size(); ++i) {
+		_bundles[i]->setVisible(!_detailed);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::buildBundles() {
+	for (size_t i = 0; i < _bundles.size(); ++i) {
+		delete _bundles[i];
+	}
+	_bundles.clear();
+
+	// The centroid of the states in each cell.
+	std::map< BundleCell, std::pair< QPointF, int > > centroids;
+	std::vector<BundleCell> cells(_placedCount);
+	for (size_t i = 0; i < _placedCount; ++i) {
+		cells[i] = bundleCell(_nodes[i]->pos());
+		std::pair< QPointF, int > & c = centroids[cells[i]];
+		c.first += _nodes[i]->pos();
+		++c.second;
+	}
+	// Bundles are undirected; the cell pair is ordered.
+	std::map< std::pair< BundleCell, BundleCell >, size_t > counts;
+	for (size_t i = 0; i < _ends.size(); ++i) {
+		if (_ends[i].first >= _placedCount || _ends[i].second >= _placedCount) continue;
+		const BundleCell & a = cells[_ends[i].first];
+		const BundleCell & b = cells[_ends[i].second];
+		if (a == b) continue;
+		++counts[a < b ? std::make_pair(a, b) : std::make_pair(b, a)];
+	}
+	_bundles.reserve(counts.size());
+	std::map< std::pair< BundleCell, BundleCell >, size_t >::const_iterator itr = counts.begin();
+	for (; itr != counts.end(); ++itr) {
+		const std::pair< QPointF, int > & a = centroids[itr->first.first];
+		const std::pair< QPointF, int > & b = centroids[itr->first.second];
+		FSMBundleItem * item = new FSMBundleItem(a.first / a.second, b.first / b.second, itr->second);
+		item->setVisible(!_detailed);
+		addItem(item);
+		_bundles.push_back(item);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::addStateItem(const FSMGraph & graph, size_t i) {
+	const FSMGraph::State & state = graph.getState(i);
+	FSMNodeItem * item = new FSMNodeItem(i, state._name, state._final);
+	item->setVisible(false);
+	addItem(item);
+	_nodes.push_back(item);
+	_stateEdges.push_back(std::vector<size_t>());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::addTransitionItem(const FSMGraph & graph, size_t i) {
+	const FSMGraph::Transition & trans = graph.getTransition(i);
+	FSMEdgeItem * item = new FSMEdgeItem(trans._from == trans._to);
+	item->setToolTip(trans._condition);
+	item->setVisible(false);
+	addItem(item);
+	_edges.push_back(item);
+	_ends.push_back(std::make_pair(trans._from, trans._to));
+	_stateEdges[trans._from].push_back(i);
+	if (trans._to != trans._from) _stateEdges[trans._to].push_back(i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool FSMGraphScene::selectState(size_t state, QPointF & center) {
+	if (state >= _placedCount) return false;
+	clearSelection();
+	_nodes[state]->setSelected(true);
+	center = _nodes[state]->pos();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphScene::trackSelection() {
+	std::vector<size_t> selected;
+	foreach(QGraphicsItem * item, selectedItems()) {
+		FSMNodeItem * node = dynamic_cast< FSMNodeItem * >(item);
+		if (node != 0x0) selected.push_back(node->getIndex());
+	}
+	std::sort(selected.begin(), selected.end());
+	// Keep the states which are still selected (in order) and append the new ones.
+	std::vector<size_t> ordered;
+	for (size_t i = 0; i < _selectedStates.size(); ++i) {
+		std::vector<size_t>::iterator itr = std::lower_bound(selected.begin(), selected.end(), _selectedStates[i]);
+		if (itr != selected.end() && *itr == _selectedStates[i]) {
+			ordered.push_back(*itr);
+			selected.erase(itr);
+		}
+	}
+	ordered.insert(ordered.end(), selected.begin(), selected.end());
+	_selectedStates.swap(ordered);
+}
+
+///////////////////////////////////////////////////////////////////////////////
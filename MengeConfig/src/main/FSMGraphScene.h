@@ -0,0 +1,379 @@
+/*!
+ *	@file		FSMGraphScene.h
+ *	@brief		The graphics scene which presents a behavior FSM.
+ */
+
+#ifndef __FSM_GRAPH_SCENE_H__
+#define	__FSM_GRAPH_SCENE_H__
+
+#include <QtWidgets/qgraphicsitem.h>
+#include <QtWidgets/qgraphicsscene.h>
+
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+class FSMGraph;
+
+/*!
+ *	@brief		The graphics item for an FSM state.
+ *
+ *	The item is cached in device coordinates; its label is only drawn when the state is
+ *	large enough on screen to read it.
+ */
+class FSMNodeItem : public QGraphicsItem {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		index		The index of the state in its graph.
+	 *	@param		name		The name of the state.
+	 *	@param		isFinal		Reports if the state is a final state.
+	 */
+	FSMNodeItem(size_t index, const QString & name, bool isFinal);
+
+	/*!
+	 *	@brief		Reports the index of the state in its graph.
+	 */
+	size_t getIndex() const { return _index; }
+
+	/*!
+	 *	@brief		Reports the item's bounds, in its local coordinates.
+	 */
+	virtual QRectF boundingRect() const;
+
+	/*!
+	 *	@brief		Draws the item.
+	 *
+	 *	@param		painter		The painter.
+	 *	@param		option		The style options (which include the item's level of detail).
+	 *	@param		widget		The widget being painted.
+	 */
+	virtual void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget);
+
+	/*!
+	 *	@brief		The width of the drawn state.
+	 */
+	static const qreal WIDTH;
+
+	/*!
+	 *	@brief		The height of the drawn state.
+	 */
+	static const qreal HEIGHT;
+
+	/*!
+	 *	@brief		The level of detail below which labels aren't drawn.
+	 */
+	static const qreal LABEL_DETAIL;
+
+protected:
+
+	/*!
+	 *	@brief		The index of the state in its graph.
+	 */
+	size_t	_index;
+
+	/*!
+	 *	@brief		The state's name.
+	 */
+	QString	_name;
+
+	/*!
+	 *	@brief		Reports if the state is a final state.
+	 */
+	bool	_final;
+};
+
+/*!
+ *	@brief		The graphics item for an FSM transition.
+ *
+ *	Edges are not cached -- a long, thin edge would need a cache image as large as its
+ *	bounding box.
+ */
+class FSMEdgeItem : public QGraphicsItem {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		loop		True if the edge connects a state to itself.
+	 */
+	FSMEdgeItem(bool loop);
+
+	/*!
+	 *	@brief		Sets the centers of the states the edge connects.
+	 *
+	 *	@param		from		The center of the source state.
+	 *	@param		to			The center of the destination state.
+	 */
+	void setEndpoints(const QPointF & from, const QPointF & to);
+
+	/*!
+	 *	@brief		Reports the item's bounds, in its local coordinates.
+	 */
+	virtual QRectF boundingRect() const;
+
+	/*!
+	 *	@brief		Draws the item.
+	 *
+	 *	@param		painter		The painter.
+	 *	@param		option		The style options.
+	 *	@param		widget		The widget being painted.
+	 */
+	virtual void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget);
+
+protected:
+
+	/*!
+	 *	@brief		The start of the drawn edge (on the source state's boundary).
+	 */
+	QPointF	_start;
+
+	/*!
+	 *	@brief		The end of the drawn edge (on the destination state's boundary).
+	 */
+	QPointF	_end;
+
+	/*!
+	 *	@brief		Reports if the edge connects a state to itself.
+	 */
+	bool	_loop;
+
+	/*!
+	 *	@brief		The edge's bounds.
+	 */
+	QRectF	_bounds;
+};
+
+/*!
+ *	@brief		The graphics item which stands in for a bundle of transitions when the
+ *				graph is zoomed out; its width grows with the number of transitions.
+ */
+class FSMBundleItem : public QGraphicsItem {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		from		The centroid of the bundle's source states.
+	 *	@param		to			The centroid of the bundle's destination states.
+	 *	@param		count		The number of transitions in the bundle.
+	 */
+	FSMBundleItem(const QPointF & from, const QPointF & to, size_t count);
+
+	/*!
+	 *	@brief		Reports the item's bounds, in its local coordinates.
+	 */
+	virtual QRectF boundingRect() const;
+
+	/*!
+	 *	@brief		Draws the item.
+	 *
+	 *	@param		painter		The painter.
+	 *	@param		option		The style options.
+	 *	@param		widget		The widget being painted.
+	 */
+	virtual void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget);
+
+protected:
+
+	/*!
+	 *	@brief		The centroid of the source states.
+	 */
+	QPointF	_from;
+
+	/*!
+	 *	@brief		The centroid of the destination states.
+	 */
+	QPointF	_to;
+
+	/*!
+	 *	@brief		The width of the drawn bundle (in pixels).
+	 */
+	qreal	_width;
+};
+
+/*!
+ *	@brief		The scene which presents a behavior FSM.
+ *
+ *	Items are found through a BSP tree so that drawing and picking only visit the visible
+ *	part of the graph.  The scene has two levels of detail: in detail, every transition is
+ *	drawn; otherwise, the transitions are collapsed into bundles which connect the cells of
+ *	a coarse grid (transitions within a single cell aren't drawn at all).
+ *
+ *	The graph may grow after it has been set (see syncGraph()); the states are then
+ *	positioned incrementally.
+ */
+class FSMGraphScene : public QGraphicsScene {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent		The optional parent.
+	 */
+	FSMGraphScene(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Replaces the presented graph.  The states have no meaningful positions
+	 *				until setPositions() is called.
+	 *
+	 *	@param		graph		The graph to present.
+	 */
+	void setGraph(const FSMGraph & graph);
+
+	/*!
+	 *	@brief		Adds the items for the states and transitions which have been appended to
+	 *				the presented graph since it was set.  The new states have no meaningful
+	 *				positions until they are moved.
+	 *
+	 *	@param		graph		The graph being presented.
+	 */
+	void syncGraph(const FSMGraph & graph);
+
+	/*!
+	 *	@brief		Positions all of the states.
+	 *
+	 *	@param		positions		The center of each state; there must be one position per
+	 *								state.
+	 */
+	void setPositions(const std::vector<Vector2> & positions);
+
+	/*!
+	 *	@brief		Positions some of the states; only the items of the moved states and their
+	 *				transitions are updated.
+	 *
+	 *	@param		positions		The center of each state; there must be one position per
+	 *								state.
+	 *	@param		moved			The states whose positions changed.
+	 */
+	void movePositions(const std::vector<Vector2> & positions, const std::vector<size_t> & moved);
+
+	/*!
+	 *	@brief		Reports the positions of the states which have been positioned.
+	 *
+	 *	@param		positions		The positions of the first getPositionedCount() states.
+	 */
+	void getPositions(std::vector<Vector2> & positions) const;
+
+	/*!
+	 *	@brief		Reports if the states have been positioned.
+	 */
+	bool hasPositions() const { return _placedCount > 0; }
+
+	/*!
+	 *	@brief		Reports the number of states (at the start of the graph) which have been
+	 *				positioned.
+	 */
+	size_t getPositionedCount() const { return _placedCount; }
+
+	/*!
+	 *	@brief		Reports the selected states, in the order they were selected.
+	 */
+	const std::vector<size_t> & getSelectedStates() const { return _selectedStates; }
+
+	/*!
+	 *	@brief		Makes the state the only selected state.
+	 *
+	 *	@param		state		The index of the state.
+	 *	@param		center		The center of the state (in scene coordinates).
+	 *	@returns	True if the state has been positioned (and was selected).
+	 */
+	bool selectState(size_t state, QPointF & center);
+
+	/*!
+	 *	@brief		Sets the level of detail.
+	 *
+	 *	@param		detailed		If true, individual transitions are drawn, otherwise
+	 *								bundles are drawn.
+	 */
+	void setDetailed(bool detailed);
+
+	/*!
+	 *	@brief		Reports the level of detail (see setDetailed()).
+	 */
+	bool isDetailed() const { return _detailed; }
+
+	/*!
+	 *	@brief		Reports the bounds of the positioned states.
+	 */
+	const QRectF & getGraphBounds() const { return _graphBounds; }
+
+	/*!
+	 *	@brief		The size of the grid cells used to bundle transitions.
+	 */
+	static const qreal BUNDLE_CELL;
+
+protected:
+
+	/*!
+	 *	@brief		Rebuilds the transition bundles from the current state positions.
+	 */
+	void buildBundles();
+
+	/*!
+	 *	@brief		Adds the item for a state.
+	 *
+	 *	@param		graph		The graph.
+	 *	@param		i			The index of the state.
+	 */
+	void addStateItem(const FSMGraph & graph, size_t i);
+
+	/*!
+	 *	@brief		Adds the item for a transition.
+	 *
+	 *	@param		graph		The graph.
+	 *	@param		i			The index of the transition.
+	 */
+	void addTransitionItem(const FSMGraph & graph, size_t i);
+
+	/*!
+	 *	@brief		Brings the record of the selection order up to date with the selection.
+	 */
+	void trackSelection();
+
+	/*!
+	 *	@brief		The state items.
+	 */
+	std::vector<FSMNodeItem *>	_nodes;
+
+	/*!
+	 *	@brief		The transition items.
+	 */
+	std::vector<FSMEdgeItem *>	_edges;
+
+	/*!
+	 *	@brief		The indices of the source and destination state of each transition.
+	 */
+	std::vector< std::pair< size_t, size_t > >	_ends;
+
+	/*!
+	 *	@brief		The transitions incident to each state.
+	 */
+	std::vector< std::vector<size_t> >	_stateEdges;
+
+	/*!
+	 *	@brief		The bundle items.
+	 */
+	std::vector<FSMBundleItem *>	_bundles;
+
+	/*!
+	 *	@brief		The number of states (at the start of the graph) which have been positioned.
+	 */
+	size_t	_placedCount;
+
+	/*!
+	 *	@brief		The selected states, in the order they were selected.
+	 */
+	std::vector<size_t>	_selectedStates;
+
+	/*!
+	 *	@brief		The level of detail (see setDetailed()).
+	 */
+	bool	_detailed;
+
+	/*!
+	 *	@brief		The bounds of the positioned states.
+	 */
+	QRectF	_graphBounds;
+};
+
+#endif	// __FSM_GRAPH_SCENE_H__
@@ -0,0 +1,68 @@
+#include "FSMGraphView.h"
+
+#include "FSMGraphScene.h"
+
+#include <QtGui/qevent.h>
+#include <QtWidgets/QOpenGLWidget>
+
+#include <math.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMGraphView
+///////////////////////////////////////////////////////////////////////////////
+
+const qreal FSMGraphView::BUNDLE_ZOOM = 0.3;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const qreal FSMGraphView::DETAIL_ZOOM = 0.4;
+
+///////////////////////////////////////////////////////////////////////////////
+
+FSMGraphView::FSMGraphView(FSMGraphScene * scene, QWidget * parent) : QGraphicsView(scene, parent), _scene(scene) {
+	setViewport(new QOpenGLWidget());
+	// An OpenGL viewport is redrawn in full anyway; tracking dirty regions only costs time.
+	setViewportUpdateMode(FullViewportUpdate);
+	setOptimizationFlags(DontSavePainterState | DontAdjustForAntialiasing);
+	setRenderHint(QPainter::Antialiasing, _scene->isDetailed());
+	setDragMode(ScrollHandDrag);
+	setTransformationAnchor(AnchorUnderMouse);
+	setResizeAnchor(AnchorViewCenter);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphView::fitGraph() {
+	if (!_scene->hasPositions()) return;
+	fitInView(_scene->getGraphBounds(), Qt::KeepAspectRatio);
+	updateDetail();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphView::wheelEvent(QWheelEvent * event) {
+	// 120 units is one notch of a standard wheel; each notch zooms by 20%.
+	qreal factor = pow(1.2, event->angleDelta().y() / 120.0);
+	const qreal zoom = transform().m11();
+	if (zoom * factor > 8.0) factor = 8.0 / zoom;
+	if (zoom * factor < 0.005) factor = 0.005 / zoom;
+	scale(factor, factor);
+	updateDetail();
+	event->accept();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMGraphView::updateDetail() {
+	const qreal zoom = transform().m11();
+	if (_scene->isDetailed() && zoom < BUNDLE_ZOOM) {
+		_scene->setDetailed(false);
+	}
+	else if (!_scene->isDetailed() && zoom > DETAIL_ZOOM) {
+		_scene->setDetailed(true);
+	}
+	// Antialiasing thousands of tiny items buys nothing.
+	setRenderHint(QPainter::Antialiasing, _scene->isDetailed());
+}
+
+///////////////////////////////////////////////////////////////////////////////
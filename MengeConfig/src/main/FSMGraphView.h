@@ -0,0 +1,65 @@
+/*!
+ *	@file		FSMGraphView.h
+ *	@brief		The view onto the behavior FSM's graphics scene.
+ */
+
+#ifndef __FSM_GRAPH_VIEW_H__
+#define	__FSM_GRAPH_VIEW_H__
+
+#include <QtWidgets/qgraphicsview.h>
+
+class FSMGraphScene;
+
+/*!
+ *	@brief		A pannable, zoomable view of an FSMGraphScene.
+ *
+ *	The view is drawn with OpenGL.  Dragging pans, the mouse wheel zooms about the cursor
+ *	and the scene's level of detail follows the zoom level (with some hysteresis so that
+ *	zooming around the threshold doesn't rebuild the visible set every step).
+ */
+class FSMGraphView : public QGraphicsView {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		scene		The scene to view.
+	 *	@param		parent		The optional parent.
+	 */
+	FSMGraphView(FSMGraphScene * scene, QWidget * parent = 0x0);
+
+	/*!
+	 *	@brief		Zooms the view so that the whole graph is visible.
+	 */
+	void fitGraph();
+
+	/*!
+	 *	@brief		The zoom level below which the scene shows bundles.
+	 */
+	static const qreal BUNDLE_ZOOM;
+
+	/*!
+	 *	@brief		The zoom level above which the scene shows individual transitions.
+	 */
+	static const qreal DETAIL_ZOOM;
+
+protected:
+
+	/*!
+	 *	@brief		Zooms the view about the cursor.
+	 *
+	 *	@param		event		The wheel event.
+	 */
+	virtual void wheelEvent(QWheelEvent * event);
+
+	/*!
+	 *	@brief		Sets the scene's level of detail from the current zoom level.
+	 */
+	void updateDetail();
+
+	/*!
+	 *	@brief		The scene being viewed.
+	 */
+	FSMGraphScene * _scene;
+};
+
+#endif	// __FSM_GRAPH_VIEW_H__
@@ -0,0 +1,445 @@
+#include "FSMLayout.h"
+
+#include <algorithm>
+#include <math.h>
+#include <unordered_map>
+#include <utility>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Builds a compressed adjacency structure from a list of node pairs.
+ *
+ *	@param		nodeCount		The number of nodes.
+ *	@param		pairs			The (node, adjacent node) pairs.
+ *	@param		start			The offset of each node's adjacent nodes in adj (with one
+ *								extra entry marking the end).
+ *	@param		adj				The adjacent nodes.
+ */
+void buildAdjacency(size_t nodeCount, const std::vector< std::pair< size_t, size_t > > & pairs, std::vector<size_t> & start, std::vector<size_t> & adj) {
+	start.assign(nodeCount + 1, 0);
+	for (size_t i = 0; i < pairs.size(); ++i) {
+		++start[pairs[i].first + 1];
+	}
+	for (size_t i = 0; i < nodeCount; ++i) {
+		start[i + 1] += start[i];
+	}
+	adj.resize(pairs.size());
+	std::vector<size_t> fill(start.begin(), start.end() - 1);
+	for (size_t i = 0; i < pairs.size(); ++i) {
+		adj[fill[pairs[i].first]++] = pairs[i].second;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Sets the horizontal positions of a row of nodes, centered on zero.
+ *
+ *	@param		begin		The first node of the row.
+ *	@param		end			One past the last node of the row.
+ *	@param		x			The horizontal position of every node.
+ */
+void spaceRow(std::vector<size_t>::const_iterator begin, std::vector<size_t>::const_iterator end, std::vector<float> & x) {
+	const float offset = 0.5f * (float)(end - begin - 1);
+	float i = 0.f;
+	for (; begin != end; ++begin, i += 1.f) {
+		x[*begin] = (i - offset) * FSMLayout::NODE_SPACING;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if an operation has been cancelled.
+ *
+ *	@param		cancel		The cancellation flag (may be null).
+ *	@returns	True if the flag is set.
+ */
+inline bool isCancelled(const std::atomic<bool> * cancel) {
+	return cancel != 0x0 && cancel->load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Computes the key of the grid cell which contains a point.
+ *
+ *	@param		p			The point.
+ *	@param		cellSize	The size of the grid cells.
+ *	@param		dx			An offset, in cells, along the x-axis.
+ *	@param		dy			An offset, in cells, along the y-axis.
+ *	@returns	The key of the cell.
+ */
+inline long long cellKey(const Vector2 & p, float cellSize, int dx = 0, int dy = 0) {
+	const long long i = (long long)floor(p.x() / cellSize) + dx;
+	const long long j = (long long)floor(p.y() / cellSize) + dy;
+	return (i << 32) ^ (j & 0xFFFFFFFFLL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMLayout
+///////////////////////////////////////////////////////////////////////////////
+
+const float FSMLayout::NODE_SPACING = 160.f;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const float FSMLayout::ROW_SPACING = 120.f;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t FSMLayout::MAX_ROW_SIZE = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const int FSMLayout::ORDER_SWEEPS = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t FSMLayout::NEIGHBORHOOD_HOPS = 2;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t FSMLayout::MAX_MOVED = 256;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const int FSMLayout::RELAX_ITERATIONS = 60;
+
+///////////////////////////////////////////////////////////////////////////////
+
+FSMLayout::FSMLayout(size_t nodeCount, const std::vector<Edge> & edges) : _nodeCount(nodeCount) {
+	std::vector< std::pair< size_t, size_t > > succ;
+	std::vector< std::pair< size_t, size_t > > nbr;
+	succ.reserve(edges.size());
+	nbr.reserve(2 * edges.size());
+	for (size_t i = 0; i < edges.size(); ++i) {
+		const Edge & e = edges[i];
+		if (e._from == e._to) continue;
+		succ.push_back(std::make_pair(e._from, e._to));
+		nbr.push_back(std::make_pair(e._from, e._to));
+		nbr.push_back(std::make_pair(e._to, e._from));
+	}
+	// Parallel edges would only weight the barycenters; drop them.
+	std::sort(succ.begin(), succ.end());
+	succ.erase(std::unique(succ.begin(), succ.end()), succ.end());
+	std::sort(nbr.begin(), nbr.end());
+	nbr.erase(std::unique(nbr.begin(), nbr.end()), nbr.end());
+	buildAdjacency(nodeCount, succ, _succStart, _succ);
+	buildAdjacency(nodeCount, nbr, _nbrStart, _nbr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool FSMLayout::layered(std::vector<Vector2> & positions, const std::atomic<bool> * cancel) const {
+	positions.resize(_nodeCount);
+	if (_nodeCount == 0) return true;
+
+	std::vector<size_t> layers;
+	const size_t layerCount = assignLayers(layers);
+	std::vector< std::vector<size_t> > members(layerCount);
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		members[layers[n]].push_back(n);
+	}
+
+	std::vector<float> x(_nodeCount);
+	for (size_t l = 0; l < layerCount; ++l) {
+		spaceRow(members[l].begin(), members[l].end(), x);
+	}
+	for (int s = 0; s < ORDER_SWEEPS; ++s) {
+		if (isCancelled(cancel)) return false;
+		for (size_t l = 1; l < layerCount; ++l) {
+			orderLayer(members[l], layers, x, true);
+		}
+		for (size_t l = layerCount - 1; l-- > 0;) {
+			orderLayer(members[l], layers, x, false);
+		}
+	}
+
+	// Wrap the wide layers onto multiple rows.
+	float y = 0.f;
+	for (size_t l = 0; l < layerCount; ++l) {
+		const std::vector<size_t> & layer = members[l];
+		for (size_t r = 0; r < layer.size(); r += MAX_ROW_SIZE) {
+			std::vector<size_t>::const_iterator begin = layer.begin() + r;
+			std::vector<size_t>::const_iterator end = layer.begin() + std::min(r + MAX_ROW_SIZE, layer.size());
+			spaceRow(begin, end, x);
+			for (; begin != end; ++begin) {
+				positions[*begin].set(x[*begin], y);
+			}
+			y += ROW_SPACING;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool FSMLayout::relax(std::vector<Vector2> & positions, size_t placedCount, const std::vector<size_t> & seeds, std::vector<size_t> & moved, const std::atomic<bool> * cancel) const {
+	moved.clear();
+	placedCount = std::min(placedCount, _nodeCount);
+	if (placedCount == 0) {
+		// Nothing to warm-start from.
+		if (!layered(positions, cancel)) return false;
+		moved.resize(_nodeCount);
+		for (size_t n = 0; n < _nodeCount; ++n) moved[n] = n;
+		return true;
+	}
+	positions.resize(_nodeCount);
+	std::vector<char> placed(_nodeCount, 0);
+	std::fill(placed.begin(), placed.begin() + placedCount, 1);
+	placeNewNodes(positions, placed);
+
+	// The neighborhood: a breadth-first search from the seeds (and the new nodes).
+	const size_t NOT_MOVING = ~size_t(0);
+	std::vector<size_t> slot(_nodeCount, NOT_MOVING);
+	std::vector<size_t> depth;
+	for (size_t n = placedCount; n < _nodeCount; ++n) {
+		slot[n] = moved.size();
+		moved.push_back(n);
+		depth.push_back(0);
+	}
+	for (size_t i = 0; i < seeds.size(); ++i) {
+		const size_t n = seeds[i];
+		if (n < _nodeCount && slot[n] == NOT_MOVING) {
+			slot[n] = moved.size();
+			moved.push_back(n);
+			depth.push_back(0);
+		}
+	}
+	for (size_t head = 0; head < moved.size() && moved.size() < MAX_MOVED; ++head) {
+		if (depth[head] == NEIGHBORHOOD_HOPS) continue;
+		const size_t node = moved[head];
+		for (size_t j = _nbrStart[node]; j < _nbrStart[node + 1] && moved.size() < MAX_MOVED; ++j) {
+			const size_t nbr = _nbr[j];
+			if (slot[nbr] == NOT_MOVING) {
+				slot[nbr] = moved.size();
+				moved.push_back(nbr);
+				depth.push_back(depth[head] + 1);
+			}
+		}
+	}
+
+	// Fruchterman-Reingold forces with the ideal edge length L: attraction d^2 / L along
+	//	edges and repulsion L^2 / d between nodes closer than the cutoff.  The fixed nodes
+	//	are bucketed in a grid so that only the nearby ones are visited.
+	const float L = NODE_SPACING;
+	const float cutoff = 2.f * L;
+	std::unordered_map< long long, std::vector<size_t> > grid;
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		if (slot[n] == NOT_MOVING) grid[cellKey(positions[n], cutoff)].push_back(n);
+	}
+	// Existing nodes are tethered to their previous positions -- the further from the
+	//	edit, the shorter the tether -- so that an edge to a distant state can't drag the
+	//	neighborhood across the drawing.
+	std::vector<Vector2> anchor(moved.size());
+	std::vector<float> tether(moved.size());
+	for (size_t m = 0; m < moved.size(); ++m) {
+		anchor[m] = positions[moved[m]];
+		tether[m] = moved[m] < placedCount ? L * (float)(1 + NEIGHBORHOOD_HOPS - depth[m]) : -1.f;
+	}
+	std::vector<Vector2> force(moved.size());
+	for (int it = 0; it < RELAX_ITERATIONS; ++it) {
+		if (isCancelled(cancel)) return false;
+		for (size_t m = 0; m < moved.size(); ++m) {
+			const size_t node = moved[m];
+			const Vector2 & p = positions[node];
+			Vector2 f(0.f, 0.f);
+			for (size_t j = _nbrStart[node]; j < _nbrStart[node + 1]; ++j) {
+				const Vector2 d = positions[_nbr[j]] - p;
+				f += d * (abs(d) / L);
+			}
+			for (int dx = -1; dx <= 1; ++dx) {
+				for (int dy = -1; dy <= 1; ++dy) {
+					std::unordered_map< long long, std::vector<size_t> >::const_iterator cell = grid.find(cellKey(p, cutoff, dx, dy));
+					if (cell == grid.end()) continue;
+					for (size_t k = 0; k < cell->second.size(); ++k) {
+						const Vector2 d = p - positions[cell->second[k]];
+						const float distSq = absSq(d);
+						if (distSq < cutoff * cutoff && distSq > 1e-4f) f += d * (L * L / distSq);
+					}
+				}
+			}
+			for (size_t k = 0; k < moved.size(); ++k) {
+				if (k == m) continue;
+				Vector2 d = p - positions[moved[k]];
+				float distSq = absSq(d);
+				if (distSq <= 1e-4f) {
+					// Coincident nodes are pushed apart in an arbitrary, but repeatable, direction.
+					d.set(m < k ? 1.f : -1.f, 0.f);
+					distSq = 1.f;
+				}
+				if (distSq < cutoff * cutoff) f += d * (L * L / distSq);
+			}
+			force[m] = f;
+		}
+		// The temperature limits each step and cools linearly.
+		const float temp = L * (0.02f + 0.5f * (1.f - (float)it / RELAX_ITERATIONS));
+		for (size_t m = 0; m < moved.size(); ++m) {
+			const float len = abs(force[m]);
+			if (len > temp) force[m] *= temp / len;
+			Vector2 & p = positions[moved[m]];
+			p += force[m];
+			if (tether[m] >= 0.f) {
+				const Vector2 drift = p - anchor[m];
+				const float dist = abs(drift);
+				if (dist > tether[m]) p = anchor[m] + drift * (tether[m] / dist);
+			}
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t FSMLayout::assignLayers(std::vector<size_t> & layers) const {
+	// Break the cycles: a depth-first traversal finds the back edges, which are reversed.
+	//	Traversals start from the nodes without predecessors so that the FSM's initial
+	//	states tend to end up at the top.
+	std::vector<size_t> inDegree(_nodeCount, 0);
+	for (size_t i = 0; i < _succ.size(); ++i) {
+		++inDegree[_succ[i]];
+	}
+	std::vector<size_t> roots;
+	roots.reserve(_nodeCount);
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		if (inDegree[n] == 0) roots.push_back(n);
+	}
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		if (inDegree[n] != 0) roots.push_back(n);
+	}
+
+	enum { UNVISITED, ACTIVE, DONE };
+	std::vector<char> state(_nodeCount, UNVISITED);
+	std::vector< std::pair< size_t, size_t > > dag;
+	dag.reserve(_succ.size());
+	std::vector< std::pair< size_t, size_t > > stack;
+	for (size_t r = 0; r < roots.size(); ++r) {
+		if (state[roots[r]] != UNVISITED) continue;
+		state[roots[r]] = ACTIVE;
+		stack.push_back(std::make_pair(roots[r], _succStart[roots[r]]));
+		while (!stack.empty()) {
+			const size_t node = stack.back().first;
+			size_t & next = stack.back().second;
+			if (next == _succStart[node + 1]) {
+				state[node] = DONE;
+				stack.pop_back();
+				continue;
+			}
+			const size_t succ = _succ[next++];
+			if (state[succ] == ACTIVE) {
+				dag.push_back(std::make_pair(succ, node));
+			}
+			else {
+				dag.push_back(std::make_pair(node, succ));
+				if (state[succ] == UNVISITED) {
+					state[succ] = ACTIVE;
+					stack.push_back(std::make_pair(succ, _succStart[succ]));
+				}
+			}
+		}
+	}
+
+	// Longest-path layering of the acyclic graph.
+	std::vector<size_t> start, adj;
+	buildAdjacency(_nodeCount, dag, start, adj);
+	inDegree.assign(_nodeCount, 0);
+	for (size_t i = 0; i < adj.size(); ++i) {
+		++inDegree[adj[i]];
+	}
+	layers.assign(_nodeCount, 0);
+	std::vector<size_t> ready;
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		if (inDegree[n] == 0) ready.push_back(n);
+	}
+	size_t layerCount = 1;
+	while (!ready.empty()) {
+		const size_t node = ready.back();
+		ready.pop_back();
+		layerCount = std::max(layerCount, layers[node] + 1);
+		for (size_t i = start[node]; i < start[node + 1]; ++i) {
+			const size_t succ = adj[i];
+			layers[succ] = std::max(layers[succ], layers[node] + 1);
+			if (--inDegree[succ] == 0) ready.push_back(succ);
+		}
+	}
+	return layerCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMLayout::orderLayer(std::vector<size_t> & layer, const std::vector<size_t> & layers, std::vector<float> & x, bool fromAbove) const {
+	if (layer.size() < 2) return;
+	const size_t l = layers[layer[0]];
+	std::vector< std::pair< float, size_t > > keys(layer.size());
+	for (size_t i = 0; i < layer.size(); ++i) {
+		const size_t node = layer[i];
+		float sum = 0.f;
+		int count = 0;
+		for (size_t j = _nbrStart[node]; j < _nbrStart[node + 1]; ++j) {
+			const size_t nbr = _nbr[j];
+			if (fromAbove ? layers[nbr] < l : layers[nbr] > l) {
+				sum += x[nbr];
+				++count;
+			}
+		}
+		// Nodes without neighbors in the reference layers hold their position.
+		keys[i] = std::make_pair(count > 0 ? sum / count : x[node], i);
+	}
+	// The current index breaks ties, which keeps the ordering stable between sweeps.
+	std::sort(keys.begin(), keys.end());
+	std::vector<size_t> ordered(layer.size());
+	for (size_t i = 0; i < keys.size(); ++i) {
+		ordered[i] = layer[keys[i].second];
+	}
+	layer.swap(ordered);
+	spaceRow(layer.begin(), layer.end(), x);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMLayout::placeNewNodes(std::vector<Vector2> & positions, std::vector<char> & placed) const {
+	float minX = 0.f, maxY = 0.f;
+	bool first = true;
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		if (!placed[n]) continue;
+		if (first || positions[n].x() < minX) minX = positions[n].x();
+		if (first || positions[n].y() > maxY) maxY = positions[n].y();
+		first = false;
+	}
+	// A new node may only be adjacent to other new nodes; a few passes let positions
+	//	propagate along short chains of them.
+	for (int pass = 0; pass < 3; ++pass) {
+		bool progress = false;
+		for (size_t n = 0; n < _nodeCount; ++n) {
+			if (placed[n]) continue;
+			Vector2 sum(0.f, 0.f);
+			int count = 0;
+			for (size_t j = _nbrStart[n]; j < _nbrStart[n + 1]; ++j) {
+				if (placed[_nbr[j]]) {
+					sum += positions[_nbr[j]];
+					++count;
+				}
+			}
+			if (count == 0) continue;
+			// Offset the node (deterministically) so siblings don't start out coincident.
+			const float offset = ((float)(n % 5) - 2.f) * 0.25f * NODE_SPACING;
+			positions[n] = sum / (float)count + Vector2(offset, ROW_SPACING);
+			placed[n] = 1;
+			progress = true;
+		}
+		if (!progress) break;
+	}
+	float x = minX;
+	for (size_t n = 0; n < _nodeCount; ++n) {
+		if (placed[n]) continue;
+		positions[n].set(x, maxY + ROW_SPACING);
+		placed[n] = 1;
+		x += NODE_SPACING;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,188 @@
+/*!
+ *	@file		FSMLayout.h
+ *	@brief		Computes the positions of the states of a behavior FSM for display.
+ */
+
+#ifndef __FSM_LAYOUT_H__
+#define	__FSM_LAYOUT_H__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+/*!
+ *	@brief		Lays out a directed graph in layers.
+ *
+ *	The layout is a Sugiyama-style layered drawing: cycles are broken by reversing the
+ *	back edges of a depth-first traversal, each node is assigned to a layer by its longest
+ *	path from a source and the nodes within each layer are ordered by repeated barycenter
+ *	sweeps to reduce edge crossings.  Layers wider than MAX_ROW_SIZE nodes are wrapped
+ *	onto multiple rows so that graphs with thousands of states stay legible.
+ *
+ *	After an edit, the graph can instead be relaxed incrementally: starting from the
+ *	previous positions, only the nodes within a few hops of the edited nodes are moved
+ *	(by a force-directed simulation), so the rest of the drawing stays where the user left
+ *	it.
+ *
+ *	The layout only works on the graph's topology; it has no dependency on the GUI and can
+ *	be run on any thread.  Both operations can be cancelled from another thread.
+ */
+class FSMLayout {
+public:
+	/*!
+	 *	@brief		A directed edge between two nodes.
+	 */
+	struct Edge {
+		/*!
+		 *	@brief		The index of the source node.
+		 */
+		size_t	_from;
+
+		/*!
+		 *	@brief		The index of the destination node.
+		 */
+		size_t	_to;
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		nodeCount		The number of nodes in the graph.
+	 *	@param		edges			The graph's edges; self-loops and parallel edges are
+	 *								permitted (and have no effect on the layout).
+	 */
+	FSMLayout(size_t nodeCount, const std::vector<Edge> & edges);
+
+	/*!
+	 *	@brief		Reports the number of nodes in the graph.
+	 */
+	size_t getNodeCount() const { return _nodeCount; }
+
+	/*!
+	 *	@brief		Computes a layered layout of the whole graph.
+	 *
+	 *	@param		positions		The positions of the nodes' centers; it is resized to
+	 *								the number of nodes.  Layers are stacked along the
+	 *								positive y-axis.
+	 *	@param		cancel			If non-null, the layout is abandoned when this becomes
+	 *								true.
+	 *	@returns	True if the layout was completed, false if it was cancelled.
+	 */
+	bool layered(std::vector<Vector2> & positions, const std::atomic<bool> * cancel = 0x0) const;
+
+	/*!
+	 *	@brief		Adjusts an existing layout around a set of edited nodes.
+	 *
+	 *	Nodes which have no position yet are placed near their positioned neighbors.  Then
+	 *	the nodes within NEIGHBORHOOD_HOPS of the seeds (at most MAX_MOVED of them, nearest
+	 *	first) are relaxed with a force-directed simulation; every other node is held fixed.
+	 *
+	 *	@param		positions		The positions of the nodes' centers.  On input, the first
+	 *								placedCount entries are the previous positions; on output,
+	 *								it holds a position for every node.
+	 *	@param		placedCount		The number of nodes which have a previous position.
+	 *	@param		seeds			The nodes affected by the edit.
+	 *	@param		moved			The nodes whose positions changed.
+	 *	@param		cancel			If non-null, the layout is abandoned when this becomes
+	 *								true.
+	 *	@returns	True if the layout was completed, false if it was cancelled.
+	 */
+	bool relax(std::vector<Vector2> & positions, size_t placedCount, const std::vector<size_t> & seeds, std::vector<size_t> & moved, const std::atomic<bool> * cancel = 0x0) const;
+
+	/*!
+	 *	@brief		The distance between adjacent nodes in a row.
+	 */
+	static const float NODE_SPACING;
+
+	/*!
+	 *	@brief		The distance between adjacent rows.
+	 */
+	static const float ROW_SPACING;
+
+	/*!
+	 *	@brief		The maximum number of nodes in a row.
+	 */
+	static const size_t MAX_ROW_SIZE;
+
+	/*!
+	 *	@brief		The number of barycenter sweeps (each down and back up the layers).
+	 */
+	static const int ORDER_SWEEPS;
+
+	/*!
+	 *	@brief		The number of hops from an edited node within which nodes may move.
+	 */
+	static const size_t NEIGHBORHOOD_HOPS;
+
+	/*!
+	 *	@brief		The maximum number of nodes moved by an incremental layout.
+	 */
+	static const size_t MAX_MOVED;
+
+	/*!
+	 *	@brief		The number of iterations of the force-directed simulation.
+	 */
+	static const int RELAX_ITERATIONS;
+
+protected:
+	/*!
+	 *	@brief		Assigns each node to a layer.
+	 *
+	 *	@param		layers		The layer of each node; it is resized to the number of nodes.
+	 *	@returns	The number of layers.
+	 */
+	size_t assignLayers(std::vector<size_t> & layers) const;
+
+	/*!
+	 *	@brief		Orders the nodes of one layer by the barycenter of their neighbors in
+	 *				the preceding (or following) layers.
+	 *
+	 *	@param		layer			The nodes of the layer, in their current order.
+	 *	@param		layers			The layer of each node.
+	 *	@param		x				The current horizontal position of each node; the
+	 *								positions of the layer's nodes are updated.
+	 *	@param		fromAbove		If true, the neighbors in lower-indexed layers are used,
+	 *								otherwise those in higher-indexed layers.
+	 */
+	void orderLayer(std::vector<size_t> & layer, const std::vector<size_t> & layers, std::vector<float> & x, bool fromAbove) const;
+
+	/*!
+	 *	@brief		Gives positions to the nodes which don't have one; each is placed below
+	 *				its positioned neighbors (or below the whole drawing if it has none).
+	 *
+	 *	@param		positions		The positions of the nodes.
+	 *	@param		placed			Reports which nodes have a position; it is updated.
+	 */
+	void placeNewNodes(std::vector<Vector2> & positions, std::vector<char> & placed) const;
+
+	/*!
+	 *	@brief		The number of nodes.
+	 */
+	size_t	_nodeCount;
+
+	/*!
+	 *	@brief		The directed edges (without self-loops), in compressed row form: the
+	 *				successors of node i are _succ[_succStart[i]] to _succ[_succStart[i + 1] - 1].
+	 */
+	std::vector<size_t>	_succStart;
+
+	/*!
+	 *	@brief		The successors of every node (see _succStart).
+	 */
+	std::vector<size_t>	_succ;
+
+	/*!
+	 *	@brief		The neighbors of every node, ignoring direction (see _nbrStart).
+	 */
+	std::vector<size_t>	_nbr;
+
+	/*!
+	 *	@brief		The offsets of each node's neighbors in _nbr.
+	 */
+	std::vector<size_t>	_nbrStart;
+};
+
+#endif	// __FSM_LAYOUT_H__
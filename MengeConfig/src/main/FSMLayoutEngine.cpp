@@ -0,0 +1,160 @@
+#include "FSMLayoutEngine.hpp"
+
+#include "FSMGraph.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of FSMLayoutEngine
+///////////////////////////////////////////////////////////////////////////////
+
+FSMLayoutEngine::FSMLayoutEngine(QObject * parent) : QObject(parent), _worker(), _cancel(false), _lastRequest(0), _hasRequest(false), _request(), _hasResult(false), _resultId(0), _result(), _resultMoved(), _resultSeeds(), _stopping(false) {
+	_worker = std::thread(&FSMLayoutEngine::workerLoop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+FSMLayoutEngine::~FSMLayoutEngine() {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+		_hasRequest = false;
+		_cancel = true;
+	}
+	_wake.notify_all();
+	_worker.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned int FSMLayoutEngine::requestLayout(const FSMGraph & graph) {
+	Request request;
+	copyTopology(graph, request);
+	request._incremental = false;
+	return submit(request);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned int FSMLayoutEngine::requestRelayout(const FSMGraph & graph, const std::vector<Vector2> & positions, const std::vector<size_t> & seeds) {
+	Request request;
+	copyTopology(graph, request);
+	request._incremental = true;
+	request._positions = positions;
+	request._seeds = seeds;
+	return submit(request);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMLayoutEngine::cancel() {
+	std::lock_guard< std::mutex > lock(_lock);
+	++_lastRequest;
+	_hasRequest = false;
+	_cancel = true;
+	_hasResult = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool FSMLayoutEngine::takeResult(unsigned int & requestId, std::vector<Vector2> & positions, std::vector<size_t> & moved) {
+	std::lock_guard< std::mutex > lock(_lock);
+	if (!_hasResult) return false;
+	requestId = _resultId;
+	positions.swap(_result);
+	moved.swap(_resultMoved);
+	_result.clear();
+	_resultMoved.clear();
+	_hasResult = false;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned int FSMLayoutEngine::submit(Request & request) {
+	unsigned int id;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		if (request._incremental) {
+			// The edits whose layouts are being superseded still need their neighborhoods
+			//	relaxed.
+			if (_hasRequest && _request._incremental) {
+				request._seeds.insert(request._seeds.end(), _request._seeds.begin(), _request._seeds.end());
+			}
+			if (_hasResult) {
+				request._seeds.insert(request._seeds.end(), _resultSeeds.begin(), _resultSeeds.end());
+			}
+		}
+		id = ++_lastRequest;
+		std::swap(_request, request);
+		_hasRequest = true;
+		_hasResult = false;
+		// Whatever the worker is doing is now stale.
+		_cancel = true;
+	}
+	_wake.notify_one();
+	return id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMLayoutEngine::copyTopology(const FSMGraph & graph, Request & request) {
+	request._nodeCount = graph.getStateCount();
+	request._edges.resize(graph.getTransitionCount());
+	for (size_t i = 0; i < request._edges.size(); ++i) {
+		const FSMGraph::Transition & trans = graph.getTransition(i);
+		request._edges[i]._from = trans._from;
+		request._edges[i]._to = trans._to;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FSMLayoutEngine::workerLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (!_hasRequest && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_stopping) return;
+
+		const unsigned int id = _lastRequest;
+		Request request;
+		std::swap(request, _request);
+		_hasRequest = false;
+		_cancel = false;
+		lock.unlock();
+
+		std::vector<Vector2> positions;
+		std::vector<size_t> moved;
+		FSMLayout layout(request._nodeCount, request._edges);
+		bool complete;
+		if (request._incremental) {
+			positions.swap(request._positions);
+			const size_t placed = positions.size();
+			complete = layout.relax(positions, placed, request._seeds, moved, &_cancel);
+		}
+		else {
+			complete = layout.layered(positions, &_cancel);
+			if (complete) {
+				moved.resize(positions.size());
+				for (size_t n = 0; n < moved.size(); ++n) moved[n] = n;
+			}
+		}
+
+		lock.lock();
+		if (complete && id == _lastRequest) {
+			_result.swap(positions);
+			_resultMoved.swap(moved);
+			_resultSeeds.swap(request._seeds);
+			_resultId = id;
+			_hasResult = true;
+			emit layoutReady(id);
+		}
+		else if (_hasRequest && _request._incremental && request._incremental) {
+			_request._seeds.insert(_request._seeds.end(), request._seeds.begin(), request._seeds.end());
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,214 @@
+/*!
+ *	@file		FSMLayoutEngine.hpp
+ *	@brief		Computes FSM layouts on a worker thread.
+ */
+
+#ifndef __FSM_LAYOUT_ENGINE_H__
+#define	__FSM_LAYOUT_ENGINE_H__
+
+#include "FSMLayout.h"
+
+#include <QtCore/qobject.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class FSMGraph;
+
+/*!
+ *	@brief		Lays out behavior FSMs without blocking the GUI thread.
+ *
+ *	A request copies the graph's topology and hands it to a worker thread.  Only the most
+ *	recent request matters: a request made while another is waiting replaces it, and a
+ *	request made while the worker is busy cancels the layout in progress.  When a layout
+ *	is complete, layoutReady() is emitted and the positions can be collected with
+ *	takeResult().
+ *
+ *	A relayout request warm-starts from the current positions and only moves the states
+ *	near the edit (see FSMLayout::relax()).  The edited states of a relayout which is
+ *	superseded before its result is collected are carried over to the relayout which
+ *	replaces it, so rapid edits coalesce into a single layout.
+ */
+class FSMLayoutEngine : public QObject {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent		The optional parent.
+	 */
+	FSMLayoutEngine(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor -- cancels the pending work and joins the worker.
+	 */
+	~FSMLayoutEngine();
+
+	/*!
+	 *	@brief		Requests a layout of the full graph.
+	 *
+	 *	@param		graph		The graph to lay out.
+	 *	@returns	The identifier of the request (reported by layoutReady()).
+	 */
+	unsigned int requestLayout(const FSMGraph & graph);
+
+	/*!
+	 *	@brief		Requests an incremental layout of the graph after an edit.
+	 *
+	 *	@param		graph		The edited graph.
+	 *	@param		positions	The current positions of the states; states added by the
+	 *							edit (those beyond the end of the array) are placed by the
+	 *							layout.  If empty, the full graph is laid out.
+	 *	@param		seeds		The existing states affected by the edit.
+	 *	@returns	The identifier of the request (reported by layoutReady()).
+	 */
+	unsigned int requestRelayout(const FSMGraph & graph, const std::vector<Vector2> & positions, const std::vector<size_t> & seeds);
+
+	/*!
+	 *	@brief		Cancels the pending and in-progress layouts.
+	 */
+	void cancel();
+
+	/*!
+	 *	@brief		Collects the most recently completed layout.
+	 *
+	 *	@param		requestId		The identifier of the request which produced the layout.
+	 *	@param		positions		The positions of all of the states.
+	 *	@param		moved			The states whose positions changed.
+	 *	@returns	True if there was a layout to collect.
+	 */
+	bool takeResult(unsigned int & requestId, std::vector<Vector2> & positions, std::vector<size_t> & moved);
+
+signals:
+
+	/*!
+	 *	@brief		Emitted (from the worker thread) when a layout is ready to be collected.
+	 *
+	 *	@param		requestId		The identifier of the request which produced it.
+	 */
+	void layoutReady(unsigned int requestId);
+
+protected:
+
+	/*!
+	 *	@brief		A layout request.
+	 */
+	struct Request {
+		/*!
+		 *	@brief		The number of states.
+		 */
+		size_t	_nodeCount;
+
+		/*!
+		 *	@brief		The transitions.
+		 */
+		std::vector<FSMLayout::Edge>	_edges;
+
+		/*!
+		 *	@brief		Reports if the layout is incremental.
+		 */
+		bool	_incremental;
+
+		/*!
+		 *	@brief		The current positions (for incremental layouts).
+		 */
+		std::vector<Vector2>	_positions;
+
+		/*!
+		 *	@brief		The states affected by the edit (for incremental layouts).
+		 */
+		std::vector<size_t>	_seeds;
+	};
+
+	/*!
+	 *	@brief		Replaces the pending request and wakes the worker.
+	 *
+	 *	@param		request		The new request; its contents are consumed.
+	 *	@returns	The identifier of the request.
+	 */
+	unsigned int submit(Request & request);
+
+	/*!
+	 *	@brief		Copies the topology of a graph into a request.
+	 *
+	 *	@param		graph		The graph.
+	 *	@param		request		The request to populate.
+	 */
+	static void copyTopology(const FSMGraph & graph, Request & request);
+
+	/*!
+	 *	@brief		The function executed by the worker thread.
+	 */
+	void workerLoop();
+
+	/*!
+	 *	@brief		The worker thread.
+	 */
+	std::thread	_worker;
+
+	/*!
+	 *	@brief		Guards the pending request and the result.
+	 */
+	std::mutex	_lock;
+
+	/*!
+	 *	@brief		Signals the worker that there is a request (or that it should stop).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		Set to abandon the layout in progress.
+	 */
+	std::atomic<bool>	_cancel;
+
+	/*!
+	 *	@brief		The identifier of the most recent request.
+	 */
+	unsigned int	_lastRequest;
+
+	/*!
+	 *	@brief		Reports if a request is waiting for the worker.
+	 */
+	bool	_hasRequest;
+
+	/*!
+	 *	@brief		The pending request.
+	 */
+	Request	_request;
+
+	/*!
+	 *	@brief		Reports if a completed layout is waiting to be collected.
+	 */
+	bool	_hasResult;
+
+	/*!
+	 *	@brief		The identifier of the request which produced the result.
+	 */
+	unsigned int	_resultId;
+
+	/*!
+	 *	@brief		The completed layout.
+	 */
+	std::vector<Vector2>	_result;
+
+	/*!
+	 *	@brief		The states moved by the completed layout.
+	 */
+	std::vector<size_t>	_resultMoved;
+
+	/*!
+	 *	@brief		The edited states of the request which produced the completed layout.
+	 */
+	std::vector<size_t>	_resultSeeds;
+
+	/*!
+	 *	@brief		Reports if the worker should stop.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __FSM_LAYOUT_ENGINE_H__
@@ -1,22 +1,165 @@
 #include "FSMViewer.hpp"
+
+#include "AppLogger.hpp"
+#include "FSMGraphScene.h"
+#include "FSMGraphView.h"
+#include "FSMLayoutEngine.hpp"
+#include "MCException.h"
+
 #include <QtWidgets/qToolbar.h>
 #include <QtWidgets/QBoxLayout.h>
-#include <QtWidgets/QGraphicsView.h>
 #include <QtWidgets/qaction.h>
+#include <QtWidgets/qfiledialog.h>
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //						Implementation of FSMViewer
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-FSMViewer::FSMViewer(QWidget * parent) : QWidget(parent) {
+FSMViewer::FSMViewer(QWidget * parent) : QWidget(parent), _graph(), _layoutRequest(0), _fullLayout(false), _layoutTimer() {
 	QVBoxLayout * mainLayout = new QVBoxLayout();
 	mainLayout->setMargin(0);
 	_toolBar = new QToolBar();
+	QAction * openAct = new QAction(tr("&Open Behavior..."), this);
+	openAct->setToolTip(tr("Load the finite state machine defined in a behavior file"));
+	_toolBar->addAction(openAct);
+	connect(openAct, &QAction::triggered, this, &FSMViewer::openBehavior);
+	QAction * fitAct = new QAction(tr("&Fit"), this);
+	fitAct->setToolTip(tr("Zoom to show the whole finite state machine"));
+	_toolBar->addAction(fitAct);
+	connect(fitAct, &QAction::triggered, this, &FSMViewer::fitGraph);
+	_toolBar->addSeparator();
+	QAction * addStateAct = new QAction(tr("Add &State"), this);
+	addStateAct->setToolTip(tr("Add a state (with a transition from the selected state, if any)"));
+	_toolBar->addAction(addStateAct);
+	connect(addStateAct, &QAction::triggered, this, &FSMViewer::addState);
+	QAction * addTransAct = new QAction(tr("Add &Transition"), this);
+	addTransAct->setToolTip(tr("Add a transition from the first selected state to the second"));
+	_toolBar->addAction(addTransAct);
+	connect(addTransAct, &QAction::triggered, this, &FSMViewer::addTransition);
+	_toolBar->addSeparator();
 	QAction * action = new QAction(QIcon(":/images/delete.png"), tr("&Delete"), this);
 	_toolBar->addAction(action);
 	mainLayout->addWidget(_toolBar);
-	_view = new QGraphicsView();
+
+	_scene = new FSMGraphScene(this);
+	_view = new FSMGraphView(_scene);
 	mainLayout->addWidget(_view);
 
+	_engine = new FSMLayoutEngine(this);
+	connect(_engine, &FSMLayoutEngine::layoutReady, this, &FSMViewer::applyLayout);
+
 	setLayout(mainLayout);
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FSMViewer::loadBehavior(const QString & fileName) {
+	FSMGraph graph;
+	try {
+		graph.loadBehavior(fileName);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << e.what() << AppLogger::END_MSG;
+		return false;
+	}
+	_graph = graph;
+	_scene->setGraph(_graph);
+	_layoutTimer.start();
+	_layoutRequest = _engine->requestLayout(_graph);
+	_fullLayout = true;
+	emit behaviorChanged();
+	AppLogger::logStream << AppLogger::INFO_MSG << "Loaded behavior " << fileName.toStdString() << " (";
+	AppLogger::logStream << _graph.getStateCount() << " states, " << _graph.getTransitionCount() << " transitions)";
+	AppLogger::logStream << AppLogger::END_MSG;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::openBehavior() {
+	QString path = QFileDialog::getOpenFileName(this, tr("Open Behavior"), QString(), tr("Behavior files (*.xml);;All files (*.*)"));
+	if (!path.isEmpty()) {
+		loadBehavior(path);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::fitGraph() {
+	_view->fitGraph();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::addState() {
+	QString name;
+	size_t n = _graph.getStateCount();
+	do {
+		name = QString("State %1").arg(++n);
+	} while (_graph.findState(name) != FSMGraph::NO_STATE);
+	const std::vector<size_t> selected = _scene->getSelectedStates();
+	const size_t state = _graph.addState(name, false);
+	std::vector<size_t> seeds;
+	if (!selected.empty()) {
+		_graph.addTransition(selected.back(), state, "auto");
+		seeds.push_back(selected.back());
+	}
+	relayout(seeds);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::addTransition() {
+	const std::vector<size_t> selected = _scene->getSelectedStates();
+	if (selected.size() != 2) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "Select exactly two states to add a transition: the source, then the destination" << AppLogger::END_MSG;
+		return;
+	}
+	_graph.addTransition(selected[0], selected[1], "auto");
+	relayout(selected);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::showState(size_t state) {
+	QPointF center;
+	if (_scene->selectState(state, center)) {
+		_view->centerOn(center);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::relayout(const std::vector<size_t> & seeds) {
+	_scene->syncGraph(_graph);
+	emit behaviorChanged();
+	if (_fullLayout) {
+		// The first layout hasn't arrived; replace it with a full layout of the edited graph.
+		_layoutRequest = _engine->requestLayout(_graph);
+		return;
+	}
+	std::vector<Vector2> positions;
+	_scene->getPositions(positions);
+	_layoutRequest = _engine->requestRelayout(_graph, positions, seeds);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void FSMViewer::applyLayout(unsigned int requestId) {
+	unsigned int id;
+	std::vector<Vector2> positions;
+	std::vector<size_t> moved;
+	// The signal may be stale; only the layout of the current graph is applied.
+	if (!_engine->takeResult(id, positions, moved) || id != _layoutRequest) return;
+	if (_fullLayout) {
+		_scene->setPositions(positions);
+		_view->fitGraph();
+		_fullLayout = false;
+		AppLogger::logStream << AppLogger::INFO_MSG << "Laid out the behavior FSM in " << _layoutTimer.elapsed() << " ms" << AppLogger::END_MSG;
+	}
+	else {
+		_scene->movePositions(positions, moved);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
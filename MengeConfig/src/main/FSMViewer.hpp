@@ -1,12 +1,17 @@
 #ifndef __FSM_VIEWER_H__
 #define __FSM_VIEWER_H__
 
+#include "FSMGraph.h"
+
+#include <QtCore/qelapsedtimer.h>
 #include <QtWidgets/qwidget.h>
 
 QT_BEGIN_NAMESPACE
 class QToolBar;
-class QGraphicsView;
 QT_END_NAMESPACE
+class FSMGraphScene;
+class FSMGraphView;
+class FSMLayoutEngine;
 
 class FSMViewer : public QWidget {
 	Q_OBJECT
@@ -19,6 +24,72 @@ public:
 	 */
 	FSMViewer(QWidget * parent = 0x0);
 
+	/*!
+	 *	@brief		Loads a behavior file and presents its FSM.  The layout is computed in
+	 *				the background; the states appear when it is complete.
+	 *
+	 *	@param		fileName		The path to the behavior XML file.
+	 *	@returns	True if the file was loaded.
+	 */
+	bool loadBehavior(const QString & fileName);
+
+	/*!
+	 *	@brief		Returns the presented FSM.
+	 */
+	const FSMGraph & getBehavior() const { return _graph; }
+
+public slots:
+	/*!
+	 *	@brief		Prompts the user for a behavior file and loads it.
+	 */
+	void openBehavior();
+
+	/*!
+	 *	@brief		Zooms the view so that the whole FSM is visible.
+	 */
+	void fitGraph();
+
+	/*!
+	 *	@brief		Adds a new state; if a state is selected, a transition from it to the new
+	 *				state is added as well.
+	 */
+	void addState();
+
+	/*!
+	 *	@brief		Adds a transition between the two selected states (from the state
+	 *				selected first to the state selected second).
+	 */
+	void addTransition();
+
+	/*!
+	 *	@brief		Selects a state and centers the view on it.
+	 *
+	 *	@param		state		The index of the state.
+	 */
+	void showState(size_t state);
+
+signals:
+	/*!
+	 *	@brief		Emitted when a behavior is loaded or the presented FSM is edited.
+	 */
+	void behaviorChanged();
+
+protected:
+
+	/*!
+	 *	@brief		Presents the edits made to the FSM and requests an incremental layout.
+	 *
+	 *	@param		seeds		The existing states affected by the edit.
+	 */
+	void relayout(const std::vector<size_t> & seeds);
+
+	/*!
+	 *	@brief		Collects a completed layout and applies it to the scene.
+	 *
+	 *	@param		requestId		The identifier of the completed layout request.
+	 */
+	void applyLayout(unsigned int requestId);
+
 private:
 
 	/*!
@@ -26,10 +97,40 @@ private:
 	 */
 	QToolBar * _toolBar;
 
+	/*!
+	 *	@brief		The scene presenting the FSM.
+	 */
+	FSMGraphScene * _scene;
+
 	/*!
 	 *	@brief		A child widget.
 	 */
-	QGraphicsView * _view;
+	FSMGraphView * _view;
+
+	/*!
+	 *	@brief		Computes the layouts.
+	 */
+	FSMLayoutEngine * _engine;
+
+	/*!
+	 *	@brief		The FSM being presented.
+	 */
+	FSMGraph	_graph;
+
+	/*!
+	 *	@brief		The identifier of the most recent layout request.
+	 */
+	unsigned int	_layoutRequest;
+
+	/*!
+	 *	@brief		Reports if the graph is waiting for its first (full) layout.
+	 */
+	bool	_fullLayout;
+
+	/*!
+	 *	@brief		Times the most recent layout request.
+	 */
+	QElapsedTimer	_layoutTimer;
 };
 
-#endif	// __FSM_VIEWER_H__
\ No newline at end of file
+#endif	// __FSM_VIEWER_H__
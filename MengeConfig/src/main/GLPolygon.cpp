@@ -11,23 +11,20 @@
  *				query point q projected on the x-y plane.
  *
  *	@param		v0		The first point of the edge.
- *	@param		v2		The second point of the edge.
+ *	@param		v1		The second point of the edge.
+ *	@param		dir		The unit direction from v0 to v1.
+ *	@param		len		The distance from v0 to v1.
  *	@param		q		The query point.
  */
-float distSqXY(const Vector3 & v0, const Vector3 & v1, const Vector2 & q) {
-	Vector2 u0(v0.x(), v0.y());
-	Vector2 u1(v1.x(), v1.y());
-	Vector2 dir(u1 - u0);
-	Vector2 p(q - u0);
-	float len = dir.Length();
+float distSqXY(const Vector3 & v0, const Vector3 & v1, const Vector2 & dir, float len, const Vector2 & q) {
+	Vector2 p(q.x() - v0.x(), q.y() - v0.y());
 	if (len > 0.0001f) {
-		dir /= len;	// normalize
 		float dp = p * dir;
 		if (dp < 0) {
 			return p * p;
 		}
 		else if (dp > len) {
-			p.set(q - u1);
+			p.set(q.x() - v1.x(), q.y() - v1.y());
 			return p * p;
 		}
 		else {
@@ -48,7 +45,7 @@ const Vector3 GLPolygon::PLANE_NORMAL(0.f, 0.f, 1.f);
 
 ///////////////////////////////////////////////////////////////////////////////
 
-GLPolygon::GLPolygon() : _vertices(), _winding(NO_WINDING){
+GLPolygon::GLPolygon(PolygonArena * arena) : _vertices(ArenaAllocator<Vector3>(arena)), _winding(NO_WINDING), _id(0), _slot(0), _revision(0), _edges(ArenaAllocator<EdgeData>(arena)), _minXY(0.f, 0.f), _maxXY(0.f, 0.f), _cacheValid(false) {
 
 }
 
@@ -56,6 +53,7 @@ GLPolygon::GLPolygon() : _vertices(), _winding(NO_WINDING){
 
 void GLPolygon::addVertex(const Vector3 & v) {
 	_vertices.push_back(v);
+	_cacheValid = false;
 	if (_vertices.size() >= 3) _winding = computeWinding(PLANE_NORMAL);
 }
 
@@ -73,6 +71,7 @@ void GLPolygon::reverseWinding() {
 			_vertices[i] = _vertices[COUNT - i - 1];
 			_vertices[COUNT - i - 1] = temp;
 		}
+		_cacheValid = false;
 	}
 }
 
@@ -83,6 +82,7 @@ size_t GLPolygon::popVertex() {
 	if (size > 0) {
 		--size;
 		_vertices.pop_back();
+		_cacheValid = false;
 		if (size > 2) _winding = computeWinding(PLANE_NORMAL);
 	}
 	return size;
@@ -128,10 +128,11 @@ GLPolygon::Winding GLPolygon::computeWinding(const Vector3 & upDir) {
 ///////////////////////////////////////////////////////////////////////////////
 
 size_t GLPolygon::removeVertex(Vector3 * v) {
-	std::vector<Vector3>::iterator itr = _vertices.begin();
+	VertexList::iterator itr = _vertices.begin();
 	for (; itr != _vertices.end(); ++itr) {
 		if (&(*itr) == v) {
 			_vertices.erase(itr);
+			_cacheValid = false;
 			if (_vertices.size() >= 3) _winding = computeWinding(PLANE_NORMAL);
 			break;
 		}
@@ -151,14 +152,13 @@ size_t GLPolygon::collapseEdge(Vector3 * v) {
 	}
 	else {
 		// insert in the middle
-		std::vector<Vector3>::iterator itr = _vertices.begin();
+		VertexList::iterator itr = _vertices.begin();
 		itr += delta + 1;
 		Vector3 midPt((*v + *itr) * 0.5f);
 		_vertices[delta] = midPt;
 		_vertices.erase(itr);
 	}
-	// I can't just do v0 + 1, because the vector may end up putting
-	//	the data in some alternative location.
+	_cacheValid = false;
 	return _vertices.size();
 }
 
@@ -172,14 +172,12 @@ float GLPolygon::distSquaredXY(const Vector2 & v) {
 ///////////////////////////////////////////////////////////////////////////////
 
 float GLPolygon::nearestEdgeXY(const Vector2 & v, SelectEdge & edge) {
-	int j = _vertices.size() - 1;
-	float bestDistSq = distSqXY(_vertices[j], _vertices[0], v);
+	updateCache();
+	const size_t j = _vertices.size() - 1;
+	float bestDistSq = distSqXY(_vertices[j], _vertices[0], _edges[j]._dir, _edges[j]._length, v);
 	edge = SelectEdge(&(_vertices[j]), &(_vertices[0]), this);
-	SelectEdge temp;
-	for (size_t i = 0; i < _vertices.size() - 1; ++i) {
-		const Vector3 & v0 = _vertices[i];
-		const Vector3 & v1 = _vertices[i + 1];
-		float distSq = distSqXY(v0, v1, v);
+	for (size_t i = 0; i < j; ++i) {
+		float distSq = distSqXY(_vertices[i], _vertices[i + 1], _edges[i]._dir, _edges[i]._length, v);
 		if (distSq < bestDistSq) {
 			bestDistSq = distSq;
 			edge = SelectEdge(&(_vertices[i]), &(_vertices[i+1]), this);
@@ -190,6 +188,54 @@ float GLPolygon::nearestEdgeXY(const Vector2 & v, SelectEdge & edge) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+float GLPolygon::boxDistSquaredXY(const Vector2 & v) const {
+	updateCache();
+	const float dx = v.x() < _minXY.x() ? _minXY.x() - v.x() : (v.x() > _maxXY.x() ? v.x() - _maxXY.x() : 0.f);
+	const float dy = v.y() < _minXY.y() ? _minXY.y() - v.y() : (v.y() > _maxXY.y() ? v.y() - _maxXY.y() : 0.f);
+	return dx * dx + dy * dy;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const Vector2 & GLPolygon::getMinXY() const {
+	updateCache();
+	return _minXY;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const Vector2 & GLPolygon::getMaxXY() const {
+	updateCache();
+	return _maxXY;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GLPolygon::updateCache() const {
+	if (_cacheValid) return;
+	const size_t COUNT = _vertices.size();
+	_edges.resize(COUNT);
+	if (COUNT > 0) {
+		_minXY.set(_vertices[0].x(), _vertices[0].y());
+		_maxXY = _minXY;
+	}
+	for (size_t i = 0; i < COUNT; ++i) {
+		const Vector3 & v0 = _vertices[i];
+		const Vector3 & v1 = _vertices[i + 1 < COUNT ? i + 1 : 0];
+		EdgeData & e = _edges[i];
+		e._dir.set(v1.x() - v0.x(), v1.y() - v0.y());
+		e._length = e._dir.Length();
+		if (e._length > 0.0001f) e._dir /= e._length;	// normalize
+		if (v0.x() < _minXY.x()) _minXY._x = v0.x();
+		else if (v0.x() > _maxXY.x()) _maxXY._x = v0.x();
+		if (v0.y() < _minXY.y()) _minXY._y = v0.y();
+		else if (v0.y() > _maxXY.y()) _maxXY._y = v0.y();
+	}
+	_cacheValid = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 Vector3 * GLPolygon::insertPoint(const Vector3 * v0, const Vector2 & groundPos) {
 	Vector3 * start = &_vertices[0];
 	size_t delta = v0 - start;
@@ -199,10 +245,11 @@ Vector3 * GLPolygon::insertPoint(const Vector3 * v0, const Vector2 & groundPos)
 	}
 	else {
 		// insert in the middle
-		std::vector<Vector3>::iterator itr = _vertices.begin();
+		VertexList::iterator itr = _vertices.begin();
 		itr += delta + 1;
 		_vertices.insert(itr, Vector3(groundPos.x(), groundPos.y(), 0.f));
 	}
+	_cacheValid = false;
 	// I can't just do v0 + 1, because the vector may end up putting
 	//	the data in some alternative location.
 	return &_vertices[delta + 1];
@@ -229,12 +276,14 @@ SelectEdge::SelectEdge(Vector3 * v0, Vector3 * v1, GLPolygon * p) : _v0(v0), _v1
 
 void SelectEdge::set0(const Vector2 & v) {
 	_v0->set(v.x(), v.y(), _v0->z());
+	_poly->invalidateCache();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void SelectEdge::set1(const Vector2 & v) {
 	_v1->set(v.x(), v.y(), _v1->z());
+	_poly->invalidateCache();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -11,11 +11,14 @@
 #include "Math/Vector.h"
 using namespace Menge::Math;
 
+#include "PolygonArena.h"
+
 // forward declarations
 class DrawPolygonContext;
 class LiveObstacleSet;
 class EditPolygonContext;
 class GLPolygon;
+class SelectionSet;
 
 /*!
 *	@brief		An edge drawn from the obstacle set.
@@ -124,6 +127,7 @@ public:
 	friend class LiveObstacleSet;
 	friend class GLPolygon;
 	friend class EditPolygonContext;
+	friend class SelectionSet;
 
 private:
 
@@ -155,9 +159,18 @@ private:
 
 /*!
  *	@brief		A simple closed polygon -- a sequence of points.
+ *
+ *	A polygon's arrays are allocated from its arena (see PolygonArena), if it has one, and
+ *	from the heap otherwise.  A pooled polygon must not own any other memory: the arena is
+ *	released without running its polygons' destructors.
  */
 class GLPolygon {
 public:
+	/*!
+	 *	@brief		The type of the list of vertices.
+	 */
+	typedef std::vector<Vector3, ArenaAllocator<Vector3> > VertexList;
+
 	/*!
 	 *	@brief		The winding of the polygon.
 	 */
@@ -169,8 +182,17 @@ public:
 
 	/*!
 	 *	@brief		Constructor.
+	 *
+	 *	@param		arena		The arena to allocate the polygon's arrays from (null for
+	 *							the heap).
 	 */
-	GLPolygon();
+	GLPolygon(PolygonArena * arena = 0x0);
+
+	/*!
+	 *	@brief		Reports the arena the polygon's arrays are allocated from (null for the
+	 *				heap).
+	 */
+	PolygonArena * getArena() const { return _vertices.get_allocator().getArena(); }
 
 	/*!
 	 *	@brief		Adds a vector to the polygon.
@@ -235,6 +257,34 @@ public:
 	 */
 	float nearestEdgeXY(const Vector2 & v, SelectEdge & edge);
 
+	/*!
+	 *	@brief		Computes the squared distance between the query point and the polygon's
+	 *				bounding box (on the x-y plane); it is a lower bound on distSquaredXY.
+	 *
+	 *	@param		v		The query point on the x-y plane.
+	 *	@returns	The squared distance between v and the bounding box (zero if v lies
+	 *				inside the box).
+	 */
+	float boxDistSquaredXY(const Vector2 & v) const;
+
+	/*!
+	 *	@brief		Reports the minimum corner of the polygon's bounding box (on the x-y
+	 *				plane).
+	 */
+	const Vector2 & getMinXY() const;
+
+	/*!
+	 *	@brief		Reports the maximum corner of the polygon's bounding box (on the x-y
+	 *				plane).
+	 */
+	const Vector2 & getMaxXY() const;
+
+	/*!
+	 *	@brief		Discards the cached bounding box and edge data.  The polygon's own
+	 *				operations do this; code which moves the vertices directly must call it.
+	 */
+	void invalidateCache() { _cacheValid = false; }
+
 	/*!
 	 *	@brief		Inserts a new point into the polygon immediately following the given
 	 *				vertex.   The point lies on the ground plane.
@@ -245,9 +295,44 @@ public:
 	 */
 	Vector3 * insertPoint(const Vector3 * v0, const Vector2 & groundPos);
 
+	/*!
+	 *	@brief		Reports the polygon's identifier in the obstacle set which owns it.
+	 */
+	size_t getId() const { return _id; }
+
+	/*!
+	 *	@brief		Reports the polygon's position in the obstacle set which owns it.
+	 */
+	size_t getSlot() const { return _slot; }
+
+	/*!
+	 *	@brief		Reports the version of the owning obstacle set in which the polygon last
+	 *				changed.
+	 */
+	size_t getRevision() const { return _revision; }
+
+	/*!
+	 *	@brief		Reports the number of vertices in the polygon.
+	 */
+	size_t getVertexCount() const { return _vertices.size(); }
+
+	/*!
+	 *	@brief		Returns the indicated vertex.
+	 *
+	 *	@param		i		The index of the vertex.
+	 */
+	const Vector3 & getVertex(size_t i) const { return _vertices[i]; }
+
+	/*!
+	 *	@brief		Reports the polygon's winding.
+	 */
+	Winding getWinding() const { return _winding; }
+
 	friend class DrawPolygonContext;
 	friend class LiveObstacleSet;
 	friend class EditPolygonContext;
+	friend class MapImporter;
+	friend class SelectionSet;
 
 protected:
 
@@ -261,16 +346,68 @@ protected:
 	 */
 	Winding computeWinding(const Vector3 & upDir);
 
+	/*!
+	 *	@brief		The data of an edge used by the distance queries.
+	 */
+	struct EdgeData {
+		/// The unit direction from the edge's first vertex to its second (on the x-y plane).
+		Vector2	_dir;
+
+		/// The length of the edge (on the x-y plane).
+		float	_length;
+	};
+
+	/*!
+	 *	@brief		Computes the bounding box and edge data if they are out of date.
+	 */
+	void updateCache() const;
+
 	/*!
 	 *	@brief		The ordered vertices in the polygon.
 	 */
-	std::vector<Vector3>	_vertices;
+	VertexList	_vertices;
 
 	/*!
 	 *	@brief		The winding of the polygon.
 	 */
 	Winding		_winding;
 
+	/*!
+	 *	@brief		The polygon's identifier in the obstacle set which owns it (assigned
+	 *				when the polygon is added to the set).
+	 */
+	size_t		_id;
+
+	/*!
+	 *	@brief		The polygon's position in the obstacle set which owns it.
+	 */
+	size_t		_slot;
+
+	/*!
+	 *	@brief		The version of the owning obstacle set in which the polygon last changed.
+	 */
+	size_t		_revision;
+
+	/*!
+	 *	@brief		The data of each edge; edge i runs from vertex i to vertex i + 1.
+	 */
+	mutable std::vector<EdgeData, ArenaAllocator<EdgeData> >	_edges;
+
+	/*!
+	 *	@brief		The minimum corner of the bounding box.
+	 */
+	mutable Vector2	_minXY;
+
+	/*!
+	 *	@brief		The maximum corner of the bounding box.
+	 */
+	mutable Vector2	_maxXY;
+
+	/*!
+	 *	@brief		Reports if the bounding box and edge data reflect the vertices.
+	 */
+	mutable bool	_cacheValid;
+
 	/*!
 	 *	@brief		The normal of the plane that the polygon lies on.
 	 *
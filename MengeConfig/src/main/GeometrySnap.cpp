@@ -0,0 +1,104 @@
+#include "GeometrySnap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of GeometrySnap
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t GeometrySnap::MAX_INTERSECTION_SEGMENTS = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+
+GeometrySnap::GeometrySnap(const Vector2 & point, float maxDist, int features) : _point(point), _maxDist(maxDist), _features(features), _vertexDistSq(maxDist * maxDist), _vertex(), _hasVertex(false), _edgeDistSq(maxDist * maxDist), _edgePoint(), _hasEdge(false), _segments() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool GeometrySnap::reaches(float minX, float minY, float maxX, float maxY) const {
+	return minX <= _point._x + _maxDist && maxX >= _point._x - _maxDist &&
+		minY <= _point._y + _maxDist && maxY >= _point._y - _maxDist;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GeometrySnap::addSegment(float x0, float y0, float x1, float y1) {
+	if (!reaches(x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, x0 > x1 ? x0 : x1, y0 > y1 ? y0 : y1)) return;
+	const float px = _point._x - x0;
+	const float py = _point._y - y0;
+	const float dx = x1 - x0;
+	const float dy = y1 - y0;
+	const float lenSq = dx * dx + dy * dy;
+	float t = 0.f;
+	if (lenSq > 0.f) {
+		t = (px * dx + py * dy) / lenSq;
+		if (t < 0.f) t = 0.f;
+		else if (t > 1.f) t = 1.f;
+	}
+	const float ex = px - t * dx;
+	const float ey = py - t * dy;
+	const float distSq = ex * ex + ey * ey;
+	if (distSq > _maxDist * _maxDist) return;
+
+	// Every vertex is the first end point of one of its polygon's edges.
+	if (_features & VERTEX_SNAP) {
+		const float vDistSq = px * px + py * py;
+		if (vDistSq <= _vertexDistSq) {
+			_vertexDistSq = vDistSq;
+			_vertex.set(x0, y0);
+			_hasVertex = true;
+		}
+	}
+	if ((_features & EDGE_SNAP) && distSq <= _edgeDistSq) {
+		_edgeDistSq = distSq;
+		_edgePoint.set(x0 + t * dx, y0 + t * dy);
+		_hasEdge = true;
+	}
+	if ((_features & INTERSECTION_SNAP) && _segments.size() < 2 * MAX_INTERSECTION_SEGMENTS) {
+		_segments.push_back(Vector2(x0, y0));
+		_segments.push_back(Vector2(x1, y1));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GeometrySnap::Feature GeometrySnap::resolve(Vector2 & snapped) const {
+	Feature feature = NO_SNAP;
+	float bestDistSq = _maxDist * _maxDist;
+	if (_hasVertex) {
+		feature = VERTEX_SNAP;
+		bestDistSq = _vertexDistSq;
+		snapped = _vertex;
+	}
+	for (size_t i = 0; i < _segments.size(); i += 2) {
+		const Vector2 & a0 = _segments[i];
+		const Vector2 & a1 = _segments[i + 1];
+		const Vector2 da(a1 - a0);
+		for (size_t j = i + 2; j < _segments.size(); j += 2) {
+			const Vector2 & b0 = _segments[j];
+			const Vector2 & b1 = _segments[j + 1];
+			// Neighboring edges only meet at their shared vertex.
+			if (a0 == b0 || a0 == b1 || a1 == b0 || a1 == b1) continue;
+			const Vector2 db(b1 - b0);
+			const float denom = det(da, db);
+			if (denom == 0.f) continue;
+			const Vector2 d0(b0 - a0);
+			const float s = det(d0, db) / denom;
+			const float t = det(d0, da) / denom;
+			if (s < 0.f || s > 1.f || t < 0.f || t > 1.f) continue;
+			const Vector2 crossing(a0 + da * s);
+			const float distSq = absSq(crossing - _point);
+			// A vertex wins a tie.
+			if (distSq < bestDistSq) {
+				feature = INTERSECTION_SNAP;
+				bestDistSq = distSq;
+				snapped = crossing;
+			}
+		}
+	}
+	if (feature == NO_SNAP && _hasEdge) {
+		feature = EDGE_SNAP;
+		snapped = _edgePoint;
+	}
+	return feature;
+}
+
+///////////////////////////////////////////////////////////////////////////////
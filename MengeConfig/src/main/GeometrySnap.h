@@ -0,0 +1,141 @@
+/*!
+ *	@file		GeometrySnap.h
+ *	@brief		The definition of the query which snaps a point to nearby obstacle geometry.
+ */
+
+#ifndef __GEOMETRY_SNAP_H__
+#define	__GEOMETRY_SNAP_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+/*!
+ *	@brief		Finds the feature of the obstacles a point should snap to.
+ *
+ *	The candidate edges are fed to the query (see ObstacleGrid::collectSegments()); the
+ *	query keeps the nearest vertex and the nearest point on an edge as they arrive, and the
+ *	edges near enough to take part in an intersection.  Vertices and intersections take
+ *	precedence over edges; between a vertex and an intersection the nearer wins.
+ */
+class GeometrySnap {
+public:
+	/*!
+	 *	@brief		The features a point can snap to (combined as bit flags).
+	 */
+	enum Feature {
+		NO_SNAP = 0x0,				/// Nothing to snap to.
+		VERTEX_SNAP = 0x1,			/// An obstacle vertex.
+		EDGE_SNAP = 0x2,			/// The nearest point on an obstacle edge.
+		INTERSECTION_SNAP = 0x4		/// The crossing of two obstacle edges.
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		point		The point to snap.
+	 *	@param		maxDist		The farthest the point may move.
+	 *	@param		features	The features to snap to (a combination of Feature flags).
+	 */
+	GeometrySnap(const Vector2 & point, float maxDist, int features);
+
+	/*!
+	 *	@brief		Returns the point to snap.
+	 */
+	const Vector2 & getPoint() const { return _point; }
+
+	/*!
+	 *	@brief		Reports the farthest the point may move.
+	 */
+	float getMaxDist() const { return _maxDist; }
+
+	/*!
+	 *	@brief		Reports if a box could hold a feature within reach of the point.
+	 *
+	 *	@param		minX		The minimum x-value of the box.
+	 *	@param		minY		The minimum y-value of the box.
+	 *	@param		maxX		The maximum x-value of the box.
+	 *	@param		maxY		The maximum y-value of the box.
+	 *	@returns	True if the box is within reach.
+	 */
+	bool reaches(float minX, float minY, float maxX, float maxY) const;
+
+	/*!
+	 *	@brief		Considers an obstacle edge; edges out of reach are ignored.
+	 *
+	 *	@param		x0		The x-value of the edge's first end point.
+	 *	@param		y0		The y-value of the edge's first end point.
+	 *	@param		x1		The x-value of the edge's second end point.
+	 *	@param		y1		The y-value of the edge's second end point.
+	 */
+	void addSegment(float x0, float y0, float x1, float y1);
+
+	/*!
+	 *	@brief		Determines the feature the point snaps to.
+	 *
+	 *	@param		snapped		The snapped point (unchanged if there is nothing to snap to).
+	 *	@returns	The feature snapped to.
+	 */
+	Feature resolve(Vector2 & snapped) const;
+
+	/*!
+	 *	@brief		The most edges tested pairwise for intersections.
+	 */
+	static const size_t MAX_INTERSECTION_SEGMENTS;
+
+protected:
+	/*!
+	 *	@brief		The point to snap.
+	 */
+	Vector2	_point;
+
+	/*!
+	 *	@brief		The farthest the point may move.
+	 */
+	float	_maxDist;
+
+	/*!
+	 *	@brief		The features to snap to.
+	 */
+	int	_features;
+
+	/*!
+	 *	@brief		The squared distance to the nearest vertex (or the squared reach).
+	 */
+	float	_vertexDistSq;
+
+	/*!
+	 *	@brief		The nearest vertex (valid if _vertexDistSq is within reach).
+	 */
+	Vector2	_vertex;
+
+	/*!
+	 *	@brief		Reports if a vertex was found.
+	 */
+	bool	_hasVertex;
+
+	/*!
+	 *	@brief		The squared distance to the nearest edge (or the squared reach).
+	 */
+	float	_edgeDistSq;
+
+	/*!
+	 *	@brief		The nearest point on an edge.
+	 */
+	Vector2	_edgePoint;
+
+	/*!
+	 *	@brief		Reports if an edge was found.
+	 */
+	bool	_hasEdge;
+
+	/*!
+	 *	@brief		The end points of the edges within reach, two per edge (only collected
+	 *				for intersections).
+	 */
+	std::vector<Vector2>	_segments;
+};
+
+#endif	// __GEOMETRY_SNAP_H__
@@ -0,0 +1,111 @@
+#include "GeometryWorker.hpp"
+
+#include "AppLogger.hpp"
+#include "LiveObstacleSet.h"
+#include "MCException.h"
+
+#include <QtCore/qelapsedtimer.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of GeometryWorker
+///////////////////////////////////////////////////////////////////////////////
+
+GeometryWorker::GeometryWorker(LiveObstacleSet * obstacles, QObject * parent) : QObject(parent), _obstacles(obstacles), _worker(), _lock(), _wake(), _pending(), _finished(), _busy(false), _stopping(false) {
+	// The worker emits its signal from its own thread; it is delivered on the GUI thread.
+	connect(this, &GeometryWorker::jobFinished, this, &GeometryWorker::mergeFinished);
+	_worker = std::thread(&GeometryWorker::workerLoop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GeometryWorker::~GeometryWorker() {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+		_pending.clear();
+	}
+	_wake.notify_all();
+	_worker.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GeometryWorker::submit(std::shared_ptr< GeometryJob > job) {
+	Task task;
+	task._job = job;
+	task._snapshot = _obstacles->takeSnapshot();
+	task._elapsed = 0;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_pending.push_back(task);
+	}
+	_wake.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool GeometryWorker::isBusy() const {
+	std::lock_guard< std::mutex > lock(_lock);
+	return _busy || !_pending.empty() || !_finished.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GeometryWorker::mergeFinished() {
+	std::deque< Task > finished;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		finished.swap(_finished);
+	}
+	for (const Task & task : finished) {
+		if (!task._error.empty()) {
+			AppLogger::logStream << AppLogger::ERROR_MSG << task._job->getName() << " failed: " << task._error << AppLogger::END_MSG;
+			continue;
+		}
+		const size_t editCount = task._edits._replaced.size() + task._edits._added.size() + task._edits._removed.size();
+		if (editCount > 0) emit mergingEdits(task._edits);
+		const size_t conflicts = _obstacles->mergeEdits(task._edits, task._snapshot->getVersion());
+		AppLogger::logStream << AppLogger::INFO_MSG << task._job->getName() << ": " << (editCount - conflicts) << " obstacle edits in " << task._elapsed << " ms";
+		if (conflicts > 0) {
+			AppLogger::logStream << "; " << conflicts << " edits of obstacles changed in the meantime were discarded";
+		}
+		AppLogger::logStream << AppLogger::END_MSG;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GeometryWorker::workerLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (_pending.empty() && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_stopping) return;
+
+		Task task = _pending.front();
+		_pending.pop_front();
+		_busy = true;
+		lock.unlock();
+
+		QElapsedTimer timer;
+		timer.start();
+		try {
+			task._job->run(*task._snapshot, task._edits);
+		}
+		catch (MCException & e) {
+			task._error = e.what();
+			task._edits = GeometryEdits();
+		}
+		task._elapsed = timer.elapsed();
+
+		lock.lock();
+		_busy = false;
+		_finished.push_back(task);
+		lock.unlock();
+		emit jobFinished();
+		lock.lock();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,187 @@
+/*!
+ *	@file		GeometryWorker.hpp
+ *	@brief		The definition of the background thread which runs long geometric operations
+ *				on snapshots of the obstacles.
+ */
+
+#ifndef __GEOMETRY_WORKER_H__
+#define	__GEOMETRY_WORKER_H__
+
+#include "ObstacleSnapshot.h"
+
+#include <QtCore/qobject.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// forward declarations
+class LiveObstacleSet;
+
+/*!
+ *	@brief		A geometric operation executed by the GeometryWorker.
+ *
+ *	The job reads an immutable snapshot of the obstacles and describes its result as edits;
+ *	it runs on the worker thread and must not touch the live obstacle set (or anything else
+ *	owned by the GUI thread).
+ */
+class GeometryJob {
+public:
+	/*!
+	 *	@brief		Destructor.
+	 */
+	virtual ~GeometryJob() {}
+
+	/*!
+	 *	@brief		Reports the name of the job (for the log).
+	 */
+	virtual std::string getName() const = 0;
+
+	/*!
+	 *	@brief		Computes the job's edits.
+	 *
+	 *	@param		snapshot		The obstacles the job operates on.
+	 *	@param		edits			The edits to the obstacles are added here.
+	 */
+	virtual void run(const ObstacleSnapshot & snapshot, GeometryEdits & edits) = 0;
+};
+
+/*!
+ *	@brief		Runs geometry jobs on a background thread so the editor stays responsive.
+ *
+ *	Each job is given a snapshot of the obstacles taken when it was submitted (which costs
+ *	no more than copying the polygons changed since the previous snapshot).  The user keeps
+ *	editing while the job runs; when it finishes, its edits are merged into the live set on
+ *	the GUI thread, rebased onto the edits made in the meantime (see
+ *	LiveObstacleSet::mergeEdits()).  Jobs run one at a time, in the order submitted.
+ */
+class GeometryWorker : public QObject {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		obstacles		The obstacles the jobs operate on.
+	 *	@param		parent			The optional parent object.
+	 */
+	GeometryWorker(LiveObstacleSet * obstacles, QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor -- waits for the running job; the queued jobs are discarded.
+	 */
+	~GeometryWorker();
+
+	/*!
+	 *	@brief		Queues a job on a snapshot of the current obstacles.
+	 *
+	 *	@param		job		The job.
+	 */
+	void submit(std::shared_ptr< GeometryJob > job);
+
+	/*!
+	 *	@brief		Reports if a job is queued or running.
+	 */
+	bool isBusy() const;
+
+signals:
+	/*!
+	 *	@brief		Emitted (from the worker thread) when a job has finished.
+	 */
+	void jobFinished();
+
+	/*!
+	 *	@brief		Emitted (on the GUI thread) just before a job's edits are merged into the
+	 *				obstacles, so references to the polygons they replace or remove can be
+	 *				released.
+	 *
+	 *	@param		edits		The edits.
+	 */
+	void mergingEdits(const GeometryEdits & edits);
+
+protected:
+	/*!
+	 *	@brief		A job and the snapshot it operates on.
+	 */
+	struct Task {
+		/*!
+		 *	@brief		The job.
+		 */
+		std::shared_ptr< GeometryJob >	_job;
+
+		/*!
+		 *	@brief		The snapshot.
+		 */
+		ObstacleSnapshotPtr	_snapshot;
+
+		/*!
+		 *	@brief		The job's edits.
+		 */
+		GeometryEdits	_edits;
+
+		/*!
+		 *	@brief		The time spent running the job (in milliseconds).
+		 */
+		qint64	_elapsed;
+
+		/*!
+		 *	@brief		The error which stopped the job (empty if it succeeded).
+		 */
+		std::string	_error;
+	};
+
+	/*!
+	 *	@brief		Merges the finished jobs' edits into the obstacles (on the GUI thread).
+	 */
+	void mergeFinished();
+
+	/*!
+	 *	@brief		The worker thread's loop.
+	 */
+	void workerLoop();
+
+	/*!
+	 *	@brief		The obstacles.
+	 */
+	LiveObstacleSet *	_obstacles;
+
+	/*!
+	 *	@brief		The worker thread.
+	 */
+	std::thread	_worker;
+
+	/*!
+	 *	@brief		Guards the queues and flags below.
+	 */
+	mutable std::mutex	_lock;
+
+	/*!
+	 *	@brief		Signals the worker that there is a job (or that it should stop).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		The jobs waiting to run.
+	 */
+	std::deque< Task >	_pending;
+
+	/*!
+	 *	@brief		The jobs waiting to be merged.
+	 */
+	std::deque< Task >	_finished;
+
+	/*!
+	 *	@brief		Reports if the worker is running a job.
+	 */
+	bool	_busy;
+
+	/*!
+	 *	@brief		Reports if the worker should stop.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __GEOMETRY_WORKER_H__
@@ -1,10 +1,16 @@
 #include "GridNode.h"
 
+#include <cmath>
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 //						Implementation of GridNode
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-GridNode::GridNode(Menge::SceneGraph::GLDagNode * parent) : Menge::SceneGraph::GLNode(), ReferenceGrid() {
+const size_t GridNode::MAX_LINES = 1000;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+GridNode::GridNode(Menge::SceneGraph::GLDagNode * parent) : Menge::SceneGraph::GLNode(), ReferenceGrid(), _hasView(false), _drawMin(), _drawMax() {
 
 }
 
@@ -18,7 +24,7 @@ GridNode::~GridNode() {
 
 void GridNode::drawGL(bool select) {
 	if (!select && _visible) {
-		glPushAttrib(GL_LIGHTING_BIT);
+		glPushAttrib(GL_LIGHTING_BIT | GL_LINE_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
 
 		// boundary
 		glLineWidth(3.f);
@@ -33,60 +39,80 @@ void GridNode::drawGL(bool select) {
 		glVertex3f(_originX, _originY, 0.f);
 		glEnd();
 
-		// minor lines
-		glColor3f(0.f, 0.f, 0.f);
-		glLineWidth(1.f);
-		float delta = _majorDist / (_minorCount + 1);
-
-		glBegin(GL_LINES);
-		// parallel to x-axis
-		float y = _originY;
-		int i = 0;
-		while (y < Y) {
-			glVertex3f(_originX, y, 0.f);
-			glVertex3f(X, y, 0.f);
-			++i;
-			y = _originY + i * delta;
+		// Only the lines inside the drawn region of the view.
+		Vector2 minPt(_originX, _originY);
+		Vector2 maxPt(X, Y);
+		if (_hasView) {
+			if (_drawMin._x > minPt._x) minPt._x = _drawMin._x;
+			if (_drawMin._y > minPt._y) minPt._y = _drawMin._y;
+			if (_drawMax._x < maxPt._x) maxPt._x = _drawMax._x;
+			if (_drawMax._y < maxPt._y) maxPt._y = _drawMax._y;
 		}
-
-		//parallel to y-axis
-		float x = _originX;
-		i = 0;
-		while (x < X) {
-			glVertex3f(x, _originY, 0.f);
-			glVertex3f(x, Y, 0.f);
-			++i;
-			x = _originX + i * delta;
+		if (_levelSpacing > 0.f && minPt._x <= maxPt._x && minPt._y <= maxPt._y) {
+			const float factor = (float)getLevelFactor();
+			const float extent = (maxPt._x - minPt._x) > (maxPt._y - minPt._y) ? (maxPt._x - minPt._x) : (maxPt._y - minPt._y);
+			float minor = _levelSpacing;
+			float weight = _levelWeight;
+			while (extent / minor > MAX_LINES) {
+				minor *= factor;
+				weight = 1.f;
+			}
+
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			// Minor lines fade in as the level's spacing grows on screen.
+			glColor4f(0.f, 0.f, 0.f, 0.2f + 0.8f * weight);
+			glLineWidth(1.f);
+			drawLines(minor, minPt, maxPt);
+
+			// Major lines
+			glColor4f(0.f, 0.f, 0.f, 1.f);
+			glLineWidth(2.f);
+			drawLines(minor * factor, minPt, maxPt);
 		}
-		glEnd();
 
-		// Major lines
-		glLineWidth(2.f);
-		glBegin(GL_LINES);
-		// parallel to x-axis
-		y = _originY;
-		i = 0;
-		while (y < Y) {
-			glVertex3f(_originX, y, 0.f);
-			glVertex3f(X, y, 0.f);
-			++i;
-			y = _originY + i * _majorDist;
-		}
+		glPopAttrib();
+	}
+}
 
-		//parallel to y-axis
-		x = _originX;
-		i = 0;
-		while (x < X) {
-			glVertex3f(x, _originY, 0.f);
-			glVertex3f(x, Y, 0.f);
-			++i;
-			x = _originX + i * _majorDist;
-		}
+/////////////////////////////////////////////////////////////////////////////////////////////
 
-		glEnd();
+void GridNode::drawLines(float spacing, const Vector2 & minPt, const Vector2 & maxPt) const {
+	glBegin(GL_LINES);
+	// parallel to x-axis
+	const int i0 = (int)ceil((minPt._y - _originY) / spacing);
+	const int i1 = (int)floor((maxPt._y - _originY) / spacing);
+	for (int i = i0; i <= i1; ++i) {
+		const float y = _originY + i * spacing;
+		glVertex3f(minPt._x, y, 0.f);
+		glVertex3f(maxPt._x, y, 0.f);
+	}
 
-		glPopAttrib();
+	//parallel to y-axis
+	const int j0 = (int)ceil((minPt._x - _originX) / spacing);
+	const int j1 = (int)floor((maxPt._x - _originX) / spacing);
+	for (int j = j0; j <= j1; ++j) {
+		const float x = _originX + j * spacing;
+		glVertex3f(x, minPt._y, 0.f);
+		glVertex3f(x, maxPt._y, 0.f);
+	}
+	glEnd();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GridNode::setView(float worldPerPixel, const Vector2 & minPt, const Vector2 & maxPt) {
+	const bool levelChanged = setViewScale(worldPerPixel);
+	if (levelChanged || !_hasView || minPt._x < _drawMin._x || minPt._y < _drawMin._y ||
+		maxPt._x > _drawMax._x || maxPt._y > _drawMax._y) {
+		const Vector2 pad((maxPt - minPt) * 0.5f);
+		_drawMin = minPt - pad;
+		_drawMax = maxPt + pad;
+		_hasView = true;
+		return true;
 	}
+	return false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -97,4 +123,4 @@ void GridNode::newContext() {
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-/////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+/////////////////////////////////////////////////////////////////////////////////////////////
@@ -45,8 +45,50 @@ public:
 	 */
 	virtual void newContext();
 
+	/*!
+	 *	@brief		Adapts the grid to the view: chooses the active level (see
+	 *				ReferenceGrid::setViewScale()) and the region whose lines are drawn.
+	 *
+	 *	The lines are drawn over the visible region padded by half its size in every
+	 *	direction, so small pans and zooms don't change what is drawn.
+	 *
+	 *	@param		worldPerPixel		The size of a pixel in world units.
+	 *	@param		minPt				The minimum corner of the visible region.
+	 *	@param		maxPt				The maximum corner of the visible region.
+	 *	@returns	True if the grid has to be drawn again to match the view.
+	 */
+	bool setView(float worldPerPixel, const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		The most lines drawn in each direction; coarser levels are drawn if the
+	 *				active level would exceed it.
+	 */
+	static const size_t MAX_LINES;
+
 protected:
+	/*!
+	 *	@brief		Draws the lines of one level.
+	 *
+	 *	@param		spacing		The distance between the lines.
+	 *	@param		minPt		The minimum corner of the region to draw.
+	 *	@param		maxPt		The maximum corner of the region to draw.
+	 */
+	void drawLines(float spacing, const Vector2 & minPt, const Vector2 & maxPt) const;
 
+	/*!
+	 *	@brief		Reports if the view has been set.
+	 */
+	bool	_hasView;
+
+	/*!
+	 *	@brief		The minimum corner of the region whose lines are drawn.
+	 */
+	Vector2	_drawMin;
+
+	/*!
+	 *	@brief		The maximum corner of the region whose lines are drawn.
+	 */
+	Vector2	_drawMax;
 };
 
 #endif	// __GRID_NODE_H__
\ No newline at end of file
@@ -1,30 +1,120 @@
 #include "LiveObstacleSet.h"
+#include "BatchOps.h"
+#include "EventBus.hpp"
 #include "glwidget.hpp"
+#include "ReferenceGrid.h"
+#include "ThreadPool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <gl/GL.h>
 
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if the query point lies inside the region (projected on the x-y
+ *				plane) using the crossing number test.
+ *
+ *	@param		region		The vertices of the region.
+ *	@param		q			The query point.
+ *	@returns	True if the query point is inside the region.
+ */
+bool insideRegionXY(const std::vector<Vector2> & region, const Vector3 & q) {
+	bool inside = false;
+	const size_t COUNT = region.size();
+	for (size_t i = 0, j = COUNT - 1; i < COUNT; j = i++) {
+		const Vector2 & a = region[i];
+		const Vector2 & b = region[j];
+		if ((a._y > q._y) != (b._y > q._y)) {
+			float x = a._x + (q._y - a._y) * (b._x - a._x) / (b._y - a._y);
+			if (q._x < x) inside = !inside;
+		}
+	}
+	return inside;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Copies a polygon into an immutable record.
+ *
+ *	@param		poly		The polygon.
+ *	@returns	The record.
+ */
+PolygonRecordPtr makeRecord(const GLPolygon * poly) {
+	std::shared_ptr< PolygonRecord > record(new PolygonRecord());
+	record->_id = poly->getId();
+	record->_winding = poly->getWinding();
+	record->_vertices.reserve(poly->getVertexCount());
+	for (size_t i = 0; i < poly->getVertexCount(); ++i) {
+		record->_vertices.push_back(poly->getVertex(i));
+	}
+	return record;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Replaces a polygon's vertices with shifted copies of a record's vertices.
+ *
+ *	@param		verts		The polygon's vertices.
+ *	@param		source		The record's vertices.
+ *	@param		dx			The shift along the x-axis.
+ *	@param		dy			The shift along the y-axis.
+ */
+void assignShifted(GLPolygon::VertexList & verts, const std::vector<Vector3> & source, double dx, double dy) {
+	verts.assign(source.begin(), source.end());
+	if (dx == 0.0 && dy == 0.0) return;
+	for (Vector3 & v : verts) {
+		v._x = static_cast<float>(v._x + dx);
+		v._y = static_cast<float>(v._y + dy);
+	}
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                    Implementation of LiveObstacleSet
 ///////////////////////////////////////////////////////////////////////////////
 
-LiveObstacleSet::LiveObstacleSet() : _polygons() {
+const size_t LiveObstacleSet::MAX_STALE_POLYGONS = 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+
+LiveObstacleSet::LiveObstacleSet() : _pickOffsets(), _pickPositions(), _pickColors(), _arena(), _polygons(), _polygonsById(), _nextId(1), _dirty(), _removed(), _listeners(), _obstacleGrid(), _obstacleGridValid(false), _staleIds(), _version(0), _snapshot(), _staleSlots(), _allStale(true), _frameShifts() {
 
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 LiveObstacleSet::~LiveObstacleSet() {
-	for (size_t i = 0; i < _polygons.size(); ++i) {
-		delete _polygons[i];
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->obstacleSetDestroyed();
 	}
+	EventBus::instance()->withdraw(this);
+	releasePolygons();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GLPolygon * LiveObstacleSet::createPolygon() {
+	return _arena.createPolygon();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 
 void LiveObstacleSet::addPolygon(GLPolygon * poly) {
+	poly->_id = _nextId++;
+	poly->_slot = _polygons.size();
 	_polygons.push_back(poly);
+	_polygonsById[poly->_id] = poly;
+	_dirty[poly->_id] = poly;
+	touch(poly);
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonAdded(poly->_slot);
+	}
+	EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -62,6 +152,9 @@ SelectVertex LiveObstacleSet::nearestVertex(const Vector2 & worldPos, float maxD
 	float d2 = maxDist * maxDist;
 	float bestDistSq = 1e6f;
 	for (GLPolygon * p : _polygons) {
+		// No vertex can be nearer than the polygon's bounding box.
+		const float boxDistSq = p->boxDistSquaredXY(worldPos);
+		if (boxDistSq >= bestDistSq || boxDistSq >= d2) continue;
 		for (size_t i = 0; i < p->_vertices.size(); ++i) {
 			Vector3 & v = p->_vertices[i];
 			float dx = worldPos._x - v._x;
@@ -87,6 +180,9 @@ GLPolygon * LiveObstacleSet::nearestPolygon(const Vector2 & worldPos, float maxD
 	GLPolygon * nearest = 0x0;
 	float bestDistSq = 1e6f;
 	for (GLPolygon * p : _polygons) {
+		// The polygon can be no nearer than its bounding box.
+		const float boxDistSq = p->boxDistSquaredXY(worldPos);
+		if (boxDistSq >= bestDistSq || boxDistSq >= d2) continue;
 		float distSq = p->distSquaredXY(worldPos);
 		if (distSq < bestDistSq && distSq < d2) {
 			nearest = p;
@@ -104,6 +200,9 @@ SelectEdge LiveObstacleSet::nearestEdge(const Vector2 & worldPos, float maxDist)
 	float bestDistSq = 1e6f;
 	SelectEdge e;
 	for (GLPolygon * p : _polygons) {
+		// No edge can be nearer than the polygon's bounding box.
+		const float boxDistSq = p->boxDistSquaredXY(worldPos);
+		if (boxDistSq >= bestDistSq || boxDistSq >= d2) continue;
 		float distSq = p->nearestEdgeXY(worldPos, e);
 		if (distSq < bestDistSq && distSq < d2) {
 			nearest = e;
@@ -117,19 +216,54 @@ SelectEdge LiveObstacleSet::nearestEdge(const Vector2 & worldPos, float maxDist)
 
 SelectVertex LiveObstacleSet::insertVertex(const Vector2 & worldPos, SelectEdge edge) {
 	Vector3 * v = edge._poly->insertPoint(edge._v0, worldPos);
+	markDirty(edge._poly);
 	return SelectVertex(v, edge._poly);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void LiveObstacleSet::addPolygons(const std::vector<GLPolygon *> & polys) {
+	if (polys.empty()) return;
+	const size_t first = _polygons.size();
+	++_version;
+	_polygons.reserve(first + polys.size());
+	_polygonsById.reserve(_polygonsById.size() + polys.size());
+	for (GLPolygon * poly : polys) {
+		poly->_id = _nextId++;
+		poly->_slot = _polygons.size();
+		poly->_revision = _version;
+		_polygons.push_back(poly);
+		_polygonsById[poly->_id] = poly;
+		_dirty[poly->_id] = poly;
+	}
+	_allStale = true;
+	_staleSlots.clear();
+	_obstacleGridValid = false;
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonsAdded(first, polys.size());
+	}
+	EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void LiveObstacleSet::removePolygon(GLPolygon * poly) {
-	std::vector<GLPolygon *>::iterator itr = _polygons.begin();
-	for (; itr != _polygons.end(); ++itr) {
-		if (*itr == poly) {
-			_polygons.erase(itr);
-			return;
-		}
+	if (detachPolygon(poly)) {
+		EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::removePolygons(const std::vector<GLPolygon *> & polys) {
+	size_t count = 0;
+	for (GLPolygon * poly : polys) {
+		if (detachPolygon(poly)) ++count;
+	}
+	if (count > 0) {
+		EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
 	}
+	return count;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -139,6 +273,9 @@ void LiveObstacleSet::removeVertex(const SelectVertex & vertex) {
 	if (vCount < 3) {
 		removePolygon(vertex._poly);
 	}
+	else {
+		markDirty(vertex._poly);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -148,10 +285,597 @@ void LiveObstacleSet::collapseEdge(const SelectEdge & edge) {
 	if (vCount < 3) {
 		removePolygon(edge._poly);
 	}
+	else {
+		markDirty(edge._poly);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::drawSelectGL(PickBuffer::ElementType type) {
+	const size_t P_COUNT = _polygons.size();
+	_pickOffsets.resize(P_COUNT + 1);
+	size_t vCount = 0;
+	for (size_t p = 0; p < P_COUNT; ++p) {
+		_pickOffsets[p] = vCount;
+		vCount += _polygons[p]->_vertices.size();
+	}
+	_pickOffsets[P_COUNT] = vCount;
+	if (vCount == 0 || type == PickBuffer::NO_ELEMENT) return;
+
+	// Vertices are drawn as points; edges and polygons are drawn as line segments.
+	const bool points = type == PickBuffer::VERTEX_ELEMENT;
+	const size_t ELEM_COUNT = points ? vCount : 2 * vCount;
+	_pickPositions.resize(ELEM_COUNT);
+	_pickColors.resize(4 * ELEM_COUNT);
+	size_t e = 0;
+	for (size_t p = 0; p < P_COUNT; ++p) {
+		const GLPolygon::VertexList & verts = _polygons[p]->_vertices;
+		const size_t COUNT = verts.size();
+		for (size_t i = 0; i < COUNT; ++i) {
+			if (points) {
+				_pickPositions[e] = verts[i];
+				PickBuffer::encodeColor(PickBuffer::makeId(type, _pickOffsets[p] + i), &_pickColors[4 * e]);
+				++e;
+			}
+			else {
+				const size_t index = type == PickBuffer::EDGE_ELEMENT ? _pickOffsets[p] + i : p;
+				const unsigned int id = PickBuffer::makeId(type, index);
+				_pickPositions[e] = verts[i];
+				PickBuffer::encodeColor(id, &_pickColors[4 * e]);
+				_pickPositions[e + 1] = verts[(i + 1) % COUNT];
+				PickBuffer::encodeColor(id, &_pickColors[4 * (e + 1)]);
+				e += 2;
+			}
+		}
+	}
+
+	glPushAttrib(GL_POINT_BIT | GL_LINE_BIT);
+	glPointSize(9.f);
+	glLineWidth(5.f);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(Vector3), &_pickPositions[0]);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, &_pickColors[0]);
+	glDrawArrays(points ? GL_POINTS : GL_LINES, 0, (GLsizei)ELEM_COUNT);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glPopAttrib();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool LiveObstacleSet::mapPickIndex(size_t index, size_t & poly, size_t & local) const {
+	if (_pickOffsets.size() != _polygons.size() + 1 || index >= _pickOffsets.back()) {
+		return false;
+	}
+	// The polygon is the last one whose first vertex does not follow the index.
+	std::vector<size_t>::const_iterator itr = std::upper_bound(_pickOffsets.begin(), _pickOffsets.end(), index);
+	poly = (itr - _pickOffsets.begin()) - 1;
+	local = index - _pickOffsets[poly];
+	return local < _polygons[poly]->_vertices.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::releasePolygons() {
+	for (size_t i = 0; i < _polygons.size(); ++i) {
+		if (_polygons[i]->getArena() != &_arena) delete _polygons[i];
+	}
+	_polygons.clear();
+	_polygonsById.clear();
+	_arena.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool LiveObstacleSet::detachPolygon(GLPolygon * poly) {
+	const size_t slot = poly->_slot;
+	if (slot >= _polygons.size() || _polygons[slot] != poly) return false;
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonAboutToBeRemoved(slot);
+	}
+	// The last polygon fills the vacancy; no other polygon moves.
+	GLPolygon * last = _polygons.back();
+	_polygons[slot] = last;
+	last->_slot = slot;
+	_polygons.pop_back();
+	++_version;
+	// The moved polygon is unchanged (its revision stands); only the snapshot's slot is.
+	if (slot < _polygons.size() && !_allStale) {
+		_staleSlots.insert(slot);
+	}
+	_polygonsById.erase(poly->_id);
+	_dirty.erase(poly->_id);
+	staleIndex(poly->_id);
+	_removed.push_back(poly->_id);
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonRemoved(slot, poly);
+	}
+	destroyPolygon(poly);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::touch(GLPolygon * poly) {
+	poly->_revision = ++_version;
+	if (!_allStale) _staleSlots.insert(poly->_slot);
+	staleIndex(poly->_id);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::staleIndex(size_t id) {
+	if (!_obstacleGridValid) return;
+	_staleIds.insert(id);
+	if (_staleIds.size() > MAX_STALE_POLYGONS) {
+		_obstacleGridValid = false;
+		_staleIds.clear();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::destroyPolygon(GLPolygon * poly) {
+	if (poly->getArena() == &_arena) {
+		_arena.destroyPolygon(poly);
+	}
+	else {
+		delete poly;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GLPolygon * LiveObstacleSet::findPolygon(size_t id) const {
+	std::unordered_map<size_t, GLPolygon *>::const_iterator itr = _polygonsById.find(id);
+	return itr == _polygonsById.end() ? 0x0 : itr->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SelectVertex LiveObstacleSet::getPickedVertex(unsigned int id) {
+	size_t p, i;
+	if (PickBuffer::getType(id) == PickBuffer::VERTEX_ELEMENT && mapPickIndex(PickBuffer::getIndex(id), p, i)) {
+		return SelectVertex(&_polygons[p]->_vertices[i], _polygons[p]);
+	}
+	return SelectVertex();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SelectEdge LiveObstacleSet::getPickedEdge(unsigned int id) {
+	size_t p, i;
+	if (PickBuffer::getType(id) == PickBuffer::EDGE_ELEMENT && mapPickIndex(PickBuffer::getIndex(id), p, i)) {
+		GLPolygon::VertexList & verts = _polygons[p]->_vertices;
+		return SelectEdge(&verts[i], &verts[(i + 1) % verts.size()], _polygons[p]);
+	}
+	return SelectEdge();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GLPolygon * LiveObstacleSet::getPickedPolygon(unsigned int id) {
+	if (PickBuffer::getType(id) == PickBuffer::POLYGON_ELEMENT) {
+		size_t p = PickBuffer::getIndex(id);
+		if (p < _polygons.size()) return _polygons[p];
+	}
+	return 0x0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::selectRegion(const std::vector<Vector2> & region, PickBuffer::ElementType type, SelectionSet & selection) {
+	if (region.size() < 3 || type == PickBuffer::NO_ELEMENT) return 0;
+	float minX = region[0]._x;
+	float maxX = region[0]._x;
+	float minY = region[0]._y;
+	float maxY = region[0]._y;
+	for (const Vector2 & v : region) {
+		if (v._x < minX) minX = v._x;
+		else if (v._x > maxX) maxX = v._x;
+		if (v._y < minY) minY = v._y;
+		else if (v._y > maxY) maxY = v._y;
+	}
+
+	// Only the polygons whose bounding boxes overlap the region's can have a vertex in it.
+	std::vector<size_t> ids;
+	getObstacleGrid().collectPolygons(minX, minY, maxX, maxY, ids);
+	std::sort(ids.begin(), ids.end());
+
+	size_t added = 0;
+	std::vector<bool> inside;
+	for (size_t id : ids) {
+		GLPolygon * p = findPolygon(id);
+		const GLPolygon::VertexList & verts = p->_vertices;
+		const size_t COUNT = verts.size();
+		inside.assign(COUNT, false);
+		bool all = true;
+		for (size_t i = 0; i < COUNT; ++i) {
+			const Vector3 & v = verts[i];
+			// The region's bounding box is a cheap rejection test for the crossing test.
+			inside[i] = v._x >= minX && v._x <= maxX && v._y >= minY && v._y <= maxY &&
+						insideRegionXY(region, v);
+			all = all && inside[i];
+			if (!all && type == PickBuffer::POLYGON_ELEMENT) break;
+		}
+		if (type == PickBuffer::POLYGON_ELEMENT) {
+			if (all) {
+				selection.addRange(p, 0, COUNT);
+				added += COUNT;
+			}
+		}
+		else {
+			for (size_t i = 0; i < COUNT; ++i) {
+				if (!inside[i]) continue;
+				if (type == PickBuffer::EDGE_ELEMENT &&
+					!inside[(i + COUNT - 1) % COUNT] && !inside[(i + 1) % COUNT]) {
+					continue;
+				}
+				selection.addVertex(p, i);
+				++added;
+			}
+		}
+	}
+	return added;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool LiveObstacleSet::isInsideObstacle(const Vector2 & p) const {
+	return getObstacleGrid().contains(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::testPoints(const Vector2 * points, size_t count, unsigned char * inside) const {
+	const ObstacleGrid & grid = getObstacleGrid();
+	std::atomic<size_t> total(0);
+	ThreadPool::instance()->parallelFor(count, 4096, [&](size_t begin, size_t end) {
+		size_t found = 0;
+		for (size_t i = begin; i < end; ++i) {
+			inside[i] = grid.contains(points[i]) ? 1 : 0;
+			found += inside[i];
+		}
+		total += found;
+	});
+	return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const ObstacleGrid & LiveObstacleSet::getObstacleGrid() const {
+	if (_obstacleGridValid && !_staleIds.empty() && _obstacleGrid.getPatchCount() + _staleIds.size() <= MAX_STALE_POLYGONS) {
+		// Only the changed polygons' cells are touched.
+		_obstacleGrid.update(*this, _staleIds);
+		_staleIds.clear();
+	}
+	else if (!_obstacleGridValid || !_staleIds.empty()) {
+		_obstacleGrid.build(*this);
+		_obstacleGridValid = true;
+		_staleIds.clear();
+	}
+	return _obstacleGrid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::collectSegments(GeometrySnap & query, size_t skipId) const {
+	if (!_obstacleGridValid) {
+		_obstacleGrid.build(*this);
+		_obstacleGridValid = true;
+		_staleIds.clear();
+	}
+	_obstacleGrid.collectSegments(query, _staleIds, skipId);
+	for (size_t id : _staleIds) {
+		const GLPolygon * poly = findPolygon(id);
+		if (poly == 0x0 || id == skipId) continue;
+		const GLPolygon::VertexList & verts = poly->_vertices;
+		if (verts.size() < 2 || poly->boxDistSquaredXY(query.getPoint()) > query.getMaxDist() * query.getMaxDist()) continue;
+		for (size_t i = 0; i < verts.size(); ++i) {
+			const Vector3 & next = verts[i + 1 < verts.size() ? i + 1 : 0];
+			query.addSegment(verts[i]._x, verts[i]._y, next._x, next._y);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::snapAll(const ReferenceGrid & grid, bool snapX, bool snapY) {
+	std::vector<GLPolygon *> & polygons = _polygons;
+	std::atomic<size_t> total(0);
+	ThreadPool::instance()->parallelFor(_polygons.size(), 16, [&](size_t begin, size_t end) {
+		size_t count = 0;
+		for (size_t p = begin; p < end; ++p) {
+			GLPolygon::VertexList & verts = polygons[p]->_vertices;
+			if (verts.empty()) continue;
+			grid.snapAll(&verts[0], verts.size(), snapX, snapY);
+			// Snapping can fold a polygon over on itself.
+			if (verts.size() >= 3) {
+				polygons[p]->_winding = polygons[p]->computeWinding(GLPolygon::PLANE_NORMAL);
+			}
+			count += verts.size();
+		}
+		total += count;
+	});
+	markAllDirty();
+	return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::transformAll(const Affine2D & xform) {
+	std::vector<GLPolygon *> & polygons = _polygons;
+	// A reflection reverses the winding of every polygon.
+	const bool reflect = xform.determinant() < 0.f;
+	std::atomic<size_t> total(0);
+	ThreadPool::instance()->parallelFor(_polygons.size(), 16, [&](size_t begin, size_t end) {
+		size_t count = 0;
+		for (size_t p = begin; p < end; ++p) {
+			GLPolygon * poly = polygons[p];
+			if (poly->_vertices.empty()) continue;
+			transformPoints(&poly->_vertices[0], poly->_vertices.size(), xform);
+			if (reflect && poly->_winding != GLPolygon::NO_WINDING) {
+				poly->_winding = poly->_winding == GLPolygon::CCW ? GLPolygon::CW : GLPolygon::CCW;
+			}
+			count += poly->_vertices.size();
+		}
+		total += count;
+	});
+	markAllDirty();
+	return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::translate(double dx, double dy) {
+	std::vector<GLPolygon *> & polygons = _polygons;
+	std::atomic<size_t> total(0);
+	ThreadPool::instance()->parallelFor(_polygons.size(), 16, [&](size_t begin, size_t end) {
+		size_t count = 0;
+		for (size_t p = begin; p < end; ++p) {
+			GLPolygon::VertexList & verts = polygons[p]->_vertices;
+			for (Vector3 & v : verts) {
+				v._x = static_cast<float>(v._x + dx);
+				v._y = static_cast<float>(v._y + dy);
+			}
+			polygons[p]->invalidateCache();
+			count += verts.size();
+		}
+		total += count;
+	});
+	// Only what is stored in the scene's coordinates is refreshed; the revisions, and the
+	//	changes to be saved, are untouched.
+	++_version;
+	_frameShifts.push_back(FrameShift());
+	_frameShifts.back()._version = _version;
+	_frameShifts.back()._dx = dx;
+	_frameShifts.back()._dy = dy;
+	_allStale = true;
+	_staleSlots.clear();
+	_obstacleGridValid = false;
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonsTranslated(dx, dy);
+	}
+	EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
+	return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::markDirty(GLPolygon * poly) {
+	poly->invalidateCache();
+	_dirty[poly->_id] = poly;
+	touch(poly);
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonChanged(poly->_slot);
+	}
+	EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::markDirty(const SelectVertex & vertex) {
+	if (vertex.isValid()) markDirty(vertex._poly);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::markDirty(const SelectEdge & edge) {
+	if (edge.isValid()) markDirty(edge._poly);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::markDirty(const SelectionSet & selection) {
+	for (const SelectionSet::Range & r : selection.getRanges()) {
+		markDirty(r._poly);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::markAllDirty() {
+	++_version;
+	for (GLPolygon * poly : _polygons) {
+		poly->invalidateCache();
+		poly->_revision = _version;
+		_dirty[poly->_id] = poly;
+	}
+	_allStale = true;
+	_staleSlots.clear();
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->allPolygonsChanged();
+	}
+	_obstacleGridValid = false;
+	EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool LiveObstacleSet::takeChanges(ObstacleChanges & changes) {
+	if (_dirty.empty() && _removed.empty()) return false;
+	for (std::unordered_map<size_t, GLPolygon *>::const_iterator itr = _dirty.begin(); itr != _dirty.end(); ++itr) {
+		const GLPolygon * poly = itr->second;
+		changes._changed[poly->_id] = makeRecord(poly);
+	}
+	for (size_t id : _removed) {
+		changes._changed.erase(id);
+		changes._removed.push_back(id);
+	}
+	_dirty.clear();
+	_removed.clear();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::restore(const PolygonRecordMap & polygons) {
+	releasePolygons();
+	_nextId = 1;
+	++_version;
+	_allStale = true;
+	_staleSlots.clear();
+	_polygons.reserve(polygons.size());
+	_polygonsById.reserve(polygons.size());
+	for (PolygonRecordMap::const_iterator itr = polygons.begin(); itr != polygons.end(); ++itr) {
+		const PolygonRecord & record = *itr->second;
+		GLPolygon * poly = _arena.createPolygon();
+		poly->_id = record._id;
+		poly->_winding = GLPolygon::Winding(record._winding);
+		poly->_vertices.assign(record._vertices.begin(), record._vertices.end());
+		poly->_slot = _polygons.size();
+		poly->_revision = _version;
+		_polygons.push_back(poly);
+		_polygonsById[poly->_id] = poly;
+		if (record._id >= _nextId) _nextId = record._id + 1;
+	}
+	_dirty.clear();
+	_removed.clear();
+	_pickOffsets.clear();
+	for (ObstacleSetListener * listener : _listeners) {
+		listener->polygonsReset();
+	}
+	_obstacleGridValid = false;
+	EventBus::instance()->post(Event(GEOMETRY_CHANGED, this));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ObstacleSnapshotPtr LiveObstacleSet::takeSnapshot() {
+	if (_snapshot && _snapshot->_version == _version) return _snapshot;
+	const size_t CHUNK = ObstacleSnapshot::CHUNK_SIZE;
+	const size_t count = _polygons.size();
+	const size_t chunkCount = (count + CHUNK - 1) / CHUNK;
+	std::shared_ptr< ObstacleSnapshot > snapshot(new ObstacleSnapshot());
+	snapshot->_count = count;
+	snapshot->_version = _version;
+
+	// The chunks being rebuilt; the others are shared with the previous snapshot.
+	std::vector< std::shared_ptr< ObstacleSnapshot::Chunk > > rebuilt(chunkCount);
+	if (_allStale || !_snapshot) {
+		for (size_t c = 0; c < chunkCount; ++c) {
+			rebuilt[c].reset(new ObstacleSnapshot::Chunk());
+			rebuilt[c]->reserve(std::min(CHUNK, count - c * CHUNK));
+			for (size_t i = c * CHUNK; i < count && i < (c + 1) * CHUNK; ++i) {
+				rebuilt[c]->push_back(makeRecord(_polygons[i]));
+			}
+		}
+	}
+	else {
+		const size_t oldCount = _snapshot->_count;
+		snapshot->_chunks = _snapshot->_chunks;
+		snapshot->_chunks.resize(chunkCount);
+		// Every chunk from the previous last one on changes length when polygons are added
+		//	or removed; chunks beyond the previous last one don't exist yet.
+		if (oldCount != count) {
+			const size_t first = oldCount > 0 ? std::min((oldCount - 1) / CHUNK, chunkCount) : 0;
+			for (size_t c = first; c < chunkCount; ++c) {
+				rebuilt[c].reset(snapshot->_chunks[c] ? new ObstacleSnapshot::Chunk(*snapshot->_chunks[c]) : new ObstacleSnapshot::Chunk());
+				rebuilt[c]->resize(std::min(CHUNK, count - c * CHUNK));
+			}
+			for (size_t i = oldCount; i < count; ++i) {
+				(*rebuilt[i / CHUNK])[i % CHUNK] = makeRecord(_polygons[i]);
+			}
+		}
+		for (size_t slot : _staleSlots) {
+			// Slots past the previous count were recorded above.
+			if (slot >= count || slot >= oldCount) continue;
+			const size_t c = slot / CHUNK;
+			if (!rebuilt[c]) {
+				rebuilt[c].reset(new ObstacleSnapshot::Chunk(*snapshot->_chunks[c]));
+			}
+			(*rebuilt[c])[slot % CHUNK] = makeRecord(_polygons[slot]);
+		}
+	}
+	snapshot->_chunks.resize(chunkCount);
+	for (size_t c = 0; c < chunkCount; ++c) {
+		if (rebuilt[c]) snapshot->_chunks[c] = rebuilt[c];
+	}
+	_staleSlots.clear();
+	_allStale = false;
+	_snapshot = snapshot;
+	return _snapshot;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t LiveObstacleSet::mergeEdits(const GeometryEdits & edits, size_t baseVersion) {
+	// The edits are in the frame of their snapshot; the set may have been shifted since.
+	double dx = 0.0;
+	double dy = 0.0;
+	for (const FrameShift & shift : _frameShifts) {
+		if (shift._version > baseVersion) {
+			dx += shift._dx;
+			dy += shift._dy;
+		}
+	}
+	size_t conflicts = 0;
+	for (const PolygonRecordPtr & record : edits._replaced) {
+		GLPolygon * poly = findPolygon(record->_id);
+		if (poly == 0x0 || poly->_revision > baseVersion) {
+			++conflicts;
+			continue;
+		}
+		assignShifted(poly->_vertices, record->_vertices, dx, dy);
+		poly->_winding = GLPolygon::Winding(record->_winding);
+		markDirty(poly);
+	}
+	std::vector<GLPolygon *> removed;
+	for (size_t id : edits._removed) {
+		GLPolygon * poly = findPolygon(id);
+		if (poly == 0x0) continue;
+		if (poly->_revision > baseVersion) {
+			++conflicts;
+		}
+		else {
+			removed.push_back(poly);
+		}
+	}
+	removePolygons(removed);
+	for (const PolygonRecordPtr & record : edits._added) {
+		GLPolygon * poly = createPolygon();
+		assignShifted(poly->_vertices, record->_vertices, dx, dy);
+		poly->_winding = GLPolygon::Winding(record->_winding);
+		addPolygon(poly);
+	}
+	return conflicts;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::addListener(ObstacleSetListener * listener) {
+	if (std::find(_listeners.begin(), _listeners.end(), listener) == _listeners.end()) {
+		_listeners.push_back(listener);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LiveObstacleSet::removeListener(ObstacleSetListener * listener) {
+	_listeners.erase(std::remove(_listeners.begin(), _listeners.end(), listener), _listeners.end());
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                    Implementation of SelectVertex
@@ -174,6 +898,7 @@ SelectVertex::SelectVertex(Vector3 * v, GLPolygon * p) : _vert(v), _poly(p) {
 
 void SelectVertex::set(float x, float y, float z) {
 	_vert->set(x, y, z);
+	_poly->invalidateCache();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -6,12 +6,25 @@
 #ifndef __LIVE_OBSTACLE_SET_H__
 #define	__LIVE_OBSTACLE_SET_H__
 
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Math/Vector.h"
 using namespace Menge::Math;
 
 #include "GLPolygon.h"
+#include "GeometrySnap.h"
+#include "ObstacleGrid.h"
+#include "ObstacleSnapshot.h"
+#include "PickBuffer.h"
+#include "PolygonArena.h"
+#include "ProjectState.h"
+#include "SelectionSet.h"
+
+// forward declarations
+class Affine2D;
+class ReferenceGrid;
 
 
 /*!
@@ -98,6 +111,8 @@ public:
 
 	// Only live obstacle set can create new instances.
 	friend class LiveObstacleSet;
+	friend class SelectionSet;
+	friend class EditPolygonContext;
 
 private:
 
@@ -121,6 +136,88 @@ private:
 
 };
 
+/*!
+ *	@brief		Receives notifications of the changes made to a LiveObstacleSet (e.g., to
+ *				keep a view of the set current without re-reading it).
+ *
+ *	Polygons are identified by their position in the set at the time of the notification.
+ */
+class ObstacleSetListener {
+public:
+	/*!
+	 *	@brief		Destructor.
+	 */
+	virtual ~ObstacleSetListener() {}
+
+	/*!
+	 *	@brief		Reports that a polygon has been appended to the set.
+	 *
+	 *	@param		index		The position of the new polygon.
+	 */
+	virtual void polygonAdded(size_t index) = 0;
+
+	/*!
+	 *	@brief		Reports that polygons have been appended to the set in bulk.
+	 *
+	 *	@param		first		The position of the first new polygon.
+	 *	@param		count		The number of new polygons.
+	 */
+	virtual void polygonsAdded(size_t first, size_t count) = 0;
+
+	/*!
+	 *	@brief		Reports that a polygon is about to be removed from the set; the set hasn't
+	 *				changed yet.
+	 *
+	 *	@param		index		The position of the polygon.
+	 */
+	virtual void polygonAboutToBeRemoved(size_t index) = 0;
+
+	/*!
+	 *	@brief		Reports that a polygon has been removed from the set.  The polygon is
+	 *				valid for the duration of the call (and destroyed afterwards).
+	 *
+	 *	No other polygon changes position except the set's last polygon: unless it was the
+	 *	removed polygon, it has moved from position getPolygonCount() into the vacated one.
+	 *
+	 *	@param		index		The position the polygon occupied.
+	 *	@param		poly		The polygon.
+	 */
+	virtual void polygonRemoved(size_t index, const GLPolygon * poly) = 0;
+
+	/*!
+	 *	@brief		Reports that a polygon's vertices have changed (possibly in number).
+	 *
+	 *	@param		index		The position of the polygon.
+	 */
+	virtual void polygonChanged(size_t index) = 0;
+
+	/*!
+	 *	@brief		Reports that the vertices of every polygon have changed.
+	 */
+	virtual void allPolygonsChanged() = 0;
+
+	/*!
+	 *	@brief		Reports that every polygon has been shifted because the scene's origin
+	 *				moved (see LiveObstacleSet::translate()).  The polygons haven't been
+	 *				edited; only values in the scene's coordinates are affected.
+	 *
+	 *	@param		dx		The shift along the x-axis.
+	 *	@param		dy		The shift along the y-axis.
+	 */
+	virtual void polygonsTranslated(double dx, double dy) = 0;
+
+	/*!
+	 *	@brief		Reports that the set's contents have been replaced.
+	 */
+	virtual void polygonsReset() = 0;
+
+	/*!
+	 *	@brief		Reports that the set is being destroyed; the listener must not use it
+	 *				afterwards.
+	 */
+	virtual void obstacleSetDestroyed() = 0;
+};
+
 /*!
  *	@brief		This is a representation of an obstacle set that can be edited.
  */
@@ -136,20 +233,56 @@ public:
 	 */
 	virtual ~LiveObstacleSet();
 
+	/*!
+	 *	@brief		Creates an empty polygon in the set's arena.  The polygon isn't part of
+	 *				the set until it is added.
+	 *
+	 *	Bulk loaders should create their polygons here: pooled polygons share slabs and
+	 *	vertex chunks instead of making several heap allocations each.
+	 *
+	 *	@returns	The new polygon.
+	 */
+	GLPolygon * createPolygon();
+
 	/*!
 	 *	@brief		Adds a polygon to the set.
 	 *
-	 *	@param		poly		The polygon to add to the set.
+	 *	@param		poly		The polygon to add to the set; either created by createPolygon
+	 *							or allocated with new.  The set takes ownership.
 	 */
 	void addPolygon(GLPolygon * poly);
 
 	/*!
-	 *	@brief		Remvoes the given polygon from the obstacle set.
+	 *	@brief		Adds polygons to the set in bulk (e.g., from an imported map).
 	 *
-	 *	@param		poly		The polygon to remove.
+	 *	The change is announced once and the obstacle index is rebuilt once, when it is next
+	 *	needed, instead of being patched for every polygon.
+	 *
+	 *	@param		polys		The polygons to add; they must have been created by
+	 *							createPolygon.  The set takes ownership.
+	 */
+	void addPolygons(const std::vector<GLPolygon *> & polys);
+
+	/*!
+	 *	@brief		Removes the given polygon from the obstacle set and destroys it.
+	 *
+	 *	Removal takes constant time: the last polygon in the set is moved into the removed
+	 *	polygon's position (see ObstacleSetListener::polygonRemoved).
+	 *
+	 *	@param		poly		The polygon to remove; it is invalid afterwards.
 	 */
 	void removePolygon(GLPolygon * poly);
 
+	/*!
+	 *	@brief		Removes the given polygons from the obstacle set and destroys them.  The
+	 *				change is announced once.
+	 *
+	 *	@param		polys		The polygons to remove (each at most once); they are invalid
+	 *							afterwards.
+	 *	@returns	The number of polygons removed.
+	 */
+	size_t removePolygons(const std::vector<GLPolygon *> & polys);
+
 	/*!
 	 *	@brief		Removes the selected vertex from its polygon -- if the polygon
 	 *				ends up with 2 vertices, the polygon in turn is deleted.
@@ -214,13 +347,452 @@ public:
 	 *	@returns	The selection of the new vertex.
 	 */
 	SelectVertex insertVertex(const Vector2 & worldPos, SelectEdge edge);
+
+	/*!
+	 *	@brief		Draws the elements of the given type into the bound pick buffer.
+	 *
+	 *	Each element is drawn with its pick identifier encoded in its color.  Vertices and
+	 *	edges are enumerated across the whole set (the edge index is the index of its first
+	 *	vertex).  The enumeration remains valid until the set changes.
+	 *
+	 *	@param		type		The type of element to draw.
+	 */
+	void drawSelectGL(PickBuffer::ElementType type);
+
+	/*!
+	 *	@brief		Returns the vertex encoded in the pick identifier.
+	 *
+	 *	@param		id		The identifier read from the pick buffer.
+	 *	@returns	A SelectVertex for the picked vertex.  It is invalid if the identifier
+	 *				does not refer to a vertex in this set.
+	 */
+	SelectVertex getPickedVertex(unsigned int id);
+
+	/*!
+	 *	@brief		Returns the edge encoded in the pick identifier.
+	 *
+	 *	@param		id		The identifier read from the pick buffer.
+	 *	@returns	A SelectEdge for the picked edge.  It is invalid if the identifier
+	 *				does not refer to an edge in this set.
+	 */
+	SelectEdge getPickedEdge(unsigned int id);
+
+	/*!
+	 *	@brief		Returns the polygon encoded in the pick identifier.
+	 *
+	 *	@param		id		The identifier read from the pick buffer.
+	 *	@returns	A pointer to the picked polygon, null if the identifier does not
+	 *				refer to a polygon in this set.
+	 */
+	GLPolygon * getPickedPolygon(unsigned int id);
+
+	/*!
+	 *	@brief		Adds the elements of the given type which lie inside the region to the
+	 *				selection.
+	 *
+	 *	Elements are selected by their vertices: a vertex is selected if it lies inside the
+	 *	region, an edge if both of its vertices do and a polygon if all of its vertices do.
+	 *	Only the polygons the obstacle grid finds overlapping the region's bounding box are
+	 *	examined (so polygons of fewer than two vertices, which it doesn't index, are never
+	 *	selected) and vertices outside of that box are rejected without performing the full
+	 *	containment test.
+	 *
+	 *	@param		region		The vertices of a simple polygon on the x-y plane (e.g., the
+	 *							corners of a selection rectangle or the points of a lasso).
+	 *	@param		type		The type of element to select.
+	 *	@param		selection	The selection to add the selected vertices to.
+	 *	@returns	The number of vertices added to the selection.
+	 */
+	size_t selectRegion(const std::vector<Vector2> & region, PickBuffer::ElementType type, SelectionSet & selection);
+
+	/*!
+	 *	@brief		Reports if a point lies inside a solid (counter-clockwise) obstacle.
+	 *
+	 *	Candidate polygons are found with a uniform grid over the polygons' bounding boxes
+	 *	(see ObstacleGrid).  The grid is rebuilt by the first query after the set changes.
+	 *
+	 *	@param		p			The query point (on the x-y plane).
+	 *	@returns	True if the point is inside an obstacle.
+	 */
+	bool isInsideObstacle(const Vector2 & p) const;
+
+	/*!
+	 *	@brief		Reports which of the given points lie inside solid obstacles.  The
+	 *				points are tested in parallel.
+	 *
+	 *	@param		points		The query points (on the x-y plane).
+	 *	@param		count		The number of query points.
+	 *	@param		inside		For each point, 1 is written if it is inside an obstacle and
+	 *							0 otherwise.
+	 *	@returns	The number of points inside obstacles.
+	 */
+	size_t testPoints(const Vector2 * points, size_t count, unsigned char * inside) const;
+
+	/*!
+	 *	@brief		Returns the index of the obstacles, bringing it up to date if the set has
+	 *				changed.
+	 *
+	 *	The polygons changed since the index was last brought up to date are patched into
+	 *	it (see ObstacleGrid::update()); it is rebuilt once more than MAX_STALE_POLYGONS
+	 *	polygons have been patched.
+	 *
+	 *	This must be called from the thread which edits the set; the returned index can be
+	 *	queried from any thread until the set next changes.
+	 */
+	const ObstacleGrid & getObstacleGrid() const;
+
+	/*!
+	 *	@brief		Feeds the obstacle edges near the query's point to a snap query.
+	 *
+	 *	The edges are found with the obstacle index (see ObstacleGrid).  Polygons changed
+	 *	since the index was built are examined directly, so the index only needs to be
+	 *	rebuilt once more than MAX_STALE_POLYGONS polygons have changed.
+	 *
+	 *	@param		query		The snap query.
+	 *	@param		skipId		The identifier of a polygon to leave out, e.g., the one being
+	 *							dragged, whose edges would otherwise hold it in place (zero
+	 *							for none).
+	 */
+	void collectSegments(GeometrySnap & query, size_t skipId = 0) const;
+
+	/*!
+	 *	@brief		The most changed polygons snap queries examine directly (or the index
+	 *				patches) before the obstacle index is rebuilt.
+	 */
+	static const size_t MAX_STALE_POLYGONS;
+
+	/*!
+	 *	@brief		Snaps every vertex in the set to the reference grid.
+	 *
+	 *	The polygons are processed in parallel and each polygon's vertices are snapped in
+	 *	bulk.  Polygon windings are updated to reflect the snapped positions.
+	 *
+	 *	@param		grid		The grid to snap to.
+	 *	@param		snapX		If true, the x-values are snapped to the nearest vertical line.
+	 *	@param		snapY		If true, the y-values are snapped to the nearest horizontal line.
+	 *	@returns	The number of vertices snapped.
+	 */
+	size_t snapAll(const ReferenceGrid & grid, bool snapX = true, bool snapY = true);
+
+	/*!
+	 *	@brief		Applies an affine transformation to every vertex in the set (e.g., to
+	 *				re-project the obstacles from site coordinates).
+	 *
+	 *	The polygons are processed in parallel and each polygon's vertices are transformed
+	 *	in bulk.
+	 *
+	 *	@param		xform		The transformation to apply.
+	 *	@returns	The number of vertices transformed.
+	 */
+	size_t transformAll(const Affine2D & xform);
+
+	/*!
+	 *	@brief		Shifts every vertex in the set (e.g., when the scene's origin moves; see
+	 *				WorldFrame).
+	 *
+	 *	Each vertex is shifted in double precision and rounded once, so a large shift costs
+	 *	no more precision than storing the result; repeated shifts by multiples of
+	 *	WorldFrame::ORIGIN_GRANULARITY don't accumulate error (see WorldFrame).  The
+	 *	polygons are processed in parallel.
+	 *
+	 *	A change of frame isn't an edit: the polygons keep their revisions and aren't
+	 *	reported as changes (see takeChanges()).  Edits computed from an earlier snapshot
+	 *	are shifted into the new frame when they are merged (see mergeEdits()).
+	 *
+	 *	@param		dx		The shift along the x-axis.
+	 *	@param		dy		The shift along the y-axis.
+	 *	@returns	The number of vertices shifted.
+	 */
+	size_t translate(double dx, double dy);
+
+	/*!
+	 *	@brief		Records that the polygon has been modified since the last time the
+	 *				changes were collected.
+	 *
+	 *	Operations of the set record their own changes; editors which modify a polygon's
+	 *	vertices directly must report the modification.
+	 *
+	 *	@param		poly		The modified polygon.
+	 */
+	void markDirty(GLPolygon * poly);
+
+	/*!
+	 *	@brief		Records that the polygon of the selected vertex has been modified.
+	 *
+	 *	@param		vertex		The modified vertex.
+	 */
+	void markDirty(const SelectVertex & vertex);
+
+	/*!
+	 *	@brief		Records that the polygon of the selected edge has been modified.
+	 *
+	 *	@param		edge		The modified edge.
+	 */
+	void markDirty(const SelectEdge & edge);
+
+	/*!
+	 *	@brief		Records that every polygon with selected vertices has been modified.
+	 *
+	 *	@param		selection		The modified selection.
+	 */
+	void markDirty(const SelectionSet & selection);
+
+	/*!
+	 *	@brief		Records that every polygon in the set has been modified.
+	 */
+	void markAllDirty();
+
+	/*!
+	 *	@brief		Collects the changes made to the set since the last collection.
+	 *
+	 *	Each modified polygon is copied into an immutable record; unmodified polygons are
+	 *	not visited, so the cost is proportional to the size of the change.
+	 *
+	 *	@param		changes		The changes are added to this object.
+	 *	@returns	True if there were any changes.
+	 */
+	bool takeChanges(ObstacleChanges & changes);
+
+	/*!
+	 *	@brief		Replaces the contents of the set with the given polygons.
+	 *
+	 *	The polygons keep their identifiers and the set is considered unmodified.
+	 *
+	 *	@param		polygons		The polygons to populate the set with.
+	 */
+	void restore(const PolygonRecordMap & polygons);
+
+	/*!
+	 *	@brief		Reports the version of the set; it increases with every change.
+	 */
+	size_t getVersion() const { return _version; }
+
+	/*!
+	 *	@brief		Captures the polygons in an immutable snapshot which can be read by other
+	 *				threads while the set is edited.
+	 *
+	 *	The snapshot shares the records of the unchanged polygons with the previous one;
+	 *	only the polygons changed since the previous snapshot are copied.
+	 *
+	 *	@returns	The snapshot of the current version.
+	 */
+	ObstacleSnapshotPtr takeSnapshot();
+
+	/*!
+	 *	@brief		Merges edits computed from a snapshot into the set.
+	 *
+	 *	The edits are rebased onto the current version: an edit of a polygon which has
+	 *	changed, or has been removed, since the snapshot conflicts with the user's edit and
+	 *	is discarded.  The other edits are applied (and announced) as usual.
+	 *
+	 *	@param		edits			The edits.
+	 *	@param		baseVersion		The version of the snapshot the edits were computed from.
+	 *	@returns	The number of discarded edits.
+	 */
+	size_t mergeEdits(const GeometryEdits & edits, size_t baseVersion);
+
+	/*!
+	 *	@brief		Reports the number of polygons in the set.
+	 */
+	size_t getPolygonCount() const { return _polygons.size(); }
+
+	/*!
+	 *	@brief		Returns the indicated polygon.
+	 *
+	 *	@param		i		The position of the polygon in the set.
+	 */
+	const GLPolygon * getPolygon(size_t i) const { return _polygons[i]; }
+
+	/*!
+	 *	@brief		Finds a polygon by its identifier.  Unlike its position, a polygon's
+	 *				identifier doesn't change while it is in the set.
+	 *
+	 *	@param		id		The identifier of the polygon.
+	 *	@returns	The polygon, or null if no polygon in the set has the identifier.
+	 */
+	GLPolygon * findPolygon(size_t id) const;
+
+	/*!
+	 *	@brief		Registers a listener to be notified of changes to the set.
+	 *
+	 *	@param		listener		The listener; the caller retains ownership.
+	 */
+	void addListener(ObstacleSetListener * listener);
+
+	/*!
+	 *	@brief		Unregisters a listener.
+	 *
+	 *	@param		listener		The listener to remove.
+	 */
+	void removeListener(ObstacleSetListener * listener);
 	
 protected:
 
+	/*!
+	 *	@brief		Maps a set-wide vertex index to its polygon and the vertex index in
+	 *				that polygon (using the enumeration of the last selection draw).
+	 *
+	 *	@param		index		The set-wide vertex index.
+	 *	@param		poly		The index of the polygon containing the vertex.
+	 *	@param		local		The index of the vertex in its polygon.
+	 *	@returns	True if the index maps to a vertex, false otherwise.
+	 */
+	bool mapPickIndex(size_t index, size_t & poly, size_t & local) const;
+
+	/*!
+	 *	@brief		Destroys every polygon in the set.  The pooled polygons are released in
+	 *				bulk with the arena.
+	 */
+	void releasePolygons();
+
+	/*!
+	 *	@brief		Removes a polygon from the set and destroys it, without announcing the
+	 *				change on the EventBus.
+	 *
+	 *	@param		poly		The polygon to remove.
+	 *	@returns	True if the polygon was in the set.
+	 */
+	bool detachPolygon(GLPolygon * poly);
+
+	/*!
+	 *	@brief		Destroys a polygon which is not in the set, returning it to the storage
+	 *				it was created from.
+	 *
+	 *	@param		poly		The polygon to destroy.
+	 */
+	void destroyPolygon(GLPolygon * poly);
+
+	/*!
+	 *	@brief		Records that a polygon changed: advances the version, marks the
+	 *				polygon's position for the next snapshot and marks it stale in the
+	 *				obstacle index.
+	 *
+	 *	@param		poly		The changed polygon.
+	 */
+	void touch(GLPolygon * poly);
+
+	/*!
+	 *	@brief		Records that the obstacle index no longer reflects a polygon.
+	 *
+	 *	@param		id		The identifier of the changed (or removed) polygon.
+	 */
+	void staleIndex(size_t id);
+
+	/*!
+	 *	@brief		A shift of every polygon (see translate()).
+	 */
+	struct FrameShift {
+		/*!
+		 *	@brief		The version of the set after the shift.
+		 */
+		size_t	_version;
+
+		/*!
+		 *	@brief		The shift along the x-axis.
+		 */
+		double	_dx;
+
+		/*!
+		 *	@brief		The shift along the y-axis.
+		 */
+		double	_dy;
+	};
+
+	/*!
+	 *	@brief		The set-wide index of the first vertex of each polygon (plus the total
+	 *				vertex count) at the time of the last selection draw.
+	 */
+	std::vector<size_t>	_pickOffsets;
+
+	/*!
+	 *	@brief		Scratch space for the positions of the elements drawn for selection.
+	 */
+	std::vector<Vector3>	_pickPositions;
+
+	/*!
+	 *	@brief		Scratch space for the encoded colors of the elements drawn for selection.
+	 */
+	std::vector<unsigned char>	_pickColors;
+
+	/*!
+	 *	@brief		The storage of the pooled polygons.
+	 */
+	PolygonArena	_arena;
+
 	/*!
 	 *	@brief		The polygons in the obstacle set.
 	 */
 	std::vector<GLPolygon *>	_polygons;
+
+	/*!
+	 *	@brief		The polygons in the obstacle set, keyed by identifier.
+	 */
+	std::unordered_map<size_t, GLPolygon *>	_polygonsById;
+
+	/*!
+	 *	@brief		The identifier assigned to the next polygon added to the set.
+	 */
+	size_t	_nextId;
+
+	/*!
+	 *	@brief		The polygons modified since the last collection of changes (keyed by
+	 *				identifier).
+	 */
+	std::unordered_map<size_t, GLPolygon *>	_dirty;
+
+	/*!
+	 *	@brief		The identifiers of the polygons removed since the last collection of
+	 *				changes.
+	 */
+	std::vector<size_t>	_removed;
+
+	/*!
+	 *	@brief		The listeners notified of changes to the set.
+	 */
+	std::vector<ObstacleSetListener *>	_listeners;
+
+	/*!
+	 *	@brief		The index of the obstacles for containment and snap queries.
+	 */
+	mutable ObstacleGrid	_obstacleGrid;
+
+	/*!
+	 *	@brief		Reports if the index reflects the current polygons (except those in
+	 *				_staleIds).
+	 */
+	mutable bool	_obstacleGridValid;
+
+	/*!
+	 *	@brief		The identifiers of the polygons changed or removed since the index was
+	 *				built.
+	 */
+	mutable std::unordered_set<size_t>	_staleIds;
+
+	/*!
+	 *	@brief		The version of the set.
+	 */
+	size_t	_version;
+
+	/*!
+	 *	@brief		The most recent snapshot.
+	 */
+	ObstacleSnapshotPtr	_snapshot;
+
+	/*!
+	 *	@brief		The positions whose polygons changed since the most recent snapshot.
+	 */
+	std::unordered_set<size_t>	_staleSlots;
+
+	/*!
+	 *	@brief		Reports if every position changed since the most recent snapshot.
+	 */
+	bool	_allStale;
+
+	/*!
+	 *	@brief		The shifts of the set, oldest first; edits computed before a shift are
+	 *				moved into the current frame.
+	 */
+	std::vector<FrameShift>	_frameShifts;
 };
 
 
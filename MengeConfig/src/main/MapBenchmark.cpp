@@ -0,0 +1,238 @@
+#include "MapBenchmark.h"
+
+#include "LiveObstacleSet.h"
+#include "MapImporter.h"
+#include "MCException.h"
+#include "WorldFrame.h"
+
+#include <QtCore/qdir.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtemporaryfile.h>
+
+#include <cmath>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Formats a rate (e.g., features per second).
+ *
+ *	@param		count		The number of items processed.
+ *	@param		ms			The time taken (in milliseconds).
+ *	@returns	The number of items per second.
+ */
+std::string formatRate(double count, qint64 ms) {
+	return QString::number(count * 1000.0 / (ms > 0 ? ms : 1), 'f', 0).toStdString();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		The times of one import.
+ */
+struct ImportTimes {
+	/// The time taken to read and parse the map (in milliseconds).
+	qint64	_read;
+
+	/// The time taken to insert the outlines into the obstacle set (in milliseconds).
+	qint64	_insert;
+
+	/// The time taken to index the obstacles (in milliseconds).
+	qint64	_index;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Writes the times of an import.
+ *
+ *	@param		times			The times.
+ *	@param		importer		The importer which read the map.
+ *	@param		out				The stream to write to.
+ */
+void printTimes(const ImportTimes & times, const MapImporter & importer, std::ostream & out) {
+	const double megabytes = importer.getByteCount() / 1048576.0;
+	out << "read " << times._read << " ms (" << formatRate((double)importer.getFeatureCount(), times._read) << " features/s, ";
+	out << QString::number(megabytes * 1000.0 / (times._read > 0 ? times._read : 1), 'f', 1).toStdString() << " MB/s), ";
+	out << "insert " << times._insert << " ms (" << formatRate((double)importer.getOutlineCount(), times._insert) << " outlines/s), ";
+	out << "index " << times._index << " ms; total " << (times._read + times._insert + times._index) << " ms\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of MapBenchmark
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t MapBenchmark::DEFAULT_FEATURES = 1000000;
+
+///////////////////////////////////////////////////////////////////////////////
+
+int MapBenchmark::runCommandLine(const QStringList & args, std::ostream & out) {
+	QString mapPath;
+	size_t featureCount = DEFAULT_FEATURES;
+	bool countGiven = false;
+	int repeat = 1;
+	bool usable = args.size() >= 1 && args[0] == "--benchmark-import";
+	for (int i = 1; usable && i < args.size(); ++i) {
+		bool ok = true;
+		if (args[i] == "--features" && i + 1 < args.size()) {
+			featureCount = (size_t)args[++i].toULongLong(&ok);
+			usable = ok && featureCount > 0;
+			countGiven = true;
+		}
+		else if (args[i] == "--repeat" && i + 1 < args.size()) {
+			repeat = args[++i].toInt(&ok);
+			usable = ok && repeat > 0;
+		}
+		else if (mapPath.isEmpty() && !args[i].startsWith("--")) {
+			mapPath = args[i];
+		}
+		else {
+			usable = false;
+		}
+	}
+	// The feature count only applies to a generated map.
+	if (!usable || (countGiven && !mapPath.isEmpty())) {
+		out << "usage: MengeConfig --benchmark-import [--features <count>] [--repeat <count>] [<map>]\n";
+		return 2;
+	}
+
+	QTemporaryFile generated(QDir::temp().filePath("mengeconfig-benchmark-XXXXXX.geojson"));
+	ImportTimes best = { 0, 0, 0 };
+	size_t outlines = 0;
+	size_t malformed = 0;
+	try {
+		if (mapPath.isEmpty()) {
+			if (!generated.open()) {
+				throw MCException("Unable to create a temporary map: " + generated.errorString().toStdString());
+			}
+			mapPath = generated.fileName();
+			generated.close();
+			QElapsedTimer timer;
+			timer.start();
+			writeGeoJson(mapPath, featureCount);
+			out << "generated " << featureCount << " features in " << timer.elapsed() << " ms\n";
+		}
+		for (int r = 0; r < repeat; ++r) {
+			MapImporter importer;
+			LiveObstacleSet obstacles;
+			ImportTimes times;
+			QElapsedTimer timer;
+			timer.start();
+			importer.read(mapPath);
+			times._read = timer.restart();
+			// The origin is moved to the map, as an interactive import does.
+			WorldFrame frame;
+			double minX, minY, maxX, maxY;
+			if (importer.getBounds(minX, minY, maxX, maxY)) {
+				frame.setOrigin(WorldFrame::roundOrigin(0.5 * (minX + maxX)), WorldFrame::roundOrigin(0.5 * (minY + maxY)));
+			}
+			timer.restart();
+			importer.insert(obstacles, frame);
+			times._insert = timer.restart();
+			obstacles.getObstacleGrid();
+			times._index = timer.elapsed();
+
+			if (r == 0) {
+				out << mapPath.toStdString() << ": " << importer.getFeatureCount() << " features (";
+				out << QString::number(importer.getByteCount() / 1048576.0, 'f', 1).toStdString() << " MB): ";
+				out << importer.getOutlineCount() << " outlines, " << importer.getSkippedCount() << " skipped, ";
+				out << importer.getMalformedCount() << " malformed\n";
+				best = times;
+			}
+			out << "run " << (r + 1) << ": ";
+			printTimes(times, importer, out);
+			if (times._read + times._insert + times._index < best._read + best._insert + best._index) {
+				best = times;
+			}
+			if (r + 1 == repeat && repeat > 1) {
+				out << "best: ";
+				printTimes(best, importer, out);
+			}
+			outlines = importer.getOutlineCount();
+			malformed = importer.getMalformedCount();
+		}
+	}
+	catch (MCException & e) {
+		out << "error: " << e.what() << "\n";
+		return 2;
+	}
+	return outlines == 0 || malformed > 0 ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MapBenchmark::writeGeoJson(const QString & path, size_t features) {
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		throw MCException("Unable to write the map " + path.toStdString() + ": " + file.errorString().toStdString());
+	}
+	// A city of blocks 40 m apart, centered near 13.4 E, 52.5 N.
+	const double LON = 13.4;
+	const double LAT = 52.5;
+	const double BLOCK = 40.0;
+	const double METERS_PER_LAT = 111320.0;
+	const double METERS_PER_LON = METERS_PER_LAT * std::cos(LAT * 3.14159265358979 / 180.0);
+	const size_t side = (size_t)std::ceil(std::sqrt((double)features));
+	const double originLon = LON - 0.5 * side * BLOCK / METERS_PER_LON;
+	const double originLat = LAT - 0.5 * side * BLOCK / METERS_PER_LAT;
+
+	QByteArray buffer;
+	const int FLUSH_SIZE = 1 << 20;
+	buffer.reserve(FLUSH_SIZE + 4096);
+	buffer.append("{\"type\":\"FeatureCollection\",\"features\":[\n");
+	// The corners of a footprint (in meters, counter-clockwise, as RFC 7946 specifies for
+	//	outer rings).
+	double corners[12];
+	for (size_t n = 0; n < features; ++n) {
+		const double w = 10.0 + (n * 7 % 20);
+		const double h = 8.0 + (n * 13 % 17);
+		size_t count = 4;
+		corners[0] = 0.0;	corners[1] = 0.0;
+		corners[2] = w;		corners[3] = 0.0;
+		if (n % 3 == 0) {
+			// An L-shaped building.
+			count = 6;
+			corners[4] = w;			corners[5] = 0.5 * h;
+			corners[6] = 0.5 * w;	corners[7] = 0.5 * h;
+			corners[8] = 0.5 * w;	corners[9] = h;
+		}
+		else {
+			corners[4] = w;			corners[5] = h;
+		}
+		corners[2 * count - 2] = 0.0;
+		corners[2 * count - 1] = h;
+
+		const double x = (n % side) * BLOCK;
+		const double y = (n / side) * BLOCK;
+		buffer.append(n == 0 ? "" : ",\n");
+		buffer.append("{\"type\":\"Feature\",\"properties\":{\"id\":").append(QByteArray::number((qulonglong)n));
+		buffer.append(",\"building\":\"yes\",\"levels\":").append(QByteArray::number((int)(1 + n % 6)));
+		buffer.append("},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[");
+		// The ring is closed: its first position is repeated.
+		for (size_t c = 0; c <= count; ++c) {
+			const size_t corner = c < count ? c : 0;
+			buffer.append(c == 0 ? "[" : ",[");
+			buffer.append(QByteArray::number(originLon + (x + corners[2 * corner]) / METERS_PER_LON, 'f', 7));
+			buffer.append(',');
+			buffer.append(QByteArray::number(originLat + (y + corners[2 * corner + 1]) / METERS_PER_LAT, 'f', 7));
+			buffer.append(']');
+		}
+		buffer.append("]]}}");
+		if (buffer.size() >= FLUSH_SIZE) {
+			if (file.write(buffer) != buffer.size()) {
+				throw MCException("Unable to write the map " + path.toStdString() + ": " + file.errorString().toStdString());
+			}
+			buffer.resize(0);
+		}
+	}
+	buffer.append("\n]}\n");
+	if (file.write(buffer) != buffer.size()) {
+		throw MCException("Unable to write the map " + path.toStdString() + ": " + file.errorString().toStdString());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
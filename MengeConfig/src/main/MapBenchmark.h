@@ -0,0 +1,62 @@
+/*!
+ *	@file		MapBenchmark.h
+ *	@brief		The definition of the throughput benchmark of map imports.
+ */
+
+#ifndef __MAP_BENCHMARK_H__
+#define	__MAP_BENCHMARK_H__
+
+#include <QtCore/qglobal.h>
+
+#include <iostream>
+
+// forward declarations
+QT_BEGIN_NAMESPACE
+class QString;
+class QStringList;
+QT_END_NAMESPACE
+
+/*!
+ *	@brief		Measures how quickly a vector map is imported: read and parsed (see
+ *				MapImporter), inserted into an obstacle set and indexed (the first build of
+ *				its obstacle grid).
+ *
+ *	Unless a map is named, a GeoJSON map of building footprints (DEFAULT_FEATURES of them,
+ *	in longitudes and latitudes, as RFC 7946 specifies) is generated for the run and
+ *	removed afterwards.
+ */
+class MapBenchmark {
+public:
+	/*!
+	 *	@brief		Runs the benchmark without presenting any GUI:
+	 *
+	 *		--benchmark-import [--features <count>] [--repeat <count>] [<map>]
+	 *
+	 *	Each repetition imports the map anew; the fastest is reported as well as every
+	 *	repetition's times.
+	 *
+	 *	@param		args		The command-line arguments (excluding the program).
+	 *	@param		out			The stream the results are written to.
+	 *	@returns	The exit code: 0 if the map was imported, 1 if it had no outlines or
+	 *				malformed features and 2 if the arguments can't be used or the map
+	 *				can't be read.
+	 */
+	static int runCommandLine(const QStringList & args, std::ostream & out);
+
+	/*!
+	 *	@brief		Writes a GeoJSON map of building footprints: rectangles and L-shaped
+	 *				outlines on a square city grid, with a few properties each.
+	 *
+	 *	@param		path			The path of the map.
+	 *	@param		features		The number of features.
+	 *	@throws		MCException if the file can't be written.
+	 */
+	static void writeGeoJson(const QString & path, size_t features);
+
+	/*!
+	 *	@brief		The number of features of the generated map.
+	 */
+	static const size_t DEFAULT_FEATURES;
+};
+
+#endif	// __MAP_BENCHMARK_H__
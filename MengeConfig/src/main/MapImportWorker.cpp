@@ -0,0 +1,91 @@
+#include "MapImportWorker.hpp"
+
+#include "MapImporter.h"
+#include "MCException.h"
+
+#include <QtCore/qelapsedtimer.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of MapImportWorker
+///////////////////////////////////////////////////////////////////////////////
+
+MapImportWorker::MapImportWorker(QObject * parent) : QObject(parent), _worker(), _lock(), _wake(), _pending(), _finished(), _busy(false), _stopping(false) {
+	_worker = std::thread(&MapImportWorker::workerLoop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MapImportWorker::~MapImportWorker() {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+		_pending.clear();
+	}
+	_wake.notify_all();
+	_worker.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MapImportWorker::submit(const QString & path) {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_pending.push_back(path);
+	}
+	_wake.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool MapImportWorker::isBusy() const {
+	std::lock_guard< std::mutex > lock(_lock);
+	return _busy || !_pending.empty() || !_finished.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MapImportWorker::takeFinished(std::deque< MapImport > & imports) {
+	std::lock_guard< std::mutex > lock(_lock);
+	imports.insert(imports.end(), _finished.begin(), _finished.end());
+	_finished.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MapImportWorker::workerLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (_pending.empty() && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_stopping) return;
+
+		MapImport import;
+		import._path = _pending.front();
+		import._elapsed = 0;
+		_pending.pop_front();
+		_busy = true;
+		lock.unlock();
+
+		QElapsedTimer timer;
+		timer.start();
+		try {
+			std::shared_ptr< MapImporter > importer = std::make_shared< MapImporter >();
+			importer->read(import._path);
+			import._importer = importer;
+		}
+		catch (MCException & e) {
+			import._error = e.what();
+		}
+		import._elapsed = timer.elapsed();
+
+		lock.lock();
+		_busy = false;
+		_finished.push_back(import);
+		lock.unlock();
+		emit mapRead();
+		lock.lock();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,139 @@
+/*!
+ *	@file		MapImportWorker.hpp
+ *	@brief		The definition of the background thread which reads vector maps.
+ */
+
+#ifndef __MAP_IMPORT_WORKER_H__
+#define	__MAP_IMPORT_WORKER_H__
+
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// forward declarations
+class MapImporter;
+
+/*!
+ *	@brief		A map read by the MapImportWorker.
+ */
+struct MapImport {
+	/*!
+	 *	@brief		The path to the map.
+	 */
+	QString	_path;
+
+	/*!
+	 *	@brief		The map's outlines (null if it couldn't be read).
+	 */
+	std::shared_ptr< MapImporter >	_importer;
+
+	/*!
+	 *	@brief		The time spent reading the map (in milliseconds).
+	 */
+	qint64	_elapsed;
+
+	/*!
+	 *	@brief		The error which prevented reading the map (empty if it was read).
+	 */
+	std::string	_error;
+};
+
+/*!
+ *	@brief		Reads vector maps on a background thread so the editor stays responsive.
+ *
+ *	Reading (and parsing) a large map takes seconds; it touches nothing but the file and
+ *	the importer, so it is done here.  Inserting the outlines into the obstacles is left to
+ *	the GUI thread, which collects the read maps with takeFinished() when mapRead() is
+ *	delivered.  Maps are read one at a time, in the order submitted.
+ */
+class MapImportWorker : public QObject {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent			The optional parent object.
+	 */
+	MapImportWorker(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor -- waits for the map being read; the queued maps are
+	 *				discarded.
+	 */
+	~MapImportWorker();
+
+	/*!
+	 *	@brief		Queues a map to read.
+	 *
+	 *	@param		path		The path to the map.
+	 */
+	void submit(const QString & path);
+
+	/*!
+	 *	@brief		Reports if a map is queued, being read or waiting to be taken.
+	 */
+	bool isBusy() const;
+
+	/*!
+	 *	@brief		Takes the maps which have been read.
+	 *
+	 *	@param		imports		The maps are appended here, in the order submitted.
+	 */
+	void takeFinished(std::deque< MapImport > & imports);
+
+signals:
+	/*!
+	 *	@brief		Emitted (from the worker thread) when a map has been read.
+	 */
+	void mapRead();
+
+protected:
+	/*!
+	 *	@brief		The worker thread's loop.
+	 */
+	void workerLoop();
+
+	/*!
+	 *	@brief		The worker thread.
+	 */
+	std::thread	_worker;
+
+	/*!
+	 *	@brief		Guards the queues and flags below.
+	 */
+	mutable std::mutex	_lock;
+
+	/*!
+	 *	@brief		Signals the worker that there is a map (or that it should stop).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		The paths of the maps waiting to be read.
+	 */
+	std::deque< QString >	_pending;
+
+	/*!
+	 *	@brief		The maps waiting to be taken.
+	 */
+	std::deque< MapImport >	_finished;
+
+	/*!
+	 *	@brief		Reports if the worker is reading a map.
+	 */
+	bool	_busy;
+
+	/*!
+	 *	@brief		Reports if the worker should stop.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __MAP_IMPORT_WORKER_H__
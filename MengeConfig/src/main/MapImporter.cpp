@@ -0,0 +1,1187 @@
+#include "MapImporter.h"
+
+#include "GLPolygon.h"
+#include "LiveObstacleSet.h"
+#include "MCException.h"
+#include "ThreadPool.h"
+#include "WorldFrame.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		The boundaries of a feature in the map.
+ */
+struct ImportFeature {
+	/*!
+	 *	@brief		The position of the feature's first byte.
+	 */
+	size_t	_begin;
+
+	/*!
+	 *	@brief		The position following the feature's last byte.
+	 */
+	size_t	_end;
+
+	/*!
+	 *	@brief		A format-specific kind (e.g., the DXF entity type).
+	 */
+	int	_kind;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		The outlines parsed by one task.
+ */
+struct ImportBlock {
+	/*!
+	 *	@brief		Constructor.
+	 */
+	ImportBlock() : _coords(), _outlineEnds(), _skipped(0), _malformed(0) {}
+
+	/*!
+	 *	@brief		The outlines' vertices: x- and y-values.
+	 */
+	std::vector< double >	_coords;
+
+	/*!
+	 *	@brief		For each outline, the index of the vertex following its last vertex.
+	 */
+	std::vector< size_t >	_outlineEnds;
+
+	/*!
+	 *	@brief		The number of features and parts which aren't outlines.
+	 */
+	size_t	_skipped;
+
+	/*!
+	 *	@brief		The number of features which couldn't be parsed.
+	 */
+	size_t	_malformed;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses a feature into a block.
+ *
+ *	@param		data		The map.
+ *	@param		feature		The feature.
+ *	@param		block		The feature's outlines are appended to this block.
+ *	@returns	False if the feature is malformed (its outlines are discarded).
+ */
+typedef bool (*FeatureParser)(const char * data, const ImportFeature & feature, ImportBlock & block);
+
+// The DXF entities which may be outlines.
+const int DXF_LWPOLYLINE = 0;
+const int DXF_POLYLINE = 1;
+
+// The Shapefile's file code and the polygon shape types.
+const qint32 SHAPE_FILE_CODE = 9994;
+const qint32 SHAPE_POLYGON = 5;
+const qint32 SHAPE_POLYGON_Z = 15;
+const qint32 SHAPE_POLYGON_M = 25;
+// The size of the Shapefile's header and of a record's header.
+const size_t SHAPE_HEADER_SIZE = 100;
+const size_t SHAPE_RECORD_HEADER_SIZE = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses a decimal number (with optional sign, fraction and exponent).  The
+ *				parse doesn't depend on the locale.
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the number; it is advanced past it.
+ *	@param		value		The number is written here.
+ *	@returns	False if there is no number at the position.
+ */
+bool parseImportNumber(const char * data, size_t end, size_t & i, double & value) {
+	size_t j = i;
+	bool negative = false;
+	if (j < end && (data[j] == '-' || data[j] == '+')) {
+		negative = data[j] == '-';
+		++j;
+	}
+	double mantissa = 0.0;
+	int exponent = 0;
+	bool digits = false;
+	for (; j < end && data[j] >= '0' && data[j] <= '9'; ++j) {
+		mantissa = mantissa * 10.0 + (data[j] - '0');
+		digits = true;
+	}
+	if (j < end && data[j] == '.') {
+		for (++j; j < end && data[j] >= '0' && data[j] <= '9'; ++j) {
+			mantissa = mantissa * 10.0 + (data[j] - '0');
+			--exponent;
+			digits = true;
+		}
+	}
+	if (!digits) return false;
+	if (j < end && (data[j] == 'e' || data[j] == 'E')) {
+		size_t k = j + 1;
+		bool negativeExp = false;
+		if (k < end && (data[k] == '-' || data[k] == '+')) {
+			negativeExp = data[k] == '-';
+			++k;
+		}
+		if (k < end && data[k] >= '0' && data[k] <= '9') {
+			int e = 0;
+			for (; k < end && data[k] >= '0' && data[k] <= '9'; ++k) {
+				if (e < 1000) e = e * 10 + (data[k] - '0');
+			}
+			exponent += negativeExp ? -e : e;
+			j = k;
+		}
+	}
+	// Dividing by an exact power of ten rounds correctly where multiplying by its inverse
+	//	wouldn't.
+	value = exponent < 0 ? mantissa / pow(10.0, -exponent) : mantissa * pow(10.0, exponent);
+	if (negative) value = -value;
+	i = j;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Computes twice the signed area of a ring (positive if it is counter-
+ *				clockwise).
+ *
+ *	@param		coords		The ring's x- and y-values.
+ *	@param		count		The number of vertices in the ring.
+ *	@returns	Twice the signed area.
+ */
+double importRingArea(const double * coords, size_t count) {
+	// Relative to the first vertex, so large world coordinates don't cancel.
+	double area = 0.0;
+	for (size_t k = 1; k + 1 < count; ++k) {
+		const double ax = coords[2 * k] - coords[0];
+		const double ay = coords[2 * k + 1] - coords[1];
+		const double bx = coords[2 * k + 2] - coords[0];
+		const double by = coords[2 * k + 3] - coords[1];
+		area += ax * by - ay * bx;
+	}
+	return area;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Completes the ring appended to a block: drops its closing vertex, makes it
+ *				counter-clockwise and records it as an outline.  Degenerate rings are
+ *				discarded.
+ *
+ *	@param		block		The block.
+ *	@param		start		The index of the ring's first vertex.
+ *	@param		ccwIsHole	If true, a counter-clockwise ring is a hole and is discarded.
+ */
+void finishImportRing(ImportBlock & block, size_t start, bool ccwIsHole) {
+	std::vector< double > & coords = block._coords;
+	size_t count = coords.size() / 2 - start;
+	if (count > 1 && coords[2 * start] == coords[coords.size() - 2] && coords[2 * start + 1] == coords.back()) {
+		coords.resize(coords.size() - 2);
+		--count;
+	}
+	const double area = count < 3 ? 0.0 : importRingArea(&coords[2 * start], count);
+	if (area == 0.0 || (ccwIsHole && area > 0.0)) {
+		coords.resize(2 * start);
+		++block._skipped;
+		return;
+	}
+	if (area < 0.0) {
+		for (size_t a = start, b = start + count - 1; a < b; ++a, --b) {
+			std::swap(coords[2 * a], coords[2 * b]);
+			std::swap(coords[2 * a + 1], coords[2 * b + 1]);
+		}
+	}
+	block._outlineEnds.push_back(coords.size() / 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses the features of a map into blocks, in parallel.
+ *
+ *	@param		data		The map.
+ *	@param		features	The features.
+ *	@param		parser		The parser of a single feature.
+ *	@param		blocks		The blocks; one is created for every BLOCK_FEATURES features.
+ */
+void parseImportFeatures(const char * data, const std::vector< ImportFeature > & features, FeatureParser parser, std::vector< ImportBlock > & blocks) {
+	const size_t BLOCK_SIZE = MapImporter::BLOCK_FEATURES;
+	blocks.resize((features.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	ThreadPool::instance()->parallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; ++b) {
+			ImportBlock & block = blocks[b];
+			const size_t last = std::min(features.size(), (b + 1) * BLOCK_SIZE);
+			for (size_t f = b * BLOCK_SIZE; f < last; ++f) {
+				const size_t coordCount = block._coords.size();
+				const size_t outlineCount = block._outlineEnds.size();
+				const size_t skipped = block._skipped;
+				if (!parser(data, features[f], block)) {
+					// Nothing of a malformed feature is kept.
+					block._coords.resize(coordCount);
+					block._outlineEnds.resize(outlineCount);
+					block._skipped = skipped;
+					++block._malformed;
+				}
+			}
+		}
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//			GeoJSON
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Advances past white space.
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position; it is advanced to the next other character.
+ */
+void skipJsonSpace(const char * data, size_t end, size_t & i) {
+	while (i < end && (data[i] == ' ' || data[i] == '\n' || data[i] == '\r' || data[i] == '\t')) ++i;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Advances past a string.
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the opening quote; it is advanced past the
+ *							closing quote.
+ *	@returns	False if the string isn't terminated.
+ */
+bool skipJsonString(const char * data, size_t end, size_t & i) {
+	for (++i; i < end; ++i) {
+		if (data[i] == '\\') {
+			++i;
+		}
+		else if (data[i] == '"') {
+			++i;
+			return true;
+		}
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Advances past a value (of any type).
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the value; it is advanced past it.
+ *	@returns	False if the value isn't terminated.
+ */
+bool skipJsonValue(const char * data, size_t end, size_t & i) {
+	int depth = 0;
+	while (i < end) {
+		const char c = data[i];
+		if (c == '"') {
+			if (!skipJsonString(data, end, i)) return false;
+			if (depth == 0) return true;
+			continue;
+		}
+		if (c == '{' || c == '[') {
+			++depth;
+		}
+		else if (c == '}' || c == ']') {
+			if (depth == 0) return true;
+			if (--depth == 0) {
+				++i;
+				return true;
+			}
+		}
+		else if (depth == 0 && (c == ',' || c == ' ' || c == '\n' || c == '\r' || c == '\t')) {
+			return true;
+		}
+		++i;
+	}
+	return depth == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if the string at a position is the given key (i.e., it is
+ *				followed by a colon).  If it is, the position is advanced past the colon.
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the string's opening quote.
+ *	@param		key			The key (without quotes).
+ *	@returns	True if the string is the key.
+ */
+bool matchJsonKey(const char * data, size_t end, size_t & i, const char * key) {
+	const size_t length = strlen(key);
+	if (i + length + 2 > end || data[i + length + 1] != '"' || strncmp(data + i + 1, key, length) != 0) return false;
+	size_t j = i + length + 2;
+	skipJsonSpace(data, end, j);
+	if (j >= end || data[j] != ':') return false;
+	i = j + 1;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses a position and appends its x- and y-values (further ordinates are
+ *				ignored).
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the position's opening bracket; it is advanced
+ *							past the closing bracket.
+ *	@param		coords		The values are appended here.
+ *	@returns	False if the position is malformed.
+ */
+bool parseGeoJsonPosition(const char * data, size_t end, size_t & i, std::vector< double > & coords) {
+	skipJsonSpace(data, end, i);
+	if (i >= end || data[i] != '[') return false;
+	++i;
+	double x, y;
+	skipJsonSpace(data, end, i);
+	if (!parseImportNumber(data, end, i, x)) return false;
+	skipJsonSpace(data, end, i);
+	if (i >= end || data[i] != ',') return false;
+	++i;
+	skipJsonSpace(data, end, i);
+	if (!parseImportNumber(data, end, i, y)) return false;
+	skipJsonSpace(data, end, i);
+	while (i < end && data[i] == ',') {
+		++i;
+		skipJsonSpace(data, end, i);
+		double ordinate;
+		if (!parseImportNumber(data, end, i, ordinate)) return false;
+		skipJsonSpace(data, end, i);
+	}
+	if (i >= end || data[i] != ']') return false;
+	++i;
+	coords.push_back(x);
+	coords.push_back(y);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses the rings of a polygon; the first is an outline, the rest are holes.
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the polygon's opening bracket; it is advanced
+ *							past the closing bracket.
+ *	@param		block		The outline is appended to this block.
+ *	@returns	False if the polygon is malformed.
+ */
+bool parseGeoJsonPolygon(const char * data, size_t end, size_t & i, ImportBlock & block) {
+	skipJsonSpace(data, end, i);
+	if (i >= end || data[i] != '[') return false;
+	++i;
+	for (size_t ring = 0; ; ++ring) {
+		skipJsonSpace(data, end, i);
+		if (i < end && data[i] == ']' && ring == 0) break;
+		if (i >= end || data[i] != '[') return false;
+		++i;
+		const size_t start = block._coords.size() / 2;
+		skipJsonSpace(data, end, i);
+		if (i < end && data[i] == ']') {
+			++i;
+		}
+		else {
+			while (true) {
+				if (!parseGeoJsonPosition(data, end, i, block._coords)) return false;
+				skipJsonSpace(data, end, i);
+				if (i >= end) return false;
+				if (data[i] == ']') {
+					++i;
+					break;
+				}
+				if (data[i] != ',') return false;
+				++i;
+			}
+		}
+		if (ring == 0) {
+			finishImportRing(block, start, false);
+		}
+		else {
+			block._coords.resize(2 * start);
+			++block._skipped;
+		}
+		skipJsonSpace(data, end, i);
+		if (i >= end) return false;
+		if (data[i] == ']') break;
+		if (data[i] != ',') return false;
+		++i;
+	}
+	++i;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses the polygons of a multi-polygon.
+ *
+ *	@param		data		The text.
+ *	@param		end			The position following the text's last character.
+ *	@param		i			The position of the multi-polygon's opening bracket; it is
+ *							advanced past the closing bracket.
+ *	@param		block		The outlines are appended to this block.
+ *	@returns	False if the multi-polygon is malformed.
+ */
+bool parseGeoJsonMultiPolygon(const char * data, size_t end, size_t & i, ImportBlock & block) {
+	skipJsonSpace(data, end, i);
+	if (i >= end || data[i] != '[') return false;
+	++i;
+	skipJsonSpace(data, end, i);
+	if (i < end && data[i] == ']') {
+		++i;
+		return true;
+	}
+	while (true) {
+		if (!parseGeoJsonPolygon(data, end, i, block)) return false;
+		skipJsonSpace(data, end, i);
+		if (i >= end) return false;
+		if (data[i] == ']') break;
+		if (data[i] != ',') return false;
+		++i;
+	}
+	++i;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses the geometries of a GeoJSON feature (or of a bare geometry).
+ *
+ *	Every object with both a "type" and "coordinates" member is a geometry; geometry
+ *	collections are thereby handled without special cases.
+ *
+ *	@param		data		The map.
+ *	@param		feature		The feature.
+ *	@param		block		The feature's outlines are appended to this block.
+ *	@returns	False if the feature is malformed.
+ */
+bool parseGeoJsonFeature(const char * data, const ImportFeature & feature, ImportBlock & block) {
+	// The state of each open object: the kind of its geometry and its coordinates.
+	enum GeometryKind { NO_GEOMETRY, POLYGON, MULTI_POLYGON, OTHER_GEOMETRY };
+	struct GeometryState {
+		GeometryKind	_kind;
+		size_t			_coordinates;
+	};
+	std::vector< GeometryState > objects;
+	const size_t end = feature._end;
+	size_t i = feature._begin;
+	while (i < end) {
+		const char c = data[i];
+		if (c == '"') {
+			if (!objects.empty()) {
+				GeometryState & state = objects.back();
+				if (matchJsonKey(data, end, i, "type")) {
+					skipJsonSpace(data, end, i);
+					if (i < end && data[i] == '"') {
+						const size_t begin = i;
+						if (!skipJsonString(data, end, i)) return false;
+						const size_t length = i - begin;
+						if (length == 9 && strncmp(data + begin, "\"Polygon\"", 9) == 0) {
+							state._kind = POLYGON;
+						}
+						else if (length == 14 && strncmp(data + begin, "\"MultiPolygon\"", 14) == 0) {
+							state._kind = MULTI_POLYGON;
+						}
+						else {
+							state._kind = OTHER_GEOMETRY;
+						}
+					}
+					continue;
+				}
+				if (matchJsonKey(data, end, i, "coordinates")) {
+					skipJsonSpace(data, end, i);
+					state._coordinates = i;
+					if (!skipJsonValue(data, end, i)) return false;
+					continue;
+				}
+			}
+			if (!skipJsonString(data, end, i)) return false;
+			continue;
+		}
+		if (c == '{') {
+			GeometryState state = { NO_GEOMETRY, 0 };
+			objects.push_back(state);
+		}
+		else if (c == '}') {
+			if (objects.empty()) return false;
+			const GeometryState state = objects.back();
+			objects.pop_back();
+			if (state._coordinates > 0) {
+				size_t j = state._coordinates;
+				if (state._kind == POLYGON) {
+					if (!parseGeoJsonPolygon(data, end, j, block)) return false;
+				}
+				else if (state._kind == MULTI_POLYGON) {
+					if (!parseGeoJsonMultiPolygon(data, end, j, block)) return false;
+				}
+				else {
+					++block._skipped;
+				}
+			}
+		}
+		++i;
+	}
+	return objects.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Finds the features of a GeoJSON map: the elements of the top-level
+ *				"features" array or, if there is none, the whole document.
+ *
+ *	@param		data		The map.
+ *	@param		size		The size of the map.
+ *	@param		features	The features are appended here.
+ *	@param		crs			The name of the map's coordinate reference system (its
+ *							top-level "crs" member) is written here; it is left empty if
+ *							the map doesn't have one.
+ *	@throws		MCException if the map isn't a JSON object.
+ */
+void findGeoJsonFeatures(const char * data, size_t size, std::vector< ImportFeature > & features, std::string & crs) {
+	size_t i = 0;
+	// A byte order mark may precede the document.
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) i = 3;
+	skipJsonSpace(data, size, i);
+	if (i >= size || data[i] != '{') {
+		throw MCException("The map is not a GeoJSON object");
+	}
+	const size_t documentBegin = i;
+	bool hasFeatures = false;
+	int depth = 0;
+	while (i < size) {
+		const char c = data[i];
+		if (c == '"') {
+			if (depth == 1 && matchJsonKey(data, size, i, "crs")) {
+				// The (pre-RFC 7946) named form: { "type": "name", "properties": { "name": ... } }.
+				skipJsonSpace(data, size, i);
+				const size_t begin = i;
+				if (!skipJsonValue(data, size, i)) break;
+				crs.assign(data + begin, i - begin);
+				for (size_t j = begin; j < i; ) {
+					if (data[j] != '"') {
+						++j;
+						continue;
+					}
+					if (matchJsonKey(data, i, j, "name")) {
+						skipJsonSpace(data, i, j);
+						const size_t nameBegin = j;
+						if (j < i && data[j] == '"' && skipJsonString(data, i, j)) {
+							crs.assign(data + nameBegin + 1, j - nameBegin - 2);
+						}
+						break;
+					}
+					if (!skipJsonString(data, i, j)) break;
+				}
+				continue;
+			}
+			if (depth == 1 && !hasFeatures && matchJsonKey(data, size, i, "features")) {
+				skipJsonSpace(data, size, i);
+				if (i >= size || data[i] != '[') break;
+				++i;
+				hasFeatures = true;
+				// The rest of the document is still scanned; the crs may follow the features.
+				while (true) {
+					skipJsonSpace(data, size, i);
+					if (i < size && data[i] == ',') {
+						++i;
+						continue;
+					}
+					if (i >= size) return;
+					if (data[i] == ']') {
+						++i;
+						break;
+					}
+					ImportFeature feature = { i, i, 0 };
+					if (!skipJsonValue(data, size, i)) {
+						throw MCException("The map's feature array is not terminated");
+					}
+					feature._end = i;
+					features.push_back(feature);
+				}
+				continue;
+			}
+			if (!skipJsonString(data, size, i)) break;
+			continue;
+		}
+		if (c == '{' || c == '[') ++depth;
+		else if (c == '}' || c == ']') --depth;
+		++i;
+	}
+	if (hasFeatures) return;
+	// A single feature or geometry.
+	ImportFeature feature = { documentBegin, size, 0 };
+	features.push_back(feature);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if a GeoJSON map's coordinate reference system is geographic, i.e.,
+ *				its positions are longitudes and latitudes in degrees.
+ *
+ *	@param		crs			The name of the system (e.g., "urn:ogc:def:crs:EPSG::3857");
+ *							empty if the map doesn't name one, in which case it is WGS 84
+ *							(RFC 7946).
+ *	@returns	True if the system is WGS 84 or another geographic system close enough
+ *				to it (ETRS89, NAD83).
+ */
+bool isGeographicCrs(const std::string & crs) {
+	if (crs.empty()) return true;
+	std::string name(crs);
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	if (name.find("crs84") != std::string::npos) return true;
+	const size_t colon = name.find_last_of(':');
+	const std::string code = colon == std::string::npos ? name : name.substr(colon + 1);
+	return code == "4326" || code == "4258" || code == "4269";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Selects the UTM zone of a geographic position.
+ *
+ *	@param		lon			The longitude (in degrees).
+ *	@param		lat			The latitude (in degrees).
+ *	@returns	The zone: 1 - 60 in the northern hemisphere, -1 - -60 in the southern.
+ */
+int findUtmZone(double lon, double lat) {
+	int zone = int(floor((lon + 180.0) / 6.0)) + 1;
+	if (zone < 1) zone = 1;
+	else if (zone > 60) zone = 60;
+	return lat < 0.0 ? -zone : zone;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Projects WGS 84 longitudes and latitudes onto a UTM zone (transverse
+ *				Mercator; Snyder's series, accurate to millimeters within the zone).
+ *
+ *	@param		coords		Pairs of longitudes and latitudes (in degrees); they are
+ *							replaced by eastings and northings (in meters).
+ *	@param		zone		The zone (see findUtmZone()).
+ */
+void projectToUtm(std::vector< double > & coords, int zone) {
+	const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+	const double A = 6378137.0;
+	const double F = 1.0 / 298.257223563;
+	const double E2 = F * (2.0 - F);
+	const double EP2 = E2 / (1.0 - E2);
+	const double K0 = 0.9996;
+	const double E4 = E2 * E2;
+	const double E6 = E4 * E2;
+	const double M1 = 1.0 - E2 / 4.0 - 3.0 * E4 / 64.0 - 5.0 * E6 / 256.0;
+	const double M2 = 3.0 * E2 / 8.0 + 3.0 * E4 / 32.0 + 45.0 * E6 / 1024.0;
+	const double M3 = 15.0 * E4 / 256.0 + 45.0 * E6 / 1024.0;
+	const double M4 = 35.0 * E6 / 3072.0;
+	const double LON0 = ((zone < 0 ? -zone : zone) * 6 - 183) * DEG_TO_RAD;
+	const double FALSE_NORTHING = zone < 0 ? 10000000.0 : 0.0;
+	ThreadPool::instance()->parallelFor(coords.size() / 2, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const double phi = coords[2 * i + 1] * DEG_TO_RAD;
+			const double sinPhi = sin(phi);
+			const double cosPhi = cos(phi);
+			const double n = A / sqrt(1.0 - E2 * sinPhi * sinPhi);
+			const double t = sinPhi * sinPhi / (cosPhi * cosPhi);
+			const double c = EP2 * cosPhi * cosPhi;
+			const double a = cosPhi * (coords[2 * i] * DEG_TO_RAD - LON0);
+			const double m = A * (M1 * phi - M2 * sin(2.0 * phi) + M3 * sin(4.0 * phi) - M4 * sin(6.0 * phi));
+			const double a2 = a * a;
+			coords[2 * i] = 500000.0 + K0 * n * (a + (1.0 - t + c) * a2 * a / 6.0 +
+				(5.0 - 18.0 * t + t * t + 72.0 * c - 58.0 * EP2) * a2 * a2 * a / 120.0);
+			coords[2 * i + 1] = FALSE_NORTHING + K0 * (m + n * sinPhi / cosPhi * (a2 / 2.0 +
+				(5.0 - t + 9.0 * c + 4.0 * c * c) * a2 * a2 / 24.0 +
+				(61.0 - 58.0 * t + t * t + 600.0 * c - 330.0 * EP2) * a2 * a2 * a2 / 720.0));
+		}
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//			DXF
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads the next group (a code line and a value line) of an ASCII DXF file.
+ *
+ *	@param		data		The map.
+ *	@param		end			The position following the last byte to read.
+ *	@param		i			The position of the group; it is advanced past it.
+ *	@param		code		The group code is written here.
+ *	@param		value		The position of the value (trimmed) is written here.
+ *	@param		valueEnd	The position following the value is written here.
+ *	@returns	False if there is no complete group at the position.
+ */
+bool nextDxfGroup(const char * data, size_t end, size_t & i, int & code, size_t & value, size_t & valueEnd) {
+	if (i >= end) return false;
+	const char * newline = static_cast<const char *>(memchr(data + i, '\n', end - i));
+	if (newline == 0x0) return false;
+	size_t j = i;
+	while (j < end && (data[j] == ' ' || data[j] == '\t')) ++j;
+	double number;
+	if (!parseImportNumber(data, end, j, number)) return false;
+	code = int(number);
+	i = (newline - data) + 1;
+
+	newline = i < end ? static_cast<const char *>(memchr(data + i, '\n', end - i)) : 0x0;
+	const size_t lineEnd = newline == 0x0 ? end : size_t(newline - data);
+	value = i;
+	valueEnd = lineEnd;
+	while (value < valueEnd && (data[value] == ' ' || data[value] == '\t')) ++value;
+	while (valueEnd > value && (data[valueEnd - 1] == '\r' || data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t')) --valueEnd;
+	i = newline == 0x0 ? end : lineEnd + 1;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if a DXF value is the given text.
+ *
+ *	@param		data		The map.
+ *	@param		value		The position of the value.
+ *	@param		valueEnd	The position following the value.
+ *	@param		text		The text.
+ *	@returns	True if the value is the text.
+ */
+bool isDxfValue(const char * data, size_t value, size_t valueEnd, const char * text) {
+	const size_t length = strlen(text);
+	return valueEnd - value == length && strncmp(data + value, text, length) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses a DXF polyline entity (LWPOLYLINE, or POLYLINE with its VERTEX
+ *				entities).  Open polylines and meshes are skipped.
+ *
+ *	@param		data		The map.
+ *	@param		feature		The entity's groups (following its type).
+ *	@param		block		The polyline's outline is appended to this block.
+ *	@returns	False if the entity is malformed.
+ */
+bool parseDxfEntity(const char * data, const ImportFeature & feature, ImportBlock & block) {
+	const size_t start = block._coords.size() / 2;
+	int flags = 0;
+	// The POLYLINE's own groups precede its first VERTEX (whose position is a dummy).
+	bool inVertex = feature._kind == DXF_LWPOLYLINE;
+	bool hasX = false;
+	double x = 0.0;
+	size_t i = feature._begin;
+	int code;
+	size_t value, valueEnd;
+	while (nextDxfGroup(data, feature._end, i, code, value, valueEnd)) {
+		double number;
+		size_t j = value;
+		if (code == 0) {
+			if (hasX) return false;
+			inVertex = isDxfValue(data, value, valueEnd, "VERTEX");
+		}
+		else if (code == 70 && !(inVertex && feature._kind == DXF_POLYLINE)) {
+			if (!parseImportNumber(data, valueEnd, j, number)) return false;
+			flags = int(number);
+		}
+		else if (code == 10 && inVertex) {
+			if (hasX || !parseImportNumber(data, valueEnd, j, x)) return false;
+			hasX = true;
+		}
+		else if (code == 20 && inVertex) {
+			if (!hasX || !parseImportNumber(data, valueEnd, j, number)) return false;
+			block._coords.push_back(x);
+			block._coords.push_back(number);
+			hasX = false;
+		}
+	}
+	if (hasX) return false;
+
+	// Polyface and polygon meshes (flags 16 and 64) aren't outlines.
+	const std::vector< double > & coords = block._coords;
+	const size_t count = coords.size() / 2 - start;
+	const bool closed = (flags & 1) != 0 || (count > 1 && coords[2 * start] == coords[coords.size() - 2] && coords[2 * start + 1] == coords.back());
+	if ((flags & (16 | 64)) != 0 || !closed) {
+		block._coords.resize(2 * start);
+		++block._skipped;
+		return true;
+	}
+	finishImportRing(block, start, false);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Finds the entities of the ENTITIES section of an ASCII DXF file.  Polylines
+ *				are reported as features; other entities are counted.
+ *
+ *	@param		data		The map.
+ *	@param		size		The size of the map.
+ *	@param		features	The polylines are appended here.
+ *	@param		others		The number of other entities is added here.
+ *	@throws		MCException if the file is a binary DXF file.
+ */
+void findDxfEntities(const char * data, size_t size, std::vector< ImportFeature > & features, size_t & others) {
+	const char BINARY_SENTINEL[] = "AutoCAD Binary DXF";
+	if (size >= sizeof(BINARY_SENTINEL) - 1 && memcmp(data, BINARY_SENTINEL, sizeof(BINARY_SENTINEL) - 1) == 0) {
+		throw MCException("Binary DXF files are not supported; save the drawing as ASCII DXF");
+	}
+	bool sectionStart = false;
+	bool inEntities = false;
+	// The current polyline (its kind is negative if the current entity isn't one).
+	ImportFeature feature = { 0, 0, -1 };
+	size_t i = 0;
+	int code;
+	size_t value, valueEnd;
+	while (true) {
+		const size_t group = i;
+		if (!nextDxfGroup(data, size, i, code, value, valueEnd)) break;
+		if (code == 2 && sectionStart) {
+			inEntities = isDxfValue(data, value, valueEnd, "ENTITIES");
+			sectionStart = false;
+			continue;
+		}
+		if (code != 0) continue;
+		// A POLYLINE's vertices belong to it, up to its SEQEND.
+		if (feature._kind == DXF_POLYLINE && isDxfValue(data, value, valueEnd, "VERTEX")) continue;
+		if (feature._kind >= 0) {
+			feature._end = group;
+			features.push_back(feature);
+			feature._kind = -1;
+			if (isDxfValue(data, value, valueEnd, "SEQEND")) continue;
+		}
+		if (isDxfValue(data, value, valueEnd, "SECTION")) {
+			sectionStart = true;
+		}
+		else if (isDxfValue(data, value, valueEnd, "ENDSEC")) {
+			inEntities = false;
+		}
+		else if (isDxfValue(data, value, valueEnd, "EOF")) {
+			break;
+		}
+		else if (inEntities) {
+			if (isDxfValue(data, value, valueEnd, "LWPOLYLINE")) {
+				feature._kind = DXF_LWPOLYLINE;
+				feature._begin = i;
+			}
+			else if (isDxfValue(data, value, valueEnd, "POLYLINE")) {
+				feature._kind = DXF_POLYLINE;
+				feature._begin = i;
+			}
+			else {
+				++others;
+			}
+		}
+	}
+	if (feature._kind >= 0) {
+		feature._end = i;
+		features.push_back(feature);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//			ESRI Shapefile
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads a big-endian 32-bit integer.
+ *
+ *	@param		p		The integer's first byte.
+ *	@returns	The integer.
+ */
+qint32 readShapeBigInt(const uchar * p) {
+	return qint32((quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads a little-endian 32-bit integer.
+ *
+ *	@param		p		The integer's first byte.
+ *	@returns	The integer.
+ */
+qint32 readShapeInt(const uchar * p) {
+	return qint32((quint32(p[3]) << 24) | (quint32(p[2]) << 16) | (quint32(p[1]) << 8) | quint32(p[0]));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads a little-endian double.
+ *
+ *	@param		p		The double's first byte.
+ *	@returns	The double.
+ */
+double readShapeDouble(const uchar * p) {
+	quint64 bits = 0;
+	for (int b = 7; b >= 0; --b) bits = (bits << 8) | p[b];
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Parses a Shapefile record.  Shapes other than polygons are skipped.
+ *
+ *	@param		data		The map.
+ *	@param		feature		The record's contents (following its header).
+ *	@param		block		The polygon's outlines are appended to this block.
+ *	@returns	False if the record is malformed.
+ */
+bool parseShapeRecord(const char * data, const ImportFeature & feature, ImportBlock & block) {
+	const uchar * record = reinterpret_cast<const uchar *>(data + feature._begin);
+	const size_t size = feature._end - feature._begin;
+	if (size < 4) return false;
+	const qint32 type = readShapeInt(record);
+	if (type != SHAPE_POLYGON && type != SHAPE_POLYGON_Z && type != SHAPE_POLYGON_M) {
+		++block._skipped;
+		return true;
+	}
+	// The type, the bounding box and the counts precede the parts and the points.
+	if (size < 44) return false;
+	const qint32 partCount = readShapeInt(record + 36);
+	const qint32 pointCount = readShapeInt(record + 40);
+	if (partCount < 0 || pointCount < 0 || 44 + 4 * quint64(partCount) + 16 * quint64(pointCount) > size) return false;
+	const uchar * parts = record + 44;
+	const uchar * points = parts + 4 * partCount;
+
+	std::vector< double > ring;
+	// Writers which ignore the format's convention produce no clockwise ring; their rings
+	//	are all outlines.
+	bool hasClockwise = false;
+	for (qint32 p = 0; p < partCount && !hasClockwise; ++p) {
+		const qint32 first = readShapeInt(parts + 4 * p);
+		const qint32 last = p + 1 < partCount ? readShapeInt(parts + 4 * (p + 1)) : pointCount;
+		if (first < 0 || first > last || last > pointCount) return false;
+		ring.clear();
+		for (qint32 k = first; k < last; ++k) {
+			ring.push_back(readShapeDouble(points + 16 * k));
+			ring.push_back(readShapeDouble(points + 16 * k + 8));
+		}
+		hasClockwise = ring.size() >= 6 && importRingArea(&ring[0], ring.size() / 2) < 0.0;
+	}
+	for (qint32 p = 0; p < partCount; ++p) {
+		const qint32 first = readShapeInt(parts + 4 * p);
+		const qint32 last = p + 1 < partCount ? readShapeInt(parts + 4 * (p + 1)) : pointCount;
+		if (first < 0 || first > last || last > pointCount) return false;
+		const size_t start = block._coords.size() / 2;
+		for (qint32 k = first; k < last; ++k) {
+			block._coords.push_back(readShapeDouble(points + 16 * k));
+			block._coords.push_back(readShapeDouble(points + 16 * k + 8));
+		}
+		finishImportRing(block, start, hasClockwise);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Finds the records of a Shapefile.
+ *
+ *	@param		data		The map.
+ *	@param		size		The size of the map.
+ *	@param		features	The records' contents are appended here.
+ *	@throws		MCException if the file isn't a Shapefile.
+ */
+void findShapeRecords(const char * data, size_t size, std::vector< ImportFeature > & features) {
+	const uchar * bytes = reinterpret_cast<const uchar *>(data);
+	if (size < SHAPE_HEADER_SIZE || readShapeBigInt(bytes) != SHAPE_FILE_CODE) {
+		throw MCException("The map is not a Shapefile");
+	}
+	// The file's length is in 16-bit words; a truncated file is read as far as it goes.
+	const size_t length = std::min(size, size_t(quint32(readShapeBigInt(bytes + 24))) * 2);
+	size_t i = SHAPE_HEADER_SIZE;
+	while (i + SHAPE_RECORD_HEADER_SIZE <= length) {
+		const size_t contentSize = size_t(quint32(readShapeBigInt(bytes + i + 4))) * 2;
+		ImportFeature feature = { i + SHAPE_RECORD_HEADER_SIZE, i + SHAPE_RECORD_HEADER_SIZE + contentSize, 0 };
+		if (feature._end > length) {
+			throw MCException("The Shapefile is damaged");
+		}
+		features.push_back(feature);
+		i = feature._end;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of MapImporter
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t MapImporter::BLOCK_FEATURES = 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+
+MapImporter::MapImporter() : _coords(), _outlineEnds(), _featureCount(0), _skipped(0), _malformed(0), _bytes(0), _utmZone(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MapImporter::Format MapImporter::getFormat(const QString & path) {
+	const QString suffix = QFileInfo(path).suffix().toLower();
+	if (suffix == "geojson" || suffix == "json") return GEOJSON_FORMAT;
+	if (suffix == "dxf") return DXF_FORMAT;
+	if (suffix == "shp") return SHAPEFILE_FORMAT;
+	return UNKNOWN_FORMAT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MapImporter::read(const QString & path) {
+	_coords.clear();
+	_outlineEnds.clear();
+	_featureCount = _skipped = _malformed = 0;
+	_bytes = 0;
+	_utmZone = 0;
+
+	const Format format = getFormat(path);
+	if (format == UNKNOWN_FORMAT) {
+		throw MCException("Unknown map format: " + path.toStdString());
+	}
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw MCException("Unable to open the map " + path.toStdString() + ": " + file.errorString().toStdString());
+	}
+	_bytes = file.size();
+	if (_bytes == 0) return;
+	const uchar * mapped = file.map(0, _bytes);
+	if (mapped == 0x0) {
+		throw MCException("Unable to map the map " + path.toStdString());
+	}
+	const char * data = reinterpret_cast<const char *>(mapped);
+	const size_t size = size_t(_bytes);
+
+	// The features are found in one pass and parsed in parallel.
+	std::vector< ImportFeature > features;
+	std::vector< ImportBlock > blocks;
+	std::string crs;
+	try {
+		FeatureParser parser = 0x0;
+		switch (format) {
+			case GEOJSON_FORMAT:
+				findGeoJsonFeatures(data, size, features, crs);
+				parser = &parseGeoJsonFeature;
+				break;
+			case DXF_FORMAT:
+				findDxfEntities(data, size, features, _skipped);
+				_featureCount = _skipped;
+				parser = &parseDxfEntity;
+				break;
+			default:
+				findShapeRecords(data, size, features);
+				parser = &parseShapeRecord;
+				break;
+		}
+		_featureCount += features.size();
+		parseImportFeatures(data, features, parser, blocks);
+	}
+	catch (MCException &) {
+		file.unmap(const_cast<uchar *>(mapped));
+		throw;
+	}
+	file.unmap(const_cast<uchar *>(mapped));
+
+	size_t coordCount = 0;
+	size_t outlineCount = 0;
+	for (const ImportBlock & block : blocks) {
+		coordCount += block._coords.size();
+		outlineCount += block._outlineEnds.size();
+	}
+	_coords.reserve(coordCount);
+	_outlineEnds.reserve(outlineCount);
+	for (ImportBlock & block : blocks) {
+		const size_t offset = _coords.size() / 2;
+		_coords.insert(_coords.end(), block._coords.begin(), block._coords.end());
+		for (size_t outlineEnd : block._outlineEnds) {
+			_outlineEnds.push_back(offset + outlineEnd);
+		}
+		_skipped += block._skipped;
+		_malformed += block._malformed;
+		std::vector< double >().swap(block._coords);
+	}
+
+	// Scene units are meters; longitudes and latitudes are projected onto the UTM zone
+	//	of the map's center.
+	double minX, minY, maxX, maxY;
+	if (format != GEOJSON_FORMAT || !isGeographicCrs(crs) || !getBounds(minX, minY, maxX, maxY)) return;
+	if (minX < -180.0 || maxX > 180.0 || minY < -90.0 || maxY > 90.0) {
+		// Maps which predate RFC 7946 often omit the crs of their projected coordinates.
+		if (crs.empty()) return;
+		_coords.clear();
+		_outlineEnds.clear();
+		throw MCException("The map's coordinate system is geographic (" + crs + ") but its coordinates aren't longitudes and latitudes");
+	}
+	_utmZone = findUtmZone(0.5 * (minX + maxX), 0.5 * (minY + maxY));
+	projectToUtm(_coords, _utmZone);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool MapImporter::getBounds(double & minX, double & minY, double & maxX, double & maxY) const {
+	if (_coords.empty()) return false;
+	minX = maxX = _coords[0];
+	minY = maxY = _coords[1];
+	for (size_t i = 2; i < _coords.size(); i += 2) {
+		if (_coords[i] < minX) minX = _coords[i];
+		else if (_coords[i] > maxX) maxX = _coords[i];
+		if (_coords[i + 1] < minY) minY = _coords[i + 1];
+		else if (_coords[i + 1] > maxY) maxY = _coords[i + 1];
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t MapImporter::insert(LiveObstacleSet & obstacles, const WorldFrame & frame) const {
+	// The arena isn't thread-safe; the polygons are allocated here and filled in parallel.
+	const size_t COUNT = _outlineEnds.size();
+	std::vector< GLPolygon * > polys(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		GLPolygon * poly = obstacles.createPolygon();
+		poly->_vertices.resize(_outlineEnds[i] - (i == 0 ? 0 : _outlineEnds[i - 1]));
+		poly->_winding = GLPolygon::CCW;
+		polys[i] = poly;
+	}
+	ThreadPool::instance()->parallelFor(COUNT, 256, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			GLPolygon::VertexList & vertices = polys[i]->_vertices;
+			const double * coords = &_coords[2 * (i == 0 ? 0 : _outlineEnds[i - 1])];
+			for (size_t v = 0; v < vertices.size(); ++v) {
+				const Vector2 p = frame.toLocal(coords[2 * v], coords[2 * v + 1]);
+				vertices[v].set(p._x, p._y, 0.f);
+			}
+		}
+	});
+	obstacles.addPolygons(polys);
+	return COUNT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
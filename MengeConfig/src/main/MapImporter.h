@@ -0,0 +1,174 @@
+/*!
+ *	@file		MapImporter.h
+ *	@brief		The definition of a reader of vector maps (GeoJSON, DXF and ESRI Shapefile)
+ *				which converts their outlines to obstacles.
+ */
+
+#ifndef __MAP_IMPORTER_H__
+#define	__MAP_IMPORTER_H__
+
+#include <QtCore/qstring.h>
+
+#include <vector>
+
+// forward declarations
+class LiveObstacleSet;
+class WorldFrame;
+
+/*!
+ *	@brief		Reads the closed outlines (e.g., building footprints) of a vector map and adds
+ *				them to an obstacle set.
+ *
+ *	The map is memory-mapped and scanned once to find the boundaries of its features;
+ *	the features are then parsed in parallel, in blocks of BLOCK_FEATURES (see
+ *	ThreadPool).  Every outline is stored in world coordinates, in double precision and
+ *	counter-clockwise, so it can be inserted wherever the scene's origin lies (see
+ *	insert()).
+ *
+ *	Supported features are:
+ *		- GeoJSON: Polygon and MultiPolygon geometries (in features, feature collections
+ *			or geometry collections).  The outer ring of every polygon is read; holes are
+ *			skipped.  Longitudes and latitudes (WGS 84, the default, or a named
+ *			geographic "crs") are projected onto the UTM zone of the map's center, so the
+ *			outlines are in meters (see getUtmZone()).  A map naming any other crs, or
+ *			without one but with coordinates out of the geographic range, is read as is.
+ *		- DXF (ASCII): closed LWPOLYLINE and POLYLINE entities of the ENTITIES section.
+ *			Bulges are ignored and block references are not expanded.
+ *		- ESRI Shapefile (the .shp file): Polygon, PolygonZ and PolygonM shapes.  Clockwise
+ *			rings are outlines and counter-clockwise rings are holes, as the format
+ *			specifies.
+ *
+ *	Everything else (points, open lines, text, ...) is counted as skipped.  A feature
+ *	which can't be parsed is counted as malformed and doesn't prevent reading the others.
+ *	Errors which prevent reading the map at all are reported by throwing an MCException.
+ */
+class MapImporter {
+public:
+	/*!
+	 *	@brief		The map formats.
+	 */
+	enum Format {
+		UNKNOWN_FORMAT,		/// The format isn't supported.
+		GEOJSON_FORMAT,		/// GeoJSON (.geojson or .json).
+		DXF_FORMAT,			/// ASCII DXF (.dxf).
+		SHAPEFILE_FORMAT	/// ESRI Shapefile (.shp).
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 */
+	MapImporter();
+
+	/*!
+	 *	@brief		Determines the format of a map from its file name.
+	 *
+	 *	@param		path		The path to the map.
+	 *	@returns	The format.
+	 */
+	static Format getFormat(const QString & path);
+
+	/*!
+	 *	@brief		Reads a map, replacing the outlines read before.
+	 *
+	 *	@param		path		The path to the map.
+	 *	@throws		MCException if the file can't be read or isn't in a supported format.
+	 */
+	void read(const QString & path);
+
+	/*!
+	 *	@brief		Reports the number of features in the map.
+	 */
+	size_t getFeatureCount() const { return _featureCount; }
+
+	/*!
+	 *	@brief		Reports the number of outlines read.
+	 */
+	size_t getOutlineCount() const { return _outlineEnds.size(); }
+
+	/*!
+	 *	@brief		Reports the number of features and parts (e.g., holes) which aren't
+	 *				outlines.
+	 */
+	size_t getSkippedCount() const { return _skipped; }
+
+	/*!
+	 *	@brief		Reports the number of features which couldn't be parsed.
+	 */
+	size_t getMalformedCount() const { return _malformed; }
+
+	/*!
+	 *	@brief		Reports the size of the map (in bytes).
+	 */
+	qint64 getByteCount() const { return _bytes; }
+
+	/*!
+	 *	@brief		Reports the UTM zone the map's longitudes and latitudes were projected
+	 *				onto: 1 - 60 north of the equator, -1 - -60 south of it and 0 if the map
+	 *				wasn't geographic.
+	 */
+	int getUtmZone() const { return _utmZone; }
+
+	/*!
+	 *	@brief		Computes the bounding box of the outlines in world coordinates.
+	 *
+	 *	@param		minX		The minimum x-value.
+	 *	@param		minY		The minimum y-value.
+	 *	@param		maxX		The maximum x-value.
+	 *	@param		maxY		The maximum y-value.
+	 *	@returns	False if there are no outlines.
+	 */
+	bool getBounds(double & minX, double & minY, double & maxX, double & maxY) const;
+
+	/*!
+	 *	@brief		Adds the outlines to an obstacle set as counter-clockwise polygons (see
+	 *				LiveObstacleSet::addPolygons()).
+	 *
+	 *	@param		obstacles		The set to add the polygons to.
+	 *	@param		frame			The frame of the set's coordinates.
+	 *	@returns	The number of polygons added.
+	 */
+	size_t insert(LiveObstacleSet & obstacles, const WorldFrame & frame) const;
+
+	/*!
+	 *	@brief		The number of features parsed by a single task.
+	 */
+	static const size_t BLOCK_FEATURES;
+
+protected:
+	/*!
+	 *	@brief		The outlines' vertices: x- and y-values in world coordinates.
+	 */
+	std::vector< double >	_coords;
+
+	/*!
+	 *	@brief		For each outline, the index of the vertex following its last vertex.
+	 */
+	std::vector< size_t >	_outlineEnds;
+
+	/*!
+	 *	@brief		The number of features in the map.
+	 */
+	size_t	_featureCount;
+
+	/*!
+	 *	@brief		The number of features and parts which aren't outlines.
+	 */
+	size_t	_skipped;
+
+	/*!
+	 *	@brief		The number of features which couldn't be parsed.
+	 */
+	size_t	_malformed;
+
+	/*!
+	 *	@brief		The size of the map (in bytes).
+	 */
+	qint64	_bytes;
+
+	/*!
+	 *	@brief		The UTM zone of the map (see getUtmZone()).
+	 */
+	int	_utmZone;
+};
+
+#endif	// __MAP_IMPORTER_H__
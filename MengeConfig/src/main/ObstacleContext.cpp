@@ -75,9 +75,13 @@ ObstacleContext::ObstacleContext() : _obstacleSet(0x0), _operationContexts(0x0),
 
 	// TODO: Determine if I *really* need to know the type of widget here.
 	_widget = new ObstacleContextWidget(this, (EditPolygonWidget*)editContext->getContextWidget(), (DrawPolygonWidget*)drawContext->getContextWidget());
+	setContextWidget(_widget);
 
 	// set state
 	_state = NEW_OBSTACLE;
+
+	// The operations don't use the mouse wheel; it is left to the view.
+	setDispatch(0, inputBit(MOUSE_INPUT) | inputBit(KEY_INPUT), TOOL_LAYER);
 }
 
 
@@ -85,9 +89,10 @@ ObstacleContext::ObstacleContext() : _obstacleSet(0x0), _operationContexts(0x0),
 
 ObstacleContext::~ObstacleContext() {
 	for (size_t i = 0; i < _operationContexts.size(); ++i) {
+		// The operations' widgets are embedded in this context's widget; they are destroyed
+		//	(and removed from it) with their contexts.
 		delete _operationContexts[i];
 	}
-	delete _widget;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -142,12 +147,6 @@ Menge::SceneGraph::ContextResult ObstacleContext::handleKeyboard(QKeyEvent * evt
 
 ///////////////////////////////////////////////////////////////////////////////
 
-QWidget * ObstacleContext::getContextWidget() {
-	return _widget;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-
 bool ObstacleContext::setPolygonDraw() {
 	if (_state != NEW_OBSTACLE) {
 		((ObstacleContextWidget*)_widget)->_tabWidget->setCurrentIndex(0);
@@ -220,6 +219,49 @@ void ObstacleContext::setObstacleSet(Menge::Agents::ObstacleSet * obstacleSet) {
 	// TODO: If the input obstacle set is *not* explicit, warn that it will be converted.
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleContext::getSettings(ProjectSettings & settings) const {
+	settings._obstacleVerb = _state;
+	settings._editMode = static_cast<EditPolygonContext *>(_operationContexts[EDIT_OBSTACLE])->getState();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleContext::setSettings(const ProjectSettings & settings) {
+	if (settings._obstacleVerb == EDIT_OBSTACLE) {
+		setPolygonEdit();
+	}
+	else {
+		setPolygonDraw();
+	}
+	EditPolygonContext::EditMode mode = EditPolygonContext::EditMode(settings._editMode);
+	if (mode != EditPolygonContext::VERTEX && mode != EditPolygonContext::EDGE && mode != EditPolygonContext::POLY) {
+		mode = EditPolygonContext::VERTEX;
+	}
+	static_cast<EditPolygonContext *>(_operationContexts[EDIT_OBSTACLE])->setState(mode);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleContext::restoreObstacles(const PolygonRecordMap & polygons) {
+	static_cast<DrawPolygonContext *>(_operationContexts[NEW_OBSTACLE])->deleteActive();
+	static_cast<EditPolygonContext *>(_operationContexts[EDIT_OBSTACLE])->reset();
+	_obstacleSet->restore(polygons);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleContext::releaseEdited(const GeometryEdits & edits) {
+	static_cast<EditPolygonContext *>(_operationContexts[EDIT_OBSTACLE])->releaseEdited(edits);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ObstacleContext::isDrawing() const {
+	return static_cast<const DrawPolygonContext *>(_operationContexts[NEW_OBSTACLE])->isDrawing();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void ObstacleContext::draw3DGL(bool select) {
@@ -228,6 +270,10 @@ void ObstacleContext::draw3DGL(bool select) {
 		// draw the live obstacle set.
 		_obstacleSet->drawGL();
 	}
+	else if (_state != NONE) {
+		// The operation determines what elements of the obstacle set can be selected.
+		_operationContexts[_state]->drawSelectGL();
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,6 +7,7 @@
 #ifndef __DRAW_OBSTACLE_CONTEXT_H__
 #define __DRAW_OBSTACLE_CONTEXT_H__
 
+#include "ProjectState.h"
 #include "QtContext.h"
 #include "QtCore/qobject"
 
@@ -16,6 +17,7 @@ namespace Menge {
 		class ObstacleSet;
 	}
 }
+struct GeometryEdits;
 class LiveObstacleSet;
 class PolygonCreatedCB;
 class ObstacleContextWidget;
@@ -90,16 +92,6 @@ public:
 	 */
 	virtual Menge::SceneGraph::ContextResult handleKeyboard(QKeyEvent * evt, GLWidget * view);
 
-	/*!
-	*	@brief		Returns the control widget associated with this context.
-	*
-	*				The main application can choose to populate a tool window with this widget.  It contains
-	*				buttons and settings to interact with or change state in the context.
-	*
-	*	@returns	A pointer to the tool widget for this context.
-	*/
-	virtual QWidget * getContextWidget();
-
 	///////////////////////////////////////////////////////////////////////////////////
 
 	/*!
@@ -143,6 +135,48 @@ public:
 	 */
 	void setObstacleSet(Menge::Agents::ObstacleSet * obstacleSet);
 
+	/*!
+	 *	@brief		Returns the live obstacle set the context is working with.
+	 */
+	LiveObstacleSet * getLiveObstacleSet() { return _obstacleSet; }
+
+	/*!
+	 *	@brief		Writes the context's operation and editing mode into the project settings.
+	 *
+	 *	@param		settings		The settings to write to.
+	 */
+	void getSettings(ProjectSettings & settings) const;
+
+	/*!
+	 *	@brief		Restores the context's operation and editing mode from the project
+	 *				settings.
+	 *
+	 *	@param		settings		The settings to read from.
+	 */
+	void setSettings(const ProjectSettings & settings);
+
+	/*!
+	 *	@brief		Replaces the contents of the live obstacle set, abandoning any drawing
+	 *				or editing in progress.
+	 *
+	 *	@param		polygons		The polygons to populate the live obstacle set with.
+	 */
+	void restoreObstacles(const PolygonRecordMap & polygons);
+
+	/*!
+	 *	@brief		Abandons the editing in progress if it references polygons the given
+	 *				edits replace or remove (see EditPolygonContext::releaseEdited()).
+	 *
+	 *	@param		edits		The edits about to be merged into the live obstacle set.
+	 */
+	void releaseEdited(const GeometryEdits & edits);
+
+	/*!
+	 *	@brief		Reports if a new obstacle is being drawn (and isn't yet in the live
+	 *				obstacle set).
+	 */
+	bool isDrawing() const;
+
 signals:
 	
 	/*!
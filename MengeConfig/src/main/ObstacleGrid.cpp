@@ -0,0 +1,344 @@
+#include "ObstacleGrid.h"
+#include "GeometrySnap.h"
+#include "GLPolygon.h"
+#include "LiveObstacleSet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ObstacleGrid
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t ObstacleGrid::CELLS_PER_POLYGON = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t ObstacleGrid::MAX_SNAP_CELLS = 256;
+
+///////////////////////////////////////////////////////////////////////////////
+
+ObstacleGrid::ObstacleGrid() : _edgeX(), _edgeY0(), _edgeY1(), _edgeSlope(), _polygons(), _cellIds(), _patched(), _patchCount(0), _solidCount(0), _origin(0.f, 0.f), _limit(0.f, 0.f), _invCellSize(1.f), _columns(0), _rows(0), _cellStart(), _cellPolygons() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleGrid::build(const LiveObstacleSet & obstacles) {
+	_edgeX.clear();
+	_edgeY0.clear();
+	_edgeY1.clear();
+	_edgeSlope.clear();
+	_polygons.clear();
+	_cellIds.clear();
+	_patched.clear();
+	_patchCount = 0;
+	_solidCount = 0;
+	_cellStart.clear();
+	_cellPolygons.clear();
+	_columns = _rows = 0;
+
+	const size_t P_COUNT = obstacles.getPolygonCount();
+	for (size_t p = 0; p < P_COUNT; ++p) {
+		const GLPolygon * poly = obstacles.getPolygon(p);
+		const size_t V_COUNT = poly->getVertexCount();
+		if (V_COUNT < 2) continue;
+		Polygon record;
+		record._id = poly->getId();
+		appendEdges(poly, record);
+		if (record._solid) ++_solidCount;
+		if (_polygons.empty()) {
+			_origin.set(record._minX, record._minY);
+			_limit.set(record._maxX, record._maxY);
+		}
+		else {
+			if (record._minX < _origin._x) _origin._x = record._minX;
+			if (record._minY < _origin._y) _origin._y = record._minY;
+			if (record._maxX > _limit._x) _limit._x = record._maxX;
+			if (record._maxY > _limit._y) _limit._y = record._maxY;
+		}
+		_cellIds.push_back(std::make_pair(record._id, (unsigned int)_polygons.size()));
+		_polygons.push_back(record);
+	}
+	if (_polygons.empty()) return;
+	std::sort(_cellIds.begin(), _cellIds.end());
+
+	// Square cells, sized so there are about CELLS_PER_POLYGON cells per polygon.
+	const float width = _limit._x - _origin._x;
+	const float height = _limit._y - _origin._y;
+	const float MIN_EXTENT = 1e-3f;
+	const float area = (width > MIN_EXTENT ? width : MIN_EXTENT) * (height > MIN_EXTENT ? height : MIN_EXTENT);
+	const float cellSize = std::sqrt(area / (float)(_polygons.size() * CELLS_PER_POLYGON));
+	_invCellSize = 1.f / cellSize;
+	_columns = (size_t)(width * _invCellSize) + 1;
+	_rows = (size_t)(height * _invCellSize) + 1;
+
+	// Count the polygons of each cell, then place them.
+	_cellStart.assign(_columns * _rows + 1, 0);
+	for (size_t p = 0; p < _polygons.size(); ++p) {
+		const Polygon & poly = _polygons[p];
+		const size_t c0 = getColumn(poly._minX), c1 = getColumn(poly._maxX);
+		const size_t r0 = getRow(poly._minY), r1 = getRow(poly._maxY);
+		for (size_t r = r0; r <= r1; ++r) {
+			for (size_t c = c0; c <= c1; ++c) {
+				++_cellStart[r * _columns + c + 1];
+			}
+		}
+	}
+	for (size_t i = 1; i < _cellStart.size(); ++i) {
+		_cellStart[i] += _cellStart[i - 1];
+	}
+	_cellPolygons.resize(_cellStart.back());
+	std::vector<size_t> fill(_cellStart.begin(), _cellStart.end() - 1);
+	for (size_t p = 0; p < _polygons.size(); ++p) {
+		const Polygon & poly = _polygons[p];
+		const size_t c0 = getColumn(poly._minX), c1 = getColumn(poly._maxX);
+		const size_t r0 = getRow(poly._minY), r1 = getRow(poly._maxY);
+		for (size_t r = r0; r <= r1; ++r) {
+			for (size_t c = c0; c <= c1; ++c) {
+				_cellPolygons[fill[r * _columns + c]++] = (unsigned int)p;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleGrid::update(const LiveObstacleSet & obstacles, const std::unordered_set<size_t> & ids) {
+	for (size_t id : ids) {
+		++_patchCount;
+		// The polygon's current record: in the cells or in the patch list.
+		Polygon * record = 0x0;
+		bool inCells = false;
+		std::vector< std::pair<size_t, unsigned int> >::const_iterator itr = std::lower_bound(_cellIds.begin(), _cellIds.end(), std::make_pair(id, 0u));
+		if (itr != _cellIds.end() && itr->first == id && _polygons[itr->second]._count > 0) {
+			record = &_polygons[itr->second];
+			inCells = true;
+		}
+		for (size_t i = 0; record == 0x0 && i < _patched.size(); ++i) {
+			Polygon & patched = _polygons[_patched[i]];
+			if (patched._id == id && patched._count > 0) record = &patched;
+		}
+
+		const GLPolygon * poly = obstacles.findPolygon(id);
+		const bool indexed = poly != 0x0 && poly->getVertexCount() >= 2;
+		if (record != 0x0) {
+			if (record->_solid) --_solidCount;
+			Polygon current = *record;
+			if (indexed) appendEdges(poly, current);
+			// A polygon in the cells stays there if it hasn't left its cells (or the grid).
+			const bool fits = !inCells || (indexed &&
+				current._minX >= _origin._x && current._maxX <= _limit._x && current._minY >= _origin._y && current._maxY <= _limit._y &&
+				getColumn(current._minX) == getColumn(record->_minX) && getColumn(current._maxX) == getColumn(record->_maxX) &&
+				getRow(current._minY) == getRow(record->_minY) && getRow(current._maxY) == getRow(record->_maxY));
+			if (indexed && fits) {
+				*record = current;
+				if (record->_solid) ++_solidCount;
+				continue;
+			}
+			// The record is left empty; queries skip it.
+			record->_solid = false;
+			record->_count = 0;
+			if (!indexed) continue;
+			_patched.push_back((unsigned int)_polygons.size());
+			_polygons.push_back(current);
+			if (current._solid) ++_solidCount;
+		}
+		else if (indexed) {
+			Polygon added;
+			added._id = id;
+			appendEdges(poly, added);
+			if (added._solid) ++_solidCount;
+			_patched.push_back((unsigned int)_polygons.size());
+			_polygons.push_back(added);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ObstacleGrid::contains(const Vector2 & p) const {
+	if (_solidCount == 0) return false;
+	for (unsigned int index : _patched) {
+		const Polygon & poly = _polygons[index];
+		if (!poly._solid) continue;
+		if (p._x < poly._minX || p._x > poly._maxX || p._y < poly._minY || p._y > poly._maxY) continue;
+		if (insideEdges(poly, p._x, p._y)) return true;
+	}
+	if (_columns == 0) return false;
+	if (p._x < _origin._x || p._x > _limit._x || p._y < _origin._y || p._y > _limit._y) return false;
+	const size_t cell = getRow(p._y) * _columns + getColumn(p._x);
+	const size_t END = _cellStart[cell + 1];
+	for (size_t i = _cellStart[cell]; i < END; ++i) {
+		const Polygon & poly = _polygons[_cellPolygons[i]];
+		if (!poly._solid) continue;
+		if (p._x < poly._minX || p._x > poly._maxX || p._y < poly._minY || p._y > poly._maxY) continue;
+		if (insideEdges(poly, p._x, p._y)) return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ObstacleGrid::insidePolygon(const float * xs, const float * ys, size_t count, float x, float y) {
+	bool inside = false;
+	for (size_t i = 0, j = count - 1; i < count; j = i++) {
+		if ((ys[i] > y) != (ys[j] > y)) {
+			const float cross = xs[i] + (y - ys[i]) * (xs[j] - xs[i]) / (ys[j] - ys[i]);
+			if (x < cross) inside = !inside;
+		}
+	}
+	return inside;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ObstacleGrid::insideEdges(const Polygon & poly, float x, float y) const {
+	const float * edgeX = &_edgeX[poly._begin];
+	const float * edgeY0 = &_edgeY0[poly._begin];
+	const float * edgeY1 = &_edgeY1[poly._begin];
+	const float * edgeSlope = &_edgeSlope[poly._begin];
+	unsigned int odd = 0;
+	size_t i = 0;
+#ifdef MC_USE_SSE2
+	// Each lane accumulates the parity of the crossings of every fourth edge.
+	const __m128 px = _mm_set1_ps(x);
+	const __m128 py = _mm_set1_ps(y);
+	__m128 lanes = _mm_setzero_ps();
+	for (; i + 4 <= poly._count; i += 4) {
+		const __m128 y0 = _mm_loadu_ps(edgeY0 + i);
+		const __m128 straddles = _mm_xor_ps(_mm_cmpgt_ps(y0, py), _mm_cmpgt_ps(_mm_loadu_ps(edgeY1 + i), py));
+		const __m128 cross = _mm_add_ps(_mm_loadu_ps(edgeX + i), _mm_mul_ps(_mm_sub_ps(py, y0), _mm_loadu_ps(edgeSlope + i)));
+		lanes = _mm_xor_ps(lanes, _mm_and_ps(straddles, _mm_cmplt_ps(px, cross)));
+	}
+	const int bits = _mm_movemask_ps(lanes);
+	odd = (bits ^ (bits >> 1) ^ (bits >> 2) ^ (bits >> 3)) & 1;
+#endif
+	for (; i < poly._count; ++i) {
+		if ((edgeY0[i] > y) != (edgeY1[i] > y) && x < edgeX[i] + (y - edgeY0[i]) * edgeSlope[i]) {
+			odd ^= 1;
+		}
+	}
+	return odd != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleGrid::collectSegments(GeometrySnap & query, const std::unordered_set<size_t> & skipIds, size_t skipId) const {
+	for (unsigned int index : _patched) {
+		const Polygon & poly = _polygons[index];
+		if (poly._count == 0 || !query.reaches(poly._minX, poly._minY, poly._maxX, poly._maxY)) continue;
+		if (poly._id == skipId || (!skipIds.empty() && skipIds.count(poly._id) > 0)) continue;
+		addSegments(query, poly);
+	}
+	if (_columns == 0 || !query.reaches(_origin._x, _origin._y, _limit._x, _limit._y)) return;
+	const Vector2 & p = query.getPoint();
+	const float reach = query.getMaxDist();
+	const size_t c0 = getColumn(p._x - reach), c1 = getColumn(p._x + reach);
+	const size_t r0 = getRow(p._y - reach), r1 = getRow(p._y + reach);
+	if ((c1 - c0 + 1) * (r1 - r0 + 1) > MAX_SNAP_CELLS) return;
+	for (size_t r = r0; r <= r1; ++r) {
+		for (size_t c = c0; c <= c1; ++c) {
+			const size_t cell = r * _columns + c;
+			const size_t END = _cellStart[cell + 1];
+			for (size_t i = _cellStart[cell]; i < END; ++i) {
+				const Polygon & poly = _polygons[_cellPolygons[i]];
+				// A polygon spanning several of the examined cells is only visited in the
+				//	first of them.
+				const size_t pc = getColumn(poly._minX);
+				const size_t pr = getRow(poly._minY);
+				if ((pc > c0 ? pc : c0) != c || (pr > r0 ? pr : r0) != r) continue;
+				if (poly._count == 0 || !query.reaches(poly._minX, poly._minY, poly._maxX, poly._maxY)) continue;
+				if (poly._id == skipId || (!skipIds.empty() && skipIds.count(poly._id) > 0)) continue;
+				addSegments(query, poly);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleGrid::collectPolygons(float minX, float minY, float maxX, float maxY, std::vector<size_t> & ids) const {
+	for (unsigned int index : _patched) {
+		const Polygon & poly = _polygons[index];
+		if (poly._count == 0 || poly._maxX < minX || poly._minX > maxX || poly._maxY < minY || poly._minY > maxY) continue;
+		ids.push_back(poly._id);
+	}
+	if (_columns == 0 || _limit._x < minX || _origin._x > maxX || _limit._y < minY || _origin._y > maxY) return;
+	const size_t c0 = getColumn(minX), c1 = getColumn(maxX);
+	const size_t r0 = getRow(minY), r1 = getRow(maxY);
+	for (size_t r = r0; r <= r1; ++r) {
+		for (size_t c = c0; c <= c1; ++c) {
+			const size_t cell = r * _columns + c;
+			const size_t END = _cellStart[cell + 1];
+			for (size_t i = _cellStart[cell]; i < END; ++i) {
+				const Polygon & poly = _polygons[_cellPolygons[i]];
+				// As in collectSegments(), a polygon is only visited in the first examined cell
+				//	it occupies.
+				const size_t pc = getColumn(poly._minX);
+				const size_t pr = getRow(poly._minY);
+				if ((pc > c0 ? pc : c0) != c || (pr > r0 ? pr : r0) != r) continue;
+				if (poly._count == 0 || poly._maxX < minX || poly._minX > maxX || poly._maxY < minY || poly._minY > maxY) continue;
+				ids.push_back(poly._id);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleGrid::addSegments(GeometrySnap & query, const Polygon & poly) const {
+	const size_t LAST = poly._begin + poly._count - 1;
+	for (size_t e = poly._begin; e <= LAST; ++e) {
+		const size_t next = e < LAST ? e + 1 : poly._begin;
+		query.addSegment(_edgeX[e], _edgeY0[e], _edgeX[next], _edgeY1[e]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleGrid::appendEdges(const GLPolygon * poly, Polygon & record) {
+	const size_t V_COUNT = poly->getVertexCount();
+	record._solid = poly->getWinding() == GLPolygon::CCW && V_COUNT >= 3;
+	record._begin = _edgeX.size();
+	record._count = V_COUNT;
+	const Vector3 & v0 = poly->getVertex(0);
+	record._minX = record._maxX = v0._x;
+	record._minY = record._maxY = v0._y;
+	for (size_t v = 0; v < V_COUNT; ++v) {
+		const Vector3 & vert = poly->getVertex(v);
+		const Vector3 & next = poly->getVertex(v + 1 < V_COUNT ? v + 1 : 0);
+		_edgeX.push_back(vert._x);
+		_edgeY0.push_back(vert._y);
+		_edgeY1.push_back(next._y);
+		_edgeSlope.push_back(next._y != vert._y ? (next._x - vert._x) / (next._y - vert._y) : 0.f);
+		if (vert._x < record._minX) record._minX = vert._x;
+		else if (vert._x > record._maxX) record._maxX = vert._x;
+		if (vert._y < record._minY) record._minY = vert._y;
+		else if (vert._y > record._maxY) record._maxY = vert._y;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t ObstacleGrid::getColumn(float x) const {
+	const float c = (x - _origin._x) * _invCellSize;
+	if (c <= 0.f) return 0;
+	const size_t col = (size_t)c;
+	return col < _columns ? col : _columns - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t ObstacleGrid::getRow(float y) const {
+	const float r = (y - _origin._y) * _invCellSize;
+	if (r <= 0.f) return 0;
+	const size_t row = (size_t)r;
+	return row < _rows ? row : _rows - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
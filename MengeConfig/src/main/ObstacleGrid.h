@@ -0,0 +1,282 @@
+/*!
+ *	@file		ObstacleGrid.h
+ *	@brief		A spatial index answering whether points lie inside obstacles and which
+ *				obstacle edges lie near a point.
+ */
+
+#ifndef __OBSTACLE_GRID_H__
+#define	__OBSTACLE_GRID_H__
+
+#include <cstddef>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+// forward declarations
+class GeometrySnap;
+class GLPolygon;
+class LiveObstacleSet;
+
+/*!
+ *	@brief		A snapshot of the obstacles of an obstacle set, indexed for point
+ *				containment tests and snapping.
+ *
+ *	Only the counter-clockwise polygons are solid; clockwise polygons bound the space
+ *	in which agents move and their interiors are free (they are indexed for snapping
+ *	only).  The polygons' edges are copied
+ *	into contiguous arrays and each polygon is recorded in the cells of a uniform grid
+ *	which its bounding box overlaps.  A query examines the polygons of a single cell,
+ *	rejecting them by their bounding boxes before running a crossing-number test over
+ *	their edges (four edges at a time where SSE2 is available).
+ *
+ *	The snapshot doesn't follow later edits of the obstacle set; it is patched (see
+ *	update()) or rebuilt as needed.  Once built, it can be queried from any number of
+ *	threads.
+ */
+class ObstacleGrid {
+public:
+	/*!
+	 *	@brief		Constructor -- an empty index.
+	 */
+	ObstacleGrid();
+
+	/*!
+	 *	@brief		Indexes the obstacles of an obstacle set.
+	 *
+	 *	@param		obstacles		The obstacle set.
+	 */
+	void build(const LiveObstacleSet & obstacles);
+
+	/*!
+	 *	@brief		Brings the index of changed polygons up to date without rebuilding it.
+	 *
+	 *	A changed polygon which still fits the cells it occupied is rewritten in place.
+	 *	Any other is removed from its cells and added to a short list of patched polygons
+	 *	which every query examines; getPatchCount() reports when a rebuild is due.
+	 *
+	 *	@param		obstacles		The obstacle set.
+	 *	@param		ids				The identifiers of the polygons added, changed or
+	 *								removed since the index was built (or last updated).
+	 */
+	void update(const LiveObstacleSet & obstacles, const std::unordered_set<size_t> & ids);
+
+	/*!
+	 *	@brief		Reports the number of polygons patched since the index was built.
+	 */
+	size_t getPatchCount() const { return _patchCount; }
+
+	/*!
+	 *	@brief		Reports if the index has no solid obstacles.
+	 */
+	bool isEmpty() const { return _solidCount == 0; }
+
+	/*!
+	 *	@brief		Reports if a point lies inside a solid obstacle.
+	 *
+	 *	@param		p		The point (on the x-y plane).
+	 *	@returns	True if the point is inside an obstacle.
+	 */
+	bool contains(const Vector2 & p) const;
+
+	/*!
+	 *	@brief		Reports if a point lies inside a polygon (using the crossing number).
+	 *
+	 *	@param		xs			The x-values of the polygon's vertices.
+	 *	@param		ys			The y-values of the polygon's vertices.
+	 *	@param		count		The number of vertices.
+	 *	@param		x			The x-value of the point.
+	 *	@param		y			The y-value of the point.
+	 *	@returns	True if the point is inside the polygon.
+	 */
+	static bool insidePolygon(const float * xs, const float * ys, size_t count, float x, float y);
+
+	/*!
+	 *	@brief		Feeds the edges near the query's point to a snap query.
+	 *
+	 *	Nothing is fed if the query's reach spans more than MAX_SNAP_CELLS cells; the view
+	 *	is then too coarse for individual features to be told apart.
+	 *
+	 *	@param		query		The snap query.
+	 *	@param		skipIds		The identifiers of the polygons to leave out (e.g., those
+	 *							changed since the index was built).
+	 *	@param		skipId		The identifier of another polygon to leave out (zero for
+	 *							none).
+	 */
+	void collectSegments(GeometrySnap & query, const std::unordered_set<size_t> & skipIds, size_t skipId = 0) const;
+
+	/*!
+	 *	@brief		Collects the identifiers of the indexed polygons whose bounding boxes
+	 *				overlap a box; each is reported once.
+	 *
+	 *	@param		minX		The minimum x-value of the box.
+	 *	@param		minY		The minimum y-value of the box.
+	 *	@param		maxX		The maximum x-value of the box.
+	 *	@param		maxY		The maximum y-value of the box.
+	 *	@param		ids			The identifiers are appended to this list.
+	 */
+	void collectPolygons(float minX, float minY, float maxX, float maxY, std::vector<size_t> & ids) const;
+
+	/*!
+	 *	@brief		The most cells a snap query examines.
+	 */
+	static const size_t MAX_SNAP_CELLS;
+
+	/*!
+	 *	@brief		The most cells per indexed polygon.
+	 */
+	static const size_t CELLS_PER_POLYGON;
+
+protected:
+	/*!
+	 *	@brief		An indexed polygon: its edges and bounding box.
+	 */
+	struct Polygon {
+		/// The identifier of the polygon in its obstacle set.
+		size_t	_id;
+
+		/// Reports if the polygon is solid (counter-clockwise).
+		bool	_solid;
+
+		/// The index of the polygon's first edge.
+		size_t	_begin;
+
+		/// The number of edges.
+		size_t	_count;
+
+		/// The minimum x-value of the bounding box.
+		float	_minX;
+
+		/// The minimum y-value of the bounding box.
+		float	_minY;
+
+		/// The maximum x-value of the bounding box.
+		float	_maxX;
+
+		/// The maximum y-value of the bounding box.
+		float	_maxY;
+	};
+
+	/*!
+	 *	@brief		Reports the column of the cell containing an x-value (clamped to the
+	 *				grid).
+	 */
+	size_t getColumn(float x) const;
+
+	/*!
+	 *	@brief		Reports the row of the cell containing a y-value (clamped to the grid).
+	 */
+	size_t getRow(float y) const;
+
+	/*!
+	 *	@brief		Reports if a point lies inside an indexed polygon (using the crossing
+	 *				number).
+	 *
+	 *	@param		poly		The polygon.
+	 *	@param		x			The x-value of the point.
+	 *	@param		y			The y-value of the point.
+	 *	@returns	True if the point is inside the polygon.
+	 */
+	bool insideEdges(const Polygon & poly, float x, float y) const;
+
+	/*!
+	 *	@brief		Appends a polygon's edges and sets its record's edges, bounding box and
+	 *				solidity (the solid count is left to the caller).
+	 *
+	 *	@param		poly		The polygon; it has at least two vertices.
+	 *	@param		record		The record.
+	 */
+	void appendEdges(const GLPolygon * poly, Polygon & record);
+
+	/*!
+	 *	@brief		Feeds the edges of an indexed polygon to a snap query.
+	 */
+	void addSegments(GeometrySnap & query, const Polygon & poly) const;
+
+	/*!
+	 *	@brief		The x-values of the edges' first vertices.
+	 */
+	std::vector<float>	_edgeX;
+
+	/*!
+	 *	@brief		The y-values of the edges' first vertices.
+	 */
+	std::vector<float>	_edgeY0;
+
+	/*!
+	 *	@brief		The y-values of the edges' second vertices.
+	 */
+	std::vector<float>	_edgeY1;
+
+	/*!
+	 *	@brief		The change in x per unit change in y along each edge (zero for
+	 *				horizontal edges, which are never crossed).
+	 */
+	std::vector<float>	_edgeSlope;
+
+	/*!
+	 *	@brief		The indexed polygons.
+	 */
+	std::vector<Polygon>	_polygons;
+
+	/*!
+	 *	@brief		The indices of the polygons in the cells, ordered by the polygons'
+	 *				identifiers.
+	 */
+	std::vector< std::pair<size_t, unsigned int> >	_cellIds;
+
+	/*!
+	 *	@brief		The indices of the patched polygons which are in no cell.
+	 */
+	std::vector<unsigned int>	_patched;
+
+	/*!
+	 *	@brief		The number of polygons patched since the index was built.
+	 */
+	size_t	_patchCount;
+
+	/*!
+	 *	@brief		The number of solid polygons.
+	 */
+	size_t	_solidCount;
+
+	/*!
+	 *	@brief		The minimum corner of the grid.
+	 */
+	Vector2	_origin;
+
+	/*!
+	 *	@brief		The maximum corner of the grid.
+	 */
+	Vector2	_limit;
+
+	/*!
+	 *	@brief		The reciprocal of the cells' width (and height).
+	 */
+	float	_invCellSize;
+
+	/*!
+	 *	@brief		The number of columns of cells.
+	 */
+	size_t	_columns;
+
+	/*!
+	 *	@brief		The number of rows of cells.
+	 */
+	size_t	_rows;
+
+	/*!
+	 *	@brief		The position in _cellPolygons of each cell's first polygon (with an
+	 *				extra entry marking the end of the last cell).
+	 */
+	std::vector<size_t>	_cellStart;
+
+	/*!
+	 *	@brief		The indices of the polygons overlapping each cell, cell after cell.
+	 */
+	std::vector<unsigned int>	_cellPolygons;
+};
+
+#endif	// __OBSTACLE_GRID_H__
@@ -0,0 +1,20 @@
+#include "ObstacleSnapshot.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ObstacleSnapshot
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t ObstacleSnapshot::CHUNK_SIZE = 256;
+
+///////////////////////////////////////////////////////////////////////////////
+
+ObstacleSnapshot::ObstacleSnapshot() : _chunks(), _count(0), _version(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const PolygonRecordPtr & ObstacleSnapshot::getPolygon(size_t i) const {
+	return (*_chunks[i / CHUNK_SIZE])[i % CHUNK_SIZE];
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,112 @@
+/*!
+ *	@file		ObstacleSnapshot.h
+ *	@brief		The definition of immutable versions of a LiveObstacleSet, which can be read
+ *				by worker threads while the set is edited.
+ */
+
+#ifndef __OBSTACLE_SNAPSHOT_H__
+#define	__OBSTACLE_SNAPSHOT_H__
+
+#include <memory>
+#include <vector>
+
+#include "ProjectState.h"
+
+/*!
+ *	@brief		An immutable version of the polygons of a LiveObstacleSet.
+ *
+ *	The polygons' records are stored in chunks of CHUNK_SIZE records, in the order of the
+ *	polygons in the set at the time of the snapshot.  Consecutive snapshots share every
+ *	chunk (and record) which didn't change; taking a snapshot only copies the table of
+ *	chunks and the chunks of the polygons changed since the previous snapshot.
+ *
+ *	A snapshot is never modified once it has been published; it can be read from any
+ *	number of threads.
+ */
+class ObstacleSnapshot {
+public:
+	/*!
+	 *	@brief		Constructor -- an empty snapshot.
+	 */
+	ObstacleSnapshot();
+
+	/*!
+	 *	@brief		Reports the version of the obstacle set captured by the snapshot (see
+	 *				LiveObstacleSet::getVersion()).
+	 */
+	size_t getVersion() const { return _version; }
+
+	/*!
+	 *	@brief		Reports the number of polygons in the snapshot.
+	 */
+	size_t getPolygonCount() const { return _count; }
+
+	/*!
+	 *	@brief		Returns the indicated polygon.
+	 *
+	 *	@param		i		The position of the polygon (less than getPolygonCount()).
+	 *	@returns	The polygon's record.
+	 */
+	const PolygonRecordPtr & getPolygon(size_t i) const;
+
+	/*!
+	 *	@brief		The number of records in a chunk.
+	 */
+	static const size_t CHUNK_SIZE;
+
+	friend class LiveObstacleSet;
+
+protected:
+	/*!
+	 *	@brief		A chunk of records.
+	 */
+	typedef std::vector< PolygonRecordPtr > Chunk;
+
+	/*!
+	 *	@brief		The chunks; every chunk but the last holds CHUNK_SIZE records.
+	 */
+	std::vector< std::shared_ptr< const Chunk > >	_chunks;
+
+	/*!
+	 *	@brief		The number of polygons.
+	 */
+	size_t	_count;
+
+	/*!
+	 *	@brief		The version of the obstacle set captured.
+	 */
+	size_t	_version;
+};
+
+/*!
+ *	@brief		A shared, read-only snapshot.
+ */
+typedef std::shared_ptr< const ObstacleSnapshot > ObstacleSnapshotPtr;
+
+/*!
+ *	@brief		Edits computed from a snapshot, to be merged into the live obstacle set.
+ */
+struct GeometryEdits {
+	/*!
+	 *	@brief		Reports if there are no edits.
+	 */
+	bool isEmpty() const { return _replaced.empty() && _added.empty() && _removed.empty(); }
+
+	/*!
+	 *	@brief		The new versions of existing polygons (identified by their records'
+	 *				identifiers).
+	 */
+	std::vector< PolygonRecordPtr >	_replaced;
+
+	/*!
+	 *	@brief		New polygons; their records' identifiers are ignored.
+	 */
+	std::vector< PolygonRecordPtr >	_added;
+
+	/*!
+	 *	@brief		The identifiers of the polygons to remove.
+	 */
+	std::vector< size_t >	_removed;
+};
+
+#endif	// __OBSTACLE_SNAPSHOT_H__
@@ -0,0 +1,148 @@
+#include "PickBuffer.h"
+
+#include <QtGui/QOpenGLFramebufferObject>
+
+#include <cassert>
+#include <gl/GL.h>
+
+#ifndef GL_MULTISAMPLE
+#define GL_MULTISAMPLE 0x809D
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//						Implementation of PickBuffer
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const unsigned int PickBuffer::NO_ID = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const size_t PickBuffer::MAX_INDEX = 0x3FFFFFFF;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int PickBuffer::makeId(ElementType type, size_t index) {
+	assert(index <= MAX_INDEX && "Element index too large to encode in a pick identifier");
+	return ((unsigned int)type << 30) | (unsigned int)(index & MAX_INDEX);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void PickBuffer::encodeColor(unsigned int id, unsigned char * rgba) {
+	rgba[0] = (unsigned char)(id >> 24);
+	rgba[1] = (unsigned char)(id >> 16);
+	rgba[2] = (unsigned char)(id >> 8);
+	rgba[3] = (unsigned char)(id);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+PickBuffer::PickBuffer() : _fbo(0x0), _ids(), _width(0), _height(0), _valid(false) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+PickBuffer::~PickBuffer() {
+	assert(_fbo == 0x0 && "Pick buffer destroyed without releasing its OpenGL resources");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool PickBuffer::beginDraw(int width, int height) {
+	if (width <= 0 || height <= 0) return false;
+	if (_fbo != 0x0 && (_fbo->width() != width || _fbo->height() != height)) {
+		delete _fbo;
+		_fbo = 0x0;
+	}
+	if (_fbo == 0x0) {
+		QOpenGLFramebufferObjectFormat format;
+		format.setAttachment(QOpenGLFramebufferObject::Depth);
+		format.setInternalTextureFormat(GL_RGBA8);
+		_fbo = new QOpenGLFramebufferObject(width, height, format);
+	}
+	if (!_fbo->bind()) return false;
+	_width = width;
+	_height = height;
+
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_LIGHTING_BIT |
+				 GL_VIEWPORT_BIT | GL_POINT_BIT | GL_LINE_BIT | GL_CURRENT_BIT);
+	// Anything which blends or modulates the color would corrupt the identifiers.
+	glDisable(GL_LIGHTING);
+	glDisable(GL_BLEND);
+	glDisable(GL_DITHER);
+	glDisable(GL_FOG);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_MULTISAMPLE);
+	glDisable(GL_POINT_SMOOTH);
+	glDisable(GL_LINE_SMOOTH);
+	glDisable(GL_DEPTH_TEST);
+	glShadeModel(GL_FLAT);
+	glViewport(0, 0, width, height);
+	glClearColor(0.f, 0.f, 0.f, 0.f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void PickBuffer::endDraw() {
+	_ids.resize((size_t)_width * _height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, &_ids[0]);
+	// The bytes were written in r, g, b, a order; assemble them into identifiers.
+	const size_t COUNT = _ids.size();
+	for (size_t i = 0; i < COUNT; ++i) {
+		const unsigned char * rgba = (const unsigned char *)&_ids[i];
+		_ids[i] = ((unsigned int)rgba[0] << 24) | ((unsigned int)rgba[1] << 16) |
+				  ((unsigned int)rgba[2] << 8) | (unsigned int)rgba[3];
+	}
+	glPopAttrib();
+	_fbo->release();
+	_valid = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void PickBuffer::destroyGL() {
+	if (_fbo != 0x0) {
+		delete _fbo;
+		_fbo = 0x0;
+	}
+	_valid = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int PickBuffer::getId(int x, int y) const {
+	if (!_valid || x < 0 || y < 0 || x >= _width || y >= _height) return NO_ID;
+	return _ids[(size_t)(_height - 1 - y) * _width + x];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int PickBuffer::getNearestId(int x, int y, int radius) const {
+	unsigned int id = getId(x, y);
+	if (id != NO_ID || !_valid) return id;
+	int bestDistSq = radius * radius + 1;
+	const int minX = x - radius < 0 ? 0 : x - radius;
+	const int maxX = x + radius >= _width ? _width - 1 : x + radius;
+	const int minY = y - radius < 0 ? 0 : y - radius;
+	const int maxY = y + radius >= _height ? _height - 1 : y + radius;
+	for (int r = minY; r <= maxY; ++r) {
+		const unsigned int * row = &_ids[(size_t)(_height - 1 - r) * _width];
+		const int dy = r - y;
+		for (int c = minX; c <= maxX; ++c) {
+			if (row[c] != NO_ID) {
+				const int dx = c - x;
+				const int distSq = dx * dx + dy * dy;
+				if (distSq < bestDistSq) {
+					bestDistSq = distSq;
+					id = row[c];
+				}
+			}
+		}
+	}
+	return id;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,185 @@
+/*!
+ *	@file		PickBuffer.h
+ *	@brief		The definition of an offscreen buffer of element identifiers used
+ *				for picking elements in the OpenGL view.
+ */
+
+#ifndef __PICK_BUFFER_H__
+#define	__PICK_BUFFER_H__
+
+#include <QtCore/qglobal.h>
+
+#include <vector>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
+
+/*!
+ *	@brief		An offscreen buffer into which pickable elements are drawn with a
+ *				color encoding their identifier.
+ *
+ *	The buffer is rendered once and then read back into memory in its entirety.  Queries
+ *	for the element under a pixel are simple array look ups until the buffer is invalidated
+ *	(e.g., the camera moves or the geometry changes).
+ *
+ *	An identifier is a 32-bit value.  The upper two bits encode the type of element and
+ *	the lower 30 bits encode the element's index.  The identifier is written into the
+ *	RGBA channels of the buffer.  The identifier 0 (NO_ID) is reserved for "nothing".
+ */
+class PickBuffer {
+public:
+	/*!
+	 *	@brief		The type of element encoded in an identifier.
+	 */
+	enum ElementType {
+		NO_ELEMENT = 0,		///< No element
+		VERTEX_ELEMENT,		///< A polygon vertex
+		EDGE_ELEMENT,		///< A polygon edge
+		POLYGON_ELEMENT		///< An entire polygon
+	};
+
+	/*!
+	 *	@brief		The identifier indicating that no element is present.
+	 */
+	static const unsigned int NO_ID;
+
+	/*!
+	 *	@brief		The largest element index that can be encoded.
+	 */
+	static const size_t MAX_INDEX;
+
+	/*!
+	 *	@brief		Constructs an identifier from an element type and index.
+	 *
+	 *	@param		type		The type of the element.
+	 *	@param		index		The index of the element.  Must be no larger than MAX_INDEX.
+	 *	@returns	The encoded identifier.
+	 */
+	static unsigned int makeId(ElementType type, size_t index);
+
+	/*!
+	 *	@brief		Reports the element type encoded in the identifier.
+	 *
+	 *	@param		id		The identifier.
+	 *	@returns	The element type.
+	 */
+	static ElementType getType(unsigned int id) { return (ElementType)(id >> 30); }
+
+	/*!
+	 *	@brief		Reports the element index encoded in the identifier.
+	 *
+	 *	@param		id		The identifier.
+	 *	@returns	The element index.
+	 */
+	static size_t getIndex(unsigned int id) { return id & 0x3FFFFFFF; }
+
+	/*!
+	 *	@brief		Writes the identifier as an RGBA color.
+	 *
+	 *	@param		id		The identifier to encode.
+	 *	@param		rgba	An array of four bytes to write the color into.
+	 */
+	static void encodeColor(unsigned int id, unsigned char * rgba);
+
+	/*!
+	 *	@brief		Constructor.
+	 */
+	PickBuffer();
+
+	/*!
+	 *	@brief		Destructor.
+	 *
+	 *	The OpenGL resources must be released with destroyGL() (with a current OpenGL
+	 *	context) prior to destruction.
+	 */
+	~PickBuffer();
+
+	/*!
+	 *	@brief		Marks the contents of the buffer as out of date.
+	 */
+	void invalidate() { _valid = false; }
+
+	/*!
+	 *	@brief		Reports if the buffer contents are up to date.
+	 */
+	bool isValid() const { return _valid; }
+
+	/*!
+	 *	@brief		Prepares the buffer to be drawn into.
+	 *
+	 *	The OpenGL context must be current.  The offscreen buffer is bound, cleared and all
+	 *	OpenGL state that would corrupt the encoded colors (lighting, blending, etc.) is
+	 *	disabled.  The caller is responsible for setting the projection and modelview
+	 *	matrices.  Every call must be paired with a call to endDraw().
+	 *
+	 *	@param		width		The width of the view (in pixels).
+	 *	@param		height		The height of the view (in pixels).
+	 *	@returns	True if the buffer is ready for drawing, false if the offscreen buffer
+	 *				could not be bound.
+	 */
+	bool beginDraw(int width, int height);
+
+	/*!
+	 *	@brief		Finishes drawing into the buffer; the contents are read back into memory
+	 *				and the OpenGL state is restored.
+	 *
+	 *	The offscreen buffer is released, the caller is responsible for rebinding the
+	 *	view's frame buffer.
+	 */
+	void endDraw();
+
+	/*!
+	 *	@brief		Releases the OpenGL resources.  The OpenGL context must be current.
+	 */
+	void destroyGL();
+
+	/*!
+	 *	@brief		Reports the identifier drawn at the given pixel.
+	 *
+	 *	@param		x		The horizontal pixel position (from the left).
+	 *	@param		y		The vertical pixel position (from the top).
+	 *	@returns	The identifier at that pixel.  NO_ID if nothing was drawn there or
+	 *				the position lies outside of the buffer.
+	 */
+	unsigned int getId(int x, int y) const;
+
+	/*!
+	 *	@brief		Reports the identifier drawn nearest the given pixel, within a
+	 *				square window.
+	 *
+	 *	@param		x			The horizontal pixel position (from the left).
+	 *	@param		y			The vertical pixel position (from the top).
+	 *	@param		radius		The half-width of the search window (in pixels).
+	 *	@returns	The identifier nearest the pixel.  NO_ID if there is none.
+	 */
+	unsigned int getNearestId(int x, int y, int radius) const;
+
+protected:
+
+	/*!
+	 *	@brief		The offscreen frame buffer.
+	 */
+	QOpenGLFramebufferObject * _fbo;
+
+	/*!
+	 *	@brief		The identifiers read back from the frame buffer, row by row, starting
+	 *				with the *bottom* row.
+	 */
+	std::vector<unsigned int> _ids;
+
+	/*!
+	 *	@brief		The width of the buffer contents (in pixels).
+	 */
+	int _width;
+
+	/*!
+	 *	@brief		The height of the buffer contents (in pixels).
+	 */
+	int _height;
+
+	/*!
+	 *	@brief		Reports if the buffer contents are up to date.
+	 */
+	bool _valid;
+};
+
+#endif	// __PICK_BUFFER_H__
@@ -0,0 +1,380 @@
+#include "PngBandReader.h"
+
+#include "MCException.h"
+
+#include <QtGui/qimage.h>
+#include <QtZlib/zlib.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		The size of the pieces of compressed data read from the file.
+ */
+const qint64 INPUT_SIZE = 1 << 16;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads a big-endian, 32-bit value.
+ */
+quint32 readBigEndian32(const unsigned char * data) {
+	return (quint32(data[0]) << 24) | (quint32(data[1]) << 16) | (quint32(data[2]) << 8) | quint32(data[3]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads a sample of a row.
+ *
+ *	@param		row			The row's (unfiltered) bytes.
+ *	@param		index		The index of the sample in the row.
+ *	@param		bitDepth	The number of bits per sample.
+ *	@returns	The sample's value, in its bit depth.
+ */
+unsigned short readSample(const unsigned char * row, size_t index, int bitDepth) {
+	if (bitDepth == 8) return row[index];
+	if (bitDepth == 16) return static_cast<unsigned short>((row[2 * index] << 8) | row[2 * index + 1]);
+	// Samples narrower than a byte are packed from the most significant bit.
+	const size_t bit = index * bitDepth;
+	const int shift = 8 - bitDepth - static_cast<int>(bit % 8);
+	return static_cast<unsigned short>((row[bit / 8] >> shift) & ((1 << bitDepth) - 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Scales a sample to eight bits.
+ *
+ *	@param		value		The sample's value.
+ *	@param		bitDepth	The number of bits per sample.
+ */
+unsigned char toByte(unsigned short value, int bitDepth) {
+	if (bitDepth == 16) return static_cast<unsigned char>(value >> 8);
+	if (bitDepth == 8) return static_cast<unsigned char>(value);
+	return static_cast<unsigned char>(value * 255 / ((1 << bitDepth) - 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of PngBandReader
+///////////////////////////////////////////////////////////////////////////////
+
+struct PngBandReader::Inflater {
+	/*!
+	 *	@brief		The zlib stream.
+	 */
+	z_stream	_stream;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+PngBandReader::PngBandReader() : _file(), _size(), _bitDepth(0), _colorType(0), _pixelBytes(0), _rowBytes(0), _palette(), _keyed(false), _prior(), _current(), _input(), _chunkRemaining(0), _inputDone(false), _row(0), _inflater() {
+	_key[0] = _key[1] = _key[2] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+PngBandReader::~PngBandReader() {
+	close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool PngBandReader::open(const QString & path) {
+	close();
+	_file.setFileName(path);
+	if (!_file.open(QIODevice::ReadOnly)) {
+		throw MCException(QString("Unable to open the image %1: %2").arg(path).arg(_file.errorString()).toStdString());
+	}
+	static const char SIGNATURE[] = "\x89PNG\r\n\x1a\n";
+	if (_file.read(8) != QByteArray(SIGNATURE, 8)) {
+		close();
+		return false;
+	}
+
+	// The header chunks precede the image's data.
+	int interlace = 0;
+	bool hasHeader = false;
+	while (true) {
+		quint32 length;
+		QByteArray type;
+		readChunkHeader(length, type);
+		if (type == "IDAT") {
+			_chunkRemaining = length;
+			break;
+		}
+		if (type == "IEND") {
+			throw MCException(QString("The image %1 has no data").arg(path).toStdString());
+		}
+		// Only the chunks describing the pixels are read; the header chunks are small.
+		QByteArray data;
+		if (type == "IHDR" || type == "PLTE" || type == "tRNS") {
+			if (length > 1024) {
+				throw MCException(QString("The image %1 has an invalid %2 chunk").arg(path).arg(QString(type)).toStdString());
+			}
+			data.resize(static_cast<int>(length));
+			readBytes(data.data(), length);
+		}
+		else if (!_file.seek(_file.pos() + length)) {
+			throw MCException(QString("The image %1 is truncated").arg(path).toStdString());
+		}
+		// The chunk's CRC.
+		char crc[4];
+		readBytes(crc, 4);
+
+		const unsigned char * bytes = reinterpret_cast<const unsigned char *>(data.constData());
+		if (type == "IHDR") {
+			if (length < 13) {
+				throw MCException(QString("The image %1 has an invalid header").arg(path).toStdString());
+			}
+			const quint32 width = readBigEndian32(bytes);
+			const quint32 height = readBigEndian32(bytes + 4);
+			if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF) {
+				throw MCException(QString("The image %1 has an invalid size").arg(path).toStdString());
+			}
+			_size = QSize(static_cast<int>(width), static_cast<int>(height));
+			_bitDepth = bytes[8];
+			_colorType = bytes[9];
+			interlace = bytes[12];
+			hasHeader = true;
+		}
+		else if (type == "PLTE") {
+			_palette.assign(256 * 4, 0);
+			for (size_t i = 0; i < 256 && 3 * i + 2 < length; ++i) {
+				_palette[4 * i] = bytes[3 * i];
+				_palette[4 * i + 1] = bytes[3 * i + 1];
+				_palette[4 * i + 2] = bytes[3 * i + 2];
+				_palette[4 * i + 3] = 255;
+			}
+		}
+		else if (type == "tRNS") {
+			if (_colorType == 3) {
+				for (size_t i = 0; i < length && 4 * i + 3 < _palette.size(); ++i) {
+					_palette[4 * i + 3] = bytes[i];
+				}
+			}
+			else if (length >= 2) {
+				_keyed = true;
+				for (size_t i = 0; i < 3 && 2 * i + 1 < length; ++i) {
+					_key[i] = static_cast<unsigned short>((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+				}
+			}
+		}
+	}
+	if (!hasHeader) {
+		throw MCException(QString("The image %1 has no header").arg(path).toStdString());
+	}
+
+	// The combinations of color type and bit depth the format allows.
+	int channels = 0;
+	switch (_colorType) {
+		case 0: channels = (_bitDepth == 1 || _bitDepth == 2 || _bitDepth == 4 || _bitDepth == 8 || _bitDepth == 16) ? 1 : 0; break;
+		case 2: channels = (_bitDepth == 8 || _bitDepth == 16) ? 3 : 0; break;
+		case 3: channels = (_bitDepth == 1 || _bitDepth == 2 || _bitDepth == 4 || _bitDepth == 8) && !_palette.empty() ? 1 : 0; break;
+		case 4: channels = (_bitDepth == 8 || _bitDepth == 16) ? 2 : 0; break;
+		case 6: channels = (_bitDepth == 8 || _bitDepth == 16) ? 4 : 0; break;
+	}
+	if (channels == 0) {
+		throw MCException(QString("The image %1 has an invalid format").arg(path).toStdString());
+	}
+	if (interlace != 0) {
+		// Interlaced rows are only complete once the last pass is decoded.
+		close();
+		return false;
+	}
+	_pixelBytes = std::max(channels * _bitDepth / 8, 1);
+	_rowBytes = (static_cast<size_t>(_size.width()) * channels * _bitDepth + 7) / 8;
+	_prior.assign(_rowBytes, 0);
+	_current.assign(_rowBytes + 1, 0);
+	_input.resize(static_cast<size_t>(INPUT_SIZE));
+
+	_inflater.reset(new Inflater());
+	std::memset(&_inflater->_stream, 0, sizeof(z_stream));
+	if (inflateInit(&_inflater->_stream) != Z_OK) {
+		_inflater.reset();
+		throw MCException(QString("Unable to decompress the image %1").arg(path).toStdString());
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PngBandReader::close() {
+	if (_inflater) {
+		inflateEnd(&_inflater->_stream);
+		_inflater.reset();
+	}
+	if (_file.isOpen()) _file.close();
+	_size = QSize();
+	_bitDepth = 0;
+	_colorType = 0;
+	_pixelBytes = 0;
+	_rowBytes = 0;
+	_palette.clear();
+	_keyed = false;
+	_prior.clear();
+	_current.clear();
+	_input.clear();
+	_chunkRemaining = 0;
+	_inputDone = false;
+	_row = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PngBandReader::readRows(QImage & band) {
+	if (!_inflater || band.format() != QImage::Format_RGBA8888 || band.width() != _size.width() || band.height() > getRemainingRows()) {
+		throw MCException("The rows requested don't belong to the open image");
+	}
+	for (int y = 0; y < band.height(); ++y) {
+		inflateRow();
+		convertRow(band.scanLine(y));
+		_prior.assign(_current.begin() + 1, _current.end());
+		++_row;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PngBandReader::readChunkHeader(quint32 & length, QByteArray & type) {
+	unsigned char header[8];
+	readBytes(reinterpret_cast<char *>(header), 8);
+	length = readBigEndian32(header);
+	type = QByteArray(reinterpret_cast<const char *>(header + 4), 4);
+	if (length > 0x7FFFFFFF) {
+		throw MCException(QString("The image %1 has an invalid chunk").arg(_file.fileName()).toStdString());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PngBandReader::readBytes(char * data, qint64 count) {
+	if (_file.read(data, count) != count) {
+		throw MCException(QString("The image %1 is truncated").arg(_file.fileName()).toStdString());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool PngBandReader::fetchInput() {
+	// The data may be split over any number of consecutive IDAT chunks.
+	while (_chunkRemaining == 0) {
+		if (_inputDone) return false;
+		char crc[4];
+		readBytes(crc, 4);
+		quint32 length;
+		QByteArray type;
+		readChunkHeader(length, type);
+		if (type != "IDAT") {
+			_inputDone = true;
+			return false;
+		}
+		_chunkRemaining = length;
+	}
+	const qint64 count = std::min(qint64(_chunkRemaining), INPUT_SIZE);
+	readBytes(&_input[0], count);
+	_chunkRemaining -= static_cast<quint32>(count);
+	_inflater->_stream.next_in = reinterpret_cast<Bytef *>(&_input[0]);
+	_inflater->_stream.avail_in = static_cast<uInt>(count);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PngBandReader::inflateRow() {
+	z_stream & stream = _inflater->_stream;
+	stream.next_out = &_current[0];
+	stream.avail_out = static_cast<uInt>(_current.size());
+	while (stream.avail_out > 0) {
+		if (stream.avail_in == 0 && !fetchInput()) {
+			throw MCException(QString("The image %1 is truncated").arg(_file.fileName()).toStdString());
+		}
+		const int result = inflate(&stream, Z_NO_FLUSH);
+		if (result == Z_STREAM_END && stream.avail_out > 0) {
+			throw MCException(QString("The image %1 is truncated").arg(_file.fileName()).toStdString());
+		}
+		if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+			throw MCException(QString("The image %1 is corrupt").arg(_file.fileName()).toStdString());
+		}
+	}
+
+	// Each row is filtered against its left neighbors and the previous row.
+	unsigned char * row = &_current[1];
+	const unsigned char * up = &_prior[0];
+	const size_t BPP = _pixelBytes;
+	switch (_current[0]) {
+		case 0:
+			break;
+		case 1:
+			for (size_t i = BPP; i < _rowBytes; ++i) row[i] = static_cast<unsigned char>(row[i] + row[i - BPP]);
+			break;
+		case 2:
+			for (size_t i = 0; i < _rowBytes; ++i) row[i] = static_cast<unsigned char>(row[i] + up[i]);
+			break;
+		case 3:
+			for (size_t i = 0; i < _rowBytes; ++i) {
+				const int left = i >= BPP ? row[i - BPP] : 0;
+				row[i] = static_cast<unsigned char>(row[i] + ((left + up[i]) >> 1));
+			}
+			break;
+		case 4:
+			for (size_t i = 0; i < _rowBytes; ++i) {
+				const int a = i >= BPP ? row[i - BPP] : 0;
+				const int b = up[i];
+				const int c = i >= BPP ? up[i - BPP] : 0;
+				const int p = a + b - c;
+				const int pa = std::abs(p - a);
+				const int pb = std::abs(p - b);
+				const int pc = std::abs(p - c);
+				const int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+				row[i] = static_cast<unsigned char>(row[i] + predictor);
+			}
+			break;
+		default:
+			throw MCException(QString("The image %1 is corrupt").arg(_file.fileName()).toStdString());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PngBandReader::convertRow(unsigned char * pixels) const {
+	const unsigned char * row = &_current[1];
+	const size_t WIDTH = static_cast<size_t>(_size.width());
+	for (size_t x = 0; x < WIDTH; ++x, pixels += 4) {
+		switch (_colorType) {
+			case 0: {
+				const unsigned short gray = readSample(row, x, _bitDepth);
+				pixels[0] = pixels[1] = pixels[2] = toByte(gray, _bitDepth);
+				pixels[3] = (_keyed && gray == _key[0]) ? 0 : 255;
+				break;
+			}
+			case 2: {
+				const unsigned short r = readSample(row, 3 * x, _bitDepth);
+				const unsigned short g = readSample(row, 3 * x + 1, _bitDepth);
+				const unsigned short b = readSample(row, 3 * x + 2, _bitDepth);
+				pixels[0] = toByte(r, _bitDepth);
+				pixels[1] = toByte(g, _bitDepth);
+				pixels[2] = toByte(b, _bitDepth);
+				pixels[3] = (_keyed && r == _key[0] && g == _key[1] && b == _key[2]) ? 0 : 255;
+				break;
+			}
+			case 3:
+				std::memcpy(pixels, &_palette[4 * readSample(row, x, _bitDepth)], 4);
+				break;
+			case 4:
+				pixels[0] = pixels[1] = pixels[2] = toByte(readSample(row, 2 * x, _bitDepth), _bitDepth);
+				pixels[3] = toByte(readSample(row, 2 * x + 1, _bitDepth), _bitDepth);
+				break;
+			case 6:
+				for (size_t c = 0; c < 4; ++c) {
+					pixels[c] = toByte(readSample(row, 4 * x + c, _bitDepth), _bitDepth);
+				}
+				break;
+		}
+	}
+}
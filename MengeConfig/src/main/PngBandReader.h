@@ -0,0 +1,206 @@
+/*!
+ *	@file		PngBandReader.h
+ *	@brief		The definition of a reader which decodes a PNG image a band of rows at a
+ *				time.
+ */
+
+#ifndef __PNG_BAND_READER_H__
+#define	__PNG_BAND_READER_H__
+
+#include <QtCore/qfile.h>
+#include <QtCore/qsize.h>
+#include <QtCore/qstring.h>
+
+#include <memory>
+#include <vector>
+
+// forward declarations
+QT_BEGIN_NAMESPACE
+class QImage;
+QT_END_NAMESPACE
+
+/*!
+ *	@brief		Decodes a PNG image from the top down, a band of rows at a time, so an image
+ *				far larger than the memory available can be processed (Qt's reader holds
+ *				the whole image).
+ *
+ *	Only the previous and current rows are held besides the band being filled.  Images
+ *	stored interlaced can't be decoded in rows; open() declines them (as it does any file
+ *	which isn't a PNG).
+ */
+class PngBandReader {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 */
+	PngBandReader();
+
+	/*!
+	 *	@brief		Destructor.
+	 */
+	~PngBandReader();
+
+	/*!
+	 *	@brief		Opens an image and reads its header.
+	 *
+	 *	@param		path		The path to the image.
+	 *	@returns	True if the image can be read in bands, false if it isn't a PNG or is
+	 *				interlaced.
+	 *	@throws		MCException if the file can't be read or its header is invalid.
+	 */
+	bool open(const QString & path);
+
+	/*!
+	 *	@brief		Closes the image.
+	 */
+	void close();
+
+	/*!
+	 *	@brief		Reports the size of the open image.
+	 */
+	const QSize & getSize() const { return _size; }
+
+	/*!
+	 *	@brief		Reports the number of rows not yet read.
+	 */
+	int getRemainingRows() const { return _size.height() - _row; }
+
+	/*!
+	 *	@brief		Decodes the next rows of the image.
+	 *
+	 *	@param		band		The rows are written here.  It must be as wide as the image,
+	 *							no taller than the rows remaining and in
+	 *							QImage::Format_RGBA8888.
+	 *	@throws		MCException if the image's data is invalid or truncated.
+	 */
+	void readRows(QImage & band);
+
+protected:
+	/*!
+	 *	@brief		Reads the header of the next chunk.
+	 *
+	 *	@param		length		The length of the chunk's data.
+	 *	@param		type		The chunk's type (four characters).
+	 *	@throws		MCException if the file ends.
+	 */
+	void readChunkHeader(quint32 & length, QByteArray & type);
+
+	/*!
+	 *	@brief		Reads bytes from the file.
+	 *
+	 *	@param		data		The bytes are written here.
+	 *	@param		count		The number of bytes to read.
+	 *	@throws		MCException if the file ends.
+	 */
+	void readBytes(char * data, qint64 count);
+
+	/*!
+	 *	@brief		Feeds the inflater the next piece of the compressed data.
+	 *
+	 *	@returns	True if there was data left.
+	 */
+	bool fetchInput();
+
+	/*!
+	 *	@brief		Decompresses and unfilters the next row into _current.
+	 *
+	 *	@throws		MCException if the data is invalid or truncated.
+	 */
+	void inflateRow();
+
+	/*!
+	 *	@brief		Converts the current row to 8-bit RGBA pixels.
+	 *
+	 *	@param		pixels		The pixels are written here (four bytes per pixel).
+	 */
+	void convertRow(unsigned char * pixels) const;
+
+	/*!
+	 *	@brief		The inflater's state (a zlib stream).
+	 */
+	struct Inflater;
+
+	/*!
+	 *	@brief		The image's file.
+	 */
+	QFile	_file;
+
+	/*!
+	 *	@brief		The image's size.
+	 */
+	QSize	_size;
+
+	/*!
+	 *	@brief		The number of bits per sample.
+	 */
+	int	_bitDepth;
+
+	/*!
+	 *	@brief		The PNG color type (0: gray, 2: RGB, 3: palette, 4: gray and alpha,
+	 *				6: RGBA).
+	 */
+	int	_colorType;
+
+	/*!
+	 *	@brief		The distance between corresponding bytes of neighboring pixels (for
+	 *				unfiltering; at least one).
+	 */
+	size_t	_pixelBytes;
+
+	/*!
+	 *	@brief		The number of bytes in a row (excluding the filter byte).
+	 */
+	size_t	_rowBytes;
+
+	/*!
+	 *	@brief		The palette (RGBA, four bytes per entry).
+	 */
+	std::vector< unsigned char >	_palette;
+
+	/*!
+	 *	@brief		Reports if a single gray level or color is transparent (see _key).
+	 */
+	bool	_keyed;
+
+	/*!
+	 *	@brief		The transparent gray level or color (in the samples' bit depth).
+	 */
+	unsigned short	_key[3];
+
+	/*!
+	 *	@brief		The previous row, unfiltered.
+	 */
+	std::vector< unsigned char >	_prior;
+
+	/*!
+	 *	@brief		The current row: its filter byte, then its bytes (unfiltered once read).
+	 */
+	std::vector< unsigned char >	_current;
+
+	/*!
+	 *	@brief		The compressed data read from the file but not yet inflated.
+	 */
+	std::vector< char >	_input;
+
+	/*!
+	 *	@brief		The compressed bytes left in the current IDAT chunk.
+	 */
+	quint32	_chunkRemaining;
+
+	/*!
+	 *	@brief		Reports if the last IDAT chunk has been read.
+	 */
+	bool	_inputDone;
+
+	/*!
+	 *	@brief		The index of the next row.
+	 */
+	int	_row;
+
+	/*!
+	 *	@brief		The inflater (null while no image is open).
+	 */
+	std::unique_ptr< Inflater >	_inflater;
+};
+
+#endif	// __PNG_BAND_READER_H__
@@ -0,0 +1,141 @@
+#include "PolygonArena.h"
+#include "GLPolygon.h"
+
+#include <cassert>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of PolygonArena
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t PolygonArena::POLYGONS_PER_SLAB = 4096;
+const size_t PolygonArena::CHUNK_SIZE = 1 << 16;
+const size_t PolygonArena::MIN_BLOCK = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+
+PolygonArena::PolygonArena() : _slabs(), _slabUsed(0), _freePolygons(0x0), _polygonCount(0), _chunks(), _chunkUsed(0), _largeBlocks(), _reserved(0) {
+	for (size_t i = 0; i < CLASS_COUNT; ++i) {
+		_freeBlocks[i] = 0x0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+PolygonArena::~PolygonArena() {
+	clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GLPolygon * PolygonArena::createPolygon() {
+	void * slot;
+	if (_freePolygons != 0x0) {
+		slot = _freePolygons;
+		_freePolygons = _freePolygons->_next;
+	}
+	else {
+		if (_slabs.empty() || _slabUsed == POLYGONS_PER_SLAB) {
+			const size_t bytes = POLYGONS_PER_SLAB * sizeof(GLPolygon);
+			_slabs.push_back(static_cast<char *>(::operator new(bytes)));
+			_reserved += bytes;
+			_slabUsed = 0;
+		}
+		slot = _slabs.back() + _slabUsed * sizeof(GLPolygon);
+		++_slabUsed;
+	}
+	++_polygonCount;
+	return new (slot) GLPolygon(this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PolygonArena::destroyPolygon(GLPolygon * poly) {
+	assert(poly->getArena() == this && "Destroying a polygon which belongs to another arena");
+	poly->~GLPolygon();
+	FreeNode * node = reinterpret_cast<FreeNode *>(poly);
+	node->_next = _freePolygons;
+	_freePolygons = node;
+	--_polygonCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void * PolygonArena::allocate(size_t bytes) {
+	const size_t c = getClass(bytes);
+	if (c == CLASS_COUNT) {
+		void * block = ::operator new(bytes);
+		_largeBlocks.insert(block);
+		_reserved += bytes;
+		return block;
+	}
+	if (_freeBlocks[c] != 0x0) {
+		FreeNode * node = _freeBlocks[c];
+		_freeBlocks[c] = node->_next;
+		return node;
+	}
+	const size_t size = MIN_BLOCK << c;
+	if (_chunks.empty() || _chunkUsed + size > CHUNK_SIZE) {
+		// The remainder of the last chunk is abandoned; it is smaller than the largest class.
+		_chunks.push_back(static_cast<char *>(::operator new(CHUNK_SIZE)));
+		_reserved += CHUNK_SIZE;
+		_chunkUsed = 0;
+	}
+	void * block = _chunks.back() + _chunkUsed;
+	_chunkUsed += size;
+	return block;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PolygonArena::deallocate(void * block, size_t bytes) {
+	if (block == 0x0) return;
+	const size_t c = getClass(bytes);
+	if (c == CLASS_COUNT) {
+		_largeBlocks.erase(block);
+		_reserved -= bytes;
+		::operator delete(block);
+		return;
+	}
+	FreeNode * node = static_cast<FreeNode *>(block);
+	node->_next = _freeBlocks[c];
+	_freeBlocks[c] = node;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PolygonArena::clear() {
+	for (size_t i = 0; i < _slabs.size(); ++i) {
+		::operator delete(_slabs[i]);
+	}
+	_slabs.clear();
+	_slabUsed = 0;
+	_freePolygons = 0x0;
+	_polygonCount = 0;
+	for (size_t i = 0; i < _chunks.size(); ++i) {
+		::operator delete(_chunks[i]);
+	}
+	_chunks.clear();
+	_chunkUsed = 0;
+	for (size_t i = 0; i < CLASS_COUNT; ++i) {
+		_freeBlocks[i] = 0x0;
+	}
+	for (std::unordered_set<void *>::iterator itr = _largeBlocks.begin(); itr != _largeBlocks.end(); ++itr) {
+		::operator delete(*itr);
+	}
+	_largeBlocks.clear();
+	_reserved = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t PolygonArena::getClass(size_t bytes) {
+	size_t c = 0;
+	size_t size = MIN_BLOCK;
+	while (size < bytes && c < CLASS_COUNT) {
+		size <<= 1;
+		++c;
+	}
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
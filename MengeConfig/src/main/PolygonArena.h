@@ -0,0 +1,295 @@
+/*!
+ *	@file		PolygonArena.h
+ *	@brief		The definition of the arena which stores an obstacle set's polygons and
+ *				their vertices.
+ */
+
+#ifndef __POLYGON_ARENA_H__
+#define	__POLYGON_ARENA_H__
+
+#include <cstddef>
+#include <new>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// forward declarations
+class GLPolygon;
+
+/*!
+ *	@brief		Storage for the polygons of an obstacle set and their per-polygon arrays
+ *				(vertices and cached edge data).
+ *
+ *	Polygons are constructed in slabs which each hold POLYGONS_PER_SLAB polygons, so the
+ *	polygons of a set are contiguous in memory and are allocated without visiting the
+ *	heap.  Arrays are carved from large chunks in power-of-two size classes; released
+ *	blocks are kept on a free list per class and reused.  Arrays larger than the largest
+ *	class are allocated from the heap (and tracked so they can be released with the arena).
+ *
+ *	Because every allocation made by a pooled polygon comes from the arena, the whole
+ *	arena can be released at once -- without running the polygons' destructors.
+ *
+ *	The arena is not thread safe; it is used from the thread which edits the obstacle set.
+ */
+class PolygonArena {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 */
+	PolygonArena();
+
+	/*!
+	 *	@brief		Destructor -- releases all memory (see clear()).
+	 */
+	~PolygonArena();
+
+	/*!
+	 *	@brief		Constructs an empty polygon whose arrays are allocated from the arena.
+	 *
+	 *	@returns	The new polygon.  It must be destroyed with destroyPolygon or released
+	 *				with the arena.
+	 */
+	GLPolygon * createPolygon();
+
+	/*!
+	 *	@brief		Destroys a polygon created by this arena, making its storage
+	 *				available to later polygons.
+	 *
+	 *	@param		poly		The polygon to destroy.
+	 */
+	void destroyPolygon(GLPolygon * poly);
+
+	/*!
+	 *	@brief		Allocates a block of memory.
+	 *
+	 *	@param		bytes		The size of the block.
+	 *	@returns	The block (aligned to at least 16 bytes).
+	 */
+	void * allocate(size_t bytes);
+
+	/*!
+	 *	@brief		Releases a block allocated by allocate().
+	 *
+	 *	@param		block		The block.
+	 *	@param		bytes		The size passed to allocate().
+	 */
+	void deallocate(void * block, size_t bytes);
+
+	/*!
+	 *	@brief		Releases all memory at once.  Every polygon created by the arena is
+	 *				invalidated; their destructors are not called.
+	 */
+	void clear();
+
+	/*!
+	 *	@brief		Reports the number of live polygons.
+	 */
+	size_t getPolygonCount() const { return _polygonCount; }
+
+	/*!
+	 *	@brief		Reports the number of bytes the arena has obtained from the heap.
+	 */
+	size_t getReservedBytes() const { return _reserved; }
+
+	/*!
+	 *	@brief		The number of polygons in a slab.
+	 */
+	static const size_t POLYGONS_PER_SLAB;
+
+	/*!
+	 *	@brief		The size (in bytes) of the chunks from which arrays are carved.
+	 */
+	static const size_t CHUNK_SIZE;
+
+	/*!
+	 *	@brief		The size (in bytes) of the smallest size class.
+	 */
+	static const size_t MIN_BLOCK;
+
+	/*!
+	 *	@brief		The number of size classes; larger arrays come from the heap.
+	 */
+	static const size_t CLASS_COUNT = 10;
+
+protected:
+	/*!
+	 *	@brief		A released polygon or block, linked into a free list.
+	 */
+	struct FreeNode {
+		/// The next free node.
+		FreeNode *	_next;
+	};
+
+	/*!
+	 *	@brief		Reports the size class of a block.
+	 *
+	 *	@param		bytes		The size of the block.
+	 *	@returns	The index of the smallest class which holds the block (CLASS_COUNT if
+	 *				the block is too large for any class).
+	 */
+	static size_t getClass(size_t bytes);
+
+	/*!
+	 *	@brief		The slabs of polygons.
+	 */
+	std::vector<char *>	_slabs;
+
+	/*!
+	 *	@brief		The number of polygons constructed in the last slab.
+	 */
+	size_t	_slabUsed;
+
+	/*!
+	 *	@brief		The destroyed polygons' storage.
+	 */
+	FreeNode *	_freePolygons;
+
+	/*!
+	 *	@brief		The number of live polygons.
+	 */
+	size_t	_polygonCount;
+
+	/*!
+	 *	@brief		The chunks from which arrays are carved.
+	 */
+	std::vector<char *>	_chunks;
+
+	/*!
+	 *	@brief		The number of bytes already carved from the last chunk.
+	 */
+	size_t	_chunkUsed;
+
+	/*!
+	 *	@brief		The released blocks of each size class.
+	 */
+	FreeNode *	_freeBlocks[CLASS_COUNT];
+
+	/*!
+	 *	@brief		The blocks too large for the size classes.
+	 */
+	std::unordered_set<void *>	_largeBlocks;
+
+	/*!
+	 *	@brief		The number of bytes obtained from the heap.
+	 */
+	size_t	_reserved;
+};
+
+/*!
+ *	@brief		A standard allocator which allocates from a PolygonArena (or the heap,
+ *				if it has no arena).  Containers using the same arena can be copied and
+ *				swapped freely.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+	typedef T * pointer;
+	typedef const T * const_pointer;
+	typedef T & reference;
+	typedef const T & const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	/*!
+	 *	@brief		The allocator of another type which allocates from the same arena.
+	 */
+	template <typename U>
+	struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	/*!
+	 *	@brief		Constructor -- an allocator which uses the heap.
+	 */
+	ArenaAllocator() : _arena(0x0) {}
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		arena		The arena to allocate from (null for the heap).
+	 */
+	explicit ArenaAllocator(PolygonArena * arena) : _arena(arena) {}
+
+	/*!
+	 *	@brief		Copy constructor (from an allocator of any type).
+	 *
+	 *	@param		other		The allocator to copy.
+	 */
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> & other) : _arena(other.getArena()) {}
+
+	/*!
+	 *	@brief		Reports the arena allocated from (null for the heap).
+	 */
+	PolygonArena * getArena() const { return _arena; }
+
+	/*!
+	 *	@brief		Allocates storage for n objects.
+	 */
+	T * allocate(size_t n, const void * hint = 0x0) {
+		const size_t bytes = n * sizeof(T);
+		return static_cast<T *>(_arena != 0x0 ? _arena->allocate(bytes) : ::operator new(bytes));
+	}
+
+	/*!
+	 *	@brief		Releases storage for n objects.
+	 */
+	void deallocate(T * p, size_t n) {
+		if (_arena != 0x0) {
+			_arena->deallocate(p, n * sizeof(T));
+		}
+		else {
+			::operator delete(p);
+		}
+	}
+
+	/*!
+	 *	@brief		Constructs an object in allocated storage.
+	 */
+	template <typename U, typename... Args>
+	void construct(U * p, Args &&... args) { ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+
+	/*!
+	 *	@brief		Destroys an object in allocated storage.
+	 */
+	template <typename U>
+	void destroy(U * p) { p->~U(); }
+
+	/*!
+	 *	@brief		Reports the address of an object.
+	 */
+	T * address(T & value) const { return &value; }
+
+	/*!
+	 *	@brief		Reports the address of an object.
+	 */
+	const T * address(const T & value) const { return &value; }
+
+	/*!
+	 *	@brief		Reports the largest number of objects which can be allocated.
+	 */
+	size_t max_size() const { return size_t(-1) / sizeof(T); }
+
+	/*!
+	 *	@brief		Reports if storage allocated by one allocator can be released by the
+	 *				other.
+	 */
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> & other) const { return _arena == other.getArena(); }
+
+	/*!
+	 *	@brief		Reports if storage allocated by one allocator can't be released by the
+	 *				other.
+	 */
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U> & other) const { return _arena != other.getArena(); }
+
+private:
+	/*!
+	 *	@brief		The arena allocated from (null for the heap).
+	 */
+	PolygonArena *	_arena;
+};
+
+#endif	// __POLYGON_ARENA_H__
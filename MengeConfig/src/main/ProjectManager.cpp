@@ -0,0 +1,328 @@
+#include "ProjectManager.hpp"
+
+#include "AppLogger.hpp"
+#include "MCException.h"
+#include "SceneViewer.hpp"
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qstandardpaths.h>
+#include <QtCore/qtimer.h>
+#include <QtWidgets/qfiledialog.h>
+#include <QtWidgets/qmessagebox.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ProjectManager
+///////////////////////////////////////////////////////////////////////////////
+
+const int ProjectManager::AUTOSAVE_INTERVAL = 5000;
+
+///////////////////////////////////////////////////////////////////////////////
+
+ProjectManager::ProjectManager(SceneViewer * viewer, QObject * parent) : QObject(parent), _viewer(viewer), _dialogParent(viewer), _timer(0x0), _path(), _recoveryPath(), _lastSettings(), _worker(), _store(), _savedState(), _queuedSettings(), _queuedChanges(), _queuedRetarget(), _retargetError(), _queuedCompact(false), _hasWork(false), _busy(false), _stopping(false) {
+	// The worker emits its signals from its own thread; they are delivered on the GUI thread.
+	connect(this, &ProjectManager::written, this, &ProjectManager::reportWritten);
+	connect(this, &ProjectManager::failed, this, &ProjectManager::reportFailed);
+
+	QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+	dataDir.mkpath(".");
+	_recoveryPath = dataDir.filePath("recovery.mcp");
+	preserveRecovery();
+
+	// The saved state starts out in sync with the (empty) scene.
+	ObstacleChanges discard;
+	_viewer->getProjectChanges(_lastSettings, discard);
+	_savedState._settings = _lastSettings;
+	try {
+		_store.create(_recoveryPath, _savedState);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "Autosave is unavailable: " << e.what() << AppLogger::END_MSG;
+	}
+
+	_worker = std::thread(&ProjectManager::workerLoop, this);
+
+	_timer = new QTimer(this);
+	connect(_timer, &QTimer::timeout, this, &ProjectManager::autosave);
+	_timer->start(AUTOSAVE_INTERVAL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ProjectManager::~ProjectManager() {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	_worker.join();
+	// The worker has flushed the final state; a clean exit leaves nothing to recover.
+	_store.close();
+	ProjectStore::remove(_recoveryPath);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::newProject() {
+	std::unique_lock< std::mutex > lock(_lock);
+	waitForWorker(lock);
+	_viewer->restoreProject(ProjectState());
+	// Discard the changes made by the restoration itself.
+	ObstacleChanges discard;
+	_viewer->getProjectChanges(_lastSettings, discard);
+	_savedState = ProjectState();
+	_savedState._settings = _lastSettings;
+	_path.clear();
+	try {
+		_store.create(_recoveryPath, _savedState);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "Autosave is unavailable: " << e.what() << AppLogger::END_MSG;
+	}
+	AppLogger::logStream << AppLogger::INFO_MSG << "Started a new project" << AppLogger::END_MSG;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::openProject() {
+	QString path = QFileDialog::getOpenFileName(_dialogParent, tr("Open Project"), QFileInfo(_path).absolutePath(), tr("MengeConfig projects (*.mcp);;All files (*.*)"));
+	if (!path.isEmpty()) {
+		openProject(path);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ProjectManager::openProject(const QString & path) {
+	// Anything still queued belongs to the project being closed.
+	autosave();
+	std::unique_lock< std::mutex > lock(_lock);
+	waitForWorker(lock);
+	QElapsedTimer timer;
+	timer.start();
+	ProjectState loaded;
+	try {
+		_store.open(path, loaded);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << e.what() << AppLogger::END_MSG;
+		// Keep autosaving the current project.
+		try {
+			ProjectState current;
+			_store.open(_path.isEmpty() ? _recoveryPath : _path, current);
+		}
+		catch (MCException & e) {
+			AppLogger::logStream << AppLogger::WARN_MSG << "Autosave is unavailable: " << e.what() << AppLogger::END_MSG;
+		}
+		return false;
+	}
+	_savedState = loaded;
+	_viewer->restoreProject(_savedState);
+	ObstacleChanges discard;
+	_viewer->getProjectChanges(_lastSettings, discard);
+	if (_path.isEmpty()) {
+		// The unnamed project's work has been abandoned in favor of the opened project.
+		ProjectStore::remove(_recoveryPath);
+	}
+	_path = path;
+	AppLogger::logStream << AppLogger::INFO_MSG << "Opened project " << path.toStdString() << " (";
+	AppLogger::logStream << _savedState._polygons.size() << " obstacles) in " << timer.elapsed() << " ms";
+	AppLogger::logStream << AppLogger::END_MSG;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::saveProject() {
+	if (_path.isEmpty()) {
+		saveProjectAs();
+	}
+	else {
+		queueChanges(QString(), true);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::saveProjectAs() {
+	QString path = getSavePath();
+	if (path.isEmpty()) return;
+	queueChanges(path, false);
+	std::unique_lock< std::mutex > lock(_lock);
+	waitForWorker(lock);
+	if (_retargetError.isEmpty()) {
+		_path = path;
+	}
+	else {
+		QMessageBox::warning(_dialogParent, tr("Save Project As"), tr("The project could not be saved to %1:\n%2").arg(QDir::toNativeSeparators(path), _retargetError));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ProjectManager::confirmClose() {
+	autosave();
+	bool unsaved = false;
+	{
+		std::unique_lock< std::mutex > lock(_lock);
+		waitForWorker(lock);
+		// A named project's changes are all in its journal now.
+		unsaved = _path.isEmpty() && !_savedState._polygons.empty();
+	}
+	if (!unsaved) return true;
+	QMessageBox::StandardButton choice = QMessageBox::question(_dialogParent, tr("Close Project"), tr("The project has never been saved.  Save it before closing?"), QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel, QMessageBox::Save);
+	if (choice == QMessageBox::Discard) return true;
+	if (choice == QMessageBox::Save) {
+		saveProjectAs();
+		return !_path.isEmpty();
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::autosave() {
+	queueChanges(QString(), false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::reportWritten(QString path, bool compacted) {
+	// Autosaves happen every few seconds; only report the writes the user asked for.
+	if (compacted) {
+		AppLogger::logStream << AppLogger::INFO_MSG << "Saved project " << path.toStdString() << AppLogger::END_MSG;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::reportFailed(QString message) {
+	AppLogger::logStream << AppLogger::ERROR_MSG << "Saving the project failed: " << message.toStdString() << AppLogger::END_MSG;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ProjectManager::queueChanges(const QString & retarget, bool compact) {
+	ProjectSettings settings;
+	ObstacleChanges changes;
+	_viewer->getProjectChanges(settings, changes);
+	if (retarget.isEmpty() && !compact && changes.isEmpty() && settings == _lastSettings) {
+		return false;
+	}
+	_lastSettings = settings;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		if (_hasWork) {
+			// Changes still queued were recorded in the frame of the queued settings.
+			_queuedChanges.translate(_queuedSettings._originX - settings._originX, _queuedSettings._originY - settings._originY);
+		}
+		_queuedSettings = settings;
+		_queuedChanges.merge(changes);
+		if (!retarget.isEmpty()) _queuedRetarget = retarget;
+		_queuedCompact = _queuedCompact || compact;
+		_hasWork = true;
+	}
+	_wake.notify_one();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::waitForWorker(std::unique_lock< std::mutex > & lock) {
+	while (_hasWork || _busy) {
+		_idle.wait(lock);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QString ProjectManager::getSavePath() {
+	return QFileDialog::getSaveFileName(_dialogParent, tr("Save Project As"), QFileInfo(_path).absolutePath(), tr("MengeConfig projects (*.mcp)"));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::preserveRecovery() {
+	if (!QFile::exists(_recoveryPath)) return;
+	QFileInfo info(_recoveryPath);
+	QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+	QString preserved = info.dir().filePath(QString("recovered-%1.mcp").arg(stamp));
+	if (QFile::rename(_recoveryPath, preserved)) {
+		QFile::rename(ProjectStore::journalPath(_recoveryPath), ProjectStore::journalPath(preserved));
+		AppLogger::logStream << AppLogger::WARN_MSG << "The previous session did not exit cleanly; its unsaved work ";
+		AppLogger::logStream << "was preserved in " << preserved.toStdString() << AppLogger::END_MSG;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectManager::workerLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (!_hasWork && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (!_hasWork) return;
+
+		ProjectSettings settings = _queuedSettings;
+		ObstacleChanges changes;
+		changes._changed.swap(_queuedChanges._changed);
+		changes._removed.swap(_queuedChanges._removed);
+		QString retarget;
+		retarget.swap(_queuedRetarget);
+		bool compact = _queuedCompact;
+		_queuedCompact = false;
+		_hasWork = false;
+		_busy = true;
+		lock.unlock();
+
+		// The store and the saved state are only touched by the GUI thread while the worker
+		//	is idle (see waitForWorker()).
+		// The saved polygons follow the scene's origin before the changes (recorded in the
+		//	new frame) are applied.
+		_savedState.setOrigin(settings._originX, settings._originY);
+		_savedState._settings = settings;
+		_savedState.apply(changes);
+		QString retargetError;
+		try {
+			if (!retarget.isEmpty()) {
+				const QString oldPath = _store.getPath();
+				try {
+					_store.create(retarget, _savedState);
+				}
+				catch (MCException & e) {
+					retargetError = QString(e.what());
+					// Keep autosaving where the project was; the saved state (this batch of
+					//	changes included) is written there in full.
+					if (!oldPath.isEmpty()) _store.create(oldPath, _savedState);
+					throw;
+				}
+				if (oldPath == _recoveryPath) ProjectStore::remove(oldPath);
+				emit written(retarget, true);
+			}
+			else if (_store.isOpen()) {
+				if (compact || _store.needsCompaction()) {
+					_store.compact(_savedState);
+					// Routine compactions aren't reported.
+					if (compact) emit written(_store.getPath(), true);
+				}
+				else {
+					_store.append(settings, changes);
+					emit written(_store.getPath(), false);
+				}
+			}
+		}
+		catch (MCException & e) {
+			emit failed(QString(e.what()));
+		}
+
+		lock.lock();
+		if (!retarget.isEmpty()) _retargetError = retargetError;
+		_busy = false;
+		if (!_hasWork) _idle.notify_all();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
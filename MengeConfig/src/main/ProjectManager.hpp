@@ -0,0 +1,287 @@
+/*!
+ *	@file		ProjectManager.hpp
+ *	@brief		Manages the current project: opening, saving and the background autosave.
+ */
+
+#ifndef __PROJECT_MANAGER_H__
+#define	__PROJECT_MANAGER_H__
+
+#include "ProjectState.h"
+#include "ProjectStore.h"
+
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+class QWidget;
+QT_END_NAMESPACE
+class SceneViewer;
+
+/*!
+ *	@brief		Manages the project being edited.
+ *
+ *	The project is saved continuously.  Every few seconds, the GUI thread collects the
+ *	changes made since the last autosave -- copies of the modified polygons, which costs
+ *	time proportional to the size of the change -- and hands them to a worker thread.
+ *	The worker serializes the changes, appends them to the project's journal and forces
+ *	them to the disk; periodically it compacts the journal into the base file.  The GUI
+ *	thread never waits on the disk (except to open a project or to save it under a new
+ *	name).
+ *
+ *	A project which has never been given a name is autosaved to a recovery file in the
+ *	application's data directory.  If the application doesn't exit cleanly, the recovery
+ *	file is preserved at the next launch and can be opened like any other project; a clean
+ *	exit removes it, once confirmClose() has given the user the chance to save the project.
+ */
+class ProjectManager : public QObject {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		viewer		The scene viewer whose contents constitute the project.
+	 *	@param		parent		The optional parent.
+	 */
+	ProjectManager(SceneViewer * viewer, QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor -- waits for the pending changes to be written and removes
+	 *				the recovery file.
+	 */
+	~ProjectManager();
+
+	/*!
+	 *	@brief		Reports the path of the current project (empty if it has never been saved).
+	 */
+	const QString & getPath() const { return _path; }
+
+	/*!
+	 *	@brief		Starts a new, empty project.
+	 */
+	void newProject();
+
+	/*!
+	 *	@brief		Prompts the user for a project file and opens it.
+	 */
+	void openProject();
+
+	/*!
+	 *	@brief		Opens the given project file.
+	 *
+	 *	@param		path		The path to the project file.
+	 *	@returns	True if the project was opened.
+	 */
+	bool openProject(const QString & path);
+
+	/*!
+	 *	@brief		Saves the current project, compacting its journal (prompts for a file
+	 *				name if the project has never been saved).
+	 */
+	void saveProject();
+
+	/*!
+	 *	@brief		Prompts the user for a file name and saves the project to it.  The
+	 *				project only takes the new name once it has been written there; a
+	 *				failure is reported to the user and the project keeps being autosaved
+	 *				where it was.
+	 */
+	void saveProjectAs();
+
+	/*!
+	 *	@brief		Writes the pending changes and, if the project has never been saved but
+	 *				has obstacles, asks the user whether to save it before it is closed.
+	 *
+	 *	@returns	True if the project can be closed, false if the user cancelled.
+	 */
+	bool confirmClose();
+
+	/*!
+	 *	@brief		Collects the changes since the last autosave and queues them to be
+	 *				written.
+	 */
+	void autosave();
+
+	/*!
+	 *	@brief		The time between autosaves (in milliseconds).
+	 */
+	static const int AUTOSAVE_INTERVAL;
+
+signals:
+
+	/*!
+	 *	@brief		Emitted (from the worker thread) when changes have been written.
+	 *
+	 *	@param		path		The path of the written project.
+	 *	@param		compacted	True if the base file was rewritten.
+	 */
+	void written(QString path, bool compacted);
+
+	/*!
+	 *	@brief		Emitted (from the worker thread) when writing has failed.
+	 *
+	 *	@param		message		A description of the failure.
+	 */
+	void failed(QString message);
+
+protected:
+
+	/*!
+	 *	@brief		Reports a successful write in the log.
+	 *
+	 *	@param		path		The path of the written project.
+	 *	@param		compacted	True if the base file was rewritten.
+	 */
+	void reportWritten(QString path, bool compacted);
+
+	/*!
+	 *	@brief		Reports a failed write in the log.
+	 *
+	 *	@param		message		A description of the failure.
+	 */
+	void reportFailed(QString message);
+
+	/*!
+	 *	@brief		Collects the current changes and queues them for the worker.
+	 *
+	 *	@param		retarget	If non-empty, the project is written in full to this path
+	 *							and subsequent changes are written there.
+	 *	@param		compact		If true, the journal is compacted into the base file.
+	 *	@returns	True if anything was queued.
+	 */
+	bool queueChanges(const QString & retarget, bool compact);
+
+	/*!
+	 *	@brief		Blocks until the worker has written everything queued and is idle.
+	 *
+	 *	@param		lock		A lock on _lock; it is held when the function returns.
+	 */
+	void waitForWorker(std::unique_lock< std::mutex > & lock);
+
+	/*!
+	 *	@brief		Prompts the user for the path of a project file to save.
+	 *
+	 *	@returns	The chosen path (empty if the user cancelled).
+	 */
+	QString getSavePath();
+
+	/*!
+	 *	@brief		Preserves the recovery file left by a session which didn't exit
+	 *				cleanly.
+	 */
+	void preserveRecovery();
+
+	/*!
+	 *	@brief		The function executed by the worker thread.
+	 */
+	void workerLoop();
+
+	/*!
+	 *	@brief		The viewer whose contents constitute the project.
+	 */
+	SceneViewer * _viewer;
+
+	/*!
+	 *	@brief		The widget used as the parent of dialogs.
+	 */
+	QWidget * _dialogParent;
+
+	/*!
+	 *	@brief		The timer which triggers autosaves.
+	 */
+	QTimer * _timer;
+
+	/*!
+	 *	@brief		The path of the current project (empty if it has never been saved).
+	 */
+	QString	_path;
+
+	/*!
+	 *	@brief		The path of the recovery file for unnamed projects.
+	 */
+	QString	_recoveryPath;
+
+	/*!
+	 *	@brief		The settings as of the last autosave.
+	 */
+	ProjectSettings	_lastSettings;
+
+	/*!
+	 *	@brief		The worker thread.
+	 */
+	std::thread	_worker;
+
+	/*!
+	 *	@brief		Guards the members shared with the worker (the store, the saved state and
+	 *				the queued work).
+	 */
+	std::mutex	_lock;
+
+	/*!
+	 *	@brief		Signals the worker that there is work (or that it should stop).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		Signals the GUI thread that the worker is idle.
+	 */
+	std::condition_variable	_idle;
+
+	/*!
+	 *	@brief		The project files (used by the worker).
+	 */
+	ProjectStore	_store;
+
+	/*!
+	 *	@brief		The project state as written to the store (used by the worker).
+	 */
+	ProjectState	_savedState;
+
+	/*!
+	 *	@brief		The queued settings.
+	 */
+	ProjectSettings	_queuedSettings;
+
+	/*!
+	 *	@brief		The queued obstacle changes.
+	 */
+	ObstacleChanges	_queuedChanges;
+
+	/*!
+	 *	@brief		The queued path to write the project to (empty if it isn't moving).
+	 */
+	QString	_queuedRetarget;
+
+	/*!
+	 *	@brief		The reason the project couldn't be written to the most recently queued
+	 *				path (empty if it was written there).
+	 */
+	QString	_retargetError;
+
+	/*!
+	 *	@brief		Reports if a compaction has been queued.
+	 */
+	bool	_queuedCompact;
+
+	/*!
+	 *	@brief		Reports if any work has been queued.
+	 */
+	bool	_hasWork;
+
+	/*!
+	 *	@brief		Reports if the worker is writing.
+	 */
+	bool	_busy;
+
+	/*!
+	 *	@brief		Reports if the worker should stop.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __PROJECT_MANAGER_H__
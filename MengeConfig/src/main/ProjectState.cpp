@@ -0,0 +1,101 @@
+#include "ProjectState.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if two vectors have identical components.
+ */
+inline bool sameXYZ(const Vector3 & a, const Vector3 & b) {
+	return a._x == b._x && a._y == b._y && a._z == b._z;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Replaces every record with a shifted copy.
+ *
+ *	@param		records		The records to shift.
+ *	@param		dx			The shift along the x-axis.
+ *	@param		dy			The shift along the y-axis.
+ */
+void translateRecords(PolygonRecordMap & records, double dx, double dy) {
+	if (dx == 0.0 && dy == 0.0) return;
+	for (PolygonRecordMap::iterator itr = records.begin(); itr != records.end(); ++itr) {
+		// Records are shared; the shifted polygon is recorded anew.
+		std::shared_ptr< PolygonRecord > record(new PolygonRecord(*itr->second));
+		for (Vector3 & v : record->_vertices) {
+			v._x = static_cast<float>(v._x + dx);
+			v._y = static_cast<float>(v._y + dy);
+		}
+		itr->second = record;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ObstacleChanges
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleChanges::merge(const ObstacleChanges & changes) {
+	// Identifiers are never reused, so a removal can only follow the polygon's changes.
+	for (PolygonRecordMap::const_iterator itr = changes._changed.begin(); itr != changes._changed.end(); ++itr) {
+		_changed[itr->first] = itr->second;
+	}
+	for (size_t id : changes._removed) {
+		_changed.erase(id);
+		_removed.push_back(id);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ObstacleChanges::translate(double dx, double dy) {
+	translateRecords(_changed, dx, dy);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ProjectSettings
+///////////////////////////////////////////////////////////////////////////////
+
+// The defaults mirror the initial state of the GLWidget and the ObstacleContext.
+ProjectSettings::ProjectSettings() : _originX(0.0), _originY(0.0), _gridOriginX(0.f), _gridOriginY(0.f), _gridWidth(100.f), _gridHeight(100.f), _gridMajorDist(5.f), _gridMinorCount(4), _gridActive(true), _gridHSnap(false), _gridVSnap(false), _cameraPosition(0.f, 0.f, 10.f), _cameraTarget(0.f, 0.f, 0.f), _cameraPerspective(true), _obstacleContextActive(false), _obstacleVerb(0), _editMode(1) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ProjectSettings::operator==(const ProjectSettings & settings) const {
+	return _originX == settings._originX && _originY == settings._originY &&
+		_gridOriginX == settings._gridOriginX && _gridOriginY == settings._gridOriginY &&
+		_gridWidth == settings._gridWidth && _gridHeight == settings._gridHeight &&
+		_gridMajorDist == settings._gridMajorDist && _gridMinorCount == settings._gridMinorCount &&
+		_gridActive == settings._gridActive && _gridHSnap == settings._gridHSnap &&
+		_gridVSnap == settings._gridVSnap && sameXYZ(_cameraPosition, settings._cameraPosition) &&
+		sameXYZ(_cameraTarget, settings._cameraTarget) && _cameraPerspective == settings._cameraPerspective &&
+		_obstacleContextActive == settings._obstacleContextActive &&
+		_obstacleVerb == settings._obstacleVerb && _editMode == settings._editMode;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ProjectState
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectState::apply(const ObstacleChanges & changes) {
+	for (PolygonRecordMap::const_iterator itr = changes._changed.begin(); itr != changes._changed.end(); ++itr) {
+		_polygons[itr->first] = itr->second;
+	}
+	for (size_t id : changes._removed) {
+		_polygons.erase(id);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectState::setOrigin(double x, double y) {
+	if (x == _settings._originX && y == _settings._originY) return;
+	translateRecords(_polygons, _settings._originX - x, _settings._originY - y);
+	_settings._originX = x;
+	_settings._originY = y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,237 @@
+/*!
+ *	@file		ProjectState.h
+ *	@brief		The in-memory representation of a MengeConfig project: the state which
+ *				is written to, and read from, a project file.
+ */
+
+#ifndef __PROJECT_STATE_H__
+#define	__PROJECT_STATE_H__
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+/*!
+ *	@brief		An immutable copy of a single polygon of the live obstacle set.
+ *
+ *	Records are shared (never copied) between the interactive obstacle set's snapshots,
+ *	the autosave worker and the project file writer.  A polygon which changes is
+ *	recorded anew; its previous record is released when nothing refers to it.
+ */
+struct PolygonRecord {
+	/*!
+	 *	@brief		The identifier of the polygon in its obstacle set.
+	 */
+	size_t	_id;
+
+	/*!
+	 *	@brief		The polygon's winding (a GLPolygon::Winding value).
+	 */
+	int	_winding;
+
+	/*!
+	 *	@brief		The polygon's vertices.
+	 */
+	std::vector<Vector3>	_vertices;
+};
+
+/*!
+ *	@brief		A shared, read-only polygon record.
+ */
+typedef std::shared_ptr< const PolygonRecord > PolygonRecordPtr;
+
+/*!
+ *	@brief		The polygons of an obstacle set, keyed by their identifiers.
+ */
+typedef std::map< size_t, PolygonRecordPtr > PolygonRecordMap;
+
+/*!
+ *	@brief		The changes to an obstacle set since the last time they were collected.
+ */
+struct ObstacleChanges {
+	/*!
+	 *	@brief		Reports if there are no changes.
+	 */
+	bool isEmpty() const { return _changed.empty() && _removed.empty(); }
+
+	/*!
+	 *	@brief		Clears the changes.
+	 */
+	void clear() { _changed.clear(); _removed.clear(); }
+
+	/*!
+	 *	@brief		Folds later changes into these changes.
+	 *
+	 *	@param		changes		The changes which happened after these changes.
+	 */
+	void merge(const ObstacleChanges & changes);
+
+	/*!
+	 *	@brief		Shifts the changed polygons (when the scene's origin moves while the
+	 *				changes are waiting to be saved).
+	 *
+	 *	@param		dx		The shift along the x-axis.
+	 *	@param		dy		The shift along the y-axis.
+	 */
+	void translate(double dx, double dy);
+
+	/*!
+	 *	@brief		The polygons which were added or modified (keyed by identifier).
+	 */
+	PolygonRecordMap	_changed;
+
+	/*!
+	 *	@brief		The identifiers of the polygons which were removed.
+	 */
+	std::vector<size_t>	_removed;
+};
+
+/*!
+ *	@brief		The application state saved in a project alongside the obstacles: the
+ *				reference grid, the camera and the obstacle context.
+ */
+struct ProjectSettings {
+	/*!
+	 *	@brief		Constructor -- the state of a newly launched application.
+	 */
+	ProjectSettings();
+
+	/*!
+	 *	@brief		Reports if the two sets of settings are identical.
+	 *
+	 *	@param		settings		The settings to compare with.
+	 */
+	bool operator==(const ProjectSettings & settings) const;
+
+	/*!
+	 *	@brief		Reports if the two sets of settings differ.
+	 *
+	 *	@param		settings		The settings to compare with.
+	 */
+	bool operator!=(const ProjectSettings & settings) const { return !(*this == settings); }
+
+	/*!
+	 *	@brief		The x-position, in world coordinates, of the origin of the scene's local
+	 *				frame (see WorldFrame).
+	 */
+	double	_originX;
+
+	/*!
+	 *	@brief		The y-position, in world coordinates, of the origin of the scene's local
+	 *				frame.
+	 */
+	double	_originY;
+
+	/*!
+	 *	@brief		The x-position of the reference grid's origin.
+	 */
+	float	_gridOriginX;
+
+	/*!
+	 *	@brief		The y-position of the reference grid's origin.
+	 */
+	float	_gridOriginY;
+
+	/*!
+	 *	@brief		The width of the reference grid.
+	 */
+	float	_gridWidth;
+
+	/*!
+	 *	@brief		The height of the reference grid.
+	 */
+	float	_gridHeight;
+
+	/*!
+	 *	@brief		The distance between the reference grid's major lines.
+	 */
+	float	_gridMajorDist;
+
+	/*!
+	 *	@brief		The number of minor lines between major lines.
+	 */
+	unsigned int	_gridMinorCount;
+
+	/*!
+	 *	@brief		Reports if the reference grid is active.
+	 */
+	bool	_gridActive;
+
+	/*!
+	 *	@brief		Reports if horizontal grid snapping is enabled.
+	 */
+	bool	_gridHSnap;
+
+	/*!
+	 *	@brief		Reports if vertical grid snapping is enabled.
+	 */
+	bool	_gridVSnap;
+
+	/*!
+	 *	@brief		The position of the camera.
+	 */
+	Vector3	_cameraPosition;
+
+	/*!
+	 *	@brief		The point the camera looks at.
+	 */
+	Vector3	_cameraTarget;
+
+	/*!
+	 *	@brief		Reports if the camera uses a perspective (as opposed to orthographic)
+	 *				projection.
+	 */
+	bool	_cameraPerspective;
+
+	/*!
+	 *	@brief		Reports if the obstacle context was the active context.
+	 */
+	bool	_obstacleContextActive;
+
+	/*!
+	 *	@brief		The obstacle context's operation (an ObstacleContext::ObstacleVerb value).
+	 */
+	int	_obstacleVerb;
+
+	/*!
+	 *	@brief		The obstacle editing mode (an EditPolygonContext::EditMode value).
+	 */
+	int	_editMode;
+};
+
+/*!
+ *	@brief		The complete state of a project.
+ */
+struct ProjectState {
+	/*!
+	 *	@brief		Applies obstacle changes to the state.
+	 *
+	 *	@param		changes		The changes to apply.
+	 */
+	void apply(const ObstacleChanges & changes);
+
+	/*!
+	 *	@brief		Moves the origin of the scene's local frame; the polygons, which are
+	 *				stored in local coordinates, are shifted into the new frame the same way
+	 *				the obstacle set shifts them (see LiveObstacleSet::translate()).
+	 *
+	 *	@param		x		The x-position of the new origin in world coordinates.
+	 *	@param		y		The y-position of the new origin in world coordinates.
+	 */
+	void setOrigin(double x, double y);
+
+	/*!
+	 *	@brief		The project settings.
+	 */
+	ProjectSettings	_settings;
+
+	/*!
+	 *	@brief		The polygons of the obstacle set.
+	 */
+	PolygonRecordMap	_polygons;
+};
+
+#endif	// __PROJECT_STATE_H__
@@ -0,0 +1,472 @@
+#include "ProjectStore.h"
+#include "MCException.h"
+
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdatetime.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <Windows.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+// Identifies a project base file ("MCPF").
+const quint32 FILE_MAGIC = 0x4D435046;
+// The version of the project file format; version 2 added the origin record.
+const quint32 FILE_VERSION = 2;
+// The oldest version of the project file format which can be read.
+const quint32 MIN_FILE_VERSION = 1;
+// Identifies the start of a segment ("MCSG").
+const quint32 SEGMENT_MAGIC = 0x4D435347;
+// The size of a segment's header: magic, generation, payload size and checksum.
+const qint64 SEGMENT_HEADER_SIZE = 4 * sizeof(quint32);
+// Journals smaller than this (in bytes) are only compacted when they hold too many segments.
+const qint64 MIN_COMPACT_SIZE = 1 << 20;
+
+// The types of the records in a segment's payload.
+const quint8 SETTINGS_RECORD = 1;
+const quint8 POLYGON_RECORD = 2;
+const quint8 REMOVE_RECORD = 3;
+// Written after every settings record (version 2); older files have their origin at zero.
+const quint8 ORIGIN_RECORD = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Computes the 32-bit FNV-1a hash of a block of data.
+ *
+ *	@param		data		The data to hash.
+ *	@returns	The hash value.
+ */
+quint32 checksum(const QByteArray & data) {
+	quint32 hash = 2166136261u;
+	const unsigned char * bytes = reinterpret_cast<const unsigned char *>(data.constData());
+	const int SIZE = data.size();
+	for (int i = 0; i < SIZE; ++i) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Prepares a stream to read or write the project format.
+ *
+ *	@param		stream		The stream to configure.
+ */
+void configureStream(QDataStream & stream) {
+	stream.setVersion(QDataStream::Qt_5_5);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Writes a settings record, followed by the origin record.
+ *
+ *	@param		out			The stream to write to.
+ *	@param		settings	The settings to write.
+ */
+void writeSettings(QDataStream & out, const ProjectSettings & settings) {
+	out << SETTINGS_RECORD;
+	out << settings._gridOriginX << settings._gridOriginY << settings._gridWidth << settings._gridHeight;
+	out << settings._gridMajorDist << quint32(settings._gridMinorCount);
+	out << settings._gridActive << settings._gridHSnap << settings._gridVSnap;
+	out << settings._cameraPosition._x << settings._cameraPosition._y << settings._cameraPosition._z;
+	out << settings._cameraTarget._x << settings._cameraTarget._y << settings._cameraTarget._z;
+	out << settings._cameraPerspective;
+	out << settings._obstacleContextActive << qint32(settings._obstacleVerb) << qint32(settings._editMode);
+	// The origin is the only value which needs double precision.
+	out.setFloatingPointPrecision(QDataStream::DoublePrecision);
+	out << ORIGIN_RECORD << settings._originX << settings._originY;
+	out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads the body of a settings record.
+ *
+ *	@param		in			The stream to read from.
+ *	@param		settings	The read settings.
+ */
+void readSettings(QDataStream & in, ProjectSettings & settings) {
+	quint32 minorCount;
+	qint32 verb, mode;
+	in >> settings._gridOriginX >> settings._gridOriginY >> settings._gridWidth >> settings._gridHeight;
+	in >> settings._gridMajorDist >> minorCount;
+	in >> settings._gridActive >> settings._gridHSnap >> settings._gridVSnap;
+	in >> settings._cameraPosition._x >> settings._cameraPosition._y >> settings._cameraPosition._z;
+	in >> settings._cameraTarget._x >> settings._cameraTarget._y >> settings._cameraTarget._z;
+	in >> settings._cameraPerspective;
+	in >> settings._obstacleContextActive >> verb >> mode;
+	settings._gridMinorCount = minorCount;
+	settings._obstacleVerb = verb;
+	settings._editMode = mode;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Writes a polygon record.
+ *
+ *	@param		out			The stream to write to.
+ *	@param		poly		The polygon to write.
+ */
+void writePolygon(QDataStream & out, const PolygonRecord & poly) {
+	out << POLYGON_RECORD << quint64(poly._id) << qint32(poly._winding) << quint32(poly._vertices.size());
+	for (const Vector3 & v : poly._vertices) {
+		out << v._x << v._y << v._z;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads the body of a polygon record.
+ *
+ *	@param		in			The stream to read from.
+ *	@returns	The read polygon.
+ */
+PolygonRecordPtr readPolygon(QDataStream & in) {
+	quint64 id;
+	qint32 winding;
+	quint32 count;
+	in >> id >> winding >> count;
+	std::shared_ptr< PolygonRecord > poly(new PolygonRecord());
+	poly->_id = size_t(id);
+	poly->_winding = winding;
+	// Don't trust the count to size the allocation; a damaged count simply runs out of data.
+	for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+		float x, y, z;
+		in >> x >> y >> z;
+		poly->_vertices.push_back(Vector3(x, y, z));
+	}
+	return poly;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Applies the records of a segment's payload to a project state.
+ *
+ *	@param		payload		The payload of the segment.
+ *	@param		state		The state to modify.
+ *	@returns	True if the payload was well formed.
+ */
+bool applyPayload(const QByteArray & payload, ProjectState & state) {
+	QDataStream in(payload);
+	configureStream(in);
+	while (!in.atEnd()) {
+		quint8 tag;
+		in >> tag;
+		if (tag == SETTINGS_RECORD) {
+			readSettings(in, state._settings);
+		}
+		else if (tag == POLYGON_RECORD) {
+			PolygonRecordPtr poly = readPolygon(in);
+			state._polygons[poly->_id] = poly;
+		}
+		else if (tag == REMOVE_RECORD) {
+			quint64 id;
+			in >> id;
+			state._polygons.erase(size_t(id));
+		}
+		else if (tag == ORIGIN_RECORD) {
+			// Moving the origin isn't journaled as changes to the polygons; the polygons
+			//	recorded so far are shifted into the new frame here.
+			double x, y;
+			in.setFloatingPointPrecision(QDataStream::DoublePrecision);
+			in >> x >> y;
+			in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+			state.setOrigin(x, y);
+		}
+		else {
+			return false;
+		}
+		if (in.status() != QDataStream::Ok) return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Writes a segment.
+ *
+ *	@param		file			The file to write to (at its current position).
+ *	@param		generation		The generation of the base file the segment belongs to.
+ *	@param		payload			The segment's records.
+ *	@returns	True if the segment was written.
+ */
+bool writeSegment(QFile & file, quint32 generation, const QByteArray & payload) {
+	QByteArray header;
+	QDataStream out(&header, QIODevice::WriteOnly);
+	configureStream(out);
+	out << SEGMENT_MAGIC << generation << quint32(payload.size()) << checksum(payload);
+	// The header and payload are written together so a torn write is caught by the checksum.
+	return file.write(header + payload) == header.size() + payload.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reads a segment.
+ *
+ *	@param		file			The file to read from (at its current position).
+ *	@param		generation		The generation of the base file the segment belongs to.
+ *	@param		payload			The segment's records.
+ *	@returns	True if a complete, intact segment was read.
+ */
+bool readSegment(QFile & file, quint32 & generation, QByteArray & payload) {
+	QByteArray header = file.read(SEGMENT_HEADER_SIZE);
+	if (header.size() != SEGMENT_HEADER_SIZE) return false;
+	QDataStream in(header);
+	configureStream(in);
+	quint32 magic, size, sum;
+	in >> magic >> generation >> size >> sum;
+	if (magic != SEGMENT_MAGIC || qint64(size) > file.size() - file.pos()) return false;
+	payload = file.read(size);
+	return payload.size() == int(size) && checksum(payload) == sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Forces the written contents of the file to the disk.
+ *
+ *	@param		file		The file to synchronize.
+ *	@returns	True if the contents reached the disk.
+ */
+bool syncFile(QFile & file) {
+	if (!file.flush()) return false;
+#ifdef _WIN32
+	return _commit(file.handle()) == 0;
+#else
+	return fsync(file.handle()) == 0;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Atomically replaces one file with another.
+ *
+ *	@param		src		The path of the replacement file.
+ *	@param		dst		The path of the file to replace.
+ *	@returns	True if the file was replaced.
+ */
+bool replaceFile(const QString & src, const QString & dst) {
+#ifdef _WIN32
+	return MoveFileExW((LPCWSTR)src.utf16(), (LPCWSTR)dst.utf16(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return ::rename(QFile::encodeName(src).constData(), QFile::encodeName(dst).constData()) == 0;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Writes a complete project state as a base file.
+ *
+ *	The file is written next to its destination, forced to the disk and then moved into
+ *	place, so the destination always holds a complete base file.
+ *
+ *	@param		path			The path to the base file.
+ *	@param		generation		The generation of the new base file.
+ *	@param		state			The state to write.
+ *	@returns	The size of the written file (in bytes).
+ *	@throws		MCException if the file can't be written.
+ */
+qint64 writeBase(const QString & path, quint32 generation, const ProjectState & state) {
+	QByteArray payload;
+	{
+		QDataStream out(&payload, QIODevice::WriteOnly);
+		configureStream(out);
+		writeSettings(out, state._settings);
+		for (PolygonRecordMap::const_iterator itr = state._polygons.begin(); itr != state._polygons.end(); ++itr) {
+			writePolygon(out, *itr->second);
+		}
+	}
+	const QString tmpPath = path + ".tmp";
+	QFile file(tmpPath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		throw MCException("Unable to write the project file " + tmpPath.toStdString() + ": " + file.errorString().toStdString());
+	}
+	QByteArray header;
+	QDataStream out(&header, QIODevice::WriteOnly);
+	configureStream(out);
+	out << FILE_MAGIC << FILE_VERSION;
+	bool written = file.write(header) == header.size() && writeSegment(file, generation, payload) && syncFile(file);
+	const qint64 size = file.size();
+	file.close();
+	if (!written || !replaceFile(tmpPath, path)) {
+		QFile::remove(tmpPath);
+		throw MCException("Unable to write the project file " + path.toStdString());
+	}
+	return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ProjectStore
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t ProjectStore::MAX_SEGMENTS = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+
+ProjectStore::ProjectStore() : _path(), _journal(), _generation(0), _baseSize(0), _segmentCount(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::open(const QString & path, ProjectState & state) {
+	close();
+	QFile base(path);
+	if (!base.open(QIODevice::ReadOnly)) {
+		throw MCException("Unable to open the project file " + path.toStdString() + ": " + base.errorString().toStdString());
+	}
+	QDataStream in(&base);
+	configureStream(in);
+	quint32 magic = 0;
+	quint32 version = 0;
+	in >> magic >> version;
+	QByteArray payload;
+	quint32 generation;
+	state = ProjectState();
+	if (magic != FILE_MAGIC || version < MIN_FILE_VERSION || version > FILE_VERSION || !readSegment(base, generation, payload) ||
+		!applyPayload(payload, state)) {
+		throw MCException("The file " + path.toStdString() + " is not a valid project file");
+	}
+	_baseSize = base.size();
+	_generation = generation;
+
+	// Replay the journal up to the first segment which is torn or belongs to another base.
+	qint64 validSize = 0;
+	QFile journal(journalPath(path));
+	if (journal.open(QIODevice::ReadOnly)) {
+		while (readSegment(journal, generation, payload) && generation == _generation) {
+			if (!applyPayload(payload, state)) break;
+			validSize = journal.pos();
+			++_segmentCount;
+		}
+		journal.close();
+	}
+	_path = path;
+	if (version < FILE_VERSION) {
+		// Builds which read the older version would stop replaying at the records this one
+		//	journals (and truncate the rest); the file is upgraded before anything is
+		//	appended so they refuse it instead.
+		_baseSize = writeBase(path, _generation + 1, state);
+		++_generation;
+		openJournal(0);
+	}
+	else {
+		openJournal(validSize);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::create(const QString & path, const ProjectState & state) {
+	close();
+	// The generation only has to differ from that of any journal left behind.
+	const quint32 generation = quint32(QDateTime::currentMSecsSinceEpoch());
+	QFile::remove(journalPath(path));
+	_baseSize = writeBase(path, generation, state);
+	_generation = generation;
+	_path = path;
+	openJournal(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::append(const ProjectSettings & settings, const ObstacleChanges & changes) {
+	if (!isOpen()) throw MCException("Appending to a project store which isn't open");
+	QByteArray payload;
+	{
+		QDataStream out(&payload, QIODevice::WriteOnly);
+		configureStream(out);
+		writeSettings(out, settings);
+		for (PolygonRecordMap::const_iterator itr = changes._changed.begin(); itr != changes._changed.end(); ++itr) {
+			writePolygon(out, *itr->second);
+		}
+		for (size_t id : changes._removed) {
+			out << REMOVE_RECORD << quint64(id);
+		}
+	}
+	const qint64 end = _journal.size();
+	if (!writeSegment(_journal, _generation, payload) || !syncFile(_journal)) {
+		// Don't leave a partial segment for later segments to be appended to.
+		_journal.resize(end);
+		_journal.seek(end);
+		throw MCException("Unable to write to the project journal " + _journal.fileName().toStdString() + ": " + _journal.errorString().toStdString());
+	}
+	++_segmentCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::compact(const ProjectState & state) {
+	if (!isOpen()) throw MCException("Compacting a project store which isn't open");
+	_baseSize = writeBase(_path, _generation + 1, state);
+	++_generation;
+	// The journal's segments now belong to the old generation; they are ignored even if the
+	//	truncation doesn't happen.
+	openJournal(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ProjectStore::needsCompaction() const {
+	if (!isOpen()) return false;
+	const qint64 size = _journal.size();
+	return _segmentCount >= MAX_SEGMENTS || (size > MIN_COMPACT_SIZE && size > _baseSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::close() {
+	if (_journal.isOpen()) _journal.close();
+	_path.clear();
+	_generation = 0;
+	_baseSize = 0;
+	_segmentCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::remove(const QString & path) {
+	QFile::remove(journalPath(path));
+	QFile::remove(path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QString ProjectStore::journalPath(const QString & path) {
+	return path + ".journal";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ProjectStore::openJournal(qint64 truncateAt) {
+	if (_journal.isOpen()) _journal.close();
+	_journal.setFileName(journalPath(_path));
+	if (!_journal.open(QIODevice::ReadWrite) || !_journal.resize(truncateAt) || !_journal.seek(truncateAt)) {
+		throw MCException("Unable to open the project journal " + _journal.fileName().toStdString() + ": " + _journal.errorString().toStdString());
+	}
+	if (truncateAt == 0) _segmentCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,159 @@
+/*!
+ *	@file		ProjectStore.h
+ *	@brief		The on-disk representation of a project: a base file and an append-only
+ *				journal of changes.
+ */
+
+#ifndef __PROJECT_STORE_H__
+#define	__PROJECT_STORE_H__
+
+#include "ProjectState.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qstring.h>
+
+/*!
+ *	@brief		Reads and writes a project file.
+ *
+ *	A project is stored in two files.  The base file (e.g., scene.mcp) holds the complete
+ *	project state as of the last compaction.  The journal (scene.mcp.journal) holds the
+ *	segments appended since then; each segment records the settings and the polygons which
+ *	changed (or were removed) since the previous segment.  Appending a segment costs time
+ *	proportional to the size of the change, not the size of the project.
+ *
+ *	Every segment carries a checksum, so a segment torn by a crash is detected and
+ *	discarded (along with anything after it).  Every segment also carries the generation
+ *	of the base file it extends; compaction writes a new base file (of the next generation)
+ *	next to the old one, replaces the old one and only then empties the journal.  A crash
+ *	at any point of a compaction leaves either the old base and its journal or the new base
+ *	and a journal whose stale segments are ignored.
+ *
+ *	Writes are forced to the disk before the operations return.  The store does no
+ *	locking; it is meant to be driven by a single (worker) thread.  Errors are reported by
+ *	throwing an MCException.
+ */
+class ProjectStore {
+public:
+	/*!
+	 *	@brief		Constructor -- the store is not attached to any file.
+	 */
+	ProjectStore();
+
+	/*!
+	 *	@brief		Reports if the store is attached to a file.
+	 */
+	bool isOpen() const { return !_path.isEmpty(); }
+
+	/*!
+	 *	@brief		Reports the path to the base file (empty if the store isn't attached).
+	 */
+	const QString & getPath() const { return _path; }
+
+	/*!
+	 *	@brief		Reads a project and attaches the store to its files.  A project written
+	 *				in an older version of the format is compacted into the current one.
+	 *
+	 *	@param		path		The path to the project's base file.
+	 *	@param		state		The project's state is written here.
+	 *	@throws		MCException if the base file can't be read.
+	 */
+	void open(const QString & path, ProjectState & state);
+
+	/*!
+	 *	@brief		Writes a complete project to the given path (replacing any project which
+	 *				is already there) and attaches the store to it.
+	 *
+	 *	@param		path		The path to the project's base file.
+	 *	@param		state		The project state to write.
+	 *	@throws		MCException if the files can't be written.
+	 */
+	void create(const QString & path, const ProjectState & state);
+
+	/*!
+	 *	@brief		Appends a segment to the journal of the attached project.
+	 *
+	 *	@param		settings		The current project settings.
+	 *	@param		changes			The obstacle changes since the last segment.
+	 *	@throws		MCException if the segment can't be written.
+	 */
+	void append(const ProjectSettings & settings, const ObstacleChanges & changes);
+
+	/*!
+	 *	@brief		Replaces the attached project's base file with the given state and empties
+	 *				its journal.
+	 *
+	 *	@param		state		The complete project state (i.e., the base state with all of
+	 *							the journal's segments applied).
+	 *	@throws		MCException if the files can't be written.
+	 */
+	void compact(const ProjectState & state);
+
+	/*!
+	 *	@brief		Reports if the journal has grown enough that it should be compacted.
+	 *
+	 *	The journal is compacted when it holds many segments or when replaying it would
+	 *	cost more than reading the base file.
+	 */
+	bool needsCompaction() const;
+
+	/*!
+	 *	@brief		Detaches the store from its files.
+	 */
+	void close();
+
+	/*!
+	 *	@brief		Deletes the files of the project at the given path.
+	 *
+	 *	@param		path		The path to the project's base file.
+	 */
+	static void remove(const QString & path);
+
+	/*!
+	 *	@brief		Reports the path of the journal belonging to the given base file.
+	 *
+	 *	@param		path		The path to the project's base file.
+	 */
+	static QString journalPath(const QString & path);
+
+	/*!
+	 *	@brief		The maximum number of segments in the journal before it is compacted.
+	 */
+	static const size_t MAX_SEGMENTS;
+
+protected:
+
+	/*!
+	 *	@brief		Opens the journal for appending.
+	 *
+	 *	@param		truncateAt		The journal is truncated to this many bytes (discarding
+	 *								stale or torn segments).
+	 */
+	void openJournal(qint64 truncateAt);
+
+	/*!
+	 *	@brief		The path to the project's base file.
+	 */
+	QString	_path;
+
+	/*!
+	 *	@brief		The open journal.
+	 */
+	QFile	_journal;
+
+	/*!
+	 *	@brief		The generation of the base file.
+	 */
+	quint32	_generation;
+
+	/*!
+	 *	@brief		The size of the base file (in bytes).
+	 */
+	qint64	_baseSize;
+
+	/*!
+	 *	@brief		The number of segments in the journal.
+	 */
+	size_t	_segmentCount;
+};
+
+#endif	// __PROJECT_STORE_H__
@@ -1,6 +1,8 @@
 #include "QtContext.h"
 #include "ContextManager.hpp"
 
+#include <QtWidgets/qwidget.h>
+
 #include <cassert>
 
 
@@ -8,7 +10,11 @@
 //						Implementation of QtContext
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-QtContext::QtContext() {
+const unsigned int QtContext::ALL_INPUT = (1u << INPUT_TYPE_COUNT) - 1;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+QtContext::QtContext() : _contextWidget(0x0), _priority(0), _inputMask(ALL_INPUT), _drawLayer(TOOL_LAYER) {
 	ContextManager * mgr = ContextManager::instance();
 	size_t id = mgr->registerContext(this);
 	assert(id != 0 && "Context registration produced invalid id");
@@ -17,8 +23,10 @@ QtContext::QtContext() {
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 QtContext::~QtContext() {
+	// Unregistering first lets observers (e.g., the tool properties) release the widget
+	//	before it is destroyed.
 	ContextManager::instance()->unregisterContext(this);
-	// TOOD: Need to handle the widget that belongs to this context.
+	delete _contextWidget;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -29,4 +37,12 @@ void QtContext::drawGL(int vWidth, int vHeight) {
 	drawUIGL(vWidth, vHeight);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void QtContext::setDispatch(int priority, unsigned int inputMask, DrawLayer layer) {
+	_priority = priority;
+	_inputMask = inputMask;
+	_drawLayer = layer;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
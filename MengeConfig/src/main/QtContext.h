@@ -26,6 +26,39 @@ class GLWidget;
  */
 class QtContext : public Menge::SceneGraph::Context {
 public:
+	/*!
+	 *	@brief		The types of input a context can handle.
+	 */
+	enum InputType {
+		MOUSE_INPUT,		/// Mouse button and motion events.
+		WHEEL_INPUT,		/// Mouse wheel events.
+		KEY_INPUT,			/// Keyboard events.
+		INPUT_TYPE_COUNT	/// The number of input types.
+	};
+
+	/*!
+	 *	@brief		The layers in which contexts draw; the layers are drawn in increasing
+	 *				order.
+	 */
+	enum DrawLayer {
+		TOOL_LAYER,			/// The active tool's elements.
+		OVERLAY_LAYER,		/// Elements drawn over the tool's (e.g., measurements).
+		DRAW_LAYER_COUNT	/// The number of draw layers.
+	};
+
+	/*!
+	 *	@brief		The input mask of a context which handles every type of input.
+	 */
+	static const unsigned int ALL_INPUT;
+
+	/*!
+	 *	@brief		Creates the input mask bit of an input type.
+	 *
+	 *	@param		type		The input type.
+	 *	@returns	The input type's bit.
+	 */
+	static unsigned int inputBit(InputType type) { return 1u << type; }
+
 	/*!
 	 *	@brief		Default constructor.
 	 */
@@ -44,6 +77,14 @@ public:
 	 */
 	virtual void drawGL(int vWidth, int vHeight);
 
+	/*!
+	 *	@brief		Draws the context's pickable elements for selection.
+	 *
+	 *	The elements are drawn with colors encoding their identifiers (see PickBuffer).
+	 *	The view is responsible for binding the pick buffer and setting the camera.
+	 */
+	void drawSelectGL() { draw3DGL(true); }
+
 	/*!
 	 *	@brief		Give the context the opportunity to respond to a mouse
 	 *				event.
@@ -83,9 +124,66 @@ public:
 	 *				The main application can choose to populate a tool window with this widget.  It contains
 	 *				buttons and settings to interact with or change state in the context.
 	 *
-	 *	@returns	A pointer to the tool widget for this context.
+	 *	@returns	A pointer to the tool widget for this context (null if it has none).
+	 */
+	QWidget * getContextWidget() const { return _contextWidget; }
+
+	/*!
+	 *	@brief		Reports the context's priority; a context on the ContextManager's stack
+	 *				is offered input before the contexts with lower priority.
+	 */
+	int getPriority() const { return _priority; }
+
+	/*!
+	 *	@brief		Reports the types of input the context handles (a bitwise union of
+	 *				inputBit() values); the context is never offered the other types.
+	 */
+	unsigned int getInputMask() const { return _inputMask; }
+
+	/*!
+	 *	@brief		Reports the layer in which the context draws.
+	 */
+	DrawLayer getDrawLayer() const { return _drawLayer; }
+
+protected:
+	/*!
+	 *	@brief		Sets the control widget associated with this context.  The context takes
+	 *				ownership of the widget; it is destroyed with the context.
+	 *
+	 *	@param		widget		The context's widget.
+	 */
+	void setContextWidget(QWidget * widget) { _contextWidget = widget; }
+
+	/*!
+	 *	@brief		Declares how the context takes part in the ContextManager's stack.  It
+	 *				must be called before the context is activated or pushed.
+	 *
+	 *	@param		priority		The context's priority (see getPriority()).
+	 *	@param		inputMask		The types of input the context handles.
+	 *	@param		layer			The layer in which the context draws.
+	 */
+	void setDispatch(int priority, unsigned int inputMask, DrawLayer layer);
+
+private:
+	/*!
+	 *	@brief		The control widget associated with this context.
+	 */
+	QWidget * _contextWidget;
+
+	/*!
+	 *	@brief		The context's priority.
+	 */
+	int	_priority;
+
+	/*!
+	 *	@brief		The types of input the context handles.
+	 */
+	unsigned int	_inputMask;
+
+	/*!
+	 *	@brief		The layer in which the context draws.
 	 */
-	virtual QWidget * getContextWidget() { return 0x0; }
+	DrawLayer	_drawLayer;
 };
 
 /*!
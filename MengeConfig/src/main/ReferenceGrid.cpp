@@ -1,17 +1,31 @@
 #include "ReferenceGrid.h"
+#include "BatchOps.h"
 
 #include <iostream>
+#include <math.h>
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //						Implementation of ReferenceGrid
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+const float ReferenceGrid::MIN_LINE_PIXELS = 8.f;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const int ReferenceGrid::MAX_LEVELS = 6;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 ReferenceGrid::ReferenceGrid()
 {
 	_originX = _originY = 0.f;
 	_width = _height = 1.f;
 	_minorCount = 0;
 	_majorDist = 0;
+	_cellSize = 0;
+	_viewScale = 0.f;
+	_levelSpacing = 0.f;
+	_levelWeight = 1.f;
 }
 
 
@@ -39,43 +53,85 @@ void ReferenceGrid::setSize(float w, float h) {
 
 void ReferenceGrid::setMinorCount(unsigned int count) {
 	_minorCount = count;
+	updateCellSize();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void ReferenceGrid::setMajorDist(float dist) {
 	_majorDist = dist;
+	updateCellSize();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void ReferenceGrid::updateCellSize() {
+	_cellSize = _majorDist / (_minorCount + 1);
+	setViewScale(_viewScale);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int ReferenceGrid::getLevelFactor() const {
+	// Without minor lines, each level halves the next coarser one.
+	return _minorCount > 0 ? _minorCount + 1 : 2;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ReferenceGrid::setViewScale(float worldPerPixel) {
+	_viewScale = worldPerPixel;
+	const float oldSpacing = _levelSpacing;
+	_levelSpacing = _cellSize;
+	_levelWeight = 1.f;
+	if (_cellSize > 0.f && worldPerPixel > 0.f) {
+		const float factor = (float)getLevelFactor();
+		const float minSpacing = MIN_LINE_PIXELS * worldPerPixel;
+		int level = 0;
+		while (_levelSpacing < minSpacing && level < MAX_LEVELS) {
+			_levelSpacing *= factor;
+			++level;
+		}
+		while (_levelSpacing / factor >= minSpacing && level > -MAX_LEVELS) {
+			_levelSpacing /= factor;
+			--level;
+		}
+		const float weight = (_levelSpacing - minSpacing) / (minSpacing * (factor - 1.f));
+		_levelWeight = weight < 0.f ? 0.f : (weight > 1.f ? 1.f : weight);
+	}
+	return _levelSpacing != oldSpacing;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 Vector2 ReferenceGrid::snap(const Vector2 & point) {
-	Vector2 O(_originX, _originY);
-	Vector2 offset = point - O;
-	float cellSize = _majorDist / (_minorCount + 1);
-	Vector2 mapped = offset / cellSize;
-	float x = round(mapped.x()) * cellSize + _originX;
-	float y = round(mapped.y()) * cellSize + _originY;
+	// A degenerate grid has no lines to snap to.
+	if (_levelSpacing <= 0.f) return point;
+	float x = round((point.x() - _originX) / _levelSpacing) * _levelSpacing + _originX;
+	float y = round((point.y() - _originY) / _levelSpacing) * _levelSpacing + _originY;
 	return Vector2(x, y);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+void ReferenceGrid::snapAll(Vector3 * points, size_t count, bool snapX, bool snapY) const {
+	if (_levelSpacing <= 0.f) return;
+	snapPoints(points, count, Vector2(_originX, _originY), _levelSpacing, snapX, snapY);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 Vector2 ReferenceGrid::snapVertical(const Vector2 & point) {
-	float offset = point.x() - _originX;
-	float cellSize = _majorDist / (_minorCount + 1);
-	float mapped = offset / cellSize;
-	float x = round(mapped) * cellSize + _originX;
+	if (_levelSpacing <= 0.f) return point;
+	float x = round((point.x() - _originX) / _levelSpacing) * _levelSpacing + _originX;
 	return Vector2(x, point.y());
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 Vector2 ReferenceGrid::snapHorizontal(const Vector2 & point) {
-	float offset = point.y() - _originY;
-	float cellSize = _majorDist / (_minorCount + 1);
-	float mapped = offset / cellSize;
-	float y = round(mapped) * cellSize + _originY;
+	if (_levelSpacing <= 0.f) return point;
+	float y = round((point.y() - _originY) / _levelSpacing) * _levelSpacing + _originY;
 	return Vector2(point.x(), y);
 }
 
@@ -2,6 +2,9 @@
 #define __REFERENCE_GRID_H__
 
 #include <Math/Vector2.h>
+#include <Math/Vector3.h>
+
+#include <cstddef>
 
 using namespace Menge::Math;
 
@@ -9,6 +12,13 @@ using namespace Menge::Math;
  *	@brief		Defines the reference grid for the simulation domain.
  *
  *	This is a 2D grid intended to lie on the x-y plane.
+ *
+ *	The grid is a hierarchy of levels: each level subdivides the next coarser one into
+ *	(minor count + 1) parts, with the user's major/minor lines as one pair of levels.  Given
+ *	the scale of the view (see setViewScale()), the finest level whose lines are at least
+ *	MIN_LINE_PIXELS apart is active; it is drawn as the minor lines (the next coarser level
+ *	as the major lines) and it is the level points snap to.  Without a view scale, the
+ *	user's minor lines are active.
  */
 class ReferenceGrid
 {
@@ -88,7 +98,50 @@ public:
 	}
 
 	/*!
-	 *	@brief		Returns the nearest grid point to the input point.
+	 *	@brief		Reports the distance between adjacent (major or minor) grid lines.
+	 */
+	float getCellSize() const { return _cellSize; }
+
+	/*!
+	 *	@brief		Chooses the active level for the scale of the view.
+	 *
+	 *	@param		worldPerPixel		The size of a pixel in world units (zero or less to
+	 *									activate the user's minor lines).
+	 *	@returns	True if the active level changed.
+	 */
+	bool setViewScale(float worldPerPixel);
+
+	/*!
+	 *	@brief		Reports the distance between the lines of the active level.
+	 */
+	float getLevelSpacing() const { return _levelSpacing; }
+
+	/*!
+	 *	@brief		Reports the number of parts each level is subdivided into by the next
+	 *				finer level.
+	 */
+	unsigned int getLevelFactor() const;
+
+	/*!
+	 *	@brief		Reports how prominent the active level's lines are on screen: 0 when they
+	 *				are MIN_LINE_PIXELS apart, rising to 1 as they approach the spacing at
+	 *				which the next finer level becomes active.
+	 */
+	float getLevelWeight() const { return _levelWeight; }
+
+	/*!
+	 *	@brief		The smallest on-screen distance (in pixels) between the lines of the
+	 *				active level.
+	 */
+	static const float MIN_LINE_PIXELS;
+
+	/*!
+	 *	@brief		The most levels above or below the user's minor lines.
+	 */
+	static const int MAX_LEVELS;
+
+	/*!
+	 *	@brief		Returns the nearest grid point of the active level to the input point.
 	 *
 	 *	@param		point		The 2D query point.
 	 *	@returns	The point on the grid nearest the query point.
@@ -96,7 +149,20 @@ public:
 	Vector2 snap(const Vector2 & point);
 
 	/*!
-	 *	@brief		"Snaps" the query point to a line parallel with grid's y-axis (preserving the y-value).
+	 *	@brief		Snaps an array of vertices to the active level of the grid in place.
+	 *
+	 *	The result is the same as snapping each vertex individually with snap(),
+	 *	snapVertical() or snapHorizontal(), but the array is processed in bulk.
+	 *
+	 *	@param		points		The vertices to snap (the z-values are preserved).
+	 *	@param		count		The number of vertices.
+	 *	@param		snapX		If true, the x-values are snapped to the nearest vertical line.
+	 *	@param		snapY		If true, the y-values are snapped to the nearest horizontal line.
+	 */
+	void snapAll(Vector3 * points, size_t count, bool snapX = true, bool snapY = true) const;
+
+	/*!
+	 *	@brief		"Snaps" the query point to a line of the active level parallel with grid's y-axis (preserving the y-value).
 	 *
 	 *	@param		point		The 2D query point.
 	 *	@returns	The point with the same y, but with the x-value of the nearest vertical grid line.
@@ -104,7 +170,7 @@ public:
 	Vector2 snapVertical(const Vector2 & point);
 
 	/*!
-	 *	@brief		"Snaps" the query point to a line parallel with the grid's x-axis (preserving the x-value).
+	 *	@brief		"Snaps" the query point to a line of the active level parallel with the grid's x-axis (preserving the x-value).
 	 *
 	 *	@param		point		The 2D query point.
 	 *	@returns	The point with the same x, but with the y-value of the nearest horizontal grid line.
@@ -153,6 +219,33 @@ protected:
 	 */
 	float _majorDist;
 
+	/*!
+	 *	@brief	The distance between adjacent grid lines -- derived from the major distance
+	 *			and the minor line count.
+	 */
+	float _cellSize;
+
+	/*!
+	 *	@brief	Updates the cell size to reflect the major distance and minor line count and
+	 *			re-chooses the active level.
+	 */
+	void updateCellSize();
+
+	/*!
+	 *	@brief	The size of a pixel of the view in world units (zero if unknown).
+	 */
+	float _viewScale;
+
+	/*!
+	 *	@brief	The distance between the lines of the active level.
+	 */
+	float _levelSpacing;
+
+	/*!
+	 *	@brief	The prominence of the active level's lines (see getLevelWeight()).
+	 */
+	float _levelWeight;
+
 };
 
 #endif	// __REFERENCE_GRID_H__
\ No newline at end of file
@@ -1,26 +1,89 @@
 #include "SceneHierarchy.hpp"
+#include "SceneHierarchyModel.hpp"
 #include <QtWidgets/qToolbar.h>
 #include <QtWidgets/QBoxLayout.h>
-#include <QtWidgets/qtreewidget.h>
+#include <QtWidgets/qlineedit.h>
+#include <QtWidgets/qlistwidget.h>
+#include <QtWidgets/qtreeview.h>
 #include <QtWidgets/qaction.h>
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //						Implementation of SceneHierarchy
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-SceneHierarchy::SceneHierarchy(QWidget * parent) : QWidget(parent) {
+SceneHierarchy::SceneHierarchy(QWidget * parent) : QWidget(parent), _toolBar(0x0), _model(0x0), _sceneTree(0x0), _index(0x0), _searchField(0x0), _resultList(0x0), _results() {
 	QVBoxLayout * mainLayout = new QVBoxLayout();
 	mainLayout->setMargin(0);
 	_toolBar = new QToolBar();
 	QAction * action = new QAction(QIcon(":/images/delete.png"), tr("&Delete"), this);
 	_toolBar->addAction(action);
 	mainLayout->addWidget(_toolBar);
-	_sceneTree = new QTreeWidget();
-	QList<QTreeWidgetItem *> items;
-	items.append(new QTreeWidgetItem((QTreeWidget *)0x0, QStringList(tr("Scene Elements"))));
-	items.append(new QTreeWidgetItem((QTreeWidget *)0x0, QStringList(tr("Behavior FSM"))));
-	_sceneTree->addTopLevelItems(items);
+	_index = new SceneSearchIndex(this);
+	_searchField = new QLineEdit();
+	_searchField->setPlaceholderText(tr("Search by type, name or id"));
+	_searchField->setClearButtonEnabled(true);
+	connect(_searchField, &QLineEdit::textChanged, this, &SceneHierarchy::search);
+	mainLayout->addWidget(_searchField);
+	_model = new SceneHierarchyModel(this);
+	_sceneTree = new QTreeView();
+	_sceneTree->setHeaderHidden(true);
+	// Uniform rows let the view lay out millions of rows without measuring each one.
+	_sceneTree->setUniformRowHeights(true);
+	_sceneTree->setModel(_model);
 	mainLayout->addWidget(_sceneTree);
+	_resultList = new QListWidget();
+	_resultList->setUniformItemSizes(true);
+	_resultList->setVisible(false);
+	connect(_resultList, &QListWidget::currentRowChanged, this, &SceneHierarchy::selectResult);
+	mainLayout->addWidget(_resultList);
 
 	setLayout(mainLayout);
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchy::setObstacleSet(LiveObstacleSet * obstacles) {
+	_model->setObstacleSet(obstacles);
+	_index->setObstacleSet(obstacles);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchy::setBehavior(const FSMGraph & graph) {
+	_index->setBehavior(graph);
+	if (!_searchField->text().isEmpty()) search(_searchField->text());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchy::search(const QString & text) {
+	_index->query(text, _results);
+	const bool searching = !text.trimmed().isEmpty();
+	_sceneTree->setVisible(!searching);
+	_resultList->setVisible(searching);
+	// The list is rebuilt without reporting the selection changes.
+	_resultList->blockSignals(true);
+	_resultList->clear();
+	for (size_t i = 0; i < _results.size(); ++i) {
+		_resultList->addItem(_results[i]._label);
+	}
+	_resultList->blockSignals(false);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchy::selectResult(int row) {
+	if (row < 0 || (size_t)row >= _results.size()) return;
+	const SceneSearchIndex::Result & result = _results[row];
+	if (result._type == SceneSearchIndex::STATE_ELEMENT) {
+		emit stateRequested(result._id);
+	}
+	else {
+		// The element may have moved since the search.
+		Vector2 minPt, maxPt;
+		if (_index->getBounds(result._type, result._id, minPt, maxPt)) {
+			emit frameRequested(minPt, maxPt);
+		}
+	}
+}
+
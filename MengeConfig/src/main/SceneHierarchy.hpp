@@ -1,12 +1,21 @@
 #ifndef __SCENE_HIERARCHY_H__
 #define __SCENE_HIERARCHY_H__
 
+#include "SceneSearchIndex.hpp"
+
 #include <QtWidgets/qwidget.h>
 
+#include <vector>
+
 QT_BEGIN_NAMESPACE
+class QLineEdit;
+class QListWidget;
 class QToolBar;
-class QTreeWidget;
+class QTreeView;
 QT_END_NAMESPACE
+class FSMGraph;
+class LiveObstacleSet;
+class SceneHierarchyModel;
 
 class SceneHierarchy : public QWidget {
 	Q_OBJECT
@@ -19,6 +28,54 @@ public:
 	 */
 	SceneHierarchy(QWidget * parent = 0x0);
 
+	/*!
+	 *	@brief		Sets the obstacle set presented in the hierarchy.
+	 *
+	 *	@param		obstacles		The obstacle set (null to present none).  The caller
+	 *								retains ownership.
+	 */
+	void setObstacleSet(LiveObstacleSet * obstacles);
+
+	/*!
+	 *	@brief		Sets the behavior FSM whose states can be searched for.
+	 *
+	 *	@param		graph		The behavior FSM.
+	 */
+	void setBehavior(const FSMGraph & graph);
+
+signals:
+	/*!
+	 *	@brief		Emitted when a search result with spatial bounds is selected.
+	 *
+	 *	@param		minPt		The minimum corner of the element's bounds.
+	 *	@param		maxPt		The maximum corner of the element's bounds.
+	 */
+	void frameRequested(const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Emitted when a behavior state is selected among the search results.
+	 *
+	 *	@param		state		The index of the state.
+	 */
+	void stateRequested(size_t state);
+
+protected:
+
+	/*!
+	 *	@brief		Replaces the search results with those of the query; the hierarchy is
+	 *				shown in place of the results while the query is empty.
+	 *
+	 *	@param		text		The query.
+	 */
+	void search(const QString & text);
+
+	/*!
+	 *	@brief		Presents the selected search result.
+	 *
+	 *	@param		row			The row of the selected result.
+	 */
+	void selectResult(int row);
+
 private:
 
 	/*!
@@ -26,10 +83,35 @@ private:
 	 */
 	QToolBar * _toolBar;
 
+	/*!
+	 *	@brief		The model of the scene's elements.
+	 */
+	SceneHierarchyModel * _model;
+
 	/*!
 	 *	@brief		A child widget.
 	 */
-	QTreeWidget * _sceneTree;
+	QTreeView * _sceneTree;
+
+	/*!
+	 *	@brief		The index searched by the search field.
+	 */
+	SceneSearchIndex * _index;
+
+	/*!
+	 *	@brief		The search field.
+	 */
+	QLineEdit * _searchField;
+
+	/*!
+	 *	@brief		The list of search results.
+	 */
+	QListWidget * _resultList;
+
+	/*!
+	 *	@brief		The results of the most recent search.
+	 */
+	std::vector<SceneSearchIndex::Result>	_results;
 };
 
-#endif	// __SCENE_HIERARCHY_H__
\ No newline at end of file
+#endif	// __SCENE_HIERARCHY_H__
@@ -0,0 +1,377 @@
+#include "SceneHierarchyModel.hpp"
+
+#include <algorithm>
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//						Implementation of SceneHierarchyModel
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const int SceneHierarchyModel::FETCH_BATCH = 1000;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+SceneHierarchyModel::SceneHierarchyModel(QObject * parent) : QAbstractItemModel(parent), _obstacles(0x0), _fetchedPolygons(0), _removing(false), _fetchedVertices() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+SceneHierarchyModel::~SceneHierarchyModel() {
+	if (_obstacles != 0x0) {
+		_obstacles->removeListener(this);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::setObstacleSet(LiveObstacleSet * obstacles) {
+	if (obstacles == _obstacles) return;
+	beginResetModel();
+	if (_obstacles != 0x0) {
+		_obstacles->removeListener(this);
+	}
+	_obstacles = obstacles;
+	if (_obstacles != 0x0) {
+		_obstacles->addListener(this);
+	}
+	clearFetched();
+	endResetModel();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const GLPolygon * SceneHierarchyModel::getPolygon(const QModelIndex & index) const {
+	if (!index.isValid()) return 0x0;
+	const quintptr id = index.internalId();
+	if (id == POLYGON_NODE) {
+		return _obstacles->getPolygon(index.row());
+	}
+	else if (id > POLYGON_NODE) {
+		return static_cast<const GLPolygon *>(index.internalPointer());
+	}
+	return 0x0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex SceneHierarchyModel::obstaclesIndex() const {
+	if (_obstacles == 0x0) return QModelIndex();
+	return createIndex(0, 0, OBSTACLES_NODE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex SceneHierarchyModel::index(int row, int column, const QModelIndex & parent) const {
+	if (!hasIndex(row, column, parent)) return QModelIndex();
+	if (!parent.isValid()) {
+		return createIndex(row, column, row == 0 ? SCENE_NODE : FSM_NODE);
+	}
+	switch (parent.internalId()) {
+		case SCENE_NODE:
+			return createIndex(row, column, OBSTACLES_NODE);
+		case OBSTACLES_NODE:
+			return createIndex(row, column, POLYGON_NODE);
+		case POLYGON_NODE:
+			// A vertex's index carries its polygon; its row is the vertex index.
+			return createIndex(row, column, const_cast<GLPolygon *>(_obstacles->getPolygon(parent.row())));
+		default:
+			return QModelIndex();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex SceneHierarchyModel::parent(const QModelIndex & child) const {
+	if (!child.isValid()) return QModelIndex();
+	const quintptr id = child.internalId();
+	switch (id) {
+		case SCENE_NODE:
+		case FSM_NODE:
+			return QModelIndex();
+		case OBSTACLES_NODE:
+			return createIndex(0, 0, SCENE_NODE);
+		case POLYGON_NODE:
+			return obstaclesIndex();
+		default:
+			return polygonIndex(static_cast<const GLPolygon *>(child.internalPointer())->getSlot());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int SceneHierarchyModel::rowCount(const QModelIndex & parent) const {
+	if (!parent.isValid()) return 2;
+	if (parent.column() > 0) return 0;
+	switch (parent.internalId()) {
+		case SCENE_NODE:
+			return _obstacles != 0x0 ? 1 : 0;
+		case OBSTACLES_NODE:
+			return (int)_fetchedPolygons;
+		case POLYGON_NODE:
+			return (int)fetchedVertices(_obstacles->getPolygon(parent.row()));
+		default:
+			return 0;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int SceneHierarchyModel::columnCount(const QModelIndex & parent) const {
+	return 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SceneHierarchyModel::hasChildren(const QModelIndex & parent) const {
+	if (!parent.isValid()) return true;
+	if (parent.column() > 0) return false;
+	switch (parent.internalId()) {
+		case SCENE_NODE:
+			return _obstacles != 0x0;
+		case OBSTACLES_NODE:
+			return _obstacles->getPolygonCount() > 0;
+		case POLYGON_NODE:
+			return _obstacles->getPolygon(parent.row())->getVertexCount() > 0;
+		default:
+			return false;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+QVariant SceneHierarchyModel::data(const QModelIndex & index, int role) const {
+	if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+	const quintptr id = index.internalId();
+	switch (id) {
+		case SCENE_NODE:
+			return tr("Scene Elements");
+		case FSM_NODE:
+			return tr("Behavior FSM");
+		case OBSTACLES_NODE:
+			return tr("Obstacles (%1)").arg((qulonglong)_obstacles->getPolygonCount());
+		case POLYGON_NODE:
+		{
+			const GLPolygon * poly = _obstacles->getPolygon(index.row());
+			return tr("Obstacle %1 (%2 vertices)").arg((qulonglong)poly->getId()).arg((qulonglong)poly->getVertexCount());
+		}
+		default:
+		{
+			const GLPolygon * poly = static_cast<const GLPolygon *>(index.internalPointer());
+			if ((size_t)index.row() >= poly->getVertexCount()) return QVariant();
+			const Vector3 & v = poly->getVertex(index.row());
+			return tr("Vertex %1 (%2, %3)").arg(index.row()).arg(v.x()).arg(v.y());
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+Qt::ItemFlags SceneHierarchyModel::flags(const QModelIndex & index) const {
+	if (!index.isValid()) return Qt::NoItemFlags;
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SceneHierarchyModel::canFetchMore(const QModelIndex & parent) const {
+	if (!parent.isValid() || _obstacles == 0x0) return false;
+	switch (parent.internalId()) {
+		case OBSTACLES_NODE:
+			return _fetchedPolygons < _obstacles->getPolygonCount();
+		case POLYGON_NODE:
+		{
+			const GLPolygon * poly = _obstacles->getPolygon(parent.row());
+			return fetchedVertices(poly) < poly->getVertexCount();
+		}
+		default:
+			return false;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::fetchMore(const QModelIndex & parent) {
+	if (!canFetchMore(parent)) return;
+	if (parent.internalId() == OBSTACLES_NODE) {
+		const size_t count = std::min((size_t)FETCH_BATCH, _obstacles->getPolygonCount() - _fetchedPolygons);
+		beginInsertRows(parent, (int)_fetchedPolygons, (int)(_fetchedPolygons + count - 1));
+		_fetchedPolygons += count;
+		endInsertRows();
+	}
+	else {
+		const GLPolygon * poly = _obstacles->getPolygon(parent.row());
+		VertexRows & rows = _fetchedVertices[poly];
+		if (rows._fetched == 0) rows._count = poly->getVertexCount();
+		const size_t count = std::min((size_t)FETCH_BATCH, poly->getVertexCount() - rows._fetched);
+		beginInsertRows(parent, (int)rows._fetched, (int)(rows._fetched + count - 1));
+		rows._fetched += count;
+		endInsertRows();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonAdded(size_t index) {
+	const QModelIndex obstacles = obstaclesIndex();
+	emit dataChanged(obstacles, obstacles);
+	// If all of the polygons had been fetched, the new one is presented immediately;
+	//	otherwise it is fetched in its turn.
+	if (index == _fetchedPolygons) {
+		beginInsertRows(obstacles, (int)index, (int)index);
+		++_fetchedPolygons;
+		endInsertRows();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonsAdded(size_t first, size_t count) {
+	const QModelIndex obstacles = obstaclesIndex();
+	emit dataChanged(obstacles, obstacles);
+	if (first == _fetchedPolygons) {
+		const size_t fetched = std::min((size_t)FETCH_BATCH, count);
+		beginInsertRows(obstacles, (int)first, (int)(first + fetched - 1));
+		_fetchedPolygons += fetched;
+		endInsertRows();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonAboutToBeRemoved(size_t index) {
+	_removing = index < _fetchedPolygons;
+	if (_removing) {
+		beginRemoveRows(obstaclesIndex(), (int)index, (int)index);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonRemoved(size_t index, const GLPolygon * poly) {
+	_fetchedVertices.erase(poly);
+	const QModelIndex obstacles = obstaclesIndex();
+	if (_removing) {
+		--_fetchedPolygons;
+		_removing = false;
+		endRemoveRows();
+		// The set's last polygon has moved into the vacated position.
+		const size_t last = _obstacles->getPolygonCount();
+		if (index < last) {
+			if (_fetchedPolygons == last) {
+				// Its row was fetched; the removal moved it up one row.
+				const int row = (int)last - 1;
+				if (row != (int)index) {
+					beginMoveRows(obstacles, row, row, obstacles, (int)index);
+					endMoveRows();
+				}
+			}
+			else {
+				beginInsertRows(obstacles, (int)index, (int)index);
+				++_fetchedPolygons;
+				endInsertRows();
+			}
+		}
+	}
+	emit dataChanged(obstacles, obstacles);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonChanged(size_t index) {
+	refreshPolygon(index);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::allPolygonsChanged() {
+	// Bulk operations move vertices, they don't add or remove them.
+	if (_fetchedPolygons == 0) return;
+	emit dataChanged(polygonIndex(0), polygonIndex(_fetchedPolygons - 1));
+	std::unordered_map<const GLPolygon *, VertexRows>::const_iterator itr = _fetchedVertices.begin();
+	for (; itr != _fetchedVertices.end(); ++itr) {
+		if (itr->second._fetched == 0) continue;
+		const QModelIndex polyIndex = polygonIndex(itr->first->getSlot());
+		emit dataChanged(index(0, 0, polyIndex), index((int)itr->second._fetched - 1, 0, polyIndex));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonsTranslated(double dx, double dy) {
+	// The polygons' rows only show their vertex counts.
+	std::unordered_map<const GLPolygon *, VertexRows>::const_iterator itr = _fetchedVertices.begin();
+	for (; itr != _fetchedVertices.end(); ++itr) {
+		if (itr->second._fetched == 0) continue;
+		const QModelIndex polyIndex = polygonIndex(itr->first->getSlot());
+		emit dataChanged(index(0, 0, polyIndex), index((int)itr->second._fetched - 1, 0, polyIndex));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::polygonsReset() {
+	beginResetModel();
+	clearFetched();
+	endResetModel();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::obstacleSetDestroyed() {
+	beginResetModel();
+	_obstacles = 0x0;
+	clearFetched();
+	endResetModel();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex SceneHierarchyModel::polygonIndex(size_t slot) const {
+	return createIndex((int)slot, 0, POLYGON_NODE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t SceneHierarchyModel::fetchedVertices(const GLPolygon * poly) const {
+	std::unordered_map<const GLPolygon *, VertexRows>::const_iterator itr = _fetchedVertices.find(poly);
+	return itr == _fetchedVertices.end() ? 0 : itr->second._fetched;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::refreshPolygon(size_t slot) {
+	if (slot >= _fetchedPolygons) return;
+	const QModelIndex polyIndex = polygonIndex(slot);
+	emit dataChanged(polyIndex, polyIndex);
+
+	const GLPolygon * poly = _obstacles->getPolygon(slot);
+	std::unordered_map<const GLPolygon *, VertexRows>::iterator itr = _fetchedVertices.find(poly);
+	if (itr == _fetchedVertices.end()) return;
+	VertexRows & rows = itr->second;
+	const size_t count = poly->getVertexCount();
+	if (count < rows._fetched) {
+		beginRemoveRows(polyIndex, (int)count, (int)rows._fetched - 1);
+		rows._fetched = count;
+		endRemoveRows();
+	}
+	else if (count > rows._fetched && rows._fetched == rows._count) {
+		// The vertices had all been fetched; the new ones are presented immediately.
+		beginInsertRows(polyIndex, (int)rows._fetched, (int)count - 1);
+		rows._fetched = count;
+		endInsertRows();
+	}
+	rows._count = count;
+	// The change doesn't identify which vertices moved (or where one was inserted).
+	if (rows._fetched > 0) {
+		emit dataChanged(index(0, 0, polyIndex), index((int)rows._fetched - 1, 0, polyIndex));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneHierarchyModel::clearFetched() {
+	_fetchedPolygons = 0;
+	_removing = false;
+	_fetchedVertices.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,284 @@
+/*!
+ *	@file		SceneHierarchyModel.hpp
+ *	@brief		The item model presenting the scene's elements to the scene hierarchy.
+ */
+
+#ifndef __SCENE_HIERARCHY_MODEL_H__
+#define	__SCENE_HIERARCHY_MODEL_H__
+
+#include "LiveObstacleSet.h"
+
+#include <QtCore/qabstractitemmodel.h>
+
+#include <unordered_map>
+
+/*!
+ *	@brief		Presents the scene's elements as a tree: the obstacle set's polygons and
+ *				their vertices under "Scene Elements", alongside the "Behavior FSM".
+ *
+ *	The model reads the obstacle set directly; it stores nothing per element except the
+ *	number of rows which have been fetched.  Rows are created lazily -- the polygons and
+ *	the vertices of a polygon are fetched FETCH_BATCH at a time, as the view scrolls to
+ *	them -- so the cost of presenting the set is proportional to what has been viewed,
+ *	not to the size of the set.
+ *
+ *	The model listens to the obstacle set and reports each edit with the narrowest
+ *	signal which describes it (rows inserted or removed, or the data of the affected rows
+ *	changed).  The model is only reset when the set's contents are replaced wholesale.
+ */
+class SceneHierarchyModel : public QAbstractItemModel, public ObstacleSetListener {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent		The optional parent.
+	 */
+	SceneHierarchyModel(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor.
+	 */
+	~SceneHierarchyModel();
+
+	/*!
+	 *	@brief		Sets the obstacle set presented by the model.
+	 *
+	 *	@param		obstacles		The obstacle set (null to present none).  The caller
+	 *								retains ownership.
+	 */
+	void setObstacleSet(LiveObstacleSet * obstacles);
+
+	/*!
+	 *	@brief		Returns the polygon presented by the index: the polygon itself or the
+	 *				polygon containing the vertex.
+	 *
+	 *	@param		index		The model index.
+	 *	@returns	The polygon, null if the index doesn't present a polygon or a vertex.
+	 */
+	const GLPolygon * getPolygon(const QModelIndex & index) const;
+
+	/*!
+	 *	@brief		Returns the index presenting the obstacle set's polygons.
+	 */
+	QModelIndex obstaclesIndex() const;
+
+	/*!
+	 *	@brief		The number of rows fetched at a time.
+	 */
+	static const int FETCH_BATCH;
+
+	/*!
+	 *	@brief		Returns the index of the item in the model.
+	 *
+	 *	@param		row			The row of the item.
+	 *	@param		column		The column of the item.
+	 *	@param		parent		The index of the item's parent.
+	 */
+	virtual QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
+
+	/*!
+	 *	@brief		Returns the index of the parent of the indexed item.
+	 *
+	 *	@param		child		The index of the item.
+	 */
+	virtual QModelIndex parent(const QModelIndex & child) const;
+
+	/*!
+	 *	@brief		Reports the number of (fetched) rows under the parent.
+	 *
+	 *	@param		parent		The index of the parent.
+	 */
+	virtual int rowCount(const QModelIndex & parent = QModelIndex()) const;
+
+	/*!
+	 *	@brief		Reports the number of columns under the parent.
+	 *
+	 *	@param		parent		The index of the parent.
+	 */
+	virtual int columnCount(const QModelIndex & parent = QModelIndex()) const;
+
+	/*!
+	 *	@brief		Reports if the parent has children (whether or not they've been fetched).
+	 *
+	 *	@param		parent		The index of the parent.
+	 */
+	virtual bool hasChildren(const QModelIndex & parent = QModelIndex()) const;
+
+	/*!
+	 *	@brief		Returns the data of the indexed item.
+	 *
+	 *	@param		index		The index of the item.
+	 *	@param		role		The role of the requested data.
+	 */
+	virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+
+	/*!
+	 *	@brief		Returns the flags of the indexed item.
+	 *
+	 *	@param		index		The index of the item.
+	 */
+	virtual Qt::ItemFlags flags(const QModelIndex & index) const;
+
+	/*!
+	 *	@brief		Reports if the parent has children which haven't been fetched.
+	 *
+	 *	@param		parent		The index of the parent.
+	 */
+	virtual bool canFetchMore(const QModelIndex & parent) const;
+
+	/*!
+	 *	@brief		Fetches the next batch of the parent's children.
+	 *
+	 *	@param		parent		The index of the parent.
+	 */
+	virtual void fetchMore(const QModelIndex & parent);
+
+	///////////////////////////////////////////////////////////////////////////////////
+	//			ObstacleSetListener interface
+	///////////////////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Inserts the polygon's row (if the polygons have all been fetched).
+	 *
+	 *	@param		index		The position of the new polygon.
+	 */
+	virtual void polygonAdded(size_t index);
+
+	/*!
+	 *	@brief		Inserts a batch of the polygons' rows (if the polygons had all been
+	 *				fetched); the rest are fetched in their turn.
+	 *
+	 *	@param		first		The position of the first new polygon.
+	 *	@param		count		The number of new polygons.
+	 */
+	virtual void polygonsAdded(size_t first, size_t count);
+
+	/*!
+	 *	@brief		Begins the removal of the polygon's row (if it has been fetched).
+	 *
+	 *	@param		index		The position of the polygon.
+	 */
+	virtual void polygonAboutToBeRemoved(size_t index);
+
+	/*!
+	 *	@brief		Completes the removal of the polygon's row and presents the polygon
+	 *				which took its position.
+	 *
+	 *	@param		index		The position the polygon occupied.
+	 *	@param		poly		The polygon.
+	 */
+	virtual void polygonRemoved(size_t index, const GLPolygon * poly);
+
+	/*!
+	 *	@brief		Reports the change to the polygon's row and its vertex rows.
+	 *
+	 *	@param		index		The position of the polygon.
+	 */
+	virtual void polygonChanged(size_t index);
+
+	/*!
+	 *	@brief		Reports the change to every fetched row.
+	 */
+	virtual void allPolygonsChanged();
+
+	/*!
+	 *	@brief		Reports the change to every fetched vertex row (they show the vertices'
+	 *				positions).
+	 *
+	 *	@param		dx		The shift along the x-axis.
+	 *	@param		dy		The shift along the y-axis.
+	 */
+	virtual void polygonsTranslated(double dx, double dy);
+
+	/*!
+	 *	@brief		Resets the model.
+	 */
+	virtual void polygonsReset();
+
+	/*!
+	 *	@brief		Resets the model to present no obstacle set.
+	 */
+	virtual void obstacleSetDestroyed();
+
+protected:
+
+	/*!
+	 *	@brief		The kinds of rows which aren't vertices; they are stored in the
+	 *				internal identifiers of their indices.  A vertex's index stores its
+	 *				polygon.
+	 */
+	enum NodeKind {
+		SCENE_NODE = 1,		/// The "Scene Elements" row.
+		FSM_NODE,			/// The "Behavior FSM" row.
+		OBSTACLES_NODE,		/// The row grouping the obstacle set's polygons.
+		POLYGON_NODE		/// A polygon's row.
+	};
+
+	/*!
+	 *	@brief		Returns the index presenting a polygon.
+	 *
+	 *	@param		slot		The polygon's position in the obstacle set.
+	 */
+	QModelIndex polygonIndex(size_t slot) const;
+
+	/*!
+	 *	@brief		Reports the number of vertex rows fetched for the polygon.
+	 *
+	 *	@param		poly		The polygon.
+	 */
+	size_t fetchedVertices(const GLPolygon * poly) const;
+
+	/*!
+	 *	@brief		Reports that the data of the indicated polygon row and its fetched
+	 *				vertex rows has changed, reconciling the vertex rows with the polygon's
+	 *				vertex count.
+	 *
+	 *	@param		slot		The polygon's position in the obstacle set.
+	 */
+	void refreshPolygon(size_t slot);
+
+	/*!
+	 *	@brief		Discards the fetched rows (within a model reset).
+	 */
+	void clearFetched();
+
+	/*!
+	 *	@brief		The presented obstacle set.
+	 */
+	LiveObstacleSet * _obstacles;
+
+	/*!
+	 *	@brief		The number of polygon rows which have been fetched.
+	 */
+	size_t	_fetchedPolygons;
+
+	/*!
+	 *	@brief		Reports if a fetched polygon row is being removed.
+	 */
+	bool	_removing;
+
+	/*!
+	 *	@brief		The vertex rows of an expanded polygon.
+	 */
+	struct VertexRows {
+		/*!
+		 *	@brief		The number of vertex rows which have been fetched.
+		 */
+		size_t	_fetched;
+
+		/*!
+		 *	@brief		The polygon's vertex count when the rows were last reconciled with it.
+		 */
+		size_t	_count;
+	};
+
+	/*!
+	 *	@brief		The vertex rows of each polygon (polygons which haven't been expanded
+	 *				have no entry).
+	 */
+	std::unordered_map<const GLPolygon *, VertexRows>	_fetchedVertices;
+};
+
+#endif	// __SCENE_HIERARCHY_MODEL_H__
@@ -0,0 +1,441 @@
+#include "SceneSearchIndex.hpp"
+
+#include "FSMGraph.h"
+#include "ThreadPool.h"
+
+#include <unordered_set>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Folds text to lower case, encoded in UTF-8.
+ */
+std::string foldText(const QString & text) {
+	const QByteArray bytes = text.toLower().toUtf8();
+	return std::string(bytes.constData(), bytes.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SceneSearchIndex
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t SceneSearchIndex::MAX_RESULTS = 200;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t SceneSearchIndex::REBUILD_THRESHOLD = 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t SceneSearchIndex::MAX_RECENT = 16 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+
+SceneSearchIndex::SceneSearchIndex(QObject * parent) : QObject(parent), _obstacles(0x0), _stateCount(0), _typeNames(), _elements(), _table(new SearchTable()), _recent(), _stale(0), _recentBuilt(0), _staleBuilt(0), _building(false), _worker(), _lastRequest(0), _hasRequest(false), _request(), _result(), _resultId(0), _stopping(false) {
+	_typeNames.resize(ELEMENT_TYPE_COUNT);
+	_typeNames[OBSTACLE_ELEMENT] = "obstacle";
+	_typeNames[STATE_ELEMENT] = "state";
+	// The signal is emitted by the worker; the table is adopted on this object's thread.
+	connect(this, &SceneSearchIndex::tableBuilt, this, &SceneSearchIndex::adoptTable, Qt::QueuedConnection);
+	_worker = std::thread(&SceneSearchIndex::workerLoop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SceneSearchIndex::~SceneSearchIndex() {
+	if (_obstacles != 0x0) {
+		_obstacles->removeListener(this);
+	}
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+		_hasRequest = false;
+	}
+	_wake.notify_all();
+	_worker.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::setObstacleSet(LiveObstacleSet * obstacles) {
+	if (obstacles == _obstacles) return;
+	if (_obstacles != 0x0) {
+		_obstacles->removeListener(this);
+		removeObstacles();
+	}
+	_obstacles = obstacles;
+	if (_obstacles != 0x0) {
+		_obstacles->addListener(this);
+		addObstacles();
+	}
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::setBehavior(const FSMGraph & graph) {
+	for (size_t s = 0; s < _stateCount; ++s) {
+		removeElement(SearchTable::makeKey(STATE_ELEMENT, s));
+	}
+	_stateCount = graph.getStateCount();
+	Element element;
+	element._hasBounds = false;
+	for (size_t s = 0; s < _stateCount; ++s) {
+		element._name = graph.getState(s)._name;
+		element._folded = foldText(element._name);
+		addElement(SearchTable::makeKey(STATE_ELEMENT, s), element);
+	}
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::query(const QString & text, std::vector<Result> & results) const {
+	results.clear();
+	std::vector<std::string> words;
+	SearchTable::splitWords(foldText(text), words);
+	if (words.empty()) return;
+
+	// Only the candidates of the most selective word are examined.
+	SearchTable::Candidates best;
+	SearchTable::Candidates candidates;
+	size_t bestSize = 0;
+	for (size_t w = 0; w < words.size(); ++w) {
+		_table->findCandidates(words[w], _typeNames, candidates);
+		const size_t size = candidates.size();
+		if (w == 0 || size < bestSize) {
+			std::swap(best, candidates);
+			bestSize = size;
+		}
+	}
+
+	std::vector<SearchKey> found;
+	std::unordered_set<SearchKey> seen;
+	auto consider = [&](SearchKey key) {
+		std::unordered_map<SearchKey, Element>::const_iterator itr = _elements.find(key);
+		// The table may hold elements which have since been removed.
+		if (itr == _elements.end() || !matches(key, itr->second, words)) return;
+		if (seen.insert(key).second) found.push_back(key);
+	};
+	for (size_t r = 0; r < best._keys.size() && found.size() < MAX_RESULTS; ++r) {
+		for (const SearchKey * k = best._keys[r].first; k != best._keys[r].second && found.size() < MAX_RESULTS; ++k) {
+			consider(*k);
+		}
+	}
+	for (const SearchTable::Word * w = best._wordBegin; w != best._wordEnd && found.size() < MAX_RESULTS; ++w) {
+		consider(w->_key);
+	}
+	for (size_t i = 0; i < _recent.size() && found.size() < MAX_RESULTS; ++i) {
+		consider(_recent[i]);
+	}
+
+	results.resize(found.size());
+	for (size_t i = 0; i < found.size(); ++i) {
+		const Element & element = _elements.find(found[i])->second;
+		Result & result = results[i];
+		result._type = ElementType(SearchTable::getType(found[i]));
+		result._id = (size_t)SearchTable::getId(found[i]);
+		if (result._type == OBSTACLE_ELEMENT) {
+			result._label = tr("Obstacle %1").arg((qulonglong)result._id);
+		}
+		else {
+			result._label = tr("State %1 \"%2\"").arg((qulonglong)result._id).arg(element._name);
+		}
+		result._hasBounds = element._hasBounds;
+		result._min = element._min;
+		result._max = element._max;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SceneSearchIndex::getBounds(ElementType type, size_t id, Vector2 & minPt, Vector2 & maxPt) const {
+	std::unordered_map<SearchKey, Element>::const_iterator itr = _elements.find(SearchTable::makeKey(type, id));
+	if (itr == _elements.end() || !itr->second._hasBounds) return false;
+	minPt = itr->second._min;
+	maxPt = itr->second._max;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::polygonAdded(size_t index) {
+	const GLPolygon * poly = _obstacles->getPolygon(index);
+	Element element;
+	setBounds(poly, element);
+	addElement(SearchTable::makeKey(OBSTACLE_ELEMENT, poly->getId()), element);
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::polygonRemoved(size_t index, const GLPolygon * poly) {
+	removeElement(SearchTable::makeKey(OBSTACLE_ELEMENT, poly->getId()));
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::polygonChanged(size_t index) {
+	const GLPolygon * poly = _obstacles->getPolygon(index);
+	std::unordered_map<SearchKey, Element>::iterator itr = _elements.find(SearchTable::makeKey(OBSTACLE_ELEMENT, poly->getId()));
+	if (itr != _elements.end()) {
+		setBounds(poly, itr->second);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::allPolygonsChanged() {
+	// Only the elements' values are written, so the polygons can be visited in parallel.
+	LiveObstacleSet * obstacles = _obstacles;
+	std::unordered_map<SearchKey, Element> & elements = _elements;
+	ThreadPool::instance()->parallelFor(_obstacles->getPolygonCount(), 256, [&](size_t begin, size_t end) {
+		for (size_t p = begin; p < end; ++p) {
+			const GLPolygon * poly = obstacles->getPolygon(p);
+			std::unordered_map<SearchKey, Element>::iterator itr = elements.find(SearchTable::makeKey(OBSTACLE_ELEMENT, poly->getId()));
+			if (itr != elements.end()) {
+				setBounds(poly, itr->second);
+			}
+		}
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::polygonsAdded(size_t first, size_t count) {
+	_elements.reserve(_elements.size() + count);
+	_recent.reserve(_recent.size() + count);
+	Element element;
+	for (size_t p = first; p < first + count; ++p) {
+		const GLPolygon * poly = _obstacles->getPolygon(p);
+		setBounds(poly, element);
+		addElement(SearchTable::makeKey(OBSTACLE_ELEMENT, poly->getId()), element);
+	}
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::polygonsTranslated(double dx, double dy) {
+	// The vertices were shifted (and rounded) the same way, so the bounds stay exact.
+	std::unordered_map<SearchKey, Element>::iterator itr = _elements.begin();
+	for (; itr != _elements.end(); ++itr) {
+		Element & element = itr->second;
+		if (!element._hasBounds || SearchTable::getType(itr->first) != OBSTACLE_ELEMENT) continue;
+		element._min.set(static_cast<float>(element._min._x + dx), static_cast<float>(element._min._y + dy));
+		element._max.set(static_cast<float>(element._max._x + dx), static_cast<float>(element._max._y + dy));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::polygonsReset() {
+	removeObstacles();
+	addObstacles();
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::obstacleSetDestroyed() {
+	removeObstacles();
+	_obstacles = 0x0;
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::addElement(SearchKey key, const Element & element) {
+	std::pair< std::unordered_map<SearchKey, Element>::iterator, bool > inserted = _elements.insert(std::make_pair(key, element));
+	if (!inserted.second) {
+		// The table may hold the element under its old name.
+		inserted.first->second = element;
+		++_stale;
+	}
+	_recent.push_back(key);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::removeElement(SearchKey key) {
+	if (_elements.erase(key) > 0) ++_stale;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::addObstacles() {
+	const size_t COUNT = _obstacles->getPolygonCount();
+	_elements.reserve(_elements.size() + COUNT);
+	_recent.reserve(_recent.size() + COUNT);
+	Element element;
+	for (size_t p = 0; p < COUNT; ++p) {
+		const GLPolygon * poly = _obstacles->getPolygon(p);
+		setBounds(poly, element);
+		addElement(SearchTable::makeKey(OBSTACLE_ELEMENT, poly->getId()), element);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::removeObstacles() {
+	std::unordered_map<SearchKey, Element>::iterator itr = _elements.begin();
+	while (itr != _elements.end()) {
+		if (SearchTable::getType(itr->first) == OBSTACLE_ELEMENT) {
+			itr = _elements.erase(itr);
+			++_stale;
+		}
+		else {
+			++itr;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::setBounds(const GLPolygon * poly, Element & element) {
+	const size_t COUNT = poly->getVertexCount();
+	element._hasBounds = COUNT > 0;
+	if (COUNT == 0) return;
+	const Vector3 & v0 = poly->getVertex(0);
+	float minX = v0.x(), maxX = v0.x(), minY = v0.y(), maxY = v0.y();
+	for (size_t i = 1; i < COUNT; ++i) {
+		const Vector3 & v = poly->getVertex(i);
+		if (v.x() < minX) minX = v.x();
+		else if (v.x() > maxX) maxX = v.x();
+		if (v.y() < minY) minY = v.y();
+		else if (v.y() > maxY) maxY = v.y();
+	}
+	element._min.set(minX, minY);
+	element._max.set(maxX, maxY);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SceneSearchIndex::matches(SearchKey key, const Element & element, const std::vector<std::string> & words) const {
+	const std::string & typeName = _typeNames[SearchTable::getType(key)];
+	const SearchKey id = SearchTable::getId(key);
+	for (size_t w = 0; w < words.size(); ++w) {
+		const std::string & word = words[w];
+		if (typeName.compare(0, word.size(), word) != 0 && !SearchTable::matchesId(id, word) &&
+			!SearchTable::matchesName(element._folded, word)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::considerRebuild() {
+	// Every query scans the recent elements; a long list can't wait for the worker.
+	if (_recent.size() > MAX_RECENT) {
+		rebuildNow();
+	}
+	else if (!_building && _recent.size() + _stale > REBUILD_THRESHOLD) {
+		requestRebuild();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::requestRebuild() {
+	std::vector<SearchTable::Entry> entries;
+	collectEntries(entries);
+	_recentBuilt = _recent.size();
+	_staleBuilt = _stale;
+	_building = true;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		++_lastRequest;
+		_request.swap(entries);
+		_hasRequest = true;
+	}
+	_wake.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::rebuildNow() {
+	{
+		// The worker's table would be older than this one.
+		std::lock_guard< std::mutex > lock(_lock);
+		++_lastRequest;
+		_request.clear();
+		_hasRequest = false;
+		_result.reset();
+	}
+	std::vector<SearchTable::Entry> entries;
+	collectEntries(entries);
+	std::shared_ptr< SearchTable > table(new SearchTable());
+	table->build(entries);
+	_table = table;
+	std::vector<SearchKey>().swap(_recent);
+	_stale = 0;
+	_recentBuilt = 0;
+	_staleBuilt = 0;
+	_building = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::collectEntries(std::vector<SearchTable::Entry> & entries) const {
+	entries.resize(_elements.size());
+	size_t e = 0;
+	std::unordered_map<SearchKey, Element>::const_iterator itr = _elements.begin();
+	for (; itr != _elements.end(); ++itr, ++e) {
+		entries[e]._key = itr->first;
+		entries[e]._name = itr->second._folded;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::adoptTable() {
+	std::shared_ptr< const SearchTable > table;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		// Only the table of the most recent snapshot is current.
+		if (!_result || _resultId != _lastRequest) return;
+		table.swap(_result);
+	}
+	_table = table;
+	_recent.erase(_recent.begin(), _recent.begin() + _recentBuilt);
+	_stale -= _staleBuilt;
+	_recentBuilt = 0;
+	_staleBuilt = 0;
+	_building = false;
+	considerRebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneSearchIndex::workerLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (!_hasRequest && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_stopping) return;
+
+		const unsigned int id = _lastRequest;
+		std::vector<SearchTable::Entry> entries;
+		entries.swap(_request);
+		_hasRequest = false;
+		lock.unlock();
+
+		std::shared_ptr< SearchTable > table(new SearchTable());
+		table->build(entries);
+
+		lock.lock();
+		if (id == _lastRequest) {
+			_result = table;
+			_resultId = id;
+			emit tableBuilt();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,430 @@
+/*!
+ *	@file		SceneSearchIndex.hpp
+ *	@brief		A type-ahead search index of the scene's elements.
+ */
+
+#ifndef __SCENE_SEARCH_INDEX_H__
+#define	__SCENE_SEARCH_INDEX_H__
+
+#include "LiveObstacleSet.h"
+#include "SearchTable.h"
+
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class FSMGraph;
+
+/*!
+ *	@brief		Finds the scene's elements -- obstacles and behavior states -- by type, name
+ *				and identifier as the user types.
+ *
+ *	The bulk of the elements are found through a SearchTable, which is built on a worker
+ *	thread.  The index is kept current as the obstacle set is edited: elements added
+ *	since the table was built are kept in a short list which is searched exhaustively,
+ *	removed elements are skipped when they are found in the table, and the table is
+ *	rebuilt in the background once the list (or the number of removed elements) exceeds
+ *	REBUILD_THRESHOLD.  A burst of additions (e.g., loading a scene) which grows the list
+ *	past MAX_RECENT is indexed at once, on the calling thread, so the list stays short
+ *	even while a table is being built.  A query only examines the candidates of its most selective word
+ *	and stops after MAX_RESULTS results, so its cost doesn't grow with the size of the
+ *	scene.
+ *
+ *	The elements' spatial bounds are maintained with the elements so that a result can be
+ *	framed in the view.
+ */
+class SceneSearchIndex : public QObject, public ObstacleSetListener {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		The types of elements in the index.
+	 */
+	enum ElementType {
+		OBSTACLE_ELEMENT,		/// An obstacle polygon (identified by its id).
+		STATE_ELEMENT,			/// A behavior FSM state (identified by its index).
+		ELEMENT_TYPE_COUNT		/// The number of element types.
+	};
+
+	/*!
+	 *	@brief		An element found by a query.
+	 */
+	struct Result {
+		/*!
+		 *	@brief		The element's type.
+		 */
+		ElementType	_type;
+
+		/*!
+		 *	@brief		The element's identifier.
+		 */
+		size_t	_id;
+
+		/*!
+		 *	@brief		The text presenting the element.
+		 */
+		QString	_label;
+
+		/*!
+		 *	@brief		Reports if the element has spatial bounds.
+		 */
+		bool	_hasBounds;
+
+		/*!
+		 *	@brief		The minimum corner of the element's bounds (on the x-y plane).
+		 */
+		Vector2	_min;
+
+		/*!
+		 *	@brief		The maximum corner of the element's bounds (on the x-y plane).
+		 */
+		Vector2	_max;
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent		The optional parent.
+	 */
+	SceneSearchIndex(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor.
+	 */
+	~SceneSearchIndex();
+
+	/*!
+	 *	@brief		Sets the obstacle set whose polygons are indexed.
+	 *
+	 *	@param		obstacles		The obstacle set (null to index none).  The caller
+	 *								retains ownership.
+	 */
+	void setObstacleSet(LiveObstacleSet * obstacles);
+
+	/*!
+	 *	@brief		Indexes the states of a behavior FSM (replacing those of the previous
+	 *				one).
+	 *
+	 *	@param		graph		The behavior FSM.
+	 */
+	void setBehavior(const FSMGraph & graph);
+
+	/*!
+	 *	@brief		Finds the elements matching the query.  An element matches if each word
+	 *				of the query is a prefix of its type's name, its identifier or one of the
+	 *				words of its name (ignoring case).
+	 *
+	 *	@param		text		The query.
+	 *	@param		results		The matching elements (at most MAX_RESULTS of them).
+	 */
+	void query(const QString & text, std::vector<Result> & results) const;
+
+	/*!
+	 *	@brief		Reports the current bounds of an element.
+	 *
+	 *	@param		type		The element's type.
+	 *	@param		id			The element's identifier.
+	 *	@param		minPt		The minimum corner of the element's bounds.
+	 *	@param		maxPt		The maximum corner of the element's bounds.
+	 *	@returns	True if the element is indexed and has bounds.
+	 */
+	bool getBounds(ElementType type, size_t id, Vector2 & minPt, Vector2 & maxPt) const;
+
+	/*!
+	 *	@brief		The most results a query reports.
+	 */
+	static const size_t MAX_RESULTS;
+
+	/*!
+	 *	@brief		The number of changes after which the table is rebuilt.
+	 */
+	static const size_t REBUILD_THRESHOLD;
+
+	/*!
+	 *	@brief		The number of elements added since the table was built above which the
+	 *				table is rebuilt immediately, rather than in the background.
+	 */
+	static const size_t MAX_RECENT;
+
+	///////////////////////////////////////////////////////////////////////////////////
+	//			ObstacleSetListener interface
+	///////////////////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Indexes the new polygon.
+	 *
+	 *	@param		index		The position of the new polygon.
+	 */
+	virtual void polygonAdded(size_t index);
+
+	/*!
+	 *	@brief		Indexes the new polygons; the table is rebuilt (at most) once.
+	 *
+	 *	@param		first		The position of the first new polygon.
+	 *	@param		count		The number of new polygons.
+	 */
+	virtual void polygonsAdded(size_t first, size_t count);
+
+	/*!
+	 *	@brief		Does nothing; the polygon is removed when the removal is complete.
+	 *
+	 *	@param		index		The position of the polygon.
+	 */
+	virtual void polygonAboutToBeRemoved(size_t index) {}
+
+	/*!
+	 *	@brief		Removes the polygon from the index.
+	 *
+	 *	@param		index		The position the polygon occupied.
+	 *	@param		poly		The polygon.
+	 */
+	virtual void polygonRemoved(size_t index, const GLPolygon * poly);
+
+	/*!
+	 *	@brief		Updates the polygon's bounds.
+	 *
+	 *	@param		index		The position of the polygon.
+	 */
+	virtual void polygonChanged(size_t index);
+
+	/*!
+	 *	@brief		Updates the bounds of every polygon.
+	 */
+	virtual void allPolygonsChanged();
+
+	/*!
+	 *	@brief		Shifts the bounds of every polygon.
+	 *
+	 *	@param		dx		The shift along the x-axis.
+	 *	@param		dy		The shift along the y-axis.
+	 */
+	virtual void polygonsTranslated(double dx, double dy);
+
+	/*!
+	 *	@brief		Re-indexes the obstacle set.
+	 */
+	virtual void polygonsReset();
+
+	/*!
+	 *	@brief		Removes the obstacle set's polygons from the index.
+	 */
+	virtual void obstacleSetDestroyed();
+
+signals:
+	/*!
+	 *	@brief		Emitted (by the worker thread) when a table has been built.
+	 */
+	void tableBuilt();
+
+protected:
+
+	/*!
+	 *	@brief		An indexed element.
+	 */
+	struct Element {
+		/*!
+		 *	@brief		The element's name.
+		 */
+		QString	_name;
+
+		/*!
+		 *	@brief		The element's name folded to lower case (and encoded in UTF-8).
+		 */
+		std::string	_folded;
+
+		/*!
+		 *	@brief		Reports if the element has spatial bounds.
+		 */
+		bool	_hasBounds;
+
+		/*!
+		 *	@brief		The minimum corner of the element's bounds.
+		 */
+		Vector2	_min;
+
+		/*!
+		 *	@brief		The maximum corner of the element's bounds.
+		 */
+		Vector2	_max;
+	};
+
+	/*!
+	 *	@brief		Adds (or replaces) an element.
+	 *
+	 *	@param		key			The element's key.
+	 *	@param		element		The element.
+	 */
+	void addElement(SearchKey key, const Element & element);
+
+	/*!
+	 *	@brief		Removes an element.
+	 *
+	 *	@param		key			The element's key.
+	 */
+	void removeElement(SearchKey key);
+
+	/*!
+	 *	@brief		Indexes every polygon of the obstacle set.
+	 */
+	void addObstacles();
+
+	/*!
+	 *	@brief		Removes every obstacle from the index.
+	 */
+	void removeObstacles();
+
+	/*!
+	 *	@brief		Computes the bounds of a polygon.
+	 *
+	 *	@param		poly		The polygon.
+	 *	@param		element		The polygon's element; its bounds are set.
+	 */
+	static void setBounds(const GLPolygon * poly, Element & element);
+
+	/*!
+	 *	@brief		Reports if an element matches every word of a query.
+	 *
+	 *	@param		key			The element's key.
+	 *	@param		element		The element.
+	 *	@param		words		The query's words (folded to lower case).
+	 */
+	bool matches(SearchKey key, const Element & element, const std::vector<std::string> & words) const;
+
+	/*!
+	 *	@brief		Rebuilds the table if enough has changed since it was built.
+	 */
+	void considerRebuild();
+
+	/*!
+	 *	@brief		Hands a snapshot of the elements to the worker thread to build a table.
+	 */
+	void requestRebuild();
+
+	/*!
+	 *	@brief		Builds the table on the calling thread; a table being built by the worker
+	 *				thread is discarded.
+	 */
+	void rebuildNow();
+
+	/*!
+	 *	@brief		Takes a snapshot of the elements.
+	 *
+	 *	@param		entries		The elements' keys and names are written here.
+	 */
+	void collectEntries(std::vector<SearchTable::Entry> & entries) const;
+
+	/*!
+	 *	@brief		Adopts the table built by the worker thread.
+	 */
+	void adoptTable();
+
+	/*!
+	 *	@brief		The worker thread's loop.
+	 */
+	void workerLoop();
+
+	/*!
+	 *	@brief		The indexed obstacle set.
+	 */
+	LiveObstacleSet * _obstacles;
+
+	/*!
+	 *	@brief		The number of indexed behavior states.
+	 */
+	size_t	_stateCount;
+
+	/*!
+	 *	@brief		The names of the element types (folded to lower case).
+	 */
+	std::vector<std::string>	_typeNames;
+
+	/*!
+	 *	@brief		The indexed elements.
+	 */
+	std::unordered_map<SearchKey, Element>	_elements;
+
+	/*!
+	 *	@brief		The table in use.
+	 */
+	std::shared_ptr< const SearchTable >	_table;
+
+	/*!
+	 *	@brief		The elements added (or renamed) since the table in use was requested.
+	 */
+	std::vector<SearchKey>	_recent;
+
+	/*!
+	 *	@brief		The number of elements removed (or renamed) since the table in use was
+	 *				requested; they remain in the table.
+	 */
+	size_t	_stale;
+
+	/*!
+	 *	@brief		The number of leading entries of _recent included in the table being
+	 *				built.
+	 */
+	size_t	_recentBuilt;
+
+	/*!
+	 *	@brief		The value of _stale when the table being built was requested.
+	 */
+	size_t	_staleBuilt;
+
+	/*!
+	 *	@brief		Reports if a table is being built.
+	 */
+	bool	_building;
+
+	/*!
+	 *	@brief		The worker thread.
+	 */
+	std::thread	_worker;
+
+	/*!
+	 *	@brief		Guards the state shared with the worker thread (below).
+	 */
+	std::mutex	_lock;
+
+	/*!
+	 *	@brief		Wakes the worker thread.
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		The identifier of the most recent rebuild request.
+	 */
+	unsigned int	_lastRequest;
+
+	/*!
+	 *	@brief		Reports if there is a request waiting for the worker.
+	 */
+	bool	_hasRequest;
+
+	/*!
+	 *	@brief		The snapshot of the elements waiting for the worker.
+	 */
+	std::vector<SearchTable::Entry>	_request;
+
+	/*!
+	 *	@brief		The most recently built table (if it hasn't been adopted).
+	 */
+	std::shared_ptr< const SearchTable >	_result;
+
+	/*!
+	 *	@brief		The identifier of the request which produced the result.
+	 */
+	unsigned int	_resultId;
+
+	/*!
+	 *	@brief		Reports if the worker thread should exit.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __SCENE_SEARCH_INDEX_H__
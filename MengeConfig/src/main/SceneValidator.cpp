@@ -0,0 +1,415 @@
+#include "SceneValidator.h"
+
+#include "AppLogger.hpp"
+#include "FSMGraph.h"
+#include "GLPolygon.h"
+#include "LiveObstacleSet.h"
+#include "MCException.h"
+#include "ObstacleGrid.h"
+#include "ProjectState.h"
+#include "ProjectStore.h"
+#include "ReferenceGrid.h"
+#include "ThreadPool.h"
+#include "WorldFrame.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/qfile.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qxmlstream.h>
+
+#include <algorithm>
+#include <functional>
+
+/*!
+ *	@brief		The number of polygons checked by a single task.
+ */
+const size_t POLYGONS_PER_TASK = 1024;
+
+/*!
+ *	@brief		The number of agents checked by a single task.
+ */
+const size_t AGENTS_PER_TASK = 16384;
+
+/*!
+ *	@brief		Produces the label by which an obstacle is identified in messages (the
+ *				label used by the scene hierarchy).
+ *
+ *	@param		poly		The obstacle.
+ *	@returns	The label.
+ */
+QString obstacleLabel(const GLPolygon * poly) {
+	return QString("Obstacle %1").arg((qulonglong)poly->getId());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ValidationIssue
+///////////////////////////////////////////////////////////////////////////////
+
+ValidationIssue::ValidationIssue(Severity severity, Check check, const std::string & message) : _severity(severity), _check(check), _message(message), _location(NO_LOCATION), _min(0.f, 0.f), _max(0.f, 0.f), _state(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ValidationIssue::setWorldLocation(const Vector2 & minPt, const Vector2 & maxPt) {
+	_location = WORLD_LOCATION;
+	_min = minPt;
+	_max = maxPt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ValidationIssue::setStateLocation(size_t state) {
+	_location = STATE_LOCATION;
+	_state = state;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SceneValidator
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t SceneValidator::MAX_LOGGED = 100;
+
+///////////////////////////////////////////////////////////////////////////////
+
+SceneValidator::SceneValidator() : _obstacles(0x0), _agents(0x0), _grid(0x0), _behavior(0x0), _issues(), _elapsed(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::validate() {
+	QElapsedTimer timer;
+	timer.start();
+	_issues.clear();
+
+	std::vector< std::function< void(IssueList &) > > tasks;
+	if (_obstacles != 0x0) {
+		// The containment index is built lazily; it must exist before the tasks query it.
+		_obstacles->getObstacleGrid();
+		const size_t count = _obstacles->getPolygonCount();
+		for (size_t begin = 0; begin < count; begin += POLYGONS_PER_TASK) {
+			const size_t end = std::min(count, begin + POLYGONS_PER_TASK);
+			tasks.push_back([=](IssueList & issues) { checkObstacles(begin, end, issues); });
+		}
+	}
+	if (_agents != 0x0 && (_obstacles != 0x0 || _grid != 0x0)) {
+		const size_t count = _agents->size();
+		for (size_t begin = 0; begin < count; begin += AGENTS_PER_TASK) {
+			const size_t end = std::min(count, begin + AGENTS_PER_TASK);
+			tasks.push_back([=](IssueList & issues) { checkAgents(begin, end, issues); });
+		}
+	}
+	if (_behavior != 0x0 && _behavior->getStateCount() > 0) {
+		tasks.push_back([=](IssueList & issues) { checkBehavior(issues); });
+	}
+
+	// Each task writes only its own list; the lists are joined in task order.
+	std::vector<IssueList> results(tasks.size());
+	ThreadPool::instance()->parallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; ++t) {
+			tasks[t](results[t]);
+		}
+	});
+	for (const IssueList & issues : results) {
+		_issues.insert(_issues.end(), issues.begin(), issues.end());
+	}
+	_elapsed = timer.elapsed();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t SceneValidator::getIssueCount(ValidationIssue::Severity severity) const {
+	size_t count = 0;
+	for (const ValidationIssue & issue : _issues) {
+		if (issue._severity == severity) ++count;
+	}
+	return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::log() const {
+	size_t logged[ValidationIssue::CHECK_COUNT] = { 0 };
+	for (const ValidationIssue & issue : _issues) {
+		if (logged[issue._check]++ >= MAX_LOGGED) continue;
+		std::string msg = QString::fromStdString(issue._message).toHtmlEscaped().toStdString();
+		if (issue._location == ValidationIssue::WORLD_LOCATION) {
+			QString text = QString("(%1, %2)").arg(0.5f * (issue._min._x + issue._max._x)).arg(0.5f * (issue._min._y + issue._max._y));
+			msg += " " + AppLogger::worldLink(text.toStdString(), issue._min, issue._max);
+		}
+		else if (issue._location == ValidationIssue::STATE_LOCATION) {
+			msg += " " + AppLogger::stateLink("(show)", issue._state);
+		}
+		AppLogger::logStream << (issue._severity == ValidationIssue::ERROR_ISSUE ? AppLogger::ERROR_MSG : AppLogger::WARN_MSG);
+		AppLogger::logStream << msg << AppLogger::END_MSG;
+	}
+	for (size_t c = 0; c < ValidationIssue::CHECK_COUNT; ++c) {
+		if (logged[c] > MAX_LOGGED) {
+			AppLogger::logStream << AppLogger::WARN_MSG << (logged[c] - MAX_LOGGED);
+			AppLogger::logStream << " similar issues were not listed" << AppLogger::END_MSG;
+		}
+	}
+	const size_t errors = getIssueCount(ValidationIssue::ERROR_ISSUE);
+	const size_t warnings = getIssueCount(ValidationIssue::WARNING_ISSUE);
+	AppLogger::logStream << (errors > 0 ? AppLogger::ERROR_MSG : (warnings > 0 ? AppLogger::WARN_MSG : AppLogger::INFO_MSG));
+	AppLogger::logStream << "Validated the scene in " << _elapsed << " ms: " << errors << " errors, ";
+	AppLogger::logStream << warnings << " warnings" << AppLogger::END_MSG;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::print(std::ostream & out) const {
+	for (const ValidationIssue & issue : _issues) {
+		out << (issue._severity == ValidationIssue::ERROR_ISSUE ? "error: " : "warning: ") << issue._message;
+		if (issue._location == ValidationIssue::WORLD_LOCATION) {
+			out << " at (" << issue._min._x << ", " << issue._min._y << ")";
+			if (issue._min._x != issue._max._x || issue._min._y != issue._max._y) {
+				out << "-(" << issue._max._x << ", " << issue._max._y << ")";
+			}
+		}
+		out << "\n";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SceneValidator::runCommandLine(const QStringList & args, std::ostream & out) {
+	QString projectPath, behaviorPath, agentsPath;
+	bool strict = false;
+	bool usable = args.size() >= 2 && args[0] == "--validate";
+	for (int i = 2; usable && i < args.size(); ++i) {
+		if (args[i] == "--strict") {
+			strict = true;
+		}
+		else if (args[i] == "--behavior" && i + 1 < args.size()) {
+			behaviorPath = args[++i];
+		}
+		else if (args[i] == "--agents" && i + 1 < args.size()) {
+			agentsPath = args[++i];
+		}
+		else {
+			usable = false;
+		}
+	}
+	if (!usable) {
+		out << "usage: MengeConfig --validate <project> [--behavior <file>] [--agents <file>] [--strict]\n";
+		return 2;
+	}
+	projectPath = args[1];
+
+	ProjectState state;
+	LiveObstacleSet obstacles;
+	ReferenceGrid grid;
+	FSMGraph behavior;
+	std::vector<Vector2> agents;
+	try {
+		ProjectStore store;
+		store.open(projectPath, state);
+		store.close();
+		if (!behaviorPath.isEmpty()) behavior.loadBehavior(behaviorPath);
+		if (!agentsPath.isEmpty()) {
+			WorldFrame frame;
+			frame.setOrigin(state._settings._originX, state._settings._originY);
+			readAgents(agentsPath, frame, agents);
+		}
+	}
+	catch (MCException & e) {
+		out << "error: " << e.what() << "\n";
+		return 2;
+	}
+	obstacles.restore(state._polygons);
+
+	SceneValidator validator;
+	validator.setObstacles(&obstacles);
+	if (state._settings._gridActive) {
+		grid.setOrigin(state._settings._gridOriginX, state._settings._gridOriginY);
+		grid.setSize(state._settings._gridWidth, state._settings._gridHeight);
+		validator.setReferenceGrid(&grid);
+	}
+	if (!behaviorPath.isEmpty()) validator.setBehavior(&behavior);
+	if (!agentsPath.isEmpty()) validator.setAgents(&agents);
+	validator.validate();
+	validator.print(out);
+
+	const size_t errors = validator.getIssueCount(ValidationIssue::ERROR_ISSUE);
+	const size_t warnings = validator.getIssueCount(ValidationIssue::WARNING_ISSUE);
+	out << projectPath.toStdString() << ": " << errors << " errors, " << warnings << " warnings (";
+	out << obstacles.getPolygonCount() << " obstacles, " << agents.size() << " agents, ";
+	out << behavior.getStateCount() << " states validated in " << validator.getElapsed() << " ms)\n";
+	return (errors > 0 || (strict && warnings > 0)) ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::readAgents(const QString & fileName, const WorldFrame & frame, std::vector<Vector2> & agents) {
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw MCException("Unable to open the agent file " + fileName.toStdString() + ": " + file.errorString().toStdString());
+	}
+	QXmlStreamReader xml(&file);
+	while (!xml.atEnd()) {
+		if (xml.readNext() != QXmlStreamReader::StartElement || xml.name() != "Agent") continue;
+		bool validX, validY;
+		const double x = xml.attributes().value("p_x").toDouble(&validX);
+		const double y = xml.attributes().value("p_y").toDouble(&validY);
+		if (!validX || !validY) {
+			throw MCException(QString("Line %1 of %2: agents require numeric p_x and p_y attributes").arg(xml.lineNumber()).arg(fileName).toStdString());
+		}
+		agents.push_back(frame.toLocal(x, y));
+	}
+	if (xml.hasError()) {
+		throw MCException(QString("Line %1 of %2: %3").arg(xml.lineNumber()).arg(fileName).arg(xml.errorString()).toStdString());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::checkObstacles(size_t begin, size_t end, IssueList & issues) const {
+	for (size_t p = begin; p < end; ++p) {
+		// The polygon's cached bounds are left alone; they aren't safe to compute concurrently.
+		const GLPolygon * poly = _obstacles->getPolygon(p);
+		const size_t count = poly->getVertexCount();
+		if (count == 0) {
+			issues.push_back(ValidationIssue(ValidationIssue::ERROR_ISSUE, ValidationIssue::OBSTACLE_CHECK, (obstacleLabel(poly) + " has no vertices").toStdString()));
+			continue;
+		}
+		Vector2 minPt(poly->getVertex(0)._x, poly->getVertex(0)._y);
+		Vector2 maxPt(minPt);
+		size_t repeated = 0;
+		float area = 0.f;
+		for (size_t i = 0; i < count; ++i) {
+			const Vector3 & v0 = poly->getVertex(i);
+			const Vector3 & v1 = poly->getVertex((i + 1) % count);
+			if (v0._x == v1._x && v0._y == v1._y) ++repeated;
+			area += v0._x * v1._y - v1._x * v0._y;
+			minPt.set(std::min(minPt._x, v0._x), std::min(minPt._y, v0._y));
+			maxPt.set(std::max(maxPt._x, v0._x), std::max(maxPt._y, v0._y));
+		}
+
+		if (count - repeated < 3) {
+			ValidationIssue issue(ValidationIssue::ERROR_ISSUE, ValidationIssue::OBSTACLE_CHECK, (obstacleLabel(poly) + " has fewer than three distinct vertices").toStdString());
+			issue.setWorldLocation(minPt, maxPt);
+			issues.push_back(issue);
+		}
+		else if (area == 0.f) {
+			ValidationIssue issue(ValidationIssue::ERROR_ISSUE, ValidationIssue::OBSTACLE_CHECK, (obstacleLabel(poly) + " encloses no area").toStdString());
+			issue.setWorldLocation(minPt, maxPt);
+			issues.push_back(issue);
+		}
+		else {
+			if (area < 0.f) {
+				ValidationIssue issue(ValidationIssue::WARNING_ISSUE, ValidationIssue::OBSTACLE_CHECK, (obstacleLabel(poly) + " is clockwise; Menge treats it as a boundary rather than a solid obstacle").toStdString());
+				issue.setWorldLocation(minPt, maxPt);
+				issues.push_back(issue);
+			}
+			if (repeated > 0) {
+				ValidationIssue issue(ValidationIssue::WARNING_ISSUE, ValidationIssue::OBSTACLE_CHECK, (obstacleLabel(poly) + QString(" has %1 zero-length edges").arg((qulonglong)repeated)).toStdString());
+				issue.setWorldLocation(minPt, maxPt);
+				issues.push_back(issue);
+			}
+		}
+
+		if (!onGrid(minPt) || !onGrid(maxPt)) {
+			ValidationIssue issue(ValidationIssue::WARNING_ISSUE, ValidationIssue::EXTENT_CHECK, (obstacleLabel(poly) + " extends beyond the reference grid").toStdString());
+			issue.setWorldLocation(minPt, maxPt);
+			issues.push_back(issue);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::checkAgents(size_t begin, size_t end, IssueList & issues) const {
+	const ObstacleGrid * solids = _obstacles != 0x0 ? &_obstacles->getObstacleGrid() : 0x0;
+	const std::vector<Vector2> & agents = *_agents;
+	for (size_t a = begin; a < end; ++a) {
+		const Vector2 & p = agents[a];
+		if (solids != 0x0 && solids->contains(p)) {
+			ValidationIssue issue(ValidationIssue::ERROR_ISSUE, ValidationIssue::AGENT_CHECK, QString("Agent %1 starts inside an obstacle").arg((qulonglong)a).toStdString());
+			issue.setWorldLocation(p, p);
+			issues.push_back(issue);
+		}
+		if (!onGrid(p)) {
+			ValidationIssue issue(ValidationIssue::WARNING_ISSUE, ValidationIssue::EXTENT_CHECK, QString("Agent %1 starts outside the reference grid").arg((qulonglong)a).toStdString());
+			issue.setWorldLocation(p, p);
+			issues.push_back(issue);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneValidator::checkBehavior(IssueList & issues) const {
+	const FSMGraph & fsm = *_behavior;
+	const size_t S = fsm.getStateCount();
+	const size_t T = fsm.getTransitionCount();
+	std::vector<size_t> outgoing(S, 0);
+	std::vector< std::vector<size_t> > sources(S);
+	for (size_t t = 0; t < T; ++t) {
+		const FSMGraph::Transition & trans = fsm.getTransition(t);
+		++outgoing[trans._from];
+		sources[trans._to].push_back(trans._from);
+		if (trans._condition.trimmed().isEmpty()) {
+			QString msg = QString("The transition from state \"%1\" to state \"%2\" has no condition").arg(fsm.getState(trans._from)._name).arg(fsm.getState(trans._to)._name);
+			ValidationIssue issue(ValidationIssue::ERROR_ISSUE, ValidationIssue::BEHAVIOR_CHECK, msg.toStdString());
+			issue.setStateLocation(trans._from);
+			issues.push_back(issue);
+		}
+	}
+
+	// The agents' goal is a final state; search backwards from the final states for the
+	//	states which can reach one.
+	std::vector<bool> reaches(S, false);
+	std::vector<size_t> frontier;
+	for (size_t s = 0; s < S; ++s) {
+		if (fsm.getState(s)._final) {
+			reaches[s] = true;
+			frontier.push_back(s);
+		}
+	}
+	const bool hasFinal = !frontier.empty();
+	while (!frontier.empty()) {
+		const size_t s = frontier.back();
+		frontier.pop_back();
+		for (size_t from : sources[s]) {
+			if (!reaches[from]) {
+				reaches[from] = true;
+				frontier.push_back(from);
+			}
+		}
+	}
+	if (!hasFinal) {
+		issues.push_back(ValidationIssue(ValidationIssue::WARNING_ISSUE, ValidationIssue::BEHAVIOR_CHECK, "The behavior has no final state; its agents never finish"));
+	}
+
+	for (size_t s = 0; s < S; ++s) {
+		const FSMGraph::State & state = fsm.getState(s);
+		QString msg;
+		ValidationIssue::Severity severity = ValidationIssue::WARNING_ISSUE;
+		if (state._final && outgoing[s] > 0) {
+			msg = QString("Final state \"%1\" has transitions; they are never taken").arg(state._name);
+		}
+		else if (!state._final && outgoing[s] == 0) {
+			msg = QString("State \"%1\" is neither final nor has transitions; its agents never leave it").arg(state._name);
+			severity = ValidationIssue::ERROR_ISSUE;
+		}
+		else if (hasFinal && !reaches[s]) {
+			msg = QString("No final state can be reached from state \"%1\"").arg(state._name);
+		}
+		if (!msg.isEmpty()) {
+			ValidationIssue issue(severity, ValidationIssue::BEHAVIOR_CHECK, msg.toStdString());
+			issue.setStateLocation(s);
+			issues.push_back(issue);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SceneValidator::onGrid(const Vector2 & p) const {
+	if (_grid == 0x0) return true;
+	const Vector2 origin = _grid->getOrigin();
+	const Vector2 size = _grid->getSize();
+	return p._x >= origin._x && p._x <= origin._x + size._x && p._y >= origin._y && p._y <= origin._y + size._y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,308 @@
+/*!
+ *	@file		SceneValidator.h
+ *	@brief		The definition of the checks run on a scene before it is simulated.
+ */
+
+#ifndef __SCENE_VALIDATOR_H__
+#define	__SCENE_VALIDATOR_H__
+
+#include <QtCore/qglobal.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+// forward declarations
+QT_BEGIN_NAMESPACE
+class QString;
+class QStringList;
+QT_END_NAMESPACE
+class FSMGraph;
+class LiveObstacleSet;
+class ReferenceGrid;
+class WorldFrame;
+
+/*!
+ *	@brief		A problem found in a scene.
+ */
+struct ValidationIssue {
+	/*!
+	 *	@brief		The severity of an issue.
+	 */
+	enum Severity {
+		WARNING_ISSUE,		/// The scene can be simulated, but probably not as intended.
+		ERROR_ISSUE			/// The scene can't be simulated as it is.
+	};
+
+	/*!
+	 *	@brief		The checks which find issues.
+	 */
+	enum Check {
+		OBSTACLE_CHECK,		/// The obstacles' shapes and winding.
+		AGENT_CHECK,		/// The agents' initial positions.
+		EXTENT_CHECK,		/// The coverage of the scene by the reference grid.
+		BEHAVIOR_CHECK,		/// The structure of the behavior FSM.
+		CHECK_COUNT			/// The number of checks.
+	};
+
+	/*!
+	 *	@brief		The kinds of locations an issue refers to.
+	 */
+	enum LocationKind {
+		NO_LOCATION,		/// The issue has no particular location.
+		WORLD_LOCATION,		/// A region of the ground plane (_min, _max).
+		STATE_LOCATION		/// A state of the behavior FSM (_state).
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		severity		The severity of the issue.
+	 *	@param		check			The check which found the issue.
+	 *	@param		message			The description of the issue.
+	 */
+	ValidationIssue(Severity severity, Check check, const std::string & message);
+
+	/*!
+	 *	@brief		Locates the issue in a region of the ground plane.
+	 *
+	 *	@param		minPt		The minimum corner of the region.
+	 *	@param		maxPt		The maximum corner of the region.
+	 */
+	void setWorldLocation(const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Locates the issue at a state of the behavior FSM.
+	 *
+	 *	@param		state		The index of the state.
+	 */
+	void setStateLocation(size_t state);
+
+	/*!
+	 *	@brief		The severity of the issue.
+	 */
+	Severity	_severity;
+
+	/*!
+	 *	@brief		The check which found the issue.
+	 */
+	Check	_check;
+
+	/*!
+	 *	@brief		The description of the issue (plain text, without its location).
+	 */
+	std::string	_message;
+
+	/*!
+	 *	@brief		The kind of location the issue refers to.
+	 */
+	LocationKind	_location;
+
+	/*!
+	 *	@brief		The minimum corner of the issue's region (for WORLD_LOCATION).
+	 */
+	Vector2	_min;
+
+	/*!
+	 *	@brief		The maximum corner of the issue's region (for WORLD_LOCATION).
+	 */
+	Vector2	_max;
+
+	/*!
+	 *	@brief		The index of the issue's state (for STATE_LOCATION).
+	 */
+	size_t	_state;
+};
+
+/*!
+ *	@brief		Verifies that a scene is fit to be simulated.
+ *
+ *	The checks cover whichever parts of the scene have been provided:
+ *		- obstacles: every polygon has at least three distinct vertices, encloses an area
+ *			and is counter-clockwise (Menge's solid obstacles; clockwise polygons are only
+ *			expected as boundaries).
+ *		- agents: no agent starts inside a solid obstacle.
+ *		- extent: the obstacles and agents lie on the reference grid.
+ *		- behavior: every transition has a condition, final states have no transitions,
+ *			other states have a way out and a final state (the agents' goal) is reachable
+ *			from every state.
+ *
+ *	The checks are divided into independent tasks (e.g., a range of polygons or agents)
+ *	which are executed on the ThreadPool.  Each task collects its own issues; they are
+ *	concatenated in task order, so the report is the same from run to run regardless of the
+ *	number of threads.  The scene must not change while it is validated.
+ */
+class SceneValidator {
+public:
+	/*!
+	 *	@brief		Constructor -- a validator of an empty scene.
+	 */
+	SceneValidator();
+
+	/*!
+	 *	@brief		Sets the obstacles to validate.
+	 *
+	 *	@param		obstacles		The obstacles (null to skip the obstacle checks).
+	 */
+	void setObstacles(const LiveObstacleSet * obstacles) { _obstacles = obstacles; }
+
+	/*!
+	 *	@brief		Sets the agents' initial positions to validate.
+	 *
+	 *	@param		agents		The positions (null to skip the agent checks).
+	 */
+	void setAgents(const std::vector<Vector2> * agents) { _agents = agents; }
+
+	/*!
+	 *	@brief		Sets the reference grid which should cover the scene.
+	 *
+	 *	@param		grid		The grid (null to skip the extent checks).
+	 */
+	void setReferenceGrid(const ReferenceGrid * grid) { _grid = grid; }
+
+	/*!
+	 *	@brief		Sets the behavior FSM to validate.
+	 *
+	 *	@param		behavior		The FSM (null to skip the behavior checks).
+	 */
+	void setBehavior(const FSMGraph * behavior) { _behavior = behavior; }
+
+	/*!
+	 *	@brief		Runs the checks, replacing the issues of the previous run.
+	 */
+	void validate();
+
+	/*!
+	 *	@brief		Reports the issues found by the last run.
+	 */
+	const std::vector<ValidationIssue> & getIssues() const { return _issues; }
+
+	/*!
+	 *	@brief		Reports the number of issues of the given severity found by the last run.
+	 */
+	size_t getIssueCount(ValidationIssue::Severity severity) const;
+
+	/*!
+	 *	@brief		Reports the duration (in milliseconds) of the last run.
+	 */
+	qint64 getElapsed() const { return _elapsed; }
+
+	/*!
+	 *	@brief		Writes the issues to the AppLogger; the locations are links which frame
+	 *				the region or show the state.  At most MAX_LOGGED issues of each check
+	 *				are written.
+	 */
+	void log() const;
+
+	/*!
+	 *	@brief		Writes the issues as plain text, one per line.
+	 *
+	 *	@param		out		The stream to write to.
+	 */
+	void print(std::ostream & out) const;
+
+	/*!
+	 *	@brief		Validates a project without presenting any GUI (for pre-flight checks in
+	 *				scripts):
+	 *
+	 *		--validate <project> [--behavior <file>] [--agents <file>] [--strict]
+	 *
+	 *	The agents are read from the <Agent> elements of an XML file (e.g., a Menge scene
+	 *	or agents exported by the agent placement tool).  The reference grid is that saved
+	 *	in the project (if it was active).
+	 *
+	 *	@param		args		The command-line arguments (excluding the program).
+	 *	@param		out			The stream the issues are written to.
+	 *	@returns	The exit code: 0 if the scene is valid, 1 if there are errors (or, with
+	 *				--strict, warnings) and 2 if the inputs can't be read.
+	 */
+	static int runCommandLine(const QStringList & args, std::ostream & out);
+
+	/*!
+	 *	@brief		Reads agent positions from the <Agent p_x="" p_y=""> elements of an XML
+	 *				file.
+	 *
+	 *	@param		fileName		The path to the file.
+	 *	@param		frame			The frame the positions are converted to (they are read
+	 *								in world coordinates).
+	 *	@param		agents			The positions are appended here.
+	 *	@throws		MCException if the file can't be read.
+	 */
+	static void readAgents(const QString & fileName, const WorldFrame & frame, std::vector<Vector2> & agents);
+
+	/*!
+	 *	@brief		The most issues of a single check written to the log.
+	 */
+	static const size_t MAX_LOGGED;
+
+protected:
+	/*!
+	 *	@brief		A task's issues.
+	 */
+	typedef std::vector<ValidationIssue> IssueList;
+
+	/*!
+	 *	@brief		Checks a range of the obstacles.
+	 *
+	 *	@param		begin		The index of the first polygon.
+	 *	@param		end			One past the index of the last polygon.
+	 *	@param		issues		The issues found are appended here.
+	 */
+	void checkObstacles(size_t begin, size_t end, IssueList & issues) const;
+
+	/*!
+	 *	@brief		Checks a range of the agents.
+	 *
+	 *	@param		begin		The index of the first agent.
+	 *	@param		end			One past the index of the last agent.
+	 *	@param		issues		The issues found are appended here.
+	 */
+	void checkAgents(size_t begin, size_t end, IssueList & issues) const;
+
+	/*!
+	 *	@brief		Checks the behavior FSM.
+	 *
+	 *	@param		issues		The issues found are appended here.
+	 */
+	void checkBehavior(IssueList & issues) const;
+
+	/*!
+	 *	@brief		Reports if a point lies on the reference grid (always true without a grid).
+	 */
+	bool onGrid(const Vector2 & p) const;
+
+	/*!
+	 *	@brief		The obstacles to validate.
+	 */
+	const LiveObstacleSet *	_obstacles;
+
+	/*!
+	 *	@brief		The agents' initial positions.
+	 */
+	const std::vector<Vector2> *	_agents;
+
+	/*!
+	 *	@brief		The reference grid.
+	 */
+	const ReferenceGrid *	_grid;
+
+	/*!
+	 *	@brief		The behavior FSM.
+	 */
+	const FSMGraph *	_behavior;
+
+	/*!
+	 *	@brief		The issues found by the last run.
+	 */
+	std::vector<ValidationIssue>	_issues;
+
+	/*!
+	 *	@brief		The duration of the last run (in milliseconds).
+	 */
+	qint64	_elapsed;
+};
+
+#endif	// __SCENE_VALIDATOR_H__
@@ -1,12 +1,29 @@
 #include "SceneViewer.hpp"
 
+#include "AgentPlacementContext.h"
+#include "AppLogger.hpp"
 #include "ContextManager.hpp"
+#include "GeometryWorker.hpp"
 #include "glwidget.hpp"
 #include "ObstacleContext.hpp"
+#include "LiveObstacleSet.h"
+#include "MapImporter.h"
+#include "MapImportWorker.hpp"
+#include "MCException.h"
+#include "PickBuffer.h"
+#include "ProjectState.h"
+#include "SimplifyJob.h"
+#include "TileLayer.hpp"
+#include "UnderlayNode.hpp"
+#include "WorldFrame.h"
+
+#include <QtCore/QElapsedTimer>
 
 #include <QtWidgets/qaction.h>
 #include <QtWidgets/QBoxLayout.h>
 #include <QtWidgets/qcombobox.h>
+#include <QtWidgets/qfiledialog.h>
+#include <QtWidgets/qinputdialog.h>
 #include <QtWidgets/QLabel.h>
 #include <QtWidgets/qToolbar.h>
 
@@ -14,7 +31,16 @@
 //						Implementation of SceneViewer
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent) {
+SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent), _obstacleContext(0x0), _agentContext(0x0), _geometryWorker(0x0), _tileLayer(0x0), _mapImportWorker(0x0) {
+	_obstacleContext = new ObstacleContext();
+	_agentContext = new AgentPlacementContext(_obstacleContext->getLiveObstacleSet());
+	_geometryWorker = new GeometryWorker(_obstacleContext->getLiveObstacleSet(), this);
+	connect(_geometryWorker, &GeometryWorker::mergingEdits, _obstacleContext, &ObstacleContext::releaseEdited);
+	_tileLayer = new TileLayer(this);
+	_mapImportWorker = new MapImportWorker(this);
+	// The worker emits its signal from its own thread; it is delivered on the GUI thread.
+	connect(_mapImportWorker, &MapImportWorker::mapRead, this, &SceneViewer::insertMaps);
+
 	QVBoxLayout * mainLayout = new QVBoxLayout();
 
 	_toolBar = new QToolBar();
@@ -23,6 +49,7 @@ SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent) {
 
 	_glView = new GLWidget();
 	mainLayout->addWidget(_glView, 1);
+	_agentContext->setWorldFrame(&_glView->getWorldFrame());
 
 	_statusLabel = new QLabel("Scene Viewer:");
 	QHBoxLayout * statusLayout = new QHBoxLayout();
@@ -42,12 +69,12 @@ SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent) {
 	_toolBar->addAction(togAxisAct);
 	connect(togAxisAct, &QAction::triggered, _glView, &GLWidget::setDrawAxis);
 
-	QAction * togPerspAct = new QAction(QIcon(":/images/togglePersp.png"), tr("Toggle &Perspective"), this);
-	togPerspAct->setCheckable(true);
-	togPerspAct->setChecked(true);
-	togPerspAct->setToolTip(tr("Toggle the current camera's projection between perspective and orthographic"));
-	_toolBar->addAction(togPerspAct);
-	connect(togPerspAct, &QAction::triggered, _glView, &GLWidget::toggleProjection);
+	_togPerspAct = new QAction(QIcon(":/images/togglePersp.png"), tr("Toggle &Perspective"), this);
+	_togPerspAct->setCheckable(true);
+	_togPerspAct->setChecked(true);
+	_togPerspAct->setToolTip(tr("Toggle the current camera's projection between perspective and orthographic"));
+	_toolBar->addAction(_togPerspAct);
+	connect(_togPerspAct, &QAction::triggered, _glView, &GLWidget::toggleProjection);
 
 	_dirComboBox = new QComboBox();
 	_dirComboBox->setEditable(false);
@@ -62,12 +89,12 @@ SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent) {
 	//connect(dirComboBox, &QComboBox::currentIndexChanged, _glView, &GLWidget::setViewDirection);
 	connect(_dirComboBox, SIGNAL(activated(int)), _glView, SLOT(setViewDirection(int)));
 
-	QAction * togGridAct = new QAction(QIcon(":/images/toggleGrid.png"), tr("Toggle &Grid"), this);
-	togGridAct->setCheckable(true);
-	togGridAct->setChecked(true);
-	togGridAct->setToolTip(tr("Toggle the reference grid; an inactive grid cannot be used for snapping."));
-	_toolBar->addAction(togGridAct);
-	connect(togGridAct, &QAction::triggered, this, &SceneViewer::toggleGrid);
+	_togGridAct = new QAction(QIcon(":/images/toggleGrid.png"), tr("Toggle &Grid"), this);
+	_togGridAct->setCheckable(true);
+	_togGridAct->setChecked(true);
+	_togGridAct->setToolTip(tr("Toggle the reference grid; an inactive grid cannot be used for snapping."));
+	_toolBar->addAction(_togGridAct);
+	connect(_togGridAct, &QAction::triggered, this, &SceneViewer::toggleGrid);
 
 	QAction * gridPropAct = new QAction(QIcon(":/images/gridProperties.png"), tr("Grid &Properties"), this);
 	gridPropAct->setToolTip(tr("Edit the reference grid's properties."));
@@ -88,8 +115,36 @@ SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent) {
 	_toolBar->addAction(_gridVSnap);
 	connect(_gridVSnap, &QAction::triggered, _glView, &GLWidget::toggleVerticalSnap);
 
+	// Snapping to obstacle geometry works with or without the grid.
+	_toolBar->addSeparator();
+	_vertexSnap = new QAction(tr("Snap V&ertex"), this);
+	_vertexSnap->setCheckable(true);
+	_vertexSnap->setChecked(false);
+	_vertexSnap->setToolTip(tr("Causes mouse selection points to snap to nearby obstacle vertices."));
+	_toolBar->addAction(_vertexSnap);
+	connect(_vertexSnap, &QAction::triggered, _glView, &GLWidget::toggleVertexSnap);
+
+	_edgeSnap = new QAction(tr("Snap E&dge"), this);
+	_edgeSnap->setCheckable(true);
+	_edgeSnap->setChecked(false);
+	_edgeSnap->setToolTip(tr("Causes mouse selection points to snap to nearby obstacle edges."));
+	_toolBar->addAction(_edgeSnap);
+	connect(_edgeSnap, &QAction::triggered, _glView, &GLWidget::toggleEdgeSnap);
+
+	_intersectionSnap = new QAction(tr("Snap &Intersection"), this);
+	_intersectionSnap->setCheckable(true);
+	_intersectionSnap->setChecked(false);
+	_intersectionSnap->setToolTip(tr("Causes mouse selection points to snap to nearby crossings of obstacle edges."));
+	_toolBar->addAction(_intersectionSnap);
+	connect(_intersectionSnap, &QAction::triggered, _glView, &GLWidget::toggleIntersectionSnap);
+	_glView->setSnapObstacles(_obstacleContext->getLiveObstacleSet());
+	_glView->setTileLayer(_tileLayer);
+	connect(_tileLayer, &TileLayer::changed, [=]() { _glView->update(); });
+
 	connect(_glView, &GLWidget::userRotated, this, &SceneViewer::userRotated);
 	connect(_glView, &GLWidget::currWorldPos, this, &SceneViewer::setCurrentWorldPos);
+	connect(_glView, &GLWidget::picked, this, &SceneViewer::setPicked);
+	connect(_glView, &GLWidget::viewSettled, this, &SceneViewer::checkOrigin);
 
 	setLayout(mainLayout);
 }
@@ -97,9 +152,270 @@ SceneViewer::SceneViewer(QWidget * parent) : QWidget(parent) {
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void SceneViewer::drawObstacle() {
-	// TODO: Determine where the context comes from.
-	QtContext * ctx = new ObstacleContext();
-	ContextManager::instance()->activate(ctx);
+	ContextManager::instance()->activate(_obstacleContext);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::placeAgents() {
+	ContextManager::instance()->activate(_agentContext);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::simplifyObstacles() {
+	bool accepted = false;
+	double tolerance = QInputDialog::getDouble(this, tr("Simplify Obstacles"), tr("Tolerance (world units):"), 0.05, 0.0, 1000.0, 3, &accepted);
+	if (accepted && tolerance > 0.0) {
+		_geometryWorker->submit(std::make_shared< SimplifyJob >(static_cast<float>(tolerance)));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::centerOrigin() {
+	if (_obstacleContext->isDrawing()) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "The origin can't be moved while an obstacle is being drawn" << AppLogger::END_MSG;
+		return;
+	}
+	double x, y;
+	_glView->getWorldFrame().toWorld(_glView->getViewTarget(), x, y);
+	setWorldOrigin(WorldFrame::roundOrigin(x), WorldFrame::roundOrigin(y));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::importMap() {
+	QString path = QFileDialog::getOpenFileName(this, tr("Import Map"), QString(), tr("Vector maps (*.geojson *.json *.dxf *.shp);;All files (*.*)"));
+	if (path.isEmpty()) return;
+	if (_obstacleContext->isDrawing()) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "Maps can't be imported while an obstacle is being drawn" << AppLogger::END_MSG;
+		return;
+	}
+	_mapImportWorker->submit(path);
+	AppLogger::logStream << AppLogger::INFO_MSG << "Reading the map " << path.toStdString() << AppLogger::END_MSG;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::insertMaps() {
+	std::deque< MapImport > imports;
+	_mapImportWorker->takeFinished(imports);
+	for (const MapImport & import : imports) {
+		if (!import._error.empty()) {
+			AppLogger::logStream << AppLogger::ERROR_MSG << "Unable to import the map: " << import._error << AppLogger::END_MSG;
+			continue;
+		}
+		const MapImporter & importer = *import._importer;
+		AppLogger::logStream << AppLogger::INFO_MSG << "Read " << importer.getFeatureCount() << " features (";
+		AppLogger::logStream << (importer.getByteCount() >> 10) << " KB) from " << import._path.toStdString() << " in " << import._elapsed << " ms: ";
+		AppLogger::logStream << importer.getOutlineCount() << " outlines, " << importer.getSkippedCount() << " other features and parts";
+		AppLogger::logStream << AppLogger::END_MSG;
+		if (importer.getUtmZone() != 0) {
+			const int zone = importer.getUtmZone();
+			AppLogger::logStream << AppLogger::INFO_MSG << "The map's longitudes and latitudes were projected onto UTM zone ";
+			AppLogger::logStream << (zone < 0 ? -zone : zone) << (zone < 0 ? "S" : "N") << " (meters)" << AppLogger::END_MSG;
+		}
+		if (importer.getMalformedCount() > 0) {
+			AppLogger::logStream << AppLogger::WARN_MSG << importer.getMalformedCount() << " features of the map couldn't be read" << AppLogger::END_MSG;
+		}
+		if (_obstacleContext->isDrawing()) {
+			// The polygon being drawn is in the scene's frame; the origin mustn't move under it.
+			AppLogger::logStream << AppLogger::WARN_MSG << "The map " << import._path.toStdString() << " was discarded; maps can't be imported while an obstacle is being drawn" << AppLogger::END_MSG;
+			continue;
+		}
+		insertMap(importer);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::insertMap(const MapImporter & importer) {
+	double minX, minY, maxX, maxY;
+	if (!importer.getBounds(minX, minY, maxX, maxY)) return;
+
+	// The outlines are converted to the scene's frame once, so the origin is moved to them
+	//	first if they are far from it (see WorldFrame).
+	LiveObstacleSet * obstacles = _obstacleContext->getLiveObstacleSet();
+	const double centerX = 0.5 * (minX + maxX);
+	const double centerY = 0.5 * (minY + maxY);
+	if (obstacles->getPolygonCount() == 0 || WorldFrame::isDistant(_glView->getWorldFrame().toLocal(centerX, centerY))) {
+		setWorldOrigin(WorldFrame::roundOrigin(centerX), WorldFrame::roundOrigin(centerY));
+	}
+	QElapsedTimer timer;
+	timer.start();
+	const WorldFrame & frame = _glView->getWorldFrame();
+	const size_t count = importer.insert(*obstacles, frame);
+	AppLogger::logStream << AppLogger::INFO_MSG << "Added " << count << " obstacles in " << timer.elapsed() << " ms" << AppLogger::END_MSG;
+	frameBounds(frame.toLocal(minX, minY), frame.toLocal(maxX, maxY));
+	_glView->invalidatePick();
+	_glView->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::openTiledMap() {
+	QString path = QFileDialog::getOpenFileName(this, tr("Open Tiled Map"), QString(), tr("Tiled maps (*.mctiles);;All files (*.*)"));
+	if (path.isEmpty()) return;
+	try {
+		_tileLayer->open(path);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << "Unable to open the tiled map: " << e.what() << AppLogger::END_MSG;
+		return;
+	}
+	const TileStore & store = _tileLayer->getStore();
+	AppLogger::logStream << AppLogger::INFO_MSG << "Opened the tiled map " << path.toStdString() << ": ";
+	AppLogger::logStream << store.getPolygonCount() << " obstacles in " << store.getNodeCount() << " tiles" << AppLogger::END_MSG;
+	// The whole map is framed; framing moves the scene's origin close to it.
+	const TileNode & root = store.getNode(0);
+	const WorldFrame & frame = _glView->getWorldFrame();
+	frameBounds(frame.toLocal(root._minX, root._minY), frame.toLocal(root._minX + root._size, root._minY + root._size));
+	_glView->cameraChanged();
+	_glView->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::exportTiledMap() {
+	LiveObstacleSet * obstacles = _obstacleContext->getLiveObstacleSet();
+	if (obstacles->getPolygonCount() == 0) {
+		AppLogger::logStream << AppLogger::WARN_MSG << "There are no obstacles to export" << AppLogger::END_MSG;
+		return;
+	}
+	QString path = QFileDialog::getSaveFileName(this, tr("Export Tiled Map"), QString(), tr("Tiled maps (*.mctiles);;All files (*.*)"));
+	if (path.isEmpty()) return;
+	QElapsedTimer timer;
+	timer.start();
+	try {
+		const size_t count = TileStore::build(path, *obstacles, _glView->getWorldFrame());
+		AppLogger::logStream << AppLogger::INFO_MSG << "Exported the obstacles to " << path.toStdString() << " in ";
+		AppLogger::logStream << count << " tiles (" << timer.elapsed() << " ms)" << AppLogger::END_MSG;
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << "Unable to export the tiled map: " << e.what() << AppLogger::END_MSG;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::closeTiledMap() {
+	if (!_tileLayer->isOpen()) return;
+	_tileLayer->close();
+	_glView->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::openUnderlay() {
+	QString path = QFileDialog::getOpenFileName(this, tr("Open Underlay Image"), QString(), tr("Images (*.png *.jpg *.jpeg *.tif *.tiff *.bmp);;All files (*.*)"));
+	if (path.isEmpty()) return;
+	try {
+		_glView->openUnderlay(path);
+	}
+	catch (MCException & e) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << "Unable to open the underlay image: " << e.what() << AppLogger::END_MSG;
+		return;
+	}
+	// The image is georeferenced by the reference grid; edit the grid to place it.
+	const QSize size = _glView->getUnderlay()->getImageSize();
+	AppLogger::logStream << AppLogger::INFO_MSG << "Opened the underlay image " << path.toStdString() << " (";
+	AppLogger::logStream << size.width() << " x " << size.height() << " pixels) over the reference grid" << AppLogger::END_MSG;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::closeUnderlay() {
+	_glView->closeUnderlay();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::checkOrigin() {
+	// The obstacle being drawn isn't in the obstacle set yet; the move waits until it is.
+	if (!_obstacleContext->isDrawing() && WorldFrame::isDistant(_glView->getViewTarget())) {
+		centerOrigin();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::setWorldOrigin(double x, double y) {
+	const WorldFrame & frame = _glView->getWorldFrame();
+	// Every shift is computed in double precision and, the origins being multiples of
+	//	WorldFrame::ORIGIN_GRANULARITY, repeated rebases don't compound rounding errors.
+	const double dx = frame.getOriginX() - x;
+	const double dy = frame.getOriginY() - y;
+	if (dx == 0.0 && dy == 0.0) return;
+	QElapsedTimer timer;
+	timer.start();
+	const size_t count = _obstacleContext->getLiveObstacleSet()->translate(dx, dy);
+	_agentContext->translate(dx, dy);
+	_glView->setWorldOrigin(x, y);
+	AppLogger::logStream << AppLogger::INFO_MSG << "Moved the scene origin to (" << QString::number(x, 'f', 2).toStdString();
+	AppLogger::logStream << ", " << QString::number(y, 'f', 2).toStdString() << "); shifted " << count;
+	AppLogger::logStream << " vertices in " << timer.elapsed() << " ms" << AppLogger::END_MSG;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::getProjectChanges(ProjectSettings & settings, ObstacleChanges & changes) {
+	_glView->getViewSettings(settings);
+	_obstacleContext->getSettings(settings);
+	settings._obstacleContextActive = ContextManager::instance()->getActive() == _obstacleContext;
+	_obstacleContext->getLiveObstacleSet()->takeChanges(changes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::restoreProject(const ProjectState & state) {
+	const ProjectSettings & settings = state._settings;
+	_glView->setViewSettings(settings);
+	// The actions only report the state; the view has already been changed.
+	_togPerspAct->setChecked(settings._cameraPerspective);
+	_togGridAct->setChecked(settings._gridActive);
+	_gridHSnap->setChecked(settings._gridHSnap);
+	_gridHSnap->setEnabled(settings._gridActive);
+	_gridVSnap->setChecked(settings._gridVSnap);
+	_gridVSnap->setEnabled(settings._gridActive);
+	_dirComboBox->setCurrentIndex(0);
+
+	_obstacleContext->restoreObstacles(state._polygons);
+	_obstacleContext->setSettings(settings);
+	ContextManager * mgr = ContextManager::instance();
+	if (settings._obstacleContextActive) {
+		mgr->activate(_obstacleContext);
+	}
+	else if (mgr->getActive() == _obstacleContext) {
+		mgr->activate(0x0);
+	}
+	_glView->invalidatePick();
+	_glView->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+LiveObstacleSet * SceneViewer::getObstacleSet() {
+	return _obstacleContext->getLiveObstacleSet();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<Vector2> & SceneViewer::getAgentPositions() const {
+	return _agentContext->getPositions();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const ReferenceGrid * SceneViewer::getReferenceGrid() const {
+	return _glView->getReferenceGrid();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::frameBounds(const Vector2 & minPt, const Vector2 & maxPt) {
+	_glView->frameBounds(minPt, maxPt);
+	checkOrigin();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -129,6 +445,27 @@ void SceneViewer::userRotated() {
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void SceneViewer::setCurrentWorldPos(float x, float y) {
+void SceneViewer::setCurrentWorldPos(double x, double y) {
 	_posLabel->setText(QString("(%1, %2)").arg(x, 0, 'f', 2).arg(y, 0, 'f', 2));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneViewer::setPicked(unsigned int pickId) {
+	QString str("Scene Viewer - ");
+	switch (PickBuffer::getType(pickId)) {
+	case PickBuffer::VERTEX_ELEMENT:
+		str += QString("vertex %1").arg(PickBuffer::getIndex(pickId));
+		break;
+	case PickBuffer::EDGE_ELEMENT:
+		str += QString("edge %1").arg(PickBuffer::getIndex(pickId));
+		break;
+	case PickBuffer::POLYGON_ELEMENT:
+		str += QString("polygon %1").arg(PickBuffer::getIndex(pickId));
+		break;
+	default:
+		str += "nothing selected";
+		break;
+	}
+	_statusLabel->setText(str);
 }
\ No newline at end of file
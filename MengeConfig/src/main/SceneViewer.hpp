@@ -3,12 +3,28 @@
 
 #include <QtWidgets/qwidget.h>
 
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
 QT_BEGIN_NAMESPACE
 class QToolBar;
 class QLabel;
 class QComboBox;
 QT_END_NAMESPACE
+class AgentPlacementContext;
+class GeometryWorker;
 class GLWidget;
+class LiveObstacleSet;
+class MapImporter;
+class MapImportWorker;
+class ObstacleContext;
+class ReferenceGrid;
+class TileLayer;
+struct ObstacleChanges;
+struct ProjectSettings;
+struct ProjectState;
 
 class SceneViewer : public QWidget {
 	Q_OBJECT
@@ -26,8 +42,125 @@ public:
 	 */
 	void drawObstacle();
 
+	/*!
+	 *	@brief		Starts the context for placing agents.
+	 */
+	void placeAgents();
+
+	/*!
+	 *	@brief		Asks for a tolerance and simplifies the obstacles' outlines in the
+	 *				background (see SimplifyJob).
+	 */
+	void simplifyObstacles();
+
+	/*!
+	 *	@brief		Moves the origin of the scene's frame to the point the view looks at (see
+	 *				WorldFrame).  It is refused while a new obstacle is being drawn.
+	 */
+	void centerOrigin();
+
+	/*!
+	 *	@brief		Asks for a vector map (GeoJSON, DXF or Shapefile) and adds its outlines
+	 *				to the obstacles (see MapImporter) once the map has been read in the
+	 *				background.
+	 */
+	void importMap();
+
+	/*!
+	 *	@brief		Asks for a tile file (see TileStore) and displays its obstacles under the
+	 *				scene's obstacles, streaming the tiles in view.
+	 */
+	void openTiledMap();
+
+	/*!
+	 *	@brief		Asks for a path and writes the scene's obstacles to it as a tile file.
+	 */
+	void exportTiledMap();
+
+	/*!
+	 *	@brief		Stops displaying the tile file's obstacles.
+	 */
+	void closeTiledMap();
+
+	/*!
+	 *	@brief		Asks for an image (e.g., a floor plan) and draws it under the scene,
+	 *				stretched over the reference grid.
+	 */
+	void openUnderlay();
+
+	/*!
+	 *	@brief		Stops drawing the underlay image.
+	 */
+	void closeUnderlay();
+
+	/*!
+	 *	@brief		Collects the current project settings and the obstacle changes made since
+	 *				the last collection.
+	 *
+	 *	@param		settings		The current settings are written here.
+	 *	@param		changes			The obstacle changes are added to this object.
+	 */
+	void getProjectChanges(ProjectSettings & settings, ObstacleChanges & changes);
+
+	/*!
+	 *	@brief		Replaces the viewer's contents and settings with those of a project.
+	 *
+	 *	@param		state		The project state to restore.
+	 */
+	void restoreProject(const ProjectState & state);
+
+	/*!
+	 *	@brief		Returns the obstacle set edited in the viewer.
+	 */
+	LiveObstacleSet * getObstacleSet();
+
+	/*!
+	 *	@brief		Returns the positions of the agents placed in the viewer.
+	 */
+	const std::vector<Vector2> & getAgentPositions() const;
+
+	/*!
+	 *	@brief		Returns the reference grid (null if the grid isn't active).
+	 */
+	const ReferenceGrid * getReferenceGrid() const;
+
+	/*!
+	 *	@brief		Moves the camera so that a region of the ground plane fills the view.
+	 *
+	 *	@param		minPt		The minimum corner of the region.
+	 *	@param		maxPt		The maximum corner of the region.
+	 */
+	void frameBounds(const Vector2 & minPt, const Vector2 & maxPt);
+
 private:
 
+	/*!
+	 *	@brief		Adds the outlines of the maps read in the background to the obstacles.
+	 */
+	void insertMaps();
+
+	/*!
+	 *	@brief		Adds the outlines of a map to the obstacles and frames them.
+	 *
+	 *	@param		importer		The map.
+	 */
+	void insertMap(const MapImporter & importer);
+
+	/*!
+	 *	@brief		Moves the origin of the scene's frame to the view if the view has moved
+	 *				too far from it (see WorldFrame::isDistant()).
+	 */
+	void checkOrigin();
+
+	/*!
+	 *	@brief		Moves the origin of the scene's frame, shifting the obstacles, the agents,
+	 *				the cameras and the grid so they keep their world positions.
+	 *
+	 *	@param		x		The x-position of the new origin in world coordinates.
+	 *	@param		y		The y-position of the new origin in world coordinates.
+	 */
+	void setWorldOrigin(double x, double y);
+
 	/*!
 	 *	@brief		Updates the status text on the viewer.
 	 */
@@ -52,8 +185,40 @@ private:
 	 *	@param		x		The x-value of the current position.
 	 *	@param		y		The y-value of the current position.
 	 */
-	void setCurrentWorldPos(float x, float y);
+	void setCurrentWorldPos(double x, double y);
+
+	/*!
+	 *	@brief		Reports the element picked in the viewer.
+	 *
+	 *	@param		pickId		The pick identifier of the element (see PickBuffer).
+	 */
+	void setPicked(unsigned int pickId);
 	
+	/*!
+	 *	@brief		The context for drawing and editing obstacles.
+	 */
+	ObstacleContext * _obstacleContext;
+
+	/*!
+	 *	@brief		The context for placing agents.
+	 */
+	AgentPlacementContext * _agentContext;
+
+	/*!
+	 *	@brief		Runs the long geometric operations on the obstacles.
+	 */
+	GeometryWorker * _geometryWorker;
+
+	/*!
+	 *	@brief		The layer of obstacles streamed from a tile file.
+	 */
+	TileLayer * _tileLayer;
+
+	/*!
+	 *	@brief		Reads the imported maps.
+	 */
+	MapImportWorker * _mapImportWorker;
+
 	/*!
 	 *	@brief		The tool bar for this window.
 	 */
@@ -79,6 +244,16 @@ private:
 	*/
 	QLabel * _posLabel;
 
+	/*!
+	 *	@brief		The action to toggle the camera's projection.
+	 */
+	QAction * _togPerspAct;
+
+	/*!
+	 *	@brief		The action to toggle the reference grid.
+	 */
+	QAction * _togGridAct;
+
 	/*!
 	 *	@brief		The action to toggle the grid's horizontal snap functiaonlity.
 	 */
@@ -89,6 +264,21 @@ private:
 	*/
 	QAction * _gridVSnap;
 
+	/*!
+	 *	@brief		The action for toggling snapping to obstacle vertices.
+	 */
+	QAction * _vertexSnap;
+
+	/*!
+	 *	@brief		The action for toggling snapping to obstacle edges.
+	 */
+	QAction * _edgeSnap;
+
+	/*!
+	 *	@brief		The action for toggling snapping to crossings of obstacle edges.
+	 */
+	QAction * _intersectionSnap;
+
 
 };
 
@@ -0,0 +1,181 @@
+#include "SearchTable.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if the byte is part of a word.
+ */
+inline bool isWordByte(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (unsigned char)c >= 0x80;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Orders words by their text.
+ */
+inline bool wordLess(const SearchTable::Word & a, const SearchTable::Word & b) {
+	return a._text < b._text;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Orders a word before the query if it precedes every word beginning with the
+ *				query.
+ */
+inline bool wordBeforePrefix(const SearchTable::Word & w, const std::string & prefix) {
+	return w._text < prefix;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Orders the query before a word if the word follows every word beginning
+ *				with the query.
+ */
+inline bool prefixBeforeWord(const std::string & prefix, const SearchTable::Word & w) {
+	return w._text.compare(0, prefix.size(), prefix) > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SearchTable::Candidates
+///////////////////////////////////////////////////////////////////////////////
+
+SearchTable::Candidates::Candidates() : _keys(), _wordBegin(0x0), _wordEnd(0x0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t SearchTable::Candidates::size() const {
+	size_t count = _wordEnd - _wordBegin;
+	for (size_t r = 0; r < _keys.size(); ++r) {
+		count += _keys[r].second - _keys[r].first;
+	}
+	return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SearchTable
+///////////////////////////////////////////////////////////////////////////////
+
+void SearchTable::build(std::vector<Entry> & entries) {
+	_keys.resize(entries.size());
+	_words.clear();
+	std::vector<std::string> words;
+	for (size_t e = 0; e < entries.size(); ++e) {
+		_keys[e] = entries[e]._key;
+		if (entries[e]._name.empty()) continue;
+		words.clear();
+		splitWords(entries[e]._name, words);
+		for (size_t w = 0; w < words.size(); ++w) {
+			_words.push_back(Word());
+			_words.back()._text.swap(words[w]);
+			_words.back()._key = entries[e]._key;
+		}
+	}
+	entries.clear();
+	std::sort(_keys.begin(), _keys.end());
+	std::sort(_words.begin(), _words.end(), wordLess);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SearchTable::findCandidates(const std::string & word, const std::vector<std::string> & typeNames, Candidates & candidates) const {
+	candidates._keys.clear();
+	candidates._wordBegin = candidates._wordEnd = 0x0;
+	if (word.empty()) return;
+
+	if (!_words.empty()) {
+		const Word * begin = &_words[0];
+		const Word * end = begin + _words.size();
+		candidates._wordBegin = std::lower_bound(begin, end, word, wordBeforePrefix);
+		candidates._wordEnd = std::upper_bound(candidates._wordBegin, end, word, prefixBeforeWord);
+	}
+	if (_keys.empty()) return;
+
+	const SearchKey * keyBegin = &_keys[0];
+	const SearchKey * keyEnd = keyBegin + _keys.size();
+	const unsigned int TYPE_COUNT = (unsigned int)typeNames.size();
+	std::vector< std::pair< SearchKey, SearchKey > > ranges;
+	for (unsigned int t = 0; t < TYPE_COUNT; ++t) {
+		if (typeNames[t].compare(0, word.size(), word) == 0) {
+			ranges.push_back(std::make_pair(makeKey(t, 0), makeKey(t + 1, 0)));
+		}
+	}
+	// The identifiers beginning with the digits d form the ranges [d, d + 1), [10d, 10d + 10),
+	//	[100d, 100d + 100), ...; identifiers have no leading zeros.
+	bool digits = word.size() < 16 && (word[0] != '0' || word.size() == 1);
+	SearchKey value = 0;
+	for (size_t i = 0; digits && i < word.size(); ++i) {
+		digits = word[i] >= '0' && word[i] <= '9';
+		value = value * 10 + (word[i] - '0');
+	}
+	if (digits) {
+		for (unsigned int t = 0; t < TYPE_COUNT; ++t) {
+			const SearchKey base = makeKey(t, 0);
+			SearchKey lo = value;
+			SearchKey hi = value + 1;
+			while (lo < MAX_ID) {
+				ranges.push_back(std::make_pair(base + lo, base + (hi < MAX_ID ? hi : MAX_ID)));
+				if (value == 0) break;
+				lo *= 10;
+				hi *= 10;
+			}
+		}
+	}
+	for (size_t r = 0; r < ranges.size(); ++r) {
+		const SearchKey * first = std::lower_bound(keyBegin, keyEnd, ranges[r].first);
+		const SearchKey * last = std::lower_bound(first, keyEnd, ranges[r].second);
+		if (first != last) {
+			candidates._keys.push_back(std::make_pair(first, last));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SearchTable::splitWords(const std::string & text, std::vector<std::string> & words) {
+	size_t i = 0;
+	const size_t LEN = text.size();
+	while (i < LEN) {
+		while (i < LEN && !isWordByte(text[i])) ++i;
+		const size_t start = i;
+		while (i < LEN && isWordByte(text[i])) ++i;
+		if (i > start) words.push_back(text.substr(start, i - start));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SearchTable::matchesName(const std::string & name, const std::string & word) {
+	const size_t LEN = name.size();
+	for (size_t i = 0; i < LEN; ++i) {
+		// Only the starts of words are tested.
+		if (!isWordByte(name[i]) || (i > 0 && isWordByte(name[i - 1]))) continue;
+		if (name.compare(i, word.size(), word) == 0) return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SearchTable::matchesId(SearchKey id, const std::string & word) {
+	char digits[24];
+	size_t count = 0;
+	do {
+		digits[count++] = (char)('0' + id % 10);
+		id /= 10;
+	} while (id > 0);
+	if (word.size() > count) return false;
+	for (size_t i = 0; i < word.size(); ++i) {
+		if (word[i] != digits[count - 1 - i]) return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,182 @@
+/*!
+ *	@file		SearchTable.h
+ *	@brief		An immutable table for type-ahead searches of the scene's elements.
+ */
+
+#ifndef __SEARCH_TABLE_H__
+#define	__SEARCH_TABLE_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*!
+ *	@brief		Identifies a searchable element: its type (in the high bits) and its
+ *				identifier among elements of that type.
+ */
+typedef unsigned long long SearchKey;
+
+/*!
+ *	@brief		The sorted keys and name words of a set of elements.
+ *
+ *	An element matches a query word if the word is a prefix of its type's name, of its
+ *	decimal identifier or of one of the words in its name.  The table finds the elements
+ *	which might match a word with a few binary searches: the keys are sorted (so the
+ *	elements of a type, and the identifiers sharing a decimal prefix, form contiguous
+ *	ranges) and the words of the names are sorted (so the words sharing a prefix form a
+ *	contiguous range).
+ *
+ *	Building the table is the expensive part; it has no dependency on the GUI and can be
+ *	done on any thread.  Once built, the table is never modified.
+ */
+class SearchTable {
+public:
+	/*!
+	 *	@brief		The name of an element to be indexed.
+	 */
+	struct Entry {
+		/*!
+		 *	@brief		The element's key.
+		 */
+		SearchKey	_key;
+
+		/*!
+		 *	@brief		The element's name (folded to lower case).
+		 */
+		std::string	_name;
+	};
+
+	/*!
+	 *	@brief		A word of an element's name.
+	 */
+	struct Word {
+		/*!
+		 *	@brief		The word (folded to lower case).
+		 */
+		std::string	_text;
+
+		/*!
+		 *	@brief		The key of the element whose name contains the word.
+		 */
+		SearchKey	_key;
+	};
+
+	/*!
+	 *	@brief		The elements which might match a query word: ranges of the sorted keys
+	 *				and a range of the sorted words.  A key may appear more than once.
+	 */
+	struct Candidates {
+		/*!
+		 *	@brief		Constructor.
+		 */
+		Candidates();
+
+		/*!
+		 *	@brief		Reports the number of candidates.
+		 */
+		size_t size() const;
+
+		/*!
+		 *	@brief		The ranges of keys, as [begin, end) pairs.
+		 */
+		std::vector< std::pair< const SearchKey *, const SearchKey * > >	_keys;
+
+		/*!
+		 *	@brief		The first word in the range of words.
+		 */
+		const Word *	_wordBegin;
+
+		/*!
+		 *	@brief		The end of the range of words.
+		 */
+		const Word *	_wordEnd;
+	};
+
+	/*!
+	 *	@brief		Builds the table.
+	 *
+	 *	@param		entries			The elements to index; the entries are consumed.
+	 */
+	void build(std::vector<Entry> & entries);
+
+	/*!
+	 *	@brief		Reports the number of elements in the table.
+	 */
+	size_t getSize() const { return _keys.size(); }
+
+	/*!
+	 *	@brief		Finds the elements which might match a query word.
+	 *
+	 *	@param		word			The query word (folded to lower case).
+	 *	@param		typeNames		The name of each type of element (folded to lower case).
+	 *	@param		candidates		The candidates are written here.
+	 */
+	void findCandidates(const std::string & word, const std::vector<std::string> & typeNames, Candidates & candidates) const;
+
+	/*!
+	 *	@brief		Creates the key of an element.
+	 *
+	 *	@param		type		The element's type.
+	 *	@param		id			The element's identifier (less than MAX_ID).
+	 */
+	static SearchKey makeKey(unsigned int type, SearchKey id) { return ((SearchKey)type << TYPE_SHIFT) | id; }
+
+	/*!
+	 *	@brief		Reports the type of the keyed element.
+	 */
+	static unsigned int getType(SearchKey key) { return (unsigned int)(key >> TYPE_SHIFT); }
+
+	/*!
+	 *	@brief		Reports the identifier of the keyed element.
+	 */
+	static SearchKey getId(SearchKey key) { return key & (MAX_ID - 1); }
+
+	/*!
+	 *	@brief		Splits text into words (runs of letters and digits; any byte outside of
+	 *				ASCII is considered a letter).
+	 *
+	 *	@param		text		The text.
+	 *	@param		words		The words are appended to this vector.
+	 */
+	static void splitWords(const std::string & text, std::vector<std::string> & words);
+
+	/*!
+	 *	@brief		Reports if the word is a prefix of one of the words of a name.
+	 *
+	 *	@param		name		The name (folded to lower case).
+	 *	@param		word		The query word.
+	 */
+	static bool matchesName(const std::string & name, const std::string & word);
+
+	/*!
+	 *	@brief		Reports if the word is a prefix of an identifier's decimal form.
+	 *
+	 *	@param		id			The identifier.
+	 *	@param		word		The query word.
+	 */
+	static bool matchesId(SearchKey id, const std::string & word);
+
+	/*!
+	 *	@brief		The position of the type in a key.
+	 */
+	static const unsigned int TYPE_SHIFT = 48;
+
+	/*!
+	 *	@brief		The bound on element identifiers.
+	 */
+	static const SearchKey MAX_ID = (SearchKey)1 << TYPE_SHIFT;
+
+protected:
+
+	/*!
+	 *	@brief		The keys of the elements, in increasing order.
+	 */
+	std::vector<SearchKey>	_keys;
+
+	/*!
+	 *	@brief		The words of the elements' names, in increasing order.
+	 */
+	std::vector<Word>	_words;
+};
+
+#endif	// __SEARCH_TABLE_H__
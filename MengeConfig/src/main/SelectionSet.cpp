@@ -0,0 +1,220 @@
+#include "SelectionSet.h"
+#include "EventBus.hpp"
+#include "GLPolygon.h"
+#include "LiveObstacleSet.h"
+
+#include <QtGui/qopengl.h>
+
+#include <cassert>
+#include <math.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SelectionSet
+///////////////////////////////////////////////////////////////////////////////
+
+SelectionSet::SelectionSet() : _ranges(), _origin() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SelectionSet::~SelectionSet() {
+	EventBus::instance()->withdraw(this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::clear() {
+	if (_ranges.empty()) return;
+	_ranges.clear();
+	_origin.clear();
+	EventBus::instance()->post(Event(SELECTION_CHANGED, this));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t SelectionSet::vertexCount() const {
+	size_t count = 0;
+	for (const Range & r : _ranges) {
+		count += r._end - r._begin;
+	}
+	return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::addVertex(GLPolygon * poly, size_t index) {
+	addRange(poly, index, index + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::addRange(GLPolygon * poly, size_t begin, size_t end) {
+	assert(begin < end && "Adding an empty range to a selection");
+	assert(end <= poly->_vertices.size() && "Adding a range beyond the end of the polygon");
+	if (!_ranges.empty()) {
+		Range & last = _ranges.back();
+		if (last._poly == poly && last._end == begin) {
+			last._end = end;
+			EventBus::instance()->post(Event(SELECTION_CHANGED, this));
+			return;
+		}
+	}
+	Range r = { poly, begin, end };
+	_ranges.push_back(r);
+	EventBus::instance()->post(Event(SELECTION_CHANGED, this));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SelectionSet::containsIndex(const GLPolygon * poly, size_t index) const {
+	for (const Range & r : _ranges) {
+		if (r._poly == poly && index >= r._begin && index < r._end) return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SelectionSet::contains(const SelectVertex & vert) const {
+	if (!vert.isValid()) return false;
+	return containsIndex(vert._poly, vert._vert - &vert._poly->_vertices[0]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SelectionSet::contains(const SelectEdge & edge) const {
+	if (!edge.isValid()) return false;
+	const Vector3 * start = &edge._poly->_vertices[0];
+	return containsIndex(edge._poly, edge._v0 - start) && containsIndex(edge._poly, edge._v1 - start);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SelectionSet::contains(const GLPolygon * poly) const {
+	if (poly == 0x0) return false;
+	size_t count = 0;
+	for (const Range & r : _ranges) {
+		if (r._poly == poly) count += r._end - r._begin;
+	}
+	return count == poly->_vertices.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Vector2 SelectionSet::getCenter() const {
+	if (_ranges.empty()) return Vector2(0.f, 0.f);
+	const Vector3 & first = _ranges[0]._poly->_vertices[_ranges[0]._begin];
+	float minX = first._x;
+	float maxX = first._x;
+	float minY = first._y;
+	float maxY = first._y;
+	for (const Range & r : _ranges) {
+		const GLPolygon::VertexList & verts = r._poly->_vertices;
+		for (size_t i = r._begin; i < r._end; ++i) {
+			const Vector3 & v = verts[i];
+			if (v._x < minX) minX = v._x;
+			else if (v._x > maxX) maxX = v._x;
+			if (v._y < minY) minY = v._y;
+			else if (v._y > maxY) maxY = v._y;
+		}
+	}
+	return Vector2(0.5f * (minX + maxX), 0.5f * (minY + maxY));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::beginTransform() {
+	_origin.resize(vertexCount());
+	size_t o = 0;
+	for (const Range & r : _ranges) {
+		const GLPolygon::VertexList & verts = r._poly->_vertices;
+		for (size_t i = r._begin; i < r._end; ++i, ++o) {
+			_origin[o].set(verts[i]._x, verts[i]._y);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::translate(const Vector2 & delta) {
+	transform(1.f, 0.f, 0.f, 1.f, Vector2(0.f, 0.f), delta);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::rotate(const Vector2 & center, float angle) {
+	const float c = cos(angle);
+	const float s = sin(angle);
+	transform(c, -s, s, c, center, Vector2(0.f, 0.f));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::scale(const Vector2 & center, float factor) {
+	transform(factor, 0.f, 0.f, factor, center, Vector2(0.f, 0.f));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::transform(float m00, float m01, float m10, float m11, const Vector2 & center, const Vector2 & offset) {
+	assert(_origin.size() == vertexCount() && "Transforming a selection without beginning the transformation");
+	// Fold the center and offset into a single translation: p' = M * p + t
+	const float tx = center._x + offset._x - (m00 * center._x + m01 * center._y);
+	const float ty = center._y + offset._y - (m10 * center._x + m11 * center._y);
+	const Vector2 * src = _origin.empty() ? 0x0 : &_origin[0];
+	for (const Range & r : _ranges) {
+		Vector3 * dst = &r._poly->_vertices[0];
+		for (size_t i = r._begin; i < r._end; ++i, ++src) {
+			dst[i]._x = m00 * src->_x + m01 * src->_y + tx;
+			dst[i]._y = m10 * src->_x + m11 * src->_y + ty;
+		}
+		r._poly->invalidateCache();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::cancelTransform() {
+	if (!_origin.empty()) {
+		translate(Vector2(0.f, 0.f));
+	}
+	_origin.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::endTransform() {
+	// Ranges of the same polygon are adjacent; update each polygon once.
+	GLPolygon * last = 0x0;
+	for (const Range & r : _ranges) {
+		if (r._poly != last) {
+			last = r._poly;
+			if (last->_vertices.size() >= 3) {
+				last->_winding = last->computeWinding(GLPolygon::PLANE_NORMAL);
+			}
+		}
+	}
+	_origin.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SelectionSet::drawGL() const {
+	if (_ranges.empty()) return;
+	glPushAttrib(GL_POINT_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glPointSize(6.f);
+	glColor3f(1.f, 0.5f, 0.f);
+	glBegin(GL_POINTS);
+	for (const Range & r : _ranges) {
+		const GLPolygon::VertexList & verts = r._poly->_vertices;
+		for (size_t i = r._begin; i < r._end; ++i) {
+			glVertex3f(verts[i]._x, verts[i]._y, verts[i]._z);
+		}
+	}
+	glEnd();
+	glPopAttrib();
+}
+
+///////////////////////////////////////////////////////////////////////////////
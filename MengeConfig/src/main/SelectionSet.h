@@ -0,0 +1,220 @@
+/*!
+ *	@file		SelectionSet.h
+ *	@brief		The definition of a set of selected polygon vertices which can be
+ *				transformed as a group.
+ */
+
+#ifndef __SELECTION_SET_H__
+#define	__SELECTION_SET_H__
+
+#include <vector>
+
+#include "Math/Vector.h"
+using namespace Menge::Math;
+
+// forward declarations
+class GLPolygon;
+class SelectEdge;
+class SelectVertex;
+
+/*!
+ *	@brief		A set of selected vertices, stored as runs of consecutive vertices.
+ *
+ *	Region selections produce long runs of consecutive vertices in the same polygon (a
+ *	whole polygon is a single run).  Rather than storing a reference per vertex, the
+ *	selection stores half-open index ranges [begin, end) into each polygon's vertices.
+ *	The selection remains valid as long as the polygons' vertex counts don't change;
+ *	any operation which inserts or removes vertices must clear the selection.
+ *
+ *	Transformations are applied as a gesture: beginTransform() records the current
+ *	positions, each transformation is applied to the recorded positions (so there is no
+ *	accumulation of error as the mouse moves) and endTransform() finalizes the affected
+ *	polygons once.
+ */
+class SelectionSet {
+public:
+	/*!
+	 *	@brief		A run of selected vertices in a single polygon.
+	 */
+	struct Range {
+		/*!
+		 *	@brief		The polygon containing the vertices.
+		 */
+		GLPolygon *	_poly;
+
+		/*!
+		 *	@brief		The index of the first selected vertex.
+		 */
+		size_t	_begin;
+
+		/*!
+		 *	@brief		One past the index of the last selected vertex.
+		 */
+		size_t	_end;
+	};
+
+	/*!
+	 *	@brief		Constructor.
+	 */
+	SelectionSet();
+
+	/*!
+	 *	@brief		Destructor.
+	 */
+	~SelectionSet();
+
+	/*!
+	 *	@brief		Removes all vertices from the selection.  Changes to the selection's
+	 *				contents are posted to the EventBus (SELECTION_CHANGED).
+	 */
+	void clear();
+
+	/*!
+	 *	@brief		Reports if the selection is empty.
+	 */
+	bool isEmpty() const { return _ranges.empty(); }
+
+	/*!
+	 *	@brief		Reports the number of selected vertices.
+	 */
+	size_t vertexCount() const;
+
+	/*!
+	 *	@brief		Adds a single vertex to the selection.
+	 *
+	 *	Vertices should be added in increasing order within a polygon; consecutive
+	 *	vertices are merged into a single range.
+	 *
+	 *	@param		poly		The polygon containing the vertex.
+	 *	@param		index		The index of the vertex in the polygon.
+	 */
+	void addVertex(GLPolygon * poly, size_t index);
+
+	/*!
+	 *	@brief		Adds a range of vertices to the selection.
+	 *
+	 *	@param		poly		The polygon containing the vertices.
+	 *	@param		begin		The index of the first vertex.
+	 *	@param		end			One past the index of the last vertex.
+	 */
+	void addRange(GLPolygon * poly, size_t begin, size_t end);
+
+	/*!
+	 *	@brief		Reports if the given vertex is selected.
+	 *
+	 *	@param		vert		The vertex to test.
+	 *	@returns	True if the vertex is in the selection.
+	 */
+	bool contains(const SelectVertex & vert) const;
+
+	/*!
+	 *	@brief		Reports if both vertices of the given edge are selected.
+	 *
+	 *	@param		edge		The edge to test.
+	 *	@returns	True if the edge is in the selection.
+	 */
+	bool contains(const SelectEdge & edge) const;
+
+	/*!
+	 *	@brief		Reports if all of the polygon's vertices are selected.
+	 *
+	 *	@param		poly		The polygon to test.
+	 *	@returns	True if the polygon is in the selection.
+	 */
+	bool contains(const GLPolygon * poly) const;
+
+	/*!
+	 *	@brief		The center of the axis-aligned bounding box of the selected vertices
+	 *				(on the x-y plane).
+	 */
+	Vector2 getCenter() const;
+
+	/*!
+	 *	@brief		Reports the runs of selected vertices.
+	 */
+	const std::vector<Range> & getRanges() const { return _ranges; }
+
+	/*!
+	 *	@brief		Records the positions of the selected vertices at the start of a
+	 *				transformation gesture.
+	 */
+	void beginTransform();
+
+	/*!
+	 *	@brief		Offsets the selected vertices from their recorded positions.
+	 *
+	 *	@param		delta		The translation (on the x-y plane).
+	 */
+	void translate(const Vector2 & delta);
+
+	/*!
+	 *	@brief		Rotates the selected vertices from their recorded positions.
+	 *
+	 *	@param		center		The center of rotation (on the x-y plane).
+	 *	@param		angle		The counter-clockwise rotation (in radians).
+	 */
+	void rotate(const Vector2 & center, float angle);
+
+	/*!
+	 *	@brief		Uniformly scales the selected vertices from their recorded positions.
+	 *
+	 *	@param		center		The center of scaling (on the x-y plane).
+	 *	@param		factor		The scale factor.
+	 */
+	void scale(const Vector2 & center, float factor);
+
+	/*!
+	 *	@brief		Restores the selected vertices to their recorded positions and ends
+	 *				the gesture.
+	 */
+	void cancelTransform();
+
+	/*!
+	 *	@brief		Ends the transformation gesture.  Properties which depend on the
+	 *				vertex positions (e.g., winding) are updated once for each affected
+	 *				polygon.
+	 */
+	void endTransform();
+
+	/*!
+	 *	@brief		Draws the selected vertices.
+	 */
+	void drawGL() const;
+
+protected:
+
+	/*!
+	 *	@brief		Reports if the given vertex lies in one of the ranges.
+	 *
+	 *	@param		poly		The polygon containing the vertex.
+	 *	@param		index		The index of the vertex in the polygon.
+	 *	@returns	True if the vertex is selected.
+	 */
+	bool containsIndex(const GLPolygon * poly, size_t index) const;
+
+	/*!
+	 *	@brief		Sets the selected vertices to the transformed recorded positions:
+	 *				p' = M * (p - center) + center + offset.
+	 *
+	 *	@param		m00		The upper-left entry of the 2x2 matrix M.
+	 *	@param		m01		The upper-right entry of the 2x2 matrix M.
+	 *	@param		m10		The lower-left entry of the 2x2 matrix M.
+	 *	@param		m11		The lower-right entry of the 2x2 matrix M.
+	 *	@param		center		The fixed point of the matrix.
+	 *	@param		offset		The translation applied after M.
+	 */
+	void transform(float m00, float m01, float m10, float m11, const Vector2 & center, const Vector2 & offset);
+
+	/*!
+	 *	@brief		The runs of selected vertices.
+	 */
+	std::vector<Range>	_ranges;
+
+	/*!
+	 *	@brief		The positions of the selected vertices at the start of the current
+	 *				transformation, in the order of the ranges.
+	 */
+	std::vector<Vector2>	_origin;
+};
+
+#endif	// __SELECTION_SET_H__
@@ -0,0 +1,245 @@
+#include "SelfCheck.h"
+
+#include "GLPolygon.h"
+#include "LiveObstacleSet.h"
+#include "ObstacleSnapshot.h"
+#include "ProjectState.h"
+#include "WorldFrame.h"
+
+#include <QtCore/qstringlist.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Adds a unit square to an obstacle set.
+ *
+ *	@param		obstacles		The set to add the square to.
+ *	@param		x				The x-position of the square's minimum corner.
+ *	@param		y				The y-position of the square's minimum corner.
+ */
+void addSquare(LiveObstacleSet & obstacles, float x, float y) {
+	GLPolygon * poly = obstacles.createPolygon();
+	poly->addVertex(Vector3(x, y, 0.f));
+	poly->addVertex(Vector3(x + 1.f, y, 0.f));
+	poly->addVertex(Vector3(x + 1.f, y + 1.f, 0.f));
+	poly->addVertex(Vector3(x, y + 1.f, 0.f));
+	obstacles.addPolygon(poly);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Reports if a snapshot holds exactly the polygons of an obstacle set.
+ *
+ *	@param		obstacles		The obstacle set.
+ *	@param		snapshot		A snapshot just taken of the set.
+ *	@param		error			A description of the first difference.
+ *	@returns	True if the snapshot matches the set.
+ */
+bool matchesSnapshot(const LiveObstacleSet & obstacles, const ObstacleSnapshotPtr & snapshot, std::string & error) {
+	const size_t COUNT = obstacles.getPolygonCount();
+	if (snapshot->getPolygonCount() != COUNT) {
+		error = "the snapshot holds " + std::to_string(snapshot->getPolygonCount()) + " polygons instead of " + std::to_string(COUNT);
+		return false;
+	}
+	for (size_t i = 0; i < COUNT; ++i) {
+		const GLPolygon * poly = obstacles.getPolygon(i);
+		const PolygonRecordPtr & record = snapshot->getPolygon(i);
+		bool same = record && record->_id == poly->getId() && record->_vertices.size() == poly->getVertexCount();
+		for (size_t v = 0; same && v < poly->getVertexCount(); ++v) {
+			same = record->_vertices[v]._x == poly->getVertex(v)._x && record->_vertices[v]._y == poly->getVertex(v)._y;
+		}
+		if (!same) {
+			error = "polygon " + std::to_string(i) + " differs from its record";
+			return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Checks incremental snapshots of a set which grows (and shrinks) across the
+ *				boundaries of the snapshot's chunks, one polygon at a time.
+ *
+ *	@param		error		A description of the failure.
+ *	@returns	True if the check passed.
+ */
+bool checkSnapshotGrowth(std::string & error) {
+	const size_t CHUNK = ObstacleSnapshot::CHUNK_SIZE;
+	LiveObstacleSet obstacles;
+	// The counts, in order: within the first chunk, across one boundary, across several
+	//	and back down across several.
+	const size_t COUNTS[] = { CHUNK - 6, CHUNK + 4, 4 * CHUNK + 17, CHUNK + 1 };
+	for (size_t target : COUNTS) {
+		while (obstacles.getPolygonCount() < target) {
+			addSquare(obstacles, float(obstacles.getPolygonCount() * 2), 0.f);
+		}
+		while (obstacles.getPolygonCount() > target) {
+			obstacles.removePolygon(obstacles.findPolygon(obstacles.getPolygon(obstacles.getPolygonCount() - 1)->getId()));
+		}
+		if (!matchesSnapshot(obstacles, obstacles.takeSnapshot(), error)) {
+			error += " at " + std::to_string(target) + " polygons";
+			return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Collects the vertices of an obstacle set and of a project state.
+ *
+ *	@param		obstacles		The obstacle set.
+ *	@param		state			The project state (holding the same polygons).
+ *	@param		live			The set's vertices are written here (x, y, x, y, ...).
+ *	@param		saved			The state's vertices are written here, in the same order.
+ */
+void collectVertices(const LiveObstacleSet & obstacles, const ProjectState & state, std::vector<float> & live, std::vector<float> & saved) {
+	live.clear();
+	saved.clear();
+	for (size_t i = 0; i < obstacles.getPolygonCount(); ++i) {
+		const GLPolygon * poly = obstacles.getPolygon(i);
+		for (size_t v = 0; v < poly->getVertexCount(); ++v) {
+			live.push_back(poly->getVertex(v)._x);
+			live.push_back(poly->getVertex(v)._y);
+		}
+		PolygonRecordMap::const_iterator itr = state._polygons.find(poly->getId());
+		if (itr == state._polygons.end()) continue;
+		for (const Vector3 & vert : itr->second->_vertices) {
+			saved.push_back(vert._x);
+			saved.push_back(vert._y);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Checks that rebasing the scene many times doesn't make its obstacles drift:
+ *				the obstacle set and the saved project state shift their vertices
+ *				identically, a vertex strays from its world position by less than the
+ *				single-precision spacing at the farthest it has been from an origin, and
+ *				repeating a sequence of rebases changes nothing.
+ *
+ *	@param		error		A description of the failure.
+ *	@returns	True if the check passed.
+ */
+bool checkOriginRebases(std::string & error) {
+	LiveObstacleSet obstacles;
+	// Squares with fractional coordinates, near the initial origin and far from it.
+	const float CORNERS[][2] = { { 0.1f, 0.3f }, { 37.77f, -12.345f }, { -4095.9f, 8191.7f }, { 312345.67f, -98765.43f } };
+	for (const float * corner : CORNERS) {
+		addSquare(obstacles, corner[0], corner[1]);
+	}
+	ObstacleChanges changes;
+	obstacles.takeChanges(changes);
+	ProjectState state;
+	state.apply(changes);
+
+	// The initial origin is zero: the local positions are the world positions.
+	std::vector<float> world, saved;
+	collectVertices(obstacles, state, world, saved);
+	std::vector<double> farthest(world.size(), 0.0);
+
+	std::mt19937 random(47);
+	std::uniform_real_distribution<double> place(-600000.0, 600000.0);
+	const size_t REBASES = 500;
+	std::vector<double> origins;
+	for (size_t i = 0; i < REBASES; ++i) {
+		// Every tenth rebase comes back to the initial origin's neighborhood.
+		const double range = i % 10 == 9 ? 0.01 : 1.0;
+		origins.push_back(WorldFrame::roundOrigin(range * place(random)));
+		origins.push_back(WorldFrame::roundOrigin(range * place(random)));
+	}
+	// The sequence returns to the initial origin.
+	origins.push_back(0.0);
+	origins.push_back(0.0);
+
+	std::vector<float> live, first;
+	double originX = 0.0;
+	double originY = 0.0;
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = 0; i < origins.size(); i += 2) {
+			obstacles.translate(originX - origins[i], originY - origins[i + 1]);
+			state.setOrigin(origins[i], origins[i + 1]);
+			originX = origins[i];
+			originY = origins[i + 1];
+			collectVertices(obstacles, state, live, saved);
+			if (live != saved) {
+				error = "the saved state differs from the obstacle set after rebase " + std::to_string(i / 2);
+				return false;
+			}
+			for (size_t v = 0; v < world.size(); ++v) {
+				const double origin = v % 2 == 0 ? originX : originY;
+				const double distance = std::fabs(world[v] - origin);
+				if (distance > farthest[v]) farthest[v] = distance;
+				// The spacing of single-precision values just beyond the farthest distance.
+				const float bound = static_cast<float>(farthest[v] * 1.01 + 1.0);
+				const double spacing = std::nextafter(bound, std::numeric_limits<float>::max()) - bound;
+				const double drift = std::fabs(origin + live[v] - world[v]);
+				if (drift >= spacing) {
+					error = "a vertex drifted by " + std::to_string(drift) + " after rebase " + std::to_string(i / 2) + " (pass " + std::to_string(pass + 1) + ")";
+					return false;
+				}
+			}
+		}
+		if (pass == 0) {
+			first = live;
+		}
+		else if (live != first) {
+			error = "repeating the rebases moved the vertices";
+			return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SelfCheck
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		A check: it reports success and describes any failure.
+ */
+typedef bool (*Check)(std::string & error);
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SelfCheck::runCommandLine(const QStringList & args, std::ostream & out) {
+	if (args.size() != 1 || args[0] != "--self-check") {
+		out << "usage: MengeConfig --self-check\n";
+		return 2;
+	}
+	struct NamedCheck {
+		const char * _name;
+		Check _check;
+	};
+	const NamedCheck CHECKS[] = {
+		{ "snapshot growth", &checkSnapshotGrowth },
+		{ "origin rebases", &checkOriginRebases }
+	};
+	size_t failed = 0;
+	for (const NamedCheck & check : CHECKS) {
+		std::string error;
+		if (check._check(error)) {
+			out << "passed: " << check._name << "\n";
+		}
+		else {
+			out << "FAILED: " << check._name << ": " << error << "\n";
+			++failed;
+		}
+	}
+	out << failed << " of " << (sizeof(CHECKS) / sizeof(CHECKS[0])) << " checks failed\n";
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+/*!
+ *	@file		SelfCheck.h
+ *	@brief		The definition of the consistency checks the application can run on itself.
+ */
+
+#ifndef __SELF_CHECK_H__
+#define	__SELF_CHECK_H__
+
+#include <QtCore/qglobal.h>
+
+#include <iostream>
+
+// forward declarations
+QT_BEGIN_NAMESPACE
+class QStringList;
+QT_END_NAMESPACE
+
+/*!
+ *	@brief		Checks of the invariants of the scene's data structures which are hard to
+ *				exercise through the GUI (e.g., edits which cross the boundaries of internal
+ *				blocks or accumulate error over many repetitions).
+ *
+ *	The checks build their own scenes; they don't need a project or a display.
+ */
+class SelfCheck {
+public:
+	/*!
+	 *	@brief		Runs the checks without presenting any GUI:
+	 *
+	 *		--self-check
+	 *
+	 *	@param		args		The command-line arguments (excluding the program).
+	 *	@param		out			The stream the results are written to.
+	 *	@returns	The exit code: 0 if every check passed, 1 if any failed and 2 if the
+	 *				arguments can't be used.
+	 */
+	static int runCommandLine(const QStringList & args, std::ostream & out);
+};
+
+#endif	// __SELF_CHECK_H__
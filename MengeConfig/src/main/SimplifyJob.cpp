@@ -0,0 +1,161 @@
+#include "SimplifyJob.h"
+
+#include "ThreadPool.h"
+
+#include <sstream>
+#include <utility>
+
+/*!
+ *	@brief		Computes the squared distance from a point to a segment in the x-y plane.
+ *
+ *	@param		p		The point.
+ *	@param		a		The segment's first end point.
+ *	@param		b		The segment's second end point.
+ *	@returns	The squared distance.
+ */
+float segmentDistSq(const Vector3 & p, const Vector3 & a, const Vector3 & b) {
+	const float dx = b._x - a._x;
+	const float dy = b._y - a._y;
+	const float lenSq = dx * dx + dy * dy;
+	float t = 0.f;
+	if (lenSq > 0.f) {
+		t = ((p._x - a._x) * dx + (p._y - a._y) * dy) / lenSq;
+		if (t < 0.f) t = 0.f;
+		else if (t > 1.f) t = 1.f;
+	}
+	const float ex = a._x + t * dx - p._x;
+	const float ey = a._y + t * dy - p._y;
+	return ex * ex + ey * ey;
+}
+
+/*!
+ *	@brief		Computes twice the signed area of a polygon's kept vertices in the x-y plane.
+ *
+ *	@param		vertices		The vertices.
+ *	@param		keep			The flags of the kept vertices.
+ *	@returns	Twice the signed area (positive for counter-clockwise).
+ */
+float keptArea(const std::vector<Vector3> & vertices, const std::vector<bool> & keep) {
+	float area = 0.f;
+	size_t first = vertices.size();
+	size_t prev = vertices.size();
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (!keep[i]) continue;
+		if (prev < vertices.size()) {
+			area += vertices[prev]._x * vertices[i]._y - vertices[i]._x * vertices[prev]._y;
+		}
+		else {
+			first = i;
+		}
+		prev = i;
+	}
+	if (first < prev) {
+		area += vertices[prev]._x * vertices[first]._y - vertices[first]._x * vertices[prev]._y;
+	}
+	return area;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of SimplifyJob
+///////////////////////////////////////////////////////////////////////////////
+
+SimplifyJob::SimplifyJob(float tolerance) : GeometryJob(), _tolerance(tolerance) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string SimplifyJob::getName() const {
+	std::stringstream ss;
+	ss << "Simplify obstacles (tolerance " << _tolerance << ")";
+	return ss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SimplifyJob::run(const ObstacleSnapshot & snapshot, GeometryEdits & edits) {
+	const size_t count = snapshot.getPolygonCount();
+	std::vector< PolygonRecordPtr > results(count);
+	const float tolerance = _tolerance;
+	ThreadPool::instance()->parallelFor(count, 256, [&](size_t begin, size_t end) {
+		std::vector<bool> keep;
+		for (size_t i = begin; i < end; ++i) {
+			const PolygonRecord & source = *snapshot.getPolygon(i);
+			const size_t vCount = source._vertices.size();
+			const size_t kept = simplify(source._vertices, tolerance, keep);
+			if (kept == vCount || kept < 3) continue;
+			// A simplification which flips the outline (or collapses it) is rejected.
+			const float before = keptArea(source._vertices, std::vector<bool>(vCount, true));
+			const float after = keptArea(source._vertices, keep);
+			if (after == 0.f || (after > 0.f) != (before > 0.f)) continue;
+
+			PolygonRecord * record = new PolygonRecord();
+			record->_id = source._id;
+			record->_winding = source._winding;
+			record->_vertices.reserve(kept);
+			for (size_t v = 0; v < vCount; ++v) {
+				if (keep[v]) record->_vertices.push_back(source._vertices[v]);
+			}
+			results[i].reset(record);
+		}
+	});
+	for (const PolygonRecordPtr & record : results) {
+		if (record) edits._replaced.push_back(record);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t SimplifyJob::simplify(const std::vector<Vector3> & vertices, float tolerance, std::vector<bool> & keep) {
+	const size_t count = vertices.size();
+	keep.assign(count, false);
+	if (count <= 3) {
+		keep.assign(count, true);
+		return count;
+	}
+	// The outline is split at vertex 0 and the vertex farthest from it; both chains are
+	//	simplified with an explicit stack of (first, last) spans.
+	size_t far = 1;
+	float farDistSq = 0.f;
+	for (size_t i = 1; i < count; ++i) {
+		const float dx = vertices[i]._x - vertices[0]._x;
+		const float dy = vertices[i]._y - vertices[0]._y;
+		const float distSq = dx * dx + dy * dy;
+		if (distSq > farDistSq) {
+			far = i;
+			farDistSq = distSq;
+		}
+	}
+	keep[0] = keep[far] = true;
+	const float tolSq = tolerance * tolerance;
+	std::vector< std::pair<size_t, size_t> > spans;
+	spans.push_back(std::make_pair(size_t(0), far));
+	spans.push_back(std::make_pair(far, count));
+	while (!spans.empty()) {
+		const size_t first = spans.back().first;
+		const size_t last = spans.back().second;
+		spans.pop_back();
+		const Vector3 & a = vertices[first];
+		const Vector3 & b = vertices[last % count];
+		size_t worst = first;
+		float worstDistSq = tolSq;
+		for (size_t i = first + 1; i < last; ++i) {
+			const float distSq = segmentDistSq(vertices[i], a, b);
+			if (distSq > worstDistSq) {
+				worst = i;
+				worstDistSq = distSq;
+			}
+		}
+		if (worst != first) {
+			keep[worst] = true;
+			spans.push_back(std::make_pair(first, worst));
+			spans.push_back(std::make_pair(worst, last));
+		}
+	}
+	size_t kept = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (keep[i]) ++kept;
+	}
+	return kept;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,61 @@
+/*!
+ *	@file		SimplifyJob.h
+ *	@brief		The definition of the geometry job which simplifies obstacle outlines.
+ */
+
+#ifndef __SIMPLIFY_JOB_H__
+#define	__SIMPLIFY_JOB_H__
+
+#include "GeometryWorker.hpp"
+
+/*!
+ *	@brief		Removes the vertices which deviate less than a tolerance from the outlines
+ *				of the obstacles (Douglas-Peucker), e.g., to thin out traced or imported
+ *				geometry.
+ *
+ *	Every polygon keeps at least three vertices and its winding; polygons which would
+ *	collapse are left unchanged.  The polygons are simplified in parallel on the ThreadPool.
+ */
+class SimplifyJob : public GeometryJob {
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		tolerance		The largest distance (in world units) a removed vertex
+	 *								may lie from the simplified outline.
+	 */
+	SimplifyJob(float tolerance);
+
+	/*!
+	 *	@brief		Reports the name of the job (for the log).
+	 */
+	virtual std::string getName() const;
+
+	/*!
+	 *	@brief		Computes the job's edits.
+	 *
+	 *	@param		snapshot		The obstacles the job operates on.
+	 *	@param		edits			The simplified polygons are added here.
+	 */
+	virtual void run(const ObstacleSnapshot & snapshot, GeometryEdits & edits);
+
+	/*!
+	 *	@brief		Simplifies a closed outline.
+	 *
+	 *	@param		vertices		The outline's vertices.
+	 *	@param		tolerance		The largest distance a removed vertex may lie from the
+	 *								simplified outline.
+	 *	@param		keep			Set to true for the vertices which are kept (resized to
+	 *								the number of vertices).
+	 *	@returns	The number of vertices kept.
+	 */
+	static size_t simplify(const std::vector<Vector3> & vertices, float tolerance, std::vector<bool> & keep);
+
+protected:
+	/*!
+	 *	@brief		The tolerance.
+	 */
+	float	_tolerance;
+};
+
+#endif	// __SIMPLIFY_JOB_H__
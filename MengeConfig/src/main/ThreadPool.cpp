@@ -0,0 +1,157 @@
+#include "ThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of ThreadPool
+///////////////////////////////////////////////////////////////////////////////
+
+ThreadPool * ThreadPool::_instance = 0x0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::once_flag ThreadPool::_instanceOnce;
+
+///////////////////////////////////////////////////////////////////////////////
+
+ThreadPool * ThreadPool::instance() {
+	std::call_once(_instanceOnce, []() {
+		// The calling thread also executes chunks, so it doesn't need a worker.
+		unsigned int cores = std::thread::hardware_concurrency();
+		_instance = new ThreadPool(cores > 1 ? cores - 1 : 0);
+	});
+	return _instance;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(size_t workerCount) : _workers(), _queues(), _loopId(0), _stopping(false) {
+	for (size_t i = 0; i <= workerCount; ++i) {
+		_queues.push_back(new ChunkQueue());
+	}
+	for (size_t i = 0; i < workerCount; ++i) {
+		_workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard< std::mutex > lock(_stateLock);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (size_t i = 0; i < _workers.size(); ++i) {
+		_workers[i].join();
+	}
+	for (size_t i = 0; i < _queues.size(); ++i) {
+		delete _queues[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const LoopBody & body) {
+	if (count == 0) return;
+	if (grain == 0) grain = 1;
+	if (_workers.empty() || count <= grain) {
+		body(0, count);
+		return;
+	}
+	// A few chunks per thread gives the threads something to steal without making the
+	//	chunks so small that the queue operations dominate.
+	const size_t MAX_CHUNKS = 8 * getThreadCount();
+	size_t chunkSize = (count + MAX_CHUNKS - 1) / MAX_CHUNKS;
+	if (chunkSize < grain) chunkSize = grain;
+	const size_t CHUNK_COUNT = (count + chunkSize - 1) / chunkSize;
+
+	Loop loop;
+	loop._body = &body;
+	loop._remaining = CHUNK_COUNT;
+	{
+		std::lock_guard< std::mutex > lock(_stateLock);
+		// Deal the chunks out as contiguous blocks, so each thread starts on neighboring data.
+		const size_t Q_COUNT = _queues.size();
+		for (size_t c = 0; c < CHUNK_COUNT; ++c) {
+			Chunk chunk = { &loop, c * chunkSize, (c + 1) * chunkSize < count ? (c + 1) * chunkSize : count };
+			ChunkQueue * queue = _queues[c * Q_COUNT / CHUNK_COUNT];
+			std::lock_guard< std::mutex > qLock(queue->_lock);
+			queue->_chunks.push_back(chunk);
+		}
+		++_loopId;
+	}
+	_wake.notify_all();
+
+	// The caller only runs its own chunks; it mustn't get stuck in another caller's loop.
+	executeChunks(_queues.size() - 1, &loop);
+
+	std::unique_lock< std::mutex > lock(_stateLock);
+	while (loop._remaining > 0) {
+		_done.wait(lock);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::workerLoop(size_t index) {
+	size_t lastLoop = 0;
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(_stateLock);
+			while (!_stopping && _loopId == lastLoop) {
+				_wake.wait(lock);
+			}
+			if (_stopping) return;
+			lastLoop = _loopId;
+		}
+		executeChunks(index, 0x0);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::executeChunks(size_t index, Loop * loop) {
+	Chunk chunk;
+	while (takeChunk(index, loop, chunk)) {
+		// The loop was set up before the chunk was queued; taking the chunk (under the
+		//	queue's lock) guarantees the loop is visible, and its caller keeps it alive until
+		//	the chunk is counted as done.
+		(*chunk._loop->_body)(chunk._begin, chunk._end);
+		if (--chunk._loop->_remaining == 0) {
+			std::lock_guard< std::mutex > lock(_stateLock);
+			_done.notify_all();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ThreadPool::takeChunk(size_t index, const Loop * loop, Chunk & chunk) {
+	{
+		ChunkQueue * own = _queues[index];
+		std::lock_guard< std::mutex > lock(own->_lock);
+		std::deque< Chunk > & chunks = own->_chunks;
+		for (std::deque< Chunk >::iterator itr = chunks.begin(); itr != chunks.end(); ++itr) {
+			if (loop == 0x0 || itr->_loop == loop) {
+				chunk = *itr;
+				chunks.erase(itr);
+				return true;
+			}
+		}
+	}
+	const size_t Q_COUNT = _queues.size();
+	for (size_t i = 1; i < Q_COUNT; ++i) {
+		ChunkQueue * victim = _queues[(index + i) % Q_COUNT];
+		std::lock_guard< std::mutex > lock(victim->_lock);
+		std::deque< Chunk > & chunks = victim->_chunks;
+		for (std::deque< Chunk >::reverse_iterator itr = chunks.rbegin(); itr != chunks.rend(); ++itr) {
+			if (loop == 0x0 || itr->_loop == loop) {
+				chunk = *itr;
+				chunks.erase(--itr.base());
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
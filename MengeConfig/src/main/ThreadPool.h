@@ -0,0 +1,200 @@
+/*!
+ *	@file		ThreadPool.h
+ *	@brief		The definition of a work-stealing pool of worker threads used to
+ *				parallelize bulk operations on geometry.
+ */
+
+#ifndef __THREAD_POOL_H__
+#define	__THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ *	@brief		A pool of worker threads which execute data-parallel loops.
+ *
+ *	A loop is divided into chunks which are dealt out to per-thread queues.  Each thread
+ *	takes chunks from the front of its own queue; when its queue is empty, it steals chunks
+ *	from the back of the other threads' queues.  Unevenly sized work (e.g., polygons with
+ *	wildly different vertex counts) is thereby balanced without a central queue.
+ *
+ *	The calling thread participates in the loop and the call returns when every chunk has
+ *	been executed.  Loops started by different threads share the workers: each loop keeps
+ *	its own count of outstanding chunks and its caller only executes (and waits on) that
+ *	loop's chunks, so a short loop isn't held up behind a long one.  A loop body must not
+ *	throw.
+ */
+class ThreadPool {
+public:
+	/*!
+	 *	@brief		The body of a loop; it is called with the half-open range of
+	 *				indices [begin, end) to process.
+	 */
+	typedef std::function< void(size_t begin, size_t end) > LoopBody;
+
+	/*!
+	 *	@brief		Retrieves the singleton member, creating it on the first call.  It can
+	 *				be called from any thread (e.g., a background job may be the first
+	 *				user of the pool).
+	 *
+	 *	@returns	A pointer to the singleton instance.
+	 */
+	static ThreadPool * instance();
+
+	/*!
+	 *	@brief		Destructor -- stops and joins the worker threads.
+	 */
+	~ThreadPool();
+
+	/*!
+	 *	@brief		Reports the number of threads which execute loops (including the
+	 *				calling thread).
+	 */
+	size_t getThreadCount() const { return _workers.size() + 1; }
+
+	/*!
+	 *	@brief		Executes the loop body over the range [0, count) in parallel.
+	 *
+	 *	@param		count		The number of indices in the loop.
+	 *	@param		grain		The minimum number of indices in each chunk of work.
+	 *	@param		body		The loop body.
+	 */
+	void parallelFor(size_t count, size_t grain, const LoopBody & body);
+
+protected:
+
+	/*!
+	 *	@brief		Private construtor enables static/singleton access.
+	 *
+	 *	@param		workerCount		The number of threads to spawn.
+	 */
+	ThreadPool(size_t workerCount);
+
+	/*!
+	 *	@brief		The state of a single call to parallelFor; it lives on the caller's
+	 *				stack.
+	 */
+	struct Loop {
+		/*!
+		 *	@brief		The loop body.
+		 */
+		const LoopBody * _body;
+
+		/*!
+		 *	@brief		The number of chunks of the loop which haven't completed.
+		 */
+		std::atomic< size_t >	_remaining;
+	};
+
+	/*!
+	 *	@brief		A chunk of a loop.
+	 */
+	struct Chunk {
+		/*!
+		 *	@brief		The loop the chunk belongs to.
+		 */
+		Loop *	_loop;
+
+		/*!
+		 *	@brief		The first index of the chunk.
+		 */
+		size_t	_begin;
+
+		/*!
+		 *	@brief		One past the last index of the chunk.
+		 */
+		size_t	_end;
+	};
+
+	/*!
+	 *	@brief		The queue of chunks belonging to a single thread.
+	 */
+	struct ChunkQueue {
+		/*!
+		 *	@brief		Guards access to the chunks.
+		 */
+		std::mutex	_lock;
+
+		/*!
+		 *	@brief		The chunks.
+		 */
+		std::deque< Chunk >	_chunks;
+	};
+
+	/*!
+	 *	@brief		The function executed by each worker thread.
+	 *
+	 *	@param		index		The index of the worker's queue.
+	 */
+	void workerLoop(size_t index);
+
+	/*!
+	 *	@brief		Executes chunks until there are none left to take.
+	 *
+	 *	@param		index		The index of the executing thread's queue.
+	 *	@param		loop		If non-null, only this loop's chunks are taken.
+	 */
+	void executeChunks(size_t index, Loop * loop);
+
+	/*!
+	 *	@brief		Takes a chunk -- first from the thread's own queue, then from the
+	 *				others.
+	 *
+	 *	@param		index		The index of the executing thread's queue.
+	 *	@param		loop		If non-null, only this loop's chunks are taken.
+	 *	@param		chunk		The taken chunk.
+	 *	@returns	True if a chunk was taken, false if there are no chunks left.
+	 */
+	bool takeChunk(size_t index, const Loop * loop, Chunk & chunk);
+
+	/// The singleton instance
+	static ThreadPool * _instance;
+
+	/// Guards the creation of the singleton instance (function-local statics aren't
+	///	initialized thread-safely by every supported compiler).
+	static std::once_flag _instanceOnce;
+
+	/*!
+	 *	@brief		The worker threads.
+	 */
+	std::vector< std::thread >	_workers;
+
+	/*!
+	 *	@brief		The chunk queues; one per worker followed by one shared by the calling
+	 *				threads.
+	 */
+	std::vector< ChunkQueue * >	_queues;
+
+	/*!
+	 *	@brief		Guards the wake and completion signals.
+	 */
+	std::mutex	_stateLock;
+
+	/*!
+	 *	@brief		Signals the workers that a loop has started (or the pool is stopping).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		Signals the calling threads that some loop's chunks have all been
+	 *				executed.
+	 */
+	std::condition_variable	_done;
+
+	/*!
+	 *	@brief		Incremented for every loop; workers use it to detect new loops.
+	 */
+	size_t	_loopId;
+
+	/*!
+	 *	@brief		Reports if the workers should stop.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __THREAD_POOL_H__
@@ -0,0 +1,250 @@
+#include "TileLayer.hpp"
+
+#include "AppLogger.hpp"
+#include "GeometrySnap.h"
+#include "MCException.h"
+#include "WorldFrame.h"
+
+#include <algorithm>
+#include <gl/GL.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of TileLayer
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t TileLayer::DEFAULT_BUDGET = 256 << 20;
+const size_t TileLayer::MAX_VIEW_TILES = 512;
+const float TileLayer::MIN_TILE_PIXELS = 64.f;
+
+///////////////////////////////////////////////////////////////////////////////
+
+TileLayer::TileLayer(QObject * parent) : QObject(parent), _store(), _cache(), _lru(), _residentBytes(0), _budget(DEFAULT_BUDGET), _view(), _viewCount(0), _loader(), _lock(), _wake(), _idle(), _requests(), _loaded(), _errors(), _busy(false), _stopping(false) {
+	// The loader emits its signal from its own thread; it is delivered on the GUI thread.
+	connect(this, &TileLayer::tilesLoaded, this, &TileLayer::acceptTiles);
+	_loader = std::thread(&TileLayer::loaderLoop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TileLayer::~TileLayer() {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+		_requests.clear();
+	}
+	_wake.notify_all();
+	_loader.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::open(const QString & path) {
+	close();
+	_store.open(path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::close() {
+	{
+		// The file can't be unmapped while the loader is decoding one of its tiles.
+		std::unique_lock< std::mutex > lock(_lock);
+		_requests.clear();
+		while (_busy) {
+			_idle.wait(lock);
+		}
+		_loaded.clear();
+		_errors.clear();
+	}
+	_cache.clear();
+	_lru.clear();
+	_residentBytes = 0;
+	_view.clear();
+	_store.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::setBudget(size_t bytes) {
+	_budget = bytes;
+	evict();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::setView(double minX, double minY, double maxX, double maxY, float worldPerPixel) {
+	if (!_store.isOpen()) return;
+	++_viewCount;
+	_view.clear();
+	_store.findTiles(minX, minY, maxX, maxY, MIN_TILE_PIXELS * worldPerPixel, MAX_VIEW_TILES, _view);
+
+	// In reverse, so the coarsest tiles end up the most recently used (and are loaded first).
+	std::deque< size_t > missing;
+	for (size_t i = _view.size(); i > 0; --i) {
+		const size_t node = _view[i - 1];
+		std::unordered_map< size_t, Entry >::iterator itr = _cache.find(node);
+		if (itr == _cache.end()) {
+			missing.push_front(node);
+		}
+		else {
+			_lru.splice(_lru.begin(), _lru, itr->second._use);
+			itr->second._lastView = _viewCount;
+		}
+	}
+	{
+		// Requests of the previous view which weren't loaded yet are dropped.
+		std::lock_guard< std::mutex > lock(_lock);
+		_requests.swap(missing);
+	}
+	_wake.notify_one();
+	evict();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::drawGL(const WorldFrame & frame) const {
+	if (_view.empty()) return;
+	glPushAttrib(GL_LINE_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glMatrixMode(GL_MODELVIEW);
+
+	glLineWidth(1.f);
+	glColor3f(0.45f, 0.45f, 0.45f);
+	for (size_t node : _view) {
+		std::unordered_map< size_t, Entry >::const_iterator itr = _cache.find(node);
+		if (itr == _cache.end()) continue;
+		// The tile's vertices are relative to its corner; the corner is placed relative to
+		//	the scene's origin in double precision.
+		const TileNode & record = _store.getNode(node);
+		glPushMatrix();
+		glTranslatef(static_cast<float>(record._minX - frame.getOriginX()), static_cast<float>(record._minY - frame.getOriginY()), 0.f);
+		for (const TilePolygon & poly : itr->second._tile->_polygons) {
+			if (poly._vertices.size() < 2) continue;
+			glBegin(GL_LINE_LOOP);
+			for (const Vector2 & v : poly._vertices) {
+				glVertex3f(v._x, v._y, 0.f);
+			}
+			glEnd();
+		}
+		glPopMatrix();
+	}
+
+	glPopAttrib();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::collectSegments(GeometrySnap & query, const WorldFrame & frame) const {
+	for (size_t node : _view) {
+		std::unordered_map< size_t, Entry >::const_iterator itr = _cache.find(node);
+		if (itr == _cache.end()) continue;
+		const TileNode & record = _store.getNode(node);
+		const float ox = static_cast<float>(record._minX - frame.getOriginX());
+		const float oy = static_cast<float>(record._minY - frame.getOriginY());
+		const float size = static_cast<float>(record._size);
+		if (!query.reaches(ox, oy, ox + size, oy + size)) continue;
+		for (const TilePolygon & poly : itr->second._tile->_polygons) {
+			const size_t COUNT = poly._vertices.size();
+			if (COUNT < 2 || !query.reaches(ox + poly._min._x, oy + poly._min._y, ox + poly._max._x, oy + poly._max._y)) continue;
+			for (size_t i = 0; i < COUNT; ++i) {
+				const Vector2 & v0 = poly._vertices[i];
+				const Vector2 & v1 = poly._vertices[i + 1 < COUNT ? i + 1 : 0];
+				query.addSegment(ox + v0._x, oy + v0._y, ox + v1._x, oy + v1._y);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::acceptTiles() {
+	std::deque< TilePtr > loaded;
+	std::deque< std::string > errors;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		loaded.swap(_loaded);
+		errors.swap(_errors);
+	}
+	for (const std::string & error : errors) {
+		AppLogger::logStream << AppLogger::ERROR_MSG << error << AppLogger::END_MSG;
+	}
+	bool inView = false;
+	for (const TilePtr & tile : loaded) {
+		// A tile requested by consecutive views may have been loaded twice.
+		if (_cache.count(tile->_node) > 0) continue;
+		Entry entry;
+		entry._tile = tile;
+		entry._lastView = 0;
+		// Tiles which have left the view are the first to be evicted.
+		if (std::find(_view.begin(), _view.end(), tile->_node) != _view.end()) {
+			entry._lastView = _viewCount;
+			entry._use = _lru.insert(_lru.begin(), tile->_node);
+			inView = true;
+		}
+		else {
+			entry._use = _lru.insert(_lru.end(), tile->_node);
+		}
+		_cache[tile->_node] = entry;
+		_residentBytes += tile->_bytes;
+	}
+	evict();
+	if (inView) emit changed();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::evict() {
+	while (_residentBytes > _budget && !_lru.empty()) {
+		std::unordered_map< size_t, Entry >::iterator itr = _cache.find(_lru.back());
+		// The tiles in view are at the front of the list; they are never evicted.
+		if (itr->second._lastView == _viewCount) break;
+		_residentBytes -= itr->second._tile->_bytes;
+		_cache.erase(itr);
+		_lru.pop_back();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileLayer::loaderLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (_requests.empty() && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_stopping) return;
+
+		const size_t node = _requests.front();
+		_requests.pop_front();
+		_busy = true;
+		lock.unlock();
+
+		TilePtr tile;
+		std::string error;
+		try {
+			tile = _store.loadTile(node);
+		}
+		catch (MCException & e) {
+			// A damaged tile is resident but empty, so it isn't requested again.
+			error = e.what();
+			std::shared_ptr< Tile > empty(new Tile());
+			empty->_node = node;
+			empty->_bytes = sizeof(Tile);
+			tile = empty;
+		}
+
+		lock.lock();
+		_busy = false;
+		// One signal covers every tile loaded before the GUI thread collects them.
+		const bool notify = _loaded.empty();
+		_loaded.push_back(tile);
+		if (!error.empty()) _errors.push_back(error);
+		_idle.notify_all();
+		lock.unlock();
+		if (notify) emit tilesLoaded();
+		lock.lock();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,265 @@
+/*!
+ *	@file		TileLayer.hpp
+ *	@brief		The definition of a layer of obstacles streamed from a tile file.
+ */
+
+#ifndef __TILE_LAYER_H__
+#define	__TILE_LAYER_H__
+
+#include "TileStore.h"
+
+#include <QtCore/qobject.h>
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// forward declarations
+class GeometrySnap;
+class WorldFrame;
+
+/*!
+ *	@brief		Displays the obstacles of a tile file (see TileStore) which are in view,
+ *				without reading the rest of the file.
+ *
+ *	The view reports the region of the ground plane it sees and its scale (see setView());
+ *	the layer finds the tiles which are large enough on screen to matter (at most
+ *	MAX_VIEW_TILES of them) and a loader thread decodes the ones which aren't resident.
+ *	Decoded tiles are kept in a least-recently-used cache of bounded size; tiles which
+ *	are out of view are evicted once the cache exceeds its budget.  Drawing and snapping
+ *	only visit the resident tiles in view, so their cost is bounded regardless of the size
+ *	of the file.
+ *
+ *	The layer is read-only; it is a map to author obstacles on.  Everything but the loader
+ *	thread lives on the GUI thread.
+ */
+class TileLayer : public QObject {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent		The optional parent object.
+	 */
+	TileLayer(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor -- waits for the tile being loaded.
+	 */
+	~TileLayer();
+
+	/*!
+	 *	@brief		Opens a tile file (closing the current one).
+	 *
+	 *	@param		path		The path to the file.
+	 *	@throws		MCException if the file can't be opened.
+	 */
+	void open(const QString & path);
+
+	/*!
+	 *	@brief		Closes the tile file and discards the resident tiles.
+	 */
+	void close();
+
+	/*!
+	 *	@brief		Reports if a tile file is open.
+	 */
+	bool isOpen() const { return _store.isOpen(); }
+
+	/*!
+	 *	@brief		Returns the tile file.
+	 */
+	const TileStore & getStore() const { return _store; }
+
+	/*!
+	 *	@brief		Sets the most memory the resident tiles may occupy.  Tiles in view are
+	 *				kept even if they exceed it.
+	 *
+	 *	@param		bytes		The budget (in bytes).
+	 */
+	void setBudget(size_t bytes);
+
+	/*!
+	 *	@brief		Reports the memory occupied by the resident tiles (in bytes).
+	 */
+	size_t getResidentBytes() const { return _residentBytes; }
+
+	/*!
+	 *	@brief		Selects the tiles in view and requests the ones which aren't resident.
+	 *
+	 *	@param		minX			The minimum x-value of the visible region (world
+	 *								coordinates).
+	 *	@param		minY			The minimum y-value of the visible region.
+	 *	@param		maxX			The maximum x-value of the visible region.
+	 *	@param		maxY			The maximum y-value of the visible region.
+	 *	@param		worldPerPixel	The size of a pixel in world units.
+	 */
+	void setView(double minX, double minY, double maxX, double maxY, float worldPerPixel);
+
+	/*!
+	 *	@brief		Draws the resident tiles in view.
+	 *
+	 *	@param		frame		The frame of the scene's coordinates; the tiles are drawn
+	 *							relative to its origin.
+	 */
+	void drawGL(const WorldFrame & frame) const;
+
+	/*!
+	 *	@brief		Offers the edges of the resident tiles in view to a snap query.
+	 *
+	 *	@param		query		The query (in the scene's coordinates).
+	 *	@param		frame		The frame of the scene's coordinates.
+	 */
+	void collectSegments(GeometrySnap & query, const WorldFrame & frame) const;
+
+	/*!
+	 *	@brief		The default memory budget (in bytes).
+	 */
+	static const size_t DEFAULT_BUDGET;
+
+	/*!
+	 *	@brief		The most tiles in view.
+	 */
+	static const size_t MAX_VIEW_TILES;
+
+	/*!
+	 *	@brief		The smallest size on screen (in pixels) of the tiles in view.
+	 */
+	static const float MIN_TILE_PIXELS;
+
+signals:
+	/*!
+	 *	@brief		Emitted (from the loader thread) when tiles have been loaded.
+	 */
+	void tilesLoaded();
+
+	/*!
+	 *	@brief		Emitted when tiles in view have become resident.
+	 */
+	void changed();
+
+protected:
+	/*!
+	 *	@brief		A resident tile.
+	 */
+	struct Entry {
+		/*!
+		 *	@brief		The tile.
+		 */
+		TilePtr	_tile;
+
+		/*!
+		 *	@brief		The tile's position in the least-recently-used list.
+		 */
+		std::list< size_t >::iterator	_use;
+
+		/*!
+		 *	@brief		The last view the tile was in (see _viewCount).
+		 */
+		size_t	_lastView;
+	};
+
+	/*!
+	 *	@brief		Makes the loaded tiles resident and evicts the tiles out of view which
+	 *				exceed the budget (on the GUI thread).
+	 */
+	void acceptTiles();
+
+	/*!
+	 *	@brief		Evicts least-recently-used tiles which are out of view until the
+	 *				resident tiles fit the budget.
+	 */
+	void evict();
+
+	/*!
+	 *	@brief		The loader thread's loop.
+	 */
+	void loaderLoop();
+
+	/*!
+	 *	@brief		The tile file.
+	 */
+	TileStore	_store;
+
+	/*!
+	 *	@brief		The resident tiles, by node.
+	 */
+	std::unordered_map< size_t, Entry >	_cache;
+
+	/*!
+	 *	@brief		The resident tiles' nodes, most recently used first.
+	 */
+	std::list< size_t >	_lru;
+
+	/*!
+	 *	@brief		The memory occupied by the resident tiles (in bytes).
+	 */
+	size_t	_residentBytes;
+
+	/*!
+	 *	@brief		The memory budget (in bytes).
+	 */
+	size_t	_budget;
+
+	/*!
+	 *	@brief		The nodes of the tiles in view, coarsest first.
+	 */
+	std::vector< size_t >	_view;
+
+	/*!
+	 *	@brief		Counts the calls to setView().
+	 */
+	size_t	_viewCount;
+
+	/*!
+	 *	@brief		The loader thread.
+	 */
+	std::thread	_loader;
+
+	/*!
+	 *	@brief		Guards the queues and flags below.
+	 */
+	std::mutex	_lock;
+
+	/*!
+	 *	@brief		Signals the loader that there are requests (or that it should stop).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		Signals that the loader has finished a tile.
+	 */
+	std::condition_variable	_idle;
+
+	/*!
+	 *	@brief		The nodes of the tiles to load; replaced by every view.
+	 */
+	std::deque< size_t >	_requests;
+
+	/*!
+	 *	@brief		The tiles loaded but not yet resident.
+	 */
+	std::deque< TilePtr >	_loaded;
+
+	/*!
+	 *	@brief		The errors of the tiles which couldn't be loaded, for the log.
+	 */
+	std::deque< std::string >	_errors;
+
+	/*!
+	 *	@brief		Reports if the loader is decoding a tile.
+	 */
+	bool	_busy;
+
+	/*!
+	 *	@brief		Reports if the loader should stop.
+	 */
+	bool	_stopping;
+};
+
+#endif	// __TILE_LAYER_H__
@@ -0,0 +1,358 @@
+#include "TileStore.h"
+
+#include "GLPolygon.h"
+#include "LiveObstacleSet.h"
+#include "MCException.h"
+#include "WorldFrame.h"
+
+#include <QtCore/qdatastream.h>
+
+#include <climits>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of Helper methods
+///////////////////////////////////////////////////////////////////////////////
+
+// Identifies a tile file ("MCTM").
+const quint32 TILE_FILE_MAGIC = 0x4D43544D;
+// The version of the tile format.
+const quint32 TILE_FILE_VERSION = 1;
+// The size of the header: magic, version, node count and polygon count.
+const qint64 TILE_HEADER_SIZE = 3 * sizeof(quint32) + sizeof(quint64);
+// The size of a node's record: corner, size, offset, byte size, polygon count and children.
+const qint64 NODE_RECORD_SIZE = 3 * sizeof(double) + sizeof(quint64) + 2 * sizeof(quint32) + 4 * sizeof(qint32);
+// The size of a polygon's header in a tile: winding and vertex count.
+const qint64 TILE_POLYGON_SIZE = 2 * sizeof(quint32);
+// The size of a vertex in a tile.
+const qint64 TILE_VERTEX_SIZE = 2 * sizeof(float);
+// The most bytes read through one stream; a QByteArray's size is an int.
+const qint64 MAX_STREAM_SIZE = INT_MAX;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Prepares a stream to read or write the tile format.  The header and the node
+ *				table are in double precision, the tiles in single precision.
+ *
+ *	@param		stream		The stream to configure.
+ *	@param		precision	The precision of the floating-point values.
+ */
+void configureTileStream(QDataStream & stream, QDataStream::FloatingPointPrecision precision) {
+	stream.setVersion(QDataStream::Qt_5_5);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(precision);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		A node of a quadtree being built.
+ */
+struct BuildNode {
+	/*!
+	 *	@brief		The node's record.
+	 */
+	TileNode	_node;
+
+	/*!
+	 *	@brief		The indices of the node's polygons.
+	 */
+	std::vector< size_t >	_polygons;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Builds a node of the quadtree and, recursively, its descendants.
+ *
+ *	@param		nodes		The nodes built so far; the new nodes are appended.
+ *	@param		polygons	The indices of the polygons in the node's square (consumed).
+ *	@param		bounds		The world bounds of every polygon: min x, min y, max x, max y.
+ *	@param		minX		The x-position of the node's minimum corner.
+ *	@param		minY		The y-position of the node's minimum corner.
+ *	@param		size		The size of the node's square.
+ *	@param		depth		The depth of the node.
+ *	@returns	The index of the node.
+ */
+size_t buildNode(std::vector< BuildNode > & nodes, std::vector< size_t > & polygons, const std::vector< double > & bounds, double minX, double minY, double size, size_t depth) {
+	const size_t index = nodes.size();
+	nodes.push_back(BuildNode());
+	TileNode & node = nodes[index]._node;
+	node._minX = minX;
+	node._minY = minY;
+	node._size = size;
+	node._offset = 0;
+	node._byteSize = 0;
+	node._polygonCount = 0;
+	for (int c = 0; c < 4; ++c) node._children[c] = -1;
+	if (polygons.size() <= TileStore::TILE_CAPACITY || depth == TileStore::MAX_DEPTH) {
+		nodes[index]._polygons.swap(polygons);
+		return index;
+	}
+
+	// Polygons which lie in one quadrant move down; the rest stay.
+	const double half = 0.5 * size;
+	const double midX = minX + half;
+	const double midY = minY + half;
+	std::vector< size_t > quadrants[4];
+	std::vector< size_t > kept;
+	for (size_t p : polygons) {
+		const double * b = &bounds[4 * p];
+		const int col = b[2] <= midX ? 0 : (b[0] >= midX ? 1 : -1);
+		const int row = b[3] <= midY ? 0 : (b[1] >= midY ? 1 : -1);
+		if (col < 0 || row < 0) {
+			kept.push_back(p);
+		}
+		else {
+			quadrants[2 * row + col].push_back(p);
+		}
+	}
+	std::vector< size_t >().swap(polygons);
+	nodes[index]._polygons.swap(kept);
+	for (int q = 0; q < 4; ++q) {
+		if (quadrants[q].empty()) continue;
+		const size_t child = buildNode(nodes, quadrants[q], bounds, minX + (q % 2) * half, minY + (q / 2) * half, half, depth + 1);
+		// The vector may have grown; the node is looked up again.
+		nodes[index]._node._children[q] = qint32(child);
+	}
+	return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of TileStore
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t TileStore::TILE_CAPACITY = 256;
+const size_t TileStore::MAX_DEPTH = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+
+TileStore::TileStore() : _file(), _data(0x0), _size(0), _nodes(), _polygonCount(0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TileStore::~TileStore() {
+	close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileStore::open(const QString & path) {
+	close();
+	_file.setFileName(path);
+	if (!_file.open(QIODevice::ReadOnly)) {
+		const std::string error = _file.errorString().toStdString();
+		close();
+		throw MCException("Unable to open the tile file " + path.toStdString() + ": " + error);
+	}
+	_size = _file.size();
+	_data = _size >= TILE_HEADER_SIZE ? _file.map(0, _size) : 0x0;
+	if (_data == 0x0) {
+		close();
+		throw MCException("Unable to map the tile file " + path.toStdString());
+	}
+
+	QDataStream header(QByteArray::fromRawData(reinterpret_cast<const char *>(_data), int(TILE_HEADER_SIZE)));
+	configureTileStream(header, QDataStream::DoublePrecision);
+	quint32 magic, version, nodeCount;
+	header >> magic >> version >> nodeCount >> _polygonCount;
+	if (magic != TILE_FILE_MAGIC || version != TILE_FILE_VERSION || nodeCount == 0 ||
+		qint64(nodeCount) * NODE_RECORD_SIZE > MAX_STREAM_SIZE || TILE_HEADER_SIZE + qint64(nodeCount) * NODE_RECORD_SIZE > _size) {
+		close();
+		throw MCException(path.toStdString() + " is not a tile file");
+	}
+
+	QDataStream in(QByteArray::fromRawData(reinterpret_cast<const char *>(_data + TILE_HEADER_SIZE), int(qint64(nodeCount) * NODE_RECORD_SIZE)));
+	configureTileStream(in, QDataStream::DoublePrecision);
+	_nodes.resize(nodeCount);
+	for (quint32 i = 0; i < nodeCount; ++i) {
+		TileNode & node = _nodes[i];
+		in >> node._minX >> node._minY >> node._size >> node._offset >> node._byteSize >> node._polygonCount;
+		// The offset is checked on its own first; a damaged one could wrap the sum.
+		bool valid = node._byteSize <= quint64(MAX_STREAM_SIZE) && node._offset <= quint64(_size) &&
+			node._byteSize <= quint64(_size) - node._offset;
+		for (int c = 0; c < 4; ++c) {
+			in >> node._children[c];
+			// Children follow their parents, so a damaged table can't form a cycle.
+			valid = valid && (node._children[c] < 0 || (quint32(node._children[c]) > i && quint32(node._children[c]) < nodeCount));
+		}
+		if (!valid) {
+			close();
+			throw MCException(QString("Node %1 of the tile file %2 is damaged").arg(i).arg(path).toStdString());
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileStore::close() {
+	if (_data != 0x0) {
+		_file.unmap(const_cast<uchar *>(_data));
+		_data = 0x0;
+	}
+	_file.close();
+	_file.setFileName(QString());
+	_size = 0;
+	_nodes.clear();
+	_polygonCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TileStore::findTiles(double minX, double minY, double maxX, double maxY, double minSize, size_t maxCount, std::vector< size_t > & tiles) const {
+	if (_nodes.empty()) return;
+	// Breadth-first, so the coarse tiles are found first.
+	std::vector< size_t > queue(1, 0);
+	for (size_t head = 0; head < queue.size() && tiles.size() < maxCount; ++head) {
+		const TileNode & node = _nodes[queue[head]];
+		// The root is always reported; it holds the largest polygons.
+		if (queue[head] != 0 && node._size < minSize) continue;
+		if (node._minX > maxX || node._minX + node._size < minX || node._minY > maxY || node._minY + node._size < minY) continue;
+		if (node._polygonCount > 0) tiles.push_back(queue[head]);
+		for (int c = 0; c < 4; ++c) {
+			if (node._children[c] >= 0) queue.push_back(size_t(node._children[c]));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TilePtr TileStore::loadTile(size_t node) const {
+	const TileNode & record = _nodes[node];
+	std::shared_ptr< Tile > tile(new Tile());
+	tile->_node = node;
+	// Don't trust the counts to size the allocations; they are checked against the data.
+	tile->_polygons.reserve(qMin(quint64(record._polygonCount), quint64(record._byteSize / TILE_POLYGON_SIZE)));
+	size_t bytes = sizeof(Tile);
+
+	QDataStream in(QByteArray::fromRawData(reinterpret_cast<const char *>(_data + record._offset), int(record._byteSize)));
+	configureTileStream(in, QDataStream::SinglePrecision);
+	for (quint32 p = 0; p < record._polygonCount; ++p) {
+		qint32 winding;
+		quint32 count;
+		in >> winding >> count;
+		if (in.status() != QDataStream::Ok || qint64(count) * TILE_VERTEX_SIZE > qint64(record._byteSize)) {
+			throw MCException(QString("Tile %1 of %2 is damaged").arg(qulonglong(node)).arg(getPath()).toStdString());
+		}
+		tile->_polygons.push_back(TilePolygon());
+		TilePolygon & poly = tile->_polygons.back();
+		poly._winding = winding;
+		poly._vertices.resize(count);
+		for (quint32 i = 0; i < count; ++i) {
+			float x, y;
+			in >> x >> y;
+			poly._vertices[i].set(x, y);
+			if (i == 0) {
+				poly._min.set(x, y);
+				poly._max.set(x, y);
+			}
+			else {
+				if (x < poly._min._x) poly._min._x = x;
+				if (y < poly._min._y) poly._min._y = y;
+				if (x > poly._max._x) poly._max._x = x;
+				if (y > poly._max._y) poly._max._y = y;
+			}
+		}
+		if (in.status() != QDataStream::Ok) {
+			throw MCException(QString("Tile %1 of %2 is damaged").arg(qulonglong(node)).arg(getPath()).toStdString());
+		}
+		bytes += sizeof(TilePolygon) + count * sizeof(Vector2);
+	}
+	tile->_bytes = bytes;
+	return tile;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t TileStore::build(const QString & path, const LiveObstacleSet & obstacles, const WorldFrame & frame) {
+	// The world bounds of the polygons (those with an edge) and of the whole set.
+	std::vector< size_t > polygons;
+	std::vector< double > bounds;
+	double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+	for (size_t i = 0; i < obstacles.getPolygonCount(); ++i) {
+		const GLPolygon * poly = obstacles.getPolygon(i);
+		if (poly->getVertexCount() < 2) continue;
+		double x0, y0, x1, y1;
+		frame.toWorld(poly->getMinXY(), x0, y0);
+		frame.toWorld(poly->getMaxXY(), x1, y1);
+		if (polygons.empty()) {
+			minX = x0; minY = y0; maxX = x1; maxY = y1;
+		}
+		else {
+			if (x0 < minX) minX = x0;
+			if (y0 < minY) minY = y0;
+			if (x1 > maxX) maxX = x1;
+			if (y1 > maxY) maxY = y1;
+		}
+		polygons.push_back(i);
+		bounds.push_back(x0);
+		bounds.push_back(y0);
+		bounds.push_back(x1);
+		bounds.push_back(y1);
+	}
+
+	// The root is a square which contains every polygon.
+	std::vector< BuildNode > nodes;
+	double size = (maxX - minX) > (maxY - minY) ? (maxX - minX) : (maxY - minY);
+	size = size > 0.0 ? size * 1.0001 : 1.0;
+	std::vector< size_t > order(polygons.size());
+	for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+	buildNode(nodes, order, bounds, minX, minY, size, 0);
+
+	if (qint64(nodes.size()) * NODE_RECORD_SIZE > MAX_STREAM_SIZE) {
+		throw MCException("Unable to write the tile file " + path.toStdString() + ": there are too many tiles");
+	}
+	// The tiles follow the node table.
+	quint64 offset = TILE_HEADER_SIZE + nodes.size() * NODE_RECORD_SIZE;
+	for (BuildNode & node : nodes) {
+		quint64 byteSize = 0;
+		for (size_t p : node._polygons) {
+			byteSize += TILE_POLYGON_SIZE + obstacles.getPolygon(polygons[p])->getVertexCount() * TILE_VERTEX_SIZE;
+		}
+		if (byteSize > quint64(MAX_STREAM_SIZE)) {
+			throw MCException("Unable to write the tile file " + path.toStdString() + ": a tile is too large");
+		}
+		node._node._offset = offset;
+		node._node._byteSize = quint32(byteSize);
+		node._node._polygonCount = quint32(node._polygons.size());
+		offset += byteSize;
+	}
+
+	// The file is written next to its destination; a mapped file is never overwritten.
+	const QString tmpPath = path + ".tmp";
+	QFile file(tmpPath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		throw MCException("Unable to write the tile file " + tmpPath.toStdString() + ": " + file.errorString().toStdString());
+	}
+	QDataStream out(&file);
+	configureTileStream(out, QDataStream::DoublePrecision);
+	out << TILE_FILE_MAGIC << TILE_FILE_VERSION << quint32(nodes.size()) << quint64(polygons.size());
+	for (const BuildNode & node : nodes) {
+		const TileNode & record = node._node;
+		out << record._minX << record._minY << record._size << record._offset << record._byteSize << record._polygonCount;
+		for (int c = 0; c < 4; ++c) out << record._children[c];
+	}
+	out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	for (const BuildNode & node : nodes) {
+		for (size_t p : node._polygons) {
+			const GLPolygon * poly = obstacles.getPolygon(polygons[p]);
+			out << qint32(poly->getWinding()) << quint32(poly->getVertexCount());
+			for (size_t i = 0; i < poly->getVertexCount(); ++i) {
+				double x, y;
+				const Vector3 & v = poly->getVertex(i);
+				frame.toWorld(Vector2(v._x, v._y), x, y);
+				out << float(x - node._node._minX) << float(y - node._node._minY);
+			}
+		}
+	}
+	const bool written = out.status() == QDataStream::Ok && file.flush();
+	file.close();
+	if (!written || (QFile::exists(path) && !QFile::remove(path)) || !QFile::rename(tmpPath, path)) {
+		QFile::remove(tmpPath);
+		throw MCException("Unable to write the tile file " + path.toStdString());
+	}
+	return nodes.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,257 @@
+/*!
+ *	@file		TileStore.h
+ *	@brief		The definition of a memory-mapped file of obstacle tiles organized as a
+ *				quadtree.
+ */
+
+#ifndef __TILE_STORE_H__
+#define	__TILE_STORE_H__
+
+#include <Math/Vector2.h>
+
+#include <QtCore/qfile.h>
+#include <QtCore/qstring.h>
+
+#include <memory>
+#include <vector>
+
+using namespace Menge::Math;
+
+// forward declarations
+class LiveObstacleSet;
+class WorldFrame;
+
+/*!
+ *	@brief		A node of the quadtree; its polygons are one tile.
+ */
+struct TileNode {
+	/*!
+	 *	@brief		The x-position of the node's minimum corner in world coordinates.
+	 */
+	double	_minX;
+
+	/*!
+	 *	@brief		The y-position of the node's minimum corner in world coordinates.
+	 */
+	double	_minY;
+
+	/*!
+	 *	@brief		The width (and height) of the node's square.
+	 */
+	double	_size;
+
+	/*!
+	 *	@brief		The position of the tile's polygons in the file.
+	 */
+	quint64	_offset;
+
+	/*!
+	 *	@brief		The size of the tile's polygons in the file (in bytes).
+	 */
+	quint32	_byteSize;
+
+	/*!
+	 *	@brief		The number of polygons in the tile.
+	 */
+	quint32	_polygonCount;
+
+	/*!
+	 *	@brief		The indices of the children, by quadrant (x-major: [min x min y,
+	 *				max x min y, min x max y, max x max y]); negative if there is no child.
+	 */
+	qint32	_children[4];
+};
+
+/*!
+ *	@brief		A polygon of a tile.
+ */
+struct TilePolygon {
+	/*!
+	 *	@brief		The polygon's winding (a GLPolygon::Winding value).
+	 */
+	int	_winding;
+
+	/*!
+	 *	@brief		The minimum corner of the polygon's bounding box (relative to the tile).
+	 */
+	Vector2	_min;
+
+	/*!
+	 *	@brief		The maximum corner of the polygon's bounding box (relative to the tile).
+	 */
+	Vector2	_max;
+
+	/*!
+	 *	@brief		The polygon's vertices, relative to the tile's minimum corner.
+	 */
+	std::vector< Vector2 >	_vertices;
+};
+
+/*!
+ *	@brief		The decoded contents of a tile.
+ */
+struct Tile {
+	/*!
+	 *	@brief		The index of the tile's node.
+	 */
+	size_t	_node;
+
+	/*!
+	 *	@brief		The tile's polygons.
+	 */
+	std::vector< TilePolygon >	_polygons;
+
+	/*!
+	 *	@brief		The memory the tile occupies (in bytes).
+	 */
+	size_t	_bytes;
+};
+
+/*!
+ *	@brief		A shared, read-only tile.
+ */
+typedef std::shared_ptr< const Tile > TilePtr;
+
+/*!
+ *	@brief		A quadtree of obstacle tiles in a memory-mapped file.
+ *
+ *	Every polygon belongs to the smallest node whose square contains it, but a node only
+ *	pushes its polygons down to its children once it holds more than TILE_CAPACITY of them.
+ *	Polygons which straddle a node's center lines stay in the node, so coarse nodes hold
+ *	the large polygons and the fine nodes the small ones; a view only needs the nodes
+ *	which are large on screen (see findTiles()).
+ *
+ *	A tile's vertices are stored in single precision relative to its node's corner (which
+ *	is stored in double precision), so the file keeps the precision of world coordinates
+ *	far from zero.  The node table is read when the file is opened; the tiles are decoded
+ *	on demand straight from the mapped file, from any thread.  Errors are reported by
+ *	throwing an MCException.
+ */
+class TileStore {
+public:
+	/*!
+	 *	@brief		Constructor -- the store is not attached to any file.
+	 */
+	TileStore();
+
+	/*!
+	 *	@brief		Destructor -- closes the file.
+	 */
+	~TileStore();
+
+	/*!
+	 *	@brief		Maps a tile file and reads its node table.
+	 *
+	 *	@param		path		The path to the file.
+	 *	@throws		MCException if the file can't be mapped or isn't a tile file.
+	 */
+	void open(const QString & path);
+
+	/*!
+	 *	@brief		Unmaps the file.  No tile may be being decoded.
+	 */
+	void close();
+
+	/*!
+	 *	@brief		Reports if the store is attached to a file.
+	 */
+	bool isOpen() const { return _data != 0x0; }
+
+	/*!
+	 *	@brief		Reports the path to the file (empty if the store isn't attached).
+	 */
+	QString getPath() const { return _file.fileName(); }
+
+	/*!
+	 *	@brief		Reports the number of nodes in the quadtree.
+	 */
+	size_t getNodeCount() const { return _nodes.size(); }
+
+	/*!
+	 *	@brief		Returns the indicated node.
+	 *
+	 *	@param		i		The index of the node (less than getNodeCount()).
+	 */
+	const TileNode & getNode(size_t i) const { return _nodes[i]; }
+
+	/*!
+	 *	@brief		Reports the total number of polygons in the file.
+	 */
+	quint64 getPolygonCount() const { return _polygonCount; }
+
+	/*!
+	 *	@brief		Finds the non-empty tiles which overlap a region, coarsest first.
+	 *
+	 *	Nodes smaller than the given size are skipped (with their descendants): their
+	 *	polygons are too small to matter at the view's scale.
+	 *
+	 *	@param		minX		The minimum x-value of the region (world coordinates).
+	 *	@param		minY		The minimum y-value of the region.
+	 *	@param		maxX		The maximum x-value of the region.
+	 *	@param		maxY		The maximum y-value of the region.
+	 *	@param		minSize		The size of the smallest node to report.
+	 *	@param		maxCount	The most tiles to report.
+	 *	@param		tiles		The indices of the tiles' nodes are written here.
+	 */
+	void findTiles(double minX, double minY, double maxX, double maxY, double minSize, size_t maxCount, std::vector< size_t > & tiles) const;
+
+	/*!
+	 *	@brief		Decodes a tile.  It is safe to call from any thread while the store is
+	 *				open.
+	 *
+	 *	@param		node		The index of the tile's node.
+	 *	@returns	The tile.
+	 *	@throws		MCException if the tile's data is damaged.
+	 */
+	TilePtr loadTile(size_t node) const;
+
+	/*!
+	 *	@brief		Writes the obstacles of a set as a tile file.
+	 *
+	 *	@param		path		The path of the file to write.
+	 *	@param		obstacles	The obstacles.
+	 *	@param		frame		The frame of the obstacles' coordinates.
+	 *	@returns	The number of tiles written.
+	 *	@throws		MCException if the file can't be written.
+	 */
+	static size_t build(const QString & path, const LiveObstacleSet & obstacles, const WorldFrame & frame);
+
+	/*!
+	 *	@brief		The most polygons in a node before it pushes polygons down to its
+	 *				children.
+	 */
+	static const size_t TILE_CAPACITY;
+
+	/*!
+	 *	@brief		The depth of the deepest nodes (the root is at depth zero).
+	 */
+	static const size_t MAX_DEPTH;
+
+protected:
+	/*!
+	 *	@brief		The mapped file.
+	 */
+	QFile	_file;
+
+	/*!
+	 *	@brief		The file's contents (null if the store isn't attached).
+	 */
+	const uchar *	_data;
+
+	/*!
+	 *	@brief		The size of the file (in bytes).
+	 */
+	qint64	_size;
+
+	/*!
+	 *	@brief		The quadtree's nodes; the root is first.
+	 */
+	std::vector< TileNode >	_nodes;
+
+	/*!
+	 *	@brief		The total number of polygons.
+	 */
+	quint64	_polygonCount;
+};
+
+#endif	// __TILE_STORE_H__
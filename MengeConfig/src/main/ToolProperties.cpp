@@ -6,15 +6,16 @@
 #include <QtWidgets/QBoxLayout.h>
 #include <QtWidgets/QFrame.h>
 #include <QtWidgets/QLabel.h>
+#include <QtWidgets/QStackedWidget.h>
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //						Implementation of ToolPropertyWidget
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-ToolPropertyWidget::ToolPropertyWidget(QWidget * parent) : QWidget(parent), _ctxWidget(0x0),_defaultWidget(0x0), _layout(0x0) {
-	_layout = new QVBoxLayout();
+ToolPropertyWidget::ToolPropertyWidget(QWidget * parent) : QWidget(parent), _stack(0x0), _defaultWidget(0x0), _pages() {
+	QVBoxLayout * layout = new QVBoxLayout();
 
-	_layout->setMargin(0);
+	layout->setMargin(0);
 
 	_defaultWidget = new QFrame();
 	QVBoxLayout * defLayout = new QVBoxLayout();
@@ -22,45 +23,84 @@ ToolPropertyWidget::ToolPropertyWidget(QWidget * parent) : QWidget(parent), _ctx
 	defLayout->addWidget(label, Qt::AlignCenter);
 	_defaultWidget->setLayout(defLayout);
 
-	_layout->addWidget(_defaultWidget);
+	_stack = new QStackedWidget();
+	_stack->addWidget(_defaultWidget);
+	layout->addWidget(_stack);
 	
-	setLayout(_layout);
+	setLayout(layout);
+
+	EventBus::instance()->subscribe(this, CONTEXT_ACTIVATED | CONTEXT_DEACTIVATED | CONTEXT_UNREGISTERED);
+	// A context may have been activated before this widget existed.
+	QtContext * active = ContextManager::instance()->getActive();
+	if (active != 0x0) activated(active);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void ToolPropertyWidget::activated(size_t ctxId) {
-	QtContext * ctx = getContext(ctxId);
-	if (ctx != 0x0) {
-		if (_ctxWidget == 0x0) {
-			_layout->removeWidget(_defaultWidget);
-		}
-		QWidget * widget = ctx->getContextWidget();
-		if (widget != 0x0) {
-			_layout->addWidget(widget);
+ToolPropertyWidget::~ToolPropertyWidget() {
+	EventBus::instance()->unsubscribe(this);
+	// The contexts own their widgets; they mustn't be destroyed with the stack.
+	std::unordered_map<QtContext *, QWidget *>::iterator itr = _pages.begin();
+	for (; itr != _pages.end(); ++itr) {
+		_stack->removeWidget(itr->second);
+		itr->second->setParent(0x0);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void ToolPropertyWidget::handleEvents(const std::vector<Event> & events) {
+	for (size_t i = 0; i < events.size(); ++i) {
+		const Event & evt = events[i];
+		switch (evt._type) {
+			case CONTEXT_ACTIVATED:
+				activated(evt._context);
+				break;
+			case CONTEXT_DEACTIVATED:
+				deactivated(evt._context);
+				break;
+			case CONTEXT_UNREGISTERED:
+				unregistered(evt._context);
+				break;
+			default:
+				break;
 		}
 	}
-	else {
-		_layout->addWidget(_defaultWidget);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void ToolPropertyWidget::activated(QtContext * ctx) {
+	QWidget * page = _defaultWidget;
+	std::unordered_map<QtContext *, QWidget *>::const_iterator itr = _pages.find(ctx);
+	if (itr != _pages.end()) {
+		page = itr->second;
+	}
+	else if (ctx->getContextWidget() != 0x0) {
+		page = ctx->getContextWidget();
+		_stack->addWidget(page);
+		_pages[ctx] = page;
 	}
+	_stack->setCurrentWidget(page);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void ToolPropertyWidget::deactivated(size_t ctxId) {
-	QtContext * ctx = getContext(ctxId);
-	if (ctx != 0x0) {
-		QWidget * widget = ctx->getContextWidget();
-		if (widget != 0x0 && widget == _ctxWidget) {
-			_layout->removeWidget(_ctxWidget);
-			_ctxWidget = 0x0;
-		}
+void ToolPropertyWidget::deactivated(QtContext * ctx) {
+	std::unordered_map<QtContext *, QWidget *>::const_iterator itr = _pages.find(ctx);
+	if (itr != _pages.end() && _stack->currentWidget() == itr->second) {
+		_stack->setCurrentWidget(_defaultWidget);
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-QtContext * ToolPropertyWidget::getContext(size_t id) {
-	ContextManager * mgr = ContextManager::instance();
-	return mgr->getContext(id);
-}
\ No newline at end of file
+void ToolPropertyWidget::unregistered(QtContext * ctx) {
+	std::unordered_map<QtContext *, QWidget *>::iterator itr = _pages.find(ctx);
+	if (itr != _pages.end()) {
+		// The context destroys the widget; removing it from the stack leaves it unparented.
+		_stack->removeWidget(itr->second);
+		itr->second->setParent(0x0);
+		_pages.erase(itr);
+	}
+}
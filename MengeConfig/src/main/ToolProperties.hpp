@@ -7,17 +7,28 @@
 #ifndef __TOOL_PROPERTIES_H__
 #define __TOOL_PROPERTIES_H__
 
+#include "EventBus.hpp"
+
 #include <QtWidgets/qwidget.h>
 
+#include <unordered_map>
 
 QT_BEGIN_NAMESPACE
-class QVBoxLayout;
+class QStackedWidget;
 QT_END_NAMESPACE
 
 class QtContext;
 
-
-class ToolPropertyWidget : public QWidget {
+/*!
+ *	@brief		Displays the property widget of the active context.
+ *
+ *	Each context's widget is added to a stack of pages the first time the context is
+ *	activated and kept there; switching contexts only changes the visible page.  The
+ *	contexts own their widgets: a page is released when its context is unregistered and
+ *	the pages remaining when this widget is destroyed are handed back to their contexts.
+ *	The context events arrive through the EventBus.
+ */
+class ToolPropertyWidget : public QWidget, public EventSubscriber {
 	Q_OBJECT
 
 public:
@@ -30,34 +41,49 @@ public:
 	ToolPropertyWidget(QWidget * parent = 0x0);
 
 	/*!
-	 *	@brief		Slot for being informed when a context gets activated.
-	 *
-	 *	@param		ctxId		The identifier for the activated context.
+	 *	@brief		Destructor.
 	 */
-	void activated(size_t ctxId);
+	~ToolPropertyWidget();
+
+	///////////////////////////////////////////////////////////////////////////////////
+	//			EventSubscriber interface
+	///////////////////////////////////////////////////////////////////////////////////
 
 	/*!
-	 *	@brief		Slot for being informed when a context gets deactivated
+	 *	@brief		Shows the page of the active context and releases the pages of
+	 *				unregistered contexts.
 	 *
-	 *	@param		ctxId		The context id for the context that has been
-	 *							deactivated.
+	 *	@param		events		The context events.
 	 */
-	void deactivated(size_t ctxId);
+	virtual void handleEvents(const std::vector<Event> & events);
 
 private:
 
 	/*!
-	 *	@brief		Queries the context manager for the given context.
+	 *	@brief		Shows the page of a newly activated context.
+	 *
+	 *	@param		ctx		The activated context.
+	 */
+	void activated(QtContext * ctx);
+
+	/*!
+	 *	@brief		Shows the default page if the deactivated context's page is shown.
+	 *
+	 *	@param		ctx		The deactivated context.
+	 */
+	void deactivated(QtContext * ctx);
+
+	/*!
+	 *	@brief		Releases the page of an unregistered context.
 	 *
-	 *	@param		id		The id for the context to acquire.
-	 *	@returns	The corresponding context, or null if none exists.
+	 *	@param		ctx		The context; it is being destroyed.
 	 */
-	QtContext * getContext(size_t id);
+	void unregistered(QtContext * ctx);
 
 	/*!
-	 *	@brief		The main context widget displayed for the current context.
+	 *	@brief		The pages: the default widget and the widgets of the activated contexts.
 	 */
-	QWidget * _ctxWidget;
+	QStackedWidget * _stack;
 
 	/*!
 	 *	@brief		The default widget when there is no context widget.
@@ -65,9 +91,9 @@ private:
 	QWidget * _defaultWidget;
 
 	/*!
-	 *	@brief		The layout for the widget.
+	 *	@brief		The page of each context which has been activated (and has a widget).
 	 */
-	QVBoxLayout * _layout;
+	std::unordered_map<QtContext *, QWidget *>	_pages;
 };
 
-#endif	// __TOOL_PROPERTIES_H__
\ No newline at end of file
+#endif	// __TOOL_PROPERTIES_H__
@@ -0,0 +1,658 @@
+#include "UnderlayNode.hpp"
+
+#include "AppLogger.hpp"
+#include "MCException.h"
+#include "PngBandReader.h"
+
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qstandardpaths.h>
+#include <QtGui/qimagereader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <gl/GL.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of UnderlayNode
+///////////////////////////////////////////////////////////////////////////////
+
+const int UnderlayNode::TILE_SIZE = 512;
+const size_t UnderlayNode::DEFAULT_BUDGET = 192 << 20;
+const size_t UnderlayNode::MAX_UPLOADS = 2;
+const size_t UnderlayNode::MAX_VIEW_TILES = 64;
+// The pyramid's tiles are written with light compression; they are written once and read
+//	often.
+const int PYRAMID_QUALITY = 80;
+
+///////////////////////////////////////////////////////////////////////////////
+
+UnderlayNode::UnderlayNode(QObject * parent) : QObject(parent), Menge::SceneGraph::GLNode(), _path(), _imageSize(), _topLevel(0), _minPt(0.f, 0.f), _maxPt(0.f, 0.f), _viewLevel(0), _view(), _viewCount(0), _cache(), _lru(), _budget(DEFAULT_BUDGET), _uploads(), _orphans(), _worker(), _lock(), _wake(), _generation(0), _workerPath(), _workerSize(), _requests(), _decoded(), _sourceBytes(0), _stopping(false), _sourceGeneration(0), _sourceRegions(false), _pyramidDir(), _pyramidReady(false), _pyramidFailed(false) {
+	// The worker emits its signals from its own thread; they are delivered on the GUI thread.
+	connect(this, &UnderlayNode::tilesDecoded, this, &UnderlayNode::acceptTiles);
+	connect(this, &UnderlayNode::pyramidFailed, this, &UnderlayNode::reportFailed);
+	_worker = std::thread(&UnderlayNode::workerLoop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+UnderlayNode::~UnderlayNode() {
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_stopping = true;
+		_requests.clear();
+	}
+	_wake.notify_all();
+	_worker.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::open(const QString & path) {
+	// Only the header is read; the pixels are decoded by the worker.
+	QImageReader reader(path);
+	const QSize size = reader.size();
+	if (!size.isValid() || size.isEmpty()) {
+		throw MCException(QString("Unable to read the image %1: %2").arg(path).arg(reader.errorString()).toStdString());
+	}
+	close();
+	_path = path;
+	_imageSize = size;
+	_topLevel = 0;
+	while ((TILE_SIZE << _topLevel) < std::max(size.width(), size.height())) {
+		++_topLevel;
+	}
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		_workerPath = path;
+		_workerSize = size;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::close() {
+	{
+		// The worker isn't waited for; the tile it is decoding is discarded on arrival.
+		std::lock_guard< std::mutex > lock(_lock);
+		++_generation;
+		_workerPath.clear();
+		_workerSize = QSize();
+		_requests.clear();
+		_decoded.clear();
+	}
+	discardTiles();
+	_path.clear();
+	_imageSize = QSize();
+	_topLevel = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::setBounds(const Vector2 & minPt, const Vector2 & maxPt) {
+	if (minPt._x == _minPt._x && minPt._y == _minPt._y && maxPt._x == _maxPt._x && maxPt._y == _maxPt._y) return false;
+	_minPt = minPt;
+	_maxPt = maxPt;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::setView(float worldPerPixel, const Vector2 & minPt, const Vector2 & maxPt) {
+	if (!isOpen()) return false;
+	const float width = _maxPt._x - _minPt._x;
+	const float height = _maxPt._y - _minPt._y;
+	std::vector< TileKey > view;
+	int level = _topLevel;
+	if (width > 0.f && height > 0.f && minPt._x < _maxPt._x && maxPt._x > _minPt._x && minPt._y < _maxPt._y && maxPt._y > _minPt._y) {
+		// The visible region in the image's pixels (rows grow downwards from the top edge).
+		const float sx = _imageSize.width() / width;
+		const float sy = _imageSize.height() / height;
+		const float left = (std::max(minPt._x, _minPt._x) - _minPt._x) * sx;
+		const float right = (std::min(maxPt._x, _maxPt._x) - _minPt._x) * sx;
+		const float top = (_maxPt._y - std::min(maxPt._y, _maxPt._y)) * sy;
+		const float bottom = (_maxPt._y - std::max(minPt._y, _minPt._y)) * sy;
+
+		// The level whose pixels are the closest to (but no larger than) a screen pixel.
+		const float imagePerScreen = worldPerPixel * std::sqrt(sx * sy);
+		level = imagePerScreen > 1.f ? static_cast<int>(std::floor(std::log(imagePerScreen) / std::log(2.f))) : 0;
+		level = std::min(std::max(level, 0), _topLevel);
+
+		int c0, c1, r0, r1;
+		while (true) {
+			const float span = static_cast<float>(TILE_SIZE << level);
+			const int cols = (_imageSize.width() + (TILE_SIZE << level) - 1) / (TILE_SIZE << level);
+			const int rows = (_imageSize.height() + (TILE_SIZE << level) - 1) / (TILE_SIZE << level);
+			c0 = std::min(std::max(static_cast<int>(left / span), 0), cols - 1);
+			c1 = std::min(std::max(static_cast<int>(right / span), 0), cols - 1);
+			r0 = std::min(std::max(static_cast<int>(top / span), 0), rows - 1);
+			r1 = std::min(std::max(static_cast<int>(bottom / span), 0), rows - 1);
+			if (level == _topLevel || static_cast<size_t>((c1 - c0 + 1) * (r1 - r0 + 1)) <= MAX_VIEW_TILES) break;
+			++level;
+		}
+
+		// The coarsest tile first (it covers everything while the others load), then the
+		//	level's tiles, nearest the center of the view first.
+		view.push_back(makeKey(_topLevel, 0, 0));
+		if (level < _topLevel) {
+			const float span = static_cast<float>(TILE_SIZE << level);
+			const float cx = 0.5f * (left + right) / span - 0.5f;
+			const float cy = 0.5f * (top + bottom) / span - 0.5f;
+			std::vector< std::pair< float, TileKey > > tiles;
+			for (int r = r0; r <= r1; ++r) {
+				for (int c = c0; c <= c1; ++c) {
+					tiles.push_back(std::make_pair((c - cx) * (c - cx) + (r - cy) * (r - cy), makeKey(level, c, r)));
+				}
+			}
+			std::sort(tiles.begin(), tiles.end());
+			for (const std::pair< float, TileKey > & tile : tiles) {
+				view.push_back(tile.second);
+			}
+		}
+	}
+	// A view which shows the same tiles doesn't disturb the requests in flight.
+	if (view == _view) return false;
+	_view.swap(view);
+	_viewLevel = level;
+	++_viewCount;
+
+	std::deque< TileKey > missing;
+	for (TileKey key : _view) {
+		std::unordered_map< TileKey, Entry >::iterator itr = _cache.find(key);
+		if (itr != _cache.end()) {
+			_lru.splice(_lru.begin(), _lru, itr->second._use);
+			itr->second._lastView = _viewCount;
+			continue;
+		}
+		bool waiting = false;
+		for (const DecodedTile & tile : _uploads) {
+			if (tile._key == key) {
+				waiting = true;
+				break;
+			}
+		}
+		if (!waiting) missing.push_back(key);
+	}
+	{
+		// Requests of the previous view which weren't decoded yet are dropped.
+		std::lock_guard< std::mutex > lock(_lock);
+		_requests.swap(missing);
+	}
+	_wake.notify_one();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::drawGL(bool select) {
+	if (select) return;
+	if (!_orphans.empty()) {
+		glDeleteTextures(static_cast<GLsizei>(_orphans.size()), &_orphans[0]);
+		_orphans.clear();
+	}
+	if (!isOpen()) return;
+	uploadTiles();
+
+	if (_visible && !_view.empty()) {
+		// Tiles in view which aren't resident yet are covered by their nearest resident
+		//	ancestor, so zooming in refines the previous level rather than showing holes.
+		std::vector< TileKey > drawn;
+		for (size_t i = 1; i < _view.size(); ++i) {
+			if (_cache.count(_view[i]) > 0) continue;
+			const int col = static_cast<int>(_view[i] & 0xFFFFFF);
+			const int row = static_cast<int>((_view[i] >> 24) & 0xFFFFFF);
+			for (int level = _viewLevel + 1; level < _topLevel; ++level) {
+				const int shift = level - _viewLevel;
+				const TileKey parent = makeKey(level, col >> shift, row >> shift);
+				if (_cache.count(parent) > 0) {
+					if (std::find(drawn.begin(), drawn.end(), parent) == drawn.end()) drawn.push_back(parent);
+					break;
+				}
+			}
+		}
+		// Coarse to fine; the coarsest tile is first in the view.
+		std::sort(drawn.begin(), drawn.end(), std::greater< TileKey >());
+		drawn.insert(drawn.begin(), _view[0]);
+		for (size_t i = 1; i < _view.size(); ++i) {
+			if (_cache.count(_view[i]) > 0) drawn.push_back(_view[i]);
+		}
+
+		glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+		glDisable(GL_LIGHTING);
+		glDisable(GL_DEPTH_TEST);
+		glDepthMask(GL_FALSE);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_TEXTURE_2D);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+		glColor4f(1.f, 1.f, 1.f, 1.f);
+
+		const float sx = (_maxPt._x - _minPt._x) / _imageSize.width();
+		const float sy = (_maxPt._y - _minPt._y) / _imageSize.height();
+		for (TileKey key : drawn) {
+			std::unordered_map< TileKey, Entry >::iterator itr = _cache.find(key);
+			if (itr == _cache.end() || itr->second._texture == 0) continue;
+			_lru.splice(_lru.begin(), _lru, itr->second._use);
+			const Entry & entry = itr->second;
+			const QRect rect = getTileRect(key, _imageSize);
+			const float x0 = _minPt._x + rect.left() * sx;
+			const float x1 = _minPt._x + (rect.right() + 1) * sx;
+			const float y0 = _maxPt._y - (rect.bottom() + 1) * sy;
+			const float y1 = _maxPt._y - rect.top() * sy;
+			// The texture's first row is the top of the tile.
+			glBindTexture(GL_TEXTURE_2D, entry._texture);
+			glBegin(GL_QUADS);
+			glTexCoord2f(0.f, entry._v);
+			glVertex3f(x0, y0, 0.f);
+			glTexCoord2f(entry._u, entry._v);
+			glVertex3f(x1, y0, 0.f);
+			glTexCoord2f(entry._u, 0.f);
+			glVertex3f(x1, y1, 0.f);
+			glTexCoord2f(0.f, 0.f);
+			glVertex3f(x0, y1, 0.f);
+			glEnd();
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glPopAttrib();
+	}
+
+	evict();
+	// The remaining tiles are uploaded over the following frames.
+	if (!_uploads.empty()) emit changed();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::newContext() {
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::destroyGL() {
+	discardTiles();
+	if (!_orphans.empty()) {
+		glDeleteTextures(static_cast<GLsizei>(_orphans.size()), &_orphans[0]);
+		_orphans.clear();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::acceptTiles() {
+	std::deque< DecodedTile > decoded;
+	size_t generation;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		decoded.swap(_decoded);
+		generation = _generation;
+	}
+	bool accepted = false;
+	for (DecodedTile & tile : decoded) {
+		// Tiles of a closed image, or decoded twice by consecutive views, are dropped.
+		if (tile._generation != generation || _cache.count(tile._key) > 0) continue;
+		_uploads.push_back(std::move(tile));
+		accepted = true;
+	}
+	// The upload waits for the next frame, when the OpenGL context is current.
+	if (accepted) emit changed();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::reportFailed(QString message) {
+	AppLogger::logStream << AppLogger::ERROR_MSG << "The underlay can't be shown: " << message.toStdString() << AppLogger::END_MSG;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::uploadTiles() {
+	size_t uploaded = 0;
+	while (!_uploads.empty() && uploaded < MAX_UPLOADS) {
+		DecodedTile tile = std::move(_uploads.front());
+		_uploads.pop_front();
+		// Tiles which have left the view in the meantime are requested again if they return.
+		if (_cache.count(tile._key) > 0 || std::find(_view.begin(), _view.end(), tile._key) == _view.end()) continue;
+
+		Entry entry;
+		entry._texture = 0;
+		entry._u = tile._u;
+		entry._v = tile._v;
+		entry._lastView = _viewCount;
+		// A tile which couldn't be decoded is resident without a texture, so it isn't
+		//	requested again.
+		if (!tile._mipmaps.empty()) {
+			glGenTextures(1, &entry._texture);
+			glBindTexture(GL_TEXTURE_2D, entry._texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			for (size_t i = 0; i < tile._mipmaps.size(); ++i) {
+				const QImage & mipmap = tile._mipmaps[i];
+				glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA, mipmap.width(), mipmap.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, mipmap.constBits());
+			}
+			glBindTexture(GL_TEXTURE_2D, 0);
+			++uploaded;
+		}
+		entry._use = _lru.insert(_lru.begin(), tile._key);
+		_cache[tile._key] = entry;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::evict() {
+	// A tile's texture and its mipmaps occupy 4/3 of its base level.
+	const size_t TILE_BYTES = static_cast<size_t>(TILE_SIZE) * TILE_SIZE * 4 * 4 / 3;
+	size_t sourceBytes;
+	{
+		std::lock_guard< std::mutex > lock(_lock);
+		sourceBytes = _sourceBytes;
+	}
+	while (_cache.size() * TILE_BYTES + sourceBytes > _budget && !_lru.empty()) {
+		std::unordered_map< TileKey, Entry >::iterator itr = _cache.find(_lru.back());
+		// The tiles in view are at the front of the list; they are never evicted.
+		if (itr->second._lastView == _viewCount) break;
+		if (itr->second._texture != 0) glDeleteTextures(1, &itr->second._texture);
+		_cache.erase(itr);
+		_lru.pop_back();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::discardTiles() {
+	for (const std::pair< const TileKey, Entry > & item : _cache) {
+		if (item.second._texture != 0) _orphans.push_back(item.second._texture);
+	}
+	_cache.clear();
+	_lru.clear();
+	_uploads.clear();
+	// The next view requests its tiles again.
+	_view.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QRect UnderlayNode::getTileRect(TileKey key, const QSize & imageSize) {
+	const int level = static_cast<int>(key >> 48);
+	const int row = static_cast<int>((key >> 24) & 0xFFFFFF);
+	const int col = static_cast<int>(key & 0xFFFFFF);
+	const int span = TILE_SIZE << level;
+	return QRect(col * span, row * span, span, span).intersected(QRect(QPoint(0, 0), imageSize));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QSize UnderlayNode::getTileSize(TileKey key, const QSize & imageSize) {
+	const int level = static_cast<int>(key >> 48);
+	const QRect rect = getTileRect(key, imageSize);
+	const int round = (1 << level) - 1;
+	return QSize(std::min((rect.width() + round) >> level, TILE_SIZE), std::min((rect.height() + round) >> level, TILE_SIZE));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QString UnderlayNode::getPyramidDir(const QString & path) {
+	const QString name = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+	return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("underlays/" + name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QString UnderlayNode::getPyramidTile(const QString & dir, TileKey key) {
+	const int level = static_cast<int>(key >> 48);
+	const int row = static_cast<int>((key >> 24) & 0xFFFFFF);
+	const int col = static_cast<int>(key & 0xFFFFFF);
+	return QString("%1/%2_%3_%4.png").arg(dir).arg(level).arg(col).arg(row);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::workerLoop() {
+	std::unique_lock< std::mutex > lock(_lock);
+	while (true) {
+		while (_requests.empty() && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_stopping) return;
+
+		const TileKey key = _requests.front();
+		_requests.pop_front();
+		const QString path = _workerPath;
+		const QSize size = _workerSize;
+		const size_t generation = _generation;
+		lock.unlock();
+
+		DecodedTile tile;
+		tile._key = key;
+		tile._generation = generation;
+		tile._u = tile._v = 0.f;
+		decodeTile(path, size, key, tile);
+
+		lock.lock();
+		// A tile of a closed image is dropped here rather than by the GUI thread.
+		if (generation != _generation) continue;
+		// One signal covers every tile decoded before the GUI thread collects them.
+		const bool notify = _decoded.empty();
+		_decoded.push_back(std::move(tile));
+		lock.unlock();
+		if (notify) emit tilesDecoded();
+		lock.lock();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::decodeTile(const QString & path, const QSize & imageSize, TileKey key, DecodedTile & tile) {
+	// A reopened image is probed again; it may have changed.
+	if (tile._generation != _sourceGeneration) {
+		_sourceGeneration = tile._generation;
+		QImageReader probe(path);
+		_sourceRegions = probe.supportsOption(QImageIOHandler::ClipRect) && probe.supportsOption(QImageIOHandler::ScaledSize);
+		_pyramidDir = _sourceRegions ? QString() : getPyramidDir(path);
+		_pyramidReady = false;
+		_pyramidFailed = false;
+	}
+
+	QImage image;
+	if (_sourceRegions) {
+		// The format decodes the tile's region, reduced to the tile's size, by itself.
+		QImageReader reader(path);
+		reader.setClipRect(getTileRect(key, imageSize));
+		reader.setScaledSize(getTileSize(key, imageSize));
+		image = reader.read();
+	}
+	else {
+		// A pyramid which couldn't be built isn't tried again for every tile in view.
+		if (_pyramidFailed) return;
+		if (!_pyramidReady) {
+			QString error;
+			_pyramidReady = buildPyramid(path, imageSize, tile._generation, error);
+			if (!_pyramidReady) {
+				if (!error.isEmpty()) {
+					_pyramidFailed = true;
+					emit pyramidFailed(error);
+				}
+				return;
+			}
+		}
+		QImageReader reader(getPyramidTile(_pyramidDir, key));
+		image = reader.read();
+	}
+	if (image.isNull()) return;
+	image = image.convertToFormat(QImage::Format_RGBA8888);
+
+	// Edge tiles are padded with transparent pixels to the texture's size.
+	QImage texture(TILE_SIZE, TILE_SIZE, QImage::Format_RGBA8888);
+	texture.fill(Qt::transparent);
+	const int width = std::min(image.width(), TILE_SIZE);
+	const int height = std::min(image.height(), TILE_SIZE);
+	for (int y = 0; y < height; ++y) {
+		std::memcpy(texture.scanLine(y), image.constScanLine(y), width * 4);
+	}
+	tile._u = static_cast<float>(width) / TILE_SIZE;
+	tile._v = static_cast<float>(height) / TILE_SIZE;
+
+	tile._mipmaps.push_back(texture);
+	while (tile._mipmaps.back().width() > 1) {
+		const QImage & prev = tile._mipmaps.back();
+		const int half = prev.width() / 2;
+		tile._mipmaps.push_back(prev.scaled(half, half, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::buildPyramid(const QString & path, const QSize & imageSize, size_t generation, QString & error) {
+	// The pyramid records the image it was cut from; an edited image is cut again.
+	const QFileInfo source(path);
+	const QByteArray stamp = QString("%1 %2 %3 %4").arg(imageSize.width()).arg(imageSize.height()).arg(source.size()).arg(source.lastModified().toMSecsSinceEpoch()).toUtf8();
+	QDir dir(_pyramidDir);
+	QFile record(dir.filePath("pyramid.txt"));
+	if (record.open(QIODevice::ReadOnly) && record.readAll() == stamp) return true;
+	record.close();
+
+	dir.removeRecursively();
+	if (!dir.mkpath(".")) {
+		error = QString("Unable to create the directory %1").arg(_pyramidDir);
+		return false;
+	}
+	bool complete = cutBaseLevel(path, imageSize, generation, error);
+	setSourceBytes(0);
+	for (int l = 1; complete && (TILE_SIZE << (l - 1)) < std::max(imageSize.width(), imageSize.height()); ++l) {
+		complete = reduceLevel(l, imageSize, generation, error);
+	}
+	if (!complete) return false;
+	if (!record.open(QIODevice::WriteOnly | QIODevice::Truncate) || record.write(stamp) != stamp.size()) {
+		error = QString("Unable to write %1: %2").arg(record.fileName()).arg(record.errorString());
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::cutBaseLevel(const QString & path, const QSize & imageSize, size_t generation, QString & error) {
+	const int rows = (imageSize.height() + TILE_SIZE - 1) / TILE_SIZE;
+	PngBandReader png;
+	try {
+		if (png.open(path)) {
+			if (png.getSize() != imageSize) {
+				error = QString("The image %1 changed while it was read").arg(path);
+				return false;
+			}
+			for (int row = 0; row < rows; ++row) {
+				QImage band(imageSize.width(), std::min(TILE_SIZE, png.getRemainingRows()), QImage::Format_RGBA8888);
+				if (band.isNull()) {
+					error = QString("Not enough memory to decode the image %1").arg(path);
+					return false;
+				}
+				setSourceBytes(band.byteCount());
+				png.readRows(band);
+				if (!saveBaseRow(band, 0, row, imageSize, generation, error)) return false;
+			}
+			return true;
+		}
+	}
+	catch (MCException & e) {
+		error = QString(e.what());
+		return false;
+	}
+
+	// The format can't be decoded in rows.
+	QImageReader reader(path);
+	const QImage image = reader.read();
+	if (image.isNull()) {
+		error = QString("Unable to decode the image %1: %2").arg(path).arg(reader.errorString());
+		return false;
+	}
+	setSourceBytes(image.byteCount());
+	for (int row = 0; row < rows; ++row) {
+		if (!saveBaseRow(image, row * TILE_SIZE, row, imageSize, generation, error)) return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::reduceLevel(int level, const QSize & imageSize, size_t generation, QString & error) {
+	const int span = TILE_SIZE << level;
+	const int cols = (imageSize.width() + span - 1) / span;
+	const int rows = (imageSize.height() + span - 1) / span;
+	const int childCols = (imageSize.width() + (span >> 1) - 1) / (span >> 1);
+	const int childRows = (imageSize.height() + (span >> 1) - 1) / (span >> 1);
+	for (int row = 0; row < rows; ++row) {
+		for (int col = 0; col < cols; ++col) {
+			// The (up to) four tiles of the previous level are joined, then halved.
+			QImage joined(2 * TILE_SIZE, 2 * TILE_SIZE, QImage::Format_RGBA8888);
+			joined.fill(Qt::transparent);
+			int width = 0;
+			int height = 0;
+			for (int r = 0; r < 2 && 2 * row + r < childRows; ++r) {
+				for (int c = 0; c < 2 && 2 * col + c < childCols; ++c) {
+					const QString childPath = getPyramidTile(_pyramidDir, makeKey(level - 1, 2 * col + c, 2 * row + r));
+					QImageReader reader(childPath);
+					const QImage child = reader.read().convertToFormat(QImage::Format_RGBA8888);
+					if (child.isNull()) {
+						error = QString("Unable to read %1: %2").arg(childPath).arg(reader.errorString());
+						return false;
+					}
+					const int childWidth = std::min(child.width(), TILE_SIZE);
+					for (int y = 0; y < child.height() && y < TILE_SIZE; ++y) {
+						std::memcpy(joined.scanLine(r * TILE_SIZE + y) + c * TILE_SIZE * 4, child.constScanLine(y), childWidth * 4);
+					}
+					width = std::max(width, c * TILE_SIZE + childWidth);
+					height = std::max(height, r * TILE_SIZE + std::min(child.height(), TILE_SIZE));
+				}
+			}
+			const TileKey key = makeKey(level, col, row);
+			const QImage tile = joined.copy(0, 0, width, height).scaled(getTileSize(key, imageSize), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+			if (!tile.save(getPyramidTile(_pyramidDir, key), "PNG", PYRAMID_QUALITY)) {
+				error = QString("Unable to write %1").arg(getPyramidTile(_pyramidDir, key));
+				return false;
+			}
+			if (isAbandoned(generation)) return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::saveBaseRow(const QImage & source, int top, int row, const QSize & imageSize, size_t generation, QString & error) {
+	const int cols = (imageSize.width() + TILE_SIZE - 1) / TILE_SIZE;
+	for (int col = 0; col < cols; ++col) {
+		const TileKey key = makeKey(0, col, row);
+		const QImage tile = source.copy(QRect(QPoint(col * TILE_SIZE, top), getTileSize(key, imageSize)));
+		if (!tile.save(getPyramidTile(_pyramidDir, key), "PNG", PYRAMID_QUALITY)) {
+			error = QString("Unable to write %1").arg(getPyramidTile(_pyramidDir, key));
+			return false;
+		}
+		if (isAbandoned(generation)) return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool UnderlayNode::isAbandoned(size_t generation) {
+	std::lock_guard< std::mutex > lock(_lock);
+	return _stopping || generation != _generation;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void UnderlayNode::setSourceBytes(size_t bytes) {
+	std::lock_guard< std::mutex > lock(_lock);
+	_sourceBytes = bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,552 @@
+/*!
+ *	@file		UnderlayNode.hpp
+ *	@brief		The definition of a raster image (e.g., a floor plan) drawn under the scene
+ *				as mipmapped texture tiles.
+ */
+
+#ifndef __UNDERLAY_NODE_H__
+#define	__UNDERLAY_NODE_H__
+
+#include <GLNode.h>
+#include <Math/Vector2.h>
+
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+#include <QtGui/qimage.h>
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace Menge::Math;
+
+/*!
+ *	@brief		Draws an image on the ground plane, stretched over a rectangle (the reference
+ *				grid's; see setBounds()).
+ *
+ *	The image is divided into a pyramid of tiles of TILE_SIZE pixels: the tiles of level L
+ *	each cover (TILE_SIZE << L) pixels of the image, and the coarsest level is a single
+ *	tile.  The view reports the region it sees and its scale (see setView()); the node
+ *	picks the level whose pixels are closest to the screen's and requests the level's
+ *	tiles in view (and the coarsest tile, which is drawn under everything else while the
+ *	others load).
+ *
+ *	A worker thread decodes the requested tiles and builds each tile's mipmaps; the GUI
+ *	thread never waits for it.  The decoded tiles are uploaded to textures while drawing,
+ *	at most MAX_UPLOADS per frame, so a burst of tiles never stalls a frame.  The textures
+ *	are kept in a least-recently-used cache of bounded size; textures out of view are
+ *	released once it exceeds its budget.
+ *
+ *	Images whose format supports decoding a region (e.g., JPEG) are decoded tile by tile.
+ *	Other images (e.g., PNG) are cut, once, into a pyramid of tile files in the cache
+ *	directory (see getPyramidDir()) from which the tiles are then decoded.  A PNG image is
+ *	decoded a row of tiles at a time; only images which can't be (e.g., interlaced ones)
+ *	are decoded in full.  The pixels the worker holds while it builds a pyramid count
+ *	against the budget until they are released.  If the pyramid can't be built, the
+ *	failure is reported (see pyramidFailed()) and the image is not tried again until it
+ *	is reopened.
+ */
+class UnderlayNode : public QObject, public Menge::SceneGraph::GLNode {
+	Q_OBJECT
+
+public:
+	/*!
+	 *	@brief		Constructor.
+	 *
+	 *	@param		parent		The optional parent object.
+	 */
+	UnderlayNode(QObject * parent = 0x0);
+
+	/*!
+	 *	@brief		Destructor -- stops the worker thread.
+	 *
+	 *	The OpenGL resources must be released with destroyGL() (with a current OpenGL
+	 *	context) before the node is destroyed.
+	 */
+	~UnderlayNode();
+
+	/*!
+	 *	@brief		Opens an image (closing the current one).  Only the image's header is read;
+	 *				its tiles are decoded as they come into view.
+	 *
+	 *	@param		path		The path to the image.
+	 *	@throws		MCException if the image can't be read.
+	 */
+	void open(const QString & path);
+
+	/*!
+	 *	@brief		Closes the image.  Its textures are released when the node is next drawn.
+	 */
+	void close();
+
+	/*!
+	 *	@brief		Reports if an image is open.
+	 */
+	bool isOpen() const { return !_path.isEmpty(); }
+
+	/*!
+	 *	@brief		Reports the path to the image (empty if none is open).
+	 */
+	const QString & getPath() const { return _path; }
+
+	/*!
+	 *	@brief		Reports the size of the image (in pixels).
+	 */
+	QSize getImageSize() const { return _imageSize; }
+
+	/*!
+	 *	@brief		Sets the rectangle the image covers; the image's top-left corner is at
+	 *				(minimum x, maximum y).
+	 *
+	 *	@param		minPt		The minimum corner of the rectangle.
+	 *	@param		maxPt		The maximum corner of the rectangle.
+	 *	@returns	True if the rectangle changed.
+	 */
+	bool setBounds(const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Selects the tiles in view and requests the ones which aren't resident.
+	 *
+	 *	@param		worldPerPixel		The size of a screen pixel in world units.
+	 *	@param		minPt				The minimum corner of the visible region.
+	 *	@param		maxPt				The maximum corner of the visible region.
+	 *	@returns	True if the tiles in view changed.
+	 */
+	bool setView(float worldPerPixel, const Vector2 & minPt, const Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Uploads decoded tiles and draws the resident tiles in view.
+	 *
+	 *	@param		select		Determines if the draw call is being performed for the
+	 *							purpose of selection (true) or for visualization (false).
+	 */
+	virtual void drawGL(bool select = false);
+
+	/*!
+	 *	@brief		Keeps the textures: the view reports a new context when it is resized, but
+	 *				its context survives until destroyGL() is called.
+	 */
+	virtual void newContext();
+
+	/*!
+	 *	@brief		Releases the OpenGL resources.  The OpenGL context must be current.
+	 */
+	void destroyGL();
+
+	/*!
+	 *	@brief		The size (in pixels) of a tile's texture.
+	 */
+	static const int TILE_SIZE;
+
+	/*!
+	 *	@brief		The default budget of the textures' memory (in bytes).
+	 */
+	static const size_t DEFAULT_BUDGET;
+
+	/*!
+	 *	@brief		The most tiles uploaded per frame.
+	 */
+	static const size_t MAX_UPLOADS;
+
+	/*!
+	 *	@brief		The most tiles of a level in view; coarser levels are used if a level
+	 *				would exceed it.
+	 */
+	static const size_t MAX_VIEW_TILES;
+
+signals:
+	/*!
+	 *	@brief		Emitted (from the worker thread) when tiles have been decoded.
+	 */
+	void tilesDecoded();
+
+	/*!
+	 *	@brief		Emitted when the node has to be drawn again: tiles are waiting to be
+	 *				uploaded.
+	 */
+	void changed();
+
+	/*!
+	 *	@brief		Emitted (from the worker thread) when the pyramid of the open image
+	 *				can't be built.
+	 *
+	 *	@param		message		A description of the failure.
+	 */
+	void pyramidFailed(QString message);
+
+protected:
+	/*!
+	 *	@brief		Identifies a tile: its level, row and column.
+	 */
+	typedef quint64 TileKey;
+
+	/*!
+	 *	@brief		Makes a tile's key.
+	 *
+	 *	@param		level		The tile's level.
+	 *	@param		col			The tile's column.
+	 *	@param		row			The tile's row.
+	 *	@returns	The key.
+	 */
+	static TileKey makeKey(int level, int col, int row) { return (TileKey(level) << 48) | (TileKey(row) << 24) | TileKey(col); }
+
+	/*!
+	 *	@brief		A tile decoded by the worker thread.
+	 */
+	struct DecodedTile {
+		/*!
+		 *	@brief		The tile.
+		 */
+		TileKey	_key;
+
+		/*!
+		 *	@brief		The image the tile belongs to (see _generation).
+		 */
+		size_t	_generation;
+
+		/*!
+		 *	@brief		The tile's mipmaps, from TILE_SIZE pixels down to one (RGBA, 8 bits
+		 *				per channel).  Empty if the tile couldn't be decoded.
+		 */
+		std::vector< QImage >	_mipmaps;
+
+		/*!
+		 *	@brief		The fraction of the texture's width covered by the image.
+		 */
+		float	_u;
+
+		/*!
+		 *	@brief		The fraction of the texture's height covered by the image.
+		 */
+		float	_v;
+	};
+
+	/*!
+	 *	@brief		A resident tile.
+	 */
+	struct Entry {
+		/*!
+		 *	@brief		The tile's texture (zero if the tile couldn't be decoded).
+		 */
+		unsigned int	_texture;
+
+		/*!
+		 *	@brief		The fraction of the texture's width covered by the image.
+		 */
+		float	_u;
+
+		/*!
+		 *	@brief		The fraction of the texture's height covered by the image.
+		 */
+		float	_v;
+
+		/*!
+		 *	@brief		The tile's position in the least-recently-used list.
+		 */
+		std::list< TileKey >::iterator	_use;
+
+		/*!
+		 *	@brief		The last view the tile was in (see _viewCount).
+		 */
+		size_t	_lastView;
+	};
+
+	/*!
+	 *	@brief		Takes the decoded tiles from the worker thread (on the GUI thread).
+	 */
+	void acceptTiles();
+
+	/*!
+	 *	@brief		Logs the failure to build a pyramid (on the GUI thread).
+	 *
+	 *	@param		message		A description of the failure.
+	 */
+	void reportFailed(QString message);
+
+	/*!
+	 *	@brief		Uploads waiting tiles (at most MAX_UPLOADS).  The OpenGL context must be
+	 *				current.
+	 */
+	void uploadTiles();
+
+	/*!
+	 *	@brief		Releases textures which are out of view until the textures (and the
+	 *				image the worker holds while building a pyramid) fit the budget.  The
+	 *				OpenGL context must be current.
+	 */
+	void evict();
+
+	/*!
+	 *	@brief		Discards the resident and decoded tiles; their textures are released when
+	 *				the node is next drawn.
+	 */
+	void discardTiles();
+
+	/*!
+	 *	@brief		Computes the region of an image covered by a tile (in pixels).
+	 *
+	 *	@param		key			The tile.
+	 *	@param		imageSize	The size of the image.
+	 *	@returns	The region, clipped to the image.
+	 */
+	static QRect getTileRect(TileKey key, const QSize & imageSize);
+
+	/*!
+	 *	@brief		Computes the size of a tile in the pixels of its level.
+	 *
+	 *	@param		key			The tile.
+	 *	@param		imageSize	The size of the image.
+	 *	@returns	The size; at most TILE_SIZE pixels on a side.
+	 */
+	static QSize getTileSize(TileKey key, const QSize & imageSize);
+
+	/*!
+	 *	@brief		Reports the directory which holds the tile pyramid of an image.
+	 *
+	 *	@param		path		The path to the image.
+	 *	@returns	A directory of the user's cache, named for the image's path.
+	 */
+	static QString getPyramidDir(const QString & path);
+
+	/*!
+	 *	@brief		Reports the path of a tile's file in a pyramid.
+	 *
+	 *	@param		dir			The pyramid's directory.
+	 *	@param		key			The tile.
+	 */
+	static QString getPyramidTile(const QString & dir, TileKey key);
+
+	/*!
+	 *	@brief		The worker thread's loop.
+	 */
+	void workerLoop();
+
+	/*!
+	 *	@brief		Decodes a tile and builds its mipmaps (on the worker thread).
+	 *
+	 *	@param		path		The path to the image.
+	 *	@param		imageSize	The size of the image.
+	 *	@param		key			The tile.
+	 *	@param		tile		The tile's mipmaps and extent are written here.
+	 */
+	void decodeTile(const QString & path, const QSize & imageSize, TileKey key, DecodedTile & tile);
+
+	/*!
+	 *	@brief		Cuts an image into the tile files of its pyramid (on the worker thread),
+	 *				unless the pyramid was already built from the image as it is.
+	 *
+	 *	The finest level is cut from the image (see cutBaseLevel()); each tile of the
+	 *	following levels is reduced from the four tiles it covers.  The pyramid is
+	 *	abandoned if the image is closed meanwhile.
+	 *
+	 *	@param		path		The path to the image.
+	 *	@param		imageSize	The size of the image.
+	 *	@param		generation	The generation of the image (see _generation).
+	 *	@param		error		A description of the failure; left empty if the pyramid was
+	 *							abandoned.
+	 *	@returns	True if the pyramid is complete.
+	 */
+	bool buildPyramid(const QString & path, const QSize & imageSize, size_t generation, QString & error);
+
+	/*!
+	 *	@brief		Cuts an image into the tiles of the pyramid's finest level.  A PNG image
+	 *				is decoded a row of tiles at a time (see PngBandReader); others are
+	 *				decoded in full.
+	 *
+	 *	@param		path		The path to the image.
+	 *	@param		imageSize	The size of the image.
+	 *	@param		generation	The generation of the image (see _generation).
+	 *	@param		error		A description of the failure.
+	 *	@returns	True if the level is complete.
+	 */
+	bool cutBaseLevel(const QString & path, const QSize & imageSize, size_t generation, QString & error);
+
+	/*!
+	 *	@brief		Builds the tiles of a level of the pyramid from those of the previous
+	 *				level.
+	 *
+	 *	@param		level		The level (greater than zero).
+	 *	@param		imageSize	The size of the image.
+	 *	@param		generation	The generation of the image (see _generation).
+	 *	@param		error		A description of the failure.
+	 *	@returns	True if the level is complete.
+	 */
+	bool reduceLevel(int level, const QSize & imageSize, size_t generation, QString & error);
+
+	/*!
+	 *	@brief		Writes a row of tiles of the pyramid's finest level.
+	 *
+	 *	@param		source		The pixels of the image; the row's tiles start at the top
+	 *							row given.
+	 *	@param		top			The row of the source where the tiles start.
+	 *	@param		row			The row of tiles.
+	 *	@param		imageSize	The size of the image.
+	 *	@param		generation	The generation of the image (see _generation).
+	 *	@param		error		A description of the failure.
+	 *	@returns	True if the row is complete.
+	 */
+	bool saveBaseRow(const QImage & source, int top, int row, const QSize & imageSize, size_t generation, QString & error);
+
+	/*!
+	 *	@brief		Reports if the image being cut has been closed (or the node is being
+	 *				destroyed).
+	 *
+	 *	@param		generation	The generation of the image (see _generation).
+	 */
+	bool isAbandoned(size_t generation);
+
+	/*!
+	 *	@brief		Records the memory the worker holds while building a pyramid.
+	 *
+	 *	@param		bytes		The number of bytes.
+	 */
+	void setSourceBytes(size_t bytes);
+
+	/*!
+	 *	@brief		The path to the image (empty if none is open).
+	 */
+	QString	_path;
+
+	/*!
+	 *	@brief		The size of the image (in pixels).
+	 */
+	QSize	_imageSize;
+
+	/*!
+	 *	@brief		The coarsest level (it has a single tile).
+	 */
+	int	_topLevel;
+
+	/*!
+	 *	@brief		The minimum corner of the rectangle the image covers.
+	 */
+	Vector2	_minPt;
+
+	/*!
+	 *	@brief		The maximum corner of the rectangle the image covers.
+	 */
+	Vector2	_maxPt;
+
+	/*!
+	 *	@brief		The level drawn in the current view.
+	 */
+	int	_viewLevel;
+
+	/*!
+	 *	@brief		The tiles requested by the current view, in the order they are drawn.
+	 */
+	std::vector< TileKey >	_view;
+
+	/*!
+	 *	@brief		Counts the views whose tiles differed from the previous one's.
+	 */
+	size_t	_viewCount;
+
+	/*!
+	 *	@brief		The resident tiles.
+	 */
+	std::unordered_map< TileKey, Entry >	_cache;
+
+	/*!
+	 *	@brief		The resident tiles, most recently used first.
+	 */
+	std::list< TileKey >	_lru;
+
+	/*!
+	 *	@brief		The budget of the textures' memory (in bytes).
+	 */
+	size_t	_budget;
+
+	/*!
+	 *	@brief		The decoded tiles waiting to be uploaded.
+	 */
+	std::deque< DecodedTile >	_uploads;
+
+	/*!
+	 *	@brief		Textures to release when the node is next drawn.
+	 */
+	std::vector< unsigned int >	_orphans;
+
+	/*!
+	 *	@brief		The worker thread.
+	 */
+	std::thread	_worker;
+
+	/*!
+	 *	@brief		Guards the members below.
+	 */
+	std::mutex	_lock;
+
+	/*!
+	 *	@brief		Signals the worker that there are requests (or that it should stop).
+	 */
+	std::condition_variable	_wake;
+
+	/*!
+	 *	@brief		Counts the images opened; tiles decoded for an earlier image are
+	 *				discarded.
+	 */
+	size_t	_generation;
+
+	/*!
+	 *	@brief		The path to the image, for the worker thread.
+	 */
+	QString	_workerPath;
+
+	/*!
+	 *	@brief		The size of the image, for the worker thread.
+	 */
+	QSize	_workerSize;
+
+	/*!
+	 *	@brief		The tiles to decode; replaced by every view.
+	 */
+	std::deque< TileKey >	_requests;
+
+	/*!
+	 *	@brief		The decoded tiles not yet taken by the GUI thread.
+	 */
+	std::deque< DecodedTile >	_decoded;
+
+	/*!
+	 *	@brief		The memory held by the worker while it builds a pyramid (in bytes).
+	 */
+	size_t	_sourceBytes;
+
+	/*!
+	 *	@brief		Reports if the worker should stop.
+	 */
+	bool	_stopping;
+
+	/*!
+	 *	@brief		The generation of the image the worker thread last decoded.
+	 */
+	size_t	_sourceGeneration;
+
+	/*!
+	 *	@brief		Reports if that image's format can decode a region at a reduced size.
+	 */
+	bool	_sourceRegions;
+
+	/*!
+	 *	@brief		The directory of that image's pyramid (empty if its format can decode a
+	 *				region).
+	 */
+	QString	_pyramidDir;
+
+	/*!
+	 *	@brief		Reports if that image's pyramid is complete.
+	 */
+	bool	_pyramidReady;
+
+	/*!
+	 *	@brief		Reports if that image's pyramid couldn't be built.
+	 */
+	bool	_pyramidFailed;
+};
+
+#endif	// __UNDERLAY_NODE_H__
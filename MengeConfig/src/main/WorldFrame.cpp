@@ -0,0 +1,48 @@
+#include "WorldFrame.h"
+
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    Implementation of WorldFrame
+///////////////////////////////////////////////////////////////////////////////
+
+const float WorldFrame::REBASE_DISTANCE = 8192.f;
+const double WorldFrame::ORIGIN_GRANULARITY = 1024.0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+WorldFrame::WorldFrame() : _originX(0.0), _originY(0.0) {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WorldFrame::setOrigin(double x, double y) {
+	_originX = x;
+	_originY = y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Vector2 WorldFrame::toLocal(double x, double y) const {
+	// The difference is taken in double precision; only the (small) result is rounded.
+	return Vector2(static_cast<float>(x - _originX), static_cast<float>(y - _originY));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WorldFrame::toWorld(const Vector2 & local, double & x, double & y) const {
+	x = _originX + local._x;
+	y = _originY + local._y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool WorldFrame::isDistant(const Vector2 & local) {
+	return std::fabs(local._x) > REBASE_DISTANCE || std::fabs(local._y) > REBASE_DISTANCE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double WorldFrame::roundOrigin(double value) {
+	return std::floor(value / ORIGIN_GRANULARITY + 0.5) * ORIGIN_GRANULARITY;
+}
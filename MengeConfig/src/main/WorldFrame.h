@@ -0,0 +1,118 @@
+/*!
+ *	@file		WorldFrame.h
+ *	@brief		The definition of the frame which relates the scene's single-precision
+ *				coordinates to world (e.g., projected site) coordinates.
+ */
+
+#ifndef __WORLD_FRAME_H__
+#define	__WORLD_FRAME_H__
+
+#include <Math/Vector2.h>
+
+using namespace Menge::Math;
+
+/*!
+ *	@brief		The origin, in world coordinates, of the scene's local frame.
+ *
+ *	Obstacles, agents, the grid and the camera are stored and drawn in single precision
+ *	relative to the origin; the origin itself is kept in double precision.  Site plans in
+ *	projected coordinates (hundreds of kilometers from zero) keep their precision as long
+ *	as the origin is near the region being edited: the scene is rebased (every local
+ *	coordinate shifted) when the view moves more than REBASE_DISTANCE away from it.
+ *
+ *	Origins are multiples of ORIGIN_GRANULARITY.  It is a power of two, so a rebase never
+ *	rounds a local coordinate which moves toward the new origin, and integral world
+ *	positions (e.g., grid lines) stay integral in the local frame.
+ *
+ *	A coordinate which moves away from the new origin is rounded to the spacing of single
+ *	precision values at its new distance.  That spacing is also a power of two and, within
+ *	2^34 units of the origin, no larger than ORIGIN_GRANULARITY, so it divides the origin:
+ *	the rounded world position lies on the same world grid whichever origin rounded it.
+ *	Rebases therefore don't compound.  A position is rounded again only when it is taken
+ *	farther from an origin than ever before, and it never drifts from where it was placed
+ *	by as much as the spacing at the farthest distance it has been from an origin (e.g.,
+ *	1/16 unit at 500,000).  SelfCheck exercises this over many rebases.
+ */
+class WorldFrame {
+public:
+	/*!
+	 *	@brief		Constructor -- the origin is at zero.
+	 */
+	WorldFrame();
+
+	/*!
+	 *	@brief		Sets the origin.
+	 *
+	 *	@param		x		The x-position of the origin in world coordinates.
+	 *	@param		y		The y-position of the origin in world coordinates.
+	 */
+	void setOrigin(double x, double y);
+
+	/*!
+	 *	@brief		Reports the x-position of the origin in world coordinates.
+	 */
+	double getOriginX() const { return _originX; }
+
+	/*!
+	 *	@brief		Reports the y-position of the origin in world coordinates.
+	 */
+	double getOriginY() const { return _originY; }
+
+	/*!
+	 *	@brief		Converts a world position to the local frame.
+	 *
+	 *	@param		x		The x-position in world coordinates.
+	 *	@param		y		The y-position in world coordinates.
+	 *	@returns	The position in the local frame.
+	 */
+	Vector2 toLocal(double x, double y) const;
+
+	/*!
+	 *	@brief		Converts a local position to world coordinates.
+	 *
+	 *	@param		local		The position in the local frame.
+	 *	@param		x			The x-position in world coordinates.
+	 *	@param		y			The y-position in world coordinates.
+	 */
+	void toWorld(const Vector2 & local, double & x, double & y) const;
+
+	/*!
+	 *	@brief		Reports if a local position is far enough from the origin that the
+	 *				scene should be rebased.
+	 *
+	 *	@param		local		The position in the local frame.
+	 */
+	static bool isDistant(const Vector2 & local);
+
+	/*!
+	 *	@brief		Rounds a world coordinate to the nearest valid origin coordinate.
+	 *
+	 *	@param		value		The world coordinate.
+	 *	@returns	The nearest multiple of ORIGIN_GRANULARITY.
+	 */
+	static double roundOrigin(double value);
+
+	/*!
+	 *	@brief		The distance from the origin, along either axis, beyond which the view
+	 *				triggers a rebase.  Single precision resolves about a millimeter here.
+	 */
+	static const float REBASE_DISTANCE;
+
+	/*!
+	 *	@brief		The spacing of valid origin coordinates.
+	 */
+	static const double ORIGIN_GRANULARITY;
+
+protected:
+	/*!
+	 *	@brief		The x-position of the origin in world coordinates.
+	 */
+	double	_originX;
+
+	/*!
+	 *	@brief		The y-position of the origin in world coordinates.
+	 */
+	double	_originY;
+};
+
+#endif	// __WORLD_FRAME_H__
@@ -1,5 +1,6 @@
 
 #include "glwidget.hpp"
+#include "ContextManager.hpp"
 #include "QtContext.h"
 
 #include <QtWidgets\qdialog.h>
@@ -16,11 +17,16 @@
 #include <math.h>
 #include <gl/GL.h>
 #include "AppLogger.hpp"
-#include "ContextManager.hpp"
 #include "GLCamera.h"
 #include "GLScene.h"
 #include "GLLight.h"
+#include "GeometrySnap.h"
 #include "GridNode.h"
+#include "LiveObstacleSet.h"
+#include "PickBuffer.h"
+#include "ProjectState.h"
+#include "TileLayer.hpp"
+#include "UnderlayNode.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -37,14 +43,16 @@
  */
 class RefGridPropDialog : public QDialog {
 public:
-	RefGridPropDialog(const ReferenceGrid * grid, QWidget * parent=0x0) : QDialog(parent) {
+	RefGridPropDialog(const ReferenceGrid * grid, const WorldFrame & frame, QWidget * parent=0x0) : QDialog(parent) {
 		setModal(false);
 		setWindowTitle(tr("Edit Reference Grid Properties"));
 		QGridLayout * layout = new QGridLayout();
 
-		Menge::Math::Vector2 o = grid->getOrigin();
-		_xO = makeNumEditor(0, "X Origin", layout, new QDoubleValidator(), QString::number(o.x()));
-		_yO = makeNumEditor(1, "Y Origin", layout, new QDoubleValidator(), QString::number(o.y()));
+		// The origin is edited in world coordinates.
+		double x, y;
+		frame.toWorld(grid->getOrigin(), x, y);
+		_xO = makeNumEditor(0, "X Origin", layout, new QDoubleValidator(), QString::number(x, 'g', 10));
+		_yO = makeNumEditor(1, "Y Origin", layout, new QDoubleValidator(), QString::number(y, 'g', 10));
 		Menge::Math::Vector2 size = grid->getSize();
 		_w = makeNumEditor(2, "Width", layout, new QDoubleValidator(), QString::number(size.x()));
 		_h = makeNumEditor(3, "Height", layout, new QDoubleValidator(), QString::number(size.y()));
@@ -111,13 +119,51 @@ protected:
 	QLineEdit * _minorCount;
 };
 
+///////////////////////////////////////////////////////////////////////////
+//				Helper functions
+///////////////////////////////////////////////////////////////////////////
+
+/*!
+ *	@brief		Offers an input event to the contexts on the stack which handle its type,
+ *				in dispatch order, until one of them handles it.
+ *
+ *	@param		type		The event's input type.
+ *	@param		evt			The event.
+ *	@param		view		The view which received the event.
+ *	@param		handler		The context method which handles the event.
+ *	@returns	The combined result: handled if a context handled the event, and needing a
+ *				redraw if any context that was offered the event needs one.
+ */
+template <typename QtEvent>
+Menge::SceneGraph::ContextResult dispatchInput(QtContext::InputType type, QtEvent * evt, GLWidget * view, Menge::SceneGraph::ContextResult (QtContext::*handler)(QtEvent *, GLWidget *)) {
+	Menge::SceneGraph::ContextResult result(false, false);
+	// A handler may push or pop contexts; the list is indexed (rather than iterated) so it
+	//	can change during the dispatch.
+	const std::vector<QtContext *> & handlers = ContextManager::instance()->getHandlers(type);
+	bool redraw = false;
+	for (size_t i = 0; i < handlers.size(); ++i) {
+		// The event is offered accepted; a context which doesn't handle it ignores it.
+		evt->accept();
+		result = (handlers[i]->*handler)(evt, view);
+		redraw = redraw || result.needsRedraw();
+		if (result.isHandled()) break;
+	}
+	result.set(result.isHandled(), redraw);
+	return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //				IMPLEMENTATION FOR GLWidget
 ///////////////////////////////////////////////////////////////////////////
 
+const float GLWidget::GEOMETRY_SNAP_PIXELS = 8.f;
+const float GLWidget::HORIZON_REACH = 8.f;
+
+///////////////////////////////////////////////////////////////////////////
+
 GLWidget::GLWidget(QWidget *parent)
 	: QOpenGLWidget(parent),
-	_scene(0x0), _context(0x0), _cameras(), _currCam(0), _downPos(), _lights(), _drawWorldAxis(true), _activeGrid(true), _hSnap(false), _vSnap(false), _isTopView(true)
+	_scene(0x0), _cameras(), _currCam(0), _downPos(), _lights(), _drawWorldAxis(true), _activeGrid(true), _hSnap(false), _vSnap(false), _geometrySnap(GeometrySnap::NO_SNAP), _snapObstacles(0x0), _tileLayer(0x0), _worldPerPixel(0.f), _worldFrame(), _grid(0x0), _underlay(0x0), _pickBuffer(0x0), _projMatrix(), _viewMatrix(), _invViewProjMatrix(), _cameraDirty(true), _hasCameraMatrices(false), _perspective(true)
 {
 	setFocusPolicy(Qt::StrongFocus);
 	setMouseTracking(true);
@@ -132,22 +178,32 @@ GLWidget::GLWidget(QWidget *parent)
 	_cameras.push_back(camera);
 
 	_scene = new Menge::SceneGraph::GLScene();
-	ContextManager * mgr = ContextManager::instance();
-	connect(mgr, &ContextManager::activated, this, &GLWidget::activated);
-	connect(mgr, &ContextManager::deactivated, this, &GLWidget::deactivated);
+	EventBus::instance()->subscribe(this, CONTEXT_STACK_CHANGED | GEOMETRY_CHANGED | SELECTION_CHANGED | CONTEXT_CHANGED);
+
+	// The underlay is added first so the grid is drawn over it.
+	_underlay = new UnderlayNode();
+	_scene->addNode(_underlay);
+	connect(_underlay, &UnderlayNode::changed, [=]() { update(); });
 
 	_grid = new GridNode();
 	_grid->setSize(100.f, 100.f);
 	_grid->setMajorDist(5.f);
 	_grid->setMinorCount(4);
 	_scene->addNode(_grid);
+
+	_pickBuffer = new PickBuffer();
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 GLWidget::~GLWidget()
 {
+	EventBus * bus = EventBus::instance();
+	bus->unsubscribe(this);
+	bus->withdraw(this);
 	cleanup();
+	delete _pickBuffer;
+	_pickBuffer = 0x0;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -177,12 +233,14 @@ void GLWidget::setScene(Menge::SceneGraph::GLScene * scene) {
 
 void GLWidget::setCameraFOV(int i, float fov) { 
 	_cameras[i].setFOV(fov); 
+	if ((size_t)i == _currCam) cameraChanged();
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void GLWidget::setCameraFarPlane(int i, float dist) {
 	_cameras[i].setFarPlane(dist); 
+	if ((size_t)i == _currCam) cameraChanged();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -191,24 +249,32 @@ void GLWidget::cleanup()
 {
     makeCurrent();
 	// TODO: Notify the scene that the window is being destroyed.
+	if (_pickBuffer) _pickBuffer->destroyGL();
+	if (_underlay) _underlay->destroyGL();
     doneCurrent();
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void GLWidget::activated(size_t id) {
-	ContextManager * mgr = ContextManager::instance();
-	QtContext * ctx = mgr->getContext(id);
-	// TODO: Test that the context in question applies to the viewer.
-	_context = ctx;
-}
-
-///////////////////////////////////////////////////////////////////////////
-
-void GLWidget::deactivated(size_t id) {
-	ContextManager * mgr = ContextManager::instance();
-	QtContext * ctx = mgr->getContext(id);
-	if (_context == ctx) _context = 0x0;
+void GLWidget::handleEvents(const std::vector<Event> & events) {
+	bool redraw = false;
+	for (size_t i = 0; i < events.size(); ++i) {
+		const Event & evt = events[i];
+		switch (evt._type) {
+			case CONTEXT_STACK_CHANGED:
+			case GEOMETRY_CHANGED:
+				invalidatePick();
+				redraw = true;
+				break;
+			case SELECTION_CHANGED:
+			case CONTEXT_CHANGED:
+				redraw = true;
+				break;
+			default:
+				break;
+		}
+	}
+	if (redraw) update();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -250,13 +316,36 @@ void GLWidget::paintGL()
 
 	if (_scene) {
 		_scene->drawGL(_cameras[_currCam], _lights, width(), height());
+		if (_cameraDirty) {
+			// The scene leaves the camera's matrices on the stacks; capture them so the camera
+			//	can be re-applied (e.g., for picking) without recomputing it.
+			GLfloat mat[16];
+			glGetFloatv(GL_PROJECTION_MATRIX, mat);
+			_projMatrix = QMatrix4x4(mat).transposed();
+			glGetFloatv(GL_MODELVIEW_MATRIX, mat);
+			_viewMatrix = QMatrix4x4(mat).transposed();
+			_invViewProjMatrix = (_projMatrix * _viewMatrix).inverted(&_hasCameraMatrices);
+			_cameraDirty = false;
+			_pickBuffer->invalidate();
+			// The grid and the underlay can only adapt to the camera once its matrices are known.
+			const bool gridChanged = updateGridView();
+			if (updateUnderlayView() || gridChanged) {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				_scene->drawGL(_cameras[_currCam], _lights, width(), height());
+			}
+			if (_tileLayer != 0x0) updateTileView();
+		}
+		// The streamed obstacles are drawn under the contexts' obstacles.
+		if (_tileLayer != 0x0) _tileLayer->drawGL(_worldFrame);
 	}
 	// various view decorations
 	// world axis
 	if (_drawWorldAxis) drawWorldAxis();
 
-	if (_context) {
-		_context->drawGL(width(), height());
+	// TODO: Test that the contexts in question apply to the viewer.
+	const std::vector<QtContext *> & contexts = ContextManager::instance()->getDrawOrder();
+	for (size_t i = 0; i < contexts.size(); ++i) {
+		contexts[i]->drawGL(width(), height());
 	}
 
 }
@@ -272,13 +361,11 @@ void GLWidget::resizeGL(int w, int h)
 
 void GLWidget::mousePressEvent(QMouseEvent *event)
 {
-	if (_context) {
-		Menge::SceneGraph::ContextResult result = _context->handleMouse(event, this);
-		if (result.needsRedraw()) {
-			update();
-		}
-		if (result.isHandled()) return;
+	Menge::SceneGraph::ContextResult result = dispatchInput(QtContext::MOUSE_INPUT, event, this, &QtContext::handleMouse);
+	if (result.needsRedraw()) {
+		update();
 	}
+	if (result.isHandled()) return;
 
 	Qt::KeyboardModifiers mods = event->modifiers();
 	bool hasCtrl = (mods & Qt::CTRL) > 0;
@@ -289,7 +376,7 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
 	if (btn == Qt::LeftButton) {
 		_downPos = event->pos();
 		if (!(hasCtrl || hasAlt || hasShift) && _scene != 0x0) {
-			std::cout << "Selection is not implemented yet!\n";
+			emit picked(pick(_downPos));
 		}
 	}
 
@@ -299,13 +386,12 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
 
 void GLWidget::mouseReleaseEvent(QMouseEvent *event)
 {
-	if (_context) {
-		Menge::SceneGraph::ContextResult result = _context->handleMouse(event, this);
-		if (result.needsRedraw()) {
-			update();
-		}
-		if (result.isHandled()) return;
+	Menge::SceneGraph::ContextResult result = dispatchInput(QtContext::MOUSE_INPUT, event, this, &QtContext::handleMouse);
+	if (result.needsRedraw()) {
+		update();
 	}
+	if (event->buttons() == Qt::NoButton) emit viewSettled();
+	if (result.isHandled()) return;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -314,16 +400,16 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
 {
 	Menge::Math::Vector2 worldPos;
 	if (getWorldPos(event->pos(), worldPos)) {
-		emit currWorldPos(worldPos.x(), worldPos.y());
+		double x, y;
+		_worldFrame.toWorld(worldPos, x, y);
+		emit currWorldPos(x, y);
 	}
 
-	if (_context) {
-		Menge::SceneGraph::ContextResult result = _context->handleMouse(event, this);
-		if (result.needsRedraw()) {
-			update();
-		}
-		if (result.isHandled()) return;
+	Menge::SceneGraph::ContextResult result = dispatchInput(QtContext::MOUSE_INPUT, event, this, &QtContext::handleMouse);
+	if (result.needsRedraw()) {
+		update();
 	}
+	if (result.isHandled()) return;
 
 	Qt::KeyboardModifiers mods = event->modifiers();
 	bool hasCtrl = (mods & Qt::CTRL) > 0;
@@ -342,7 +428,6 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
 			_cameras[_currCam].orbitHorizontalAxis(delta.y() * 0.0075f);
 			_cameras[_currCam].orbitVerticalAxis(-delta.x() * 0.0075f);
 			cameraMoved = true;
-			_isTopView = false;
 			emit userRotated();
 		}
 		else if (pan) {
@@ -356,20 +441,21 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
 			cameraMoved = true;
 		}
 		_downPos = event->pos();
-		if (cameraMoved) update();
+		if (cameraMoved) {
+			cameraChanged();
+			update();
+		}
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void GLWidget::wheelEvent(QWheelEvent *event) {
-	if (_context) {
-		Menge::SceneGraph::ContextResult result = _context->handleWheel(event, this);
-		if (result.needsRedraw()) {
-			update();
-		}
-		if (result.isHandled()) return;
+	Menge::SceneGraph::ContextResult result = dispatchInput(QtContext::WHEEL_INPUT, event, this, &QtContext::handleWheel);
+	if (result.needsRedraw()) {
+		update();
 	}
+	if (result.isHandled()) return;
 
 	Qt::KeyboardModifiers mods = event->modifiers();
 	bool hasCtrl = (mods & Qt::CTRL) > 0;
@@ -380,32 +466,30 @@ void GLWidget::wheelEvent(QWheelEvent *event) {
 	if (hasAlt) amount *= 2;
 	if (hasShift) amount *= 2;
 	_cameras[_currCam].zoom(amount);
+	cameraChanged();
 	update();
+	if (event->buttons() == Qt::NoButton) emit viewSettled();
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void GLWidget::keyPressEvent(QKeyEvent *event) {
-	if (_context) {
-		Menge::SceneGraph::ContextResult result = _context->handleKeyboard(event, this);
-		if (result.needsRedraw()) {
-			update();
-		}
-		if (result.isHandled()) return;
+	Menge::SceneGraph::ContextResult result = dispatchInput(QtContext::KEY_INPUT, event, this, &QtContext::handleKeyboard);
+	if (result.needsRedraw()) {
+		update();
 	}
+	if (result.isHandled()) return;
 	QOpenGLWidget::keyPressEvent(event);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void GLWidget::keyReleaseEvent(QKeyEvent *event) {
-	if (_context) {
-		Menge::SceneGraph::ContextResult result = _context->handleKeyboard(event, this);
-		if (result.needsRedraw()) {
-			update();
-		}
-		if (result.isHandled()) return;
+	Menge::SceneGraph::ContextResult result = dispatchInput(QtContext::KEY_INPUT, event, this, &QtContext::handleKeyboard);
+	if (result.needsRedraw()) {
+		update();
 	}
+	if (result.isHandled()) return;
 	QOpenGLWidget::keyReleaseEvent(event);
 }
 
@@ -432,6 +516,7 @@ void GLWidget::newGLContext() {
 	for (size_t i = 0; i < _cameras.size(); ++i) {
 		_cameras[i].setViewport(w, h);
 	}
+	cameraChanged();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -454,6 +539,8 @@ void GLWidget::toggleProjection(bool isPerspective) {
 	else {
 		_cameras[_currCam].setOrtho();
 	}
+	_perspective = isPerspective;
+	cameraChanged();
 	update();
 }
 
@@ -481,15 +568,39 @@ void GLWidget::toggleVerticalSnap(bool isActive) {
 
 ///////////////////////////////////////////////////////////////////////////
 
+void GLWidget::toggleVertexSnap(bool isActive) {
+	if (isActive) _geometrySnap |= GeometrySnap::VERTEX_SNAP;
+	else _geometrySnap &= ~GeometrySnap::VERTEX_SNAP;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::toggleEdgeSnap(bool isActive) {
+	if (isActive) _geometrySnap |= GeometrySnap::EDGE_SNAP;
+	else _geometrySnap &= ~GeometrySnap::EDGE_SNAP;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::toggleIntersectionSnap(bool isActive) {
+	if (isActive) _geometrySnap |= GeometrySnap::INTERSECTION_SNAP;
+	else _geometrySnap &= ~GeometrySnap::INTERSECTION_SNAP;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 void GLWidget::editGridProperties() {
-	RefGridPropDialog dlg(_grid);
+	RefGridPropDialog dlg(_grid, _worldFrame);
 	if (dlg.exec() == QDialog::Accepted) {
-		_grid->setOrigin(dlg._xO->text().toFloat(), dlg._yO->text().toFloat());
+		Menge::Math::Vector2 origin = _worldFrame.toLocal(dlg._xO->text().toDouble(), dlg._yO->text().toDouble());
+		_grid->setOrigin(origin._x, origin._y);
 		_grid->setSize(dlg._w->text().toFloat(), dlg._h->text().toFloat());
 		_grid->setMajorDist(dlg._majorDist->text().toFloat());
 		_grid->setMinorCount(dlg._minorCount->text().toInt());
 		AppLogger::logStream << AppLogger::INFO_MSG << "Modifying reference grid properties:\n";
 		AppLogger::logStream << (*_grid) << "\n" << AppLogger::END_MSG;
+		// The grid and the underlay adapt to the new rectangle when next drawn.
+		_cameraDirty = true;
 		update();
 	}
 
@@ -497,46 +608,47 @@ void GLWidget::editGridProperties() {
 
 ///////////////////////////////////////////////////////////////////////////
 
+bool GLWidget::getWorldRay(const QPoint & screenPos, Menge::Math::Vector3 & origin, Menge::Math::Vector3 & dir) const {
+	if (!_hasCameraMatrices) return false;
+	// Normalized device coordinates of the screen position; screen y points down.
+	float x = 2.f * screenPos.x() / width() - 1.f;
+	float y = 1.f - 2.f * screenPos.y() / height();
+	QVector3D nearPt = _invViewProjMatrix.map(QVector3D(x, y, -1.f));
+	QVector3D farPt = _invViewProjMatrix.map(QVector3D(x, y, 1.f));
+	origin.set(nearPt.x(), nearPt.y(), nearPt.z());
+	dir.set(farPt.x() - nearPt.x(), farPt.y() - nearPt.y(), farPt.z() - nearPt.z());
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 bool GLWidget::getWorldPos(const QPoint & screenPos, Menge::Math::Vector2 & worldPos, bool ignoreSnap) {
 	// TODO: worldPos should be in R3
-	if (_isTopView) {
-		// THIS IS A TOTAL HACK
-		//	There should be a 4-byte enumeration at the beginning of the camera which reports
-		//	if it is perspective or orthographic
-		//  Replace this hack with proper calls into the camera when the interface is extended to
-		//	report projection type.
-		int persp = *(int*)(&_cameras[_currCam]);
-
-		float w = (float)width();
-		float h = (float)height();
-		float u = screenPos.x() / w;
-		float v = (h - screenPos.y()) / h;
-		float wHalfWidth, wHalfHeight;
-		
-		Menge::Math::Vector3 pos = _cameras[_currCam].getPosition();
-		if (persp == 0) {	// orthographic
-			wHalfWidth = 0.5f / _cameras[_currCam].getOrthoScaleFactor() * _cameras[_currCam].targetDistance();
-			wHalfHeight = wHalfWidth * h / w;
-		}
-		else {		// perspective
-			wHalfHeight = pos.z() * tan(_cameras[_currCam].getFOV() * 0.5f / 180.f * 3.141597f);
-			wHalfWidth = wHalfHeight * w / h;
-		}
-		float x = pos.x() - wHalfWidth + (u * wHalfWidth * 2.f);
-		float y = pos.y() - wHalfHeight + (v * wHalfHeight * 2.f);
-		worldPos.set(x, y);
-
-		if (!ignoreSnap ) {
-			worldPos = snap(worldPos);
-		}
-		return true;
-	} 
-	return false;
+	Menge::Math::Vector3 origin, dir;
+	if (!getWorldRay(screenPos, origin, dir)) return false;
+	// Intersect with the z = 0 plane; a ray parallel to the plane, or one which only
+	//	reaches it behind the camera, doesn't hit it.
+	if (fabs(dir.z()) < 1e-6f) return false;
+	float t = -origin.z() / dir.z();
+	if (t < 0.f) return false;
+	worldPos.set(origin.x() + t * dir.x(), origin.y() + t * dir.y());
+
+	if (!ignoreSnap ) {
+		worldPos = snap(worldPos);
+	}
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-Menge::Math::Vector2 GLWidget::snap(const Menge::Math::Vector2 & pos) {
+Menge::Math::Vector2 GLWidget::snap(const Menge::Math::Vector2 & pos, size_t skipId) {
+	if (_geometrySnap != GeometrySnap::NO_SNAP && (_snapObstacles != 0x0 || _tileLayer != 0x0) && _worldPerPixel > 0.f) {
+		GeometrySnap query(pos, GEOMETRY_SNAP_PIXELS * _worldPerPixel, _geometrySnap);
+		if (_snapObstacles != 0x0) _snapObstacles->collectSegments(query, skipId);
+		if (_tileLayer != 0x0) _tileLayer->collectSegments(query, _worldFrame);
+		Menge::Math::Vector2 snapped;
+		if (query.resolve(snapped) != GeometrySnap::NO_SNAP) return snapped;
+	}
 	if ( _activeGrid) {
 		if (_hSnap && _vSnap) {
 			return _grid->snap(pos);
@@ -553,35 +665,269 @@ Menge::Math::Vector2 GLWidget::snap(const Menge::Math::Vector2 & pos) {
 
 ///////////////////////////////////////////////////////////////////////////
 
-float GLWidget::getWorldScale(float len) {
-	float length = len;
-	if (_isTopView) {
-		// THIS IS A TOTAL HACK
-		//	There should be a 4-byte enumeration at the beginning of the camera which reports
-		//	if it is perspective or orthographic
-		//  Replace this hack with proper calls into the camera when the interface is extended to
-		//	report projection type.
-		int persp = *(int*)(&_cameras[_currCam]);
-
-		float scale = 1.f;
-		if (persp == 0) {	// orthographic
-			float wWidth = _cameras[_currCam].targetDistance() / _cameras[_currCam].getOrthoScaleFactor();
-			scale = wWidth / width();
+const ReferenceGrid * GLWidget::getReferenceGrid() const {
+	return _activeGrid ? _grid : 0x0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool GLWidget::updateGridView() {
+	_worldPerPixel = getWorldScale(1.f);
+	// If the horizon is in view, the whole grid may be visible.
+	Menge::Math::Vector2 minPt, maxPt;
+	if (!getVisibleRegion(minPt, maxPt)) {
+		minPt = _grid->getOrigin();
+		maxPt = minPt + _grid->getSize();
+	}
+	return _grid->setView(_worldPerPixel, minPt, maxPt);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::updateTileView() {
+	Menge::Math::Vector2 minPt, maxPt;
+	if (!getVisibleRegion(minPt, maxPt)) {
+		// Whatever is much farther away than the target is too small to matter.
+		const Menge::SceneGraph::GLCamera & cam = _cameras[_currCam];
+		const Menge::Math::Vector3 offset = cam.getPosition() - cam.getTarget();
+		const float reach = HORIZON_REACH * sqrtf(offset._x * offset._x + offset._y * offset._y + offset._z * offset._z);
+		const Menge::Math::Vector2 target = getViewTarget();
+		minPt.set(target._x - reach, target._y - reach);
+		maxPt.set(target._x + reach, target._y + reach);
+	}
+	double minX, minY, maxX, maxY;
+	_worldFrame.toWorld(minPt, minX, minY);
+	_worldFrame.toWorld(maxPt, maxX, maxY);
+	_tileLayer->setView(minX, minY, maxX, maxY, _worldPerPixel);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool GLWidget::updateUnderlayView() {
+	if (!_underlay->isOpen()) return false;
+	const Menge::Math::Vector2 origin = _grid->getOrigin();
+	const bool moved = _underlay->setBounds(origin, origin + _grid->getSize());
+	Menge::Math::Vector2 minPt, maxPt;
+	if (!getVisibleRegion(minPt, maxPt)) {
+		minPt = origin;
+		maxPt = origin + _grid->getSize();
+	}
+	return _underlay->setView(_worldPerPixel, minPt, maxPt) || moved;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::openUnderlay(const QString & path) {
+	_underlay->open(path);
+	// The tiles are chosen when the view is next drawn.
+	_cameraDirty = true;
+	update();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::closeUnderlay() {
+	_underlay->close();
+	update();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool GLWidget::getVisibleRegion(Menge::Math::Vector2 & minPt, Menge::Math::Vector2 & maxPt) {
+	// The visible region is bounded by the ground points under the view's corners.
+	const QPoint corners[4] = { QPoint(0, 0), QPoint(width(), 0), QPoint(0, height()), QPoint(width(), height()) };
+	for (int i = 0; i < 4; ++i) {
+		Menge::Math::Vector2 p;
+		if (!getWorldPos(corners[i], p, true)) return false;
+		if (i == 0) {
+			minPt = maxPt = p;
+		}
+		else {
+			if (p._x < minPt._x) minPt._x = p._x;
+			if (p._y < minPt._y) minPt._y = p._y;
+			if (p._x > maxPt._x) maxPt._x = p._x;
+			if (p._y > maxPt._y) maxPt._y = p._y;
 		}
-		else {		// perspective
-			Menge::Math::Vector3 pos = _cameras[_currCam].getPosition();
-			float wHeight = 2.f * pos.z() * tan(_cameras[_currCam].getFOV() * 0.5f / 180.f * 3.141597f);
-			scale = wHeight / height();
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+float GLWidget::getWorldScale(float len) {
+	return getWorldScale(len, QPoint(width() / 2, height() / 2));
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+float GLWidget::getWorldScale(float len, const QPoint & screenPos) {
+	// Measure a one pixel step on the ground plane in each screen direction and use the
+	//	larger, so screen space tolerances never shrink in foreshortened views.
+	Menge::Math::Vector2 p0, px, py;
+	if (getWorldPos(screenPos, p0, true) &&
+		getWorldPos(screenPos + QPoint(1, 0), px, true) &&
+		getWorldPos(screenPos + QPoint(0, 1), py, true)) {
+		float sx = abs(px - p0);
+		float sy = abs(py - p0);
+		return len * (sx > sy ? sx : sy);
+	}
+	return len;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+unsigned int GLWidget::pick(const QPoint & screenPos, int radius) {
+	const std::vector<QtContext *> & contexts = ContextManager::instance()->getHandlers(QtContext::MOUSE_INPUT);
+	if (contexts.empty() || !_hasCameraMatrices) return PickBuffer::NO_ID;
+	if (!_pickBuffer->isValid()) {
+		makeCurrent();
+		if (_pickBuffer->beginDraw(width(), height())) {
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadMatrixf(_projMatrix.constData());
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadMatrixf(_viewMatrix.constData());
+
+			// The contexts which receive the mouse first are drawn last (on top).
+			for (size_t i = contexts.size(); i > 0; --i) {
+				contexts[i - 1]->drawSelectGL();
+			}
+
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+			_pickBuffer->endDraw();
 		}
-		length *= scale;
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+		doneCurrent();
 	}
-	return length;
+	return _pickBuffer->getNearestId(screenPos.x(), screenPos.y(), radius);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::invalidatePick() {
+	_pickBuffer->invalidate();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::getViewSettings(ProjectSettings & settings) const {
+	const Menge::SceneGraph::GLCamera & cam = _cameras[_currCam];
+	settings._cameraPosition = cam.getPosition();
+	settings._cameraTarget = cam.getTarget();
+	settings._cameraPerspective = _perspective;
+	settings._originX = _worldFrame.getOriginX();
+	settings._originY = _worldFrame.getOriginY();
+
+	Menge::Math::Vector2 origin = _grid->getOrigin();
+	Menge::Math::Vector2 size = _grid->getSize();
+	settings._gridOriginX = origin._x;
+	settings._gridOriginY = origin._y;
+	settings._gridWidth = size._x;
+	settings._gridHeight = size._y;
+	settings._gridMajorDist = _grid->getMajorDist();
+	settings._gridMinorCount = _grid->getMinorCount();
+	settings._gridActive = _activeGrid;
+	settings._gridHSnap = _hSnap;
+	settings._gridVSnap = _vSnap;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::setViewSettings(const ProjectSettings & settings) {
+	// The settings are expressed in their own frame; nothing is shifted.
+	_worldFrame.setOrigin(settings._originX, settings._originY);
+	Menge::SceneGraph::GLCamera & cam = _cameras[_currCam];
+	const Menge::Math::Vector3 & pos = settings._cameraPosition;
+	const Menge::Math::Vector3 & target = settings._cameraTarget;
+	cam.setPosition(pos._x, pos._y, pos._z);
+	cam.setTarget(target._x, target._y, target._z);
+	if (settings._cameraPerspective) {
+		cam.setPersp();
+	}
+	else {
+		cam.setOrtho();
+	}
+	_perspective = settings._cameraPerspective;
+	cameraChanged();
+
+	_grid->setOrigin(settings._gridOriginX, settings._gridOriginY);
+	_grid->setSize(settings._gridWidth, settings._gridHeight);
+	_grid->setMajorDist(settings._gridMajorDist);
+	_grid->setMinorCount(settings._gridMinorCount);
+	toggleReferenceGrid(settings._gridActive);
+	_hSnap = settings._gridHSnap;
+	_vSnap = settings._gridVSnap;
+	update();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::frameBounds(const Menge::Math::Vector2 & minPt, const Menge::Math::Vector2 & maxPt) {
+	// The region is padded, and a degenerate region is framed as a small square.
+	const float MARGIN = 1.25f;
+	const float MIN_SIZE = 1.f;
+	const float w = maxPt._x - minPt._x > MIN_SIZE ? maxPt._x - minPt._x : MIN_SIZE;
+	const float h = maxPt._y - minPt._y > MIN_SIZE ? maxPt._y - minPt._y : MIN_SIZE;
+	Menge::SceneGraph::GLCamera & cam = _cameras[_currCam];
+	const Menge::Math::Vector3 target = cam.getTarget();
+	Menge::Math::Vector3 offset = cam.getPosition() - target;
+	// The extent of a pixel at the target grows with the camera's distance; the distance is
+	//	scaled to make the region span the view.
+	const float pixel = getWorldScale(1.f);
+	const float desired = MARGIN * (w / width() > h / height() ? w / width() : h / height());
+	if (pixel > 0.f) {
+		offset *= desired / pixel;
+	}
+	const float cx = 0.5f * (minPt._x + maxPt._x);
+	const float cy = 0.5f * (minPt._y + maxPt._y);
+	cam.setTarget(cx, cy, 0.f);
+	cam.setPosition(cx + offset._x, cy + offset._y, offset._z);
+	cameraChanged();
+	update();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+Menge::Math::Vector2 GLWidget::getViewTarget() const {
+	const Menge::Math::Vector3 & target = _cameras[_currCam].getTarget();
+	return Menge::Math::Vector2(target._x, target._y);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::setWorldOrigin(double x, double y) {
+	// The shift is computed in double precision; the shifted values are small again.
+	const double dx = _worldFrame.getOriginX() - x;
+	const double dy = _worldFrame.getOriginY() - y;
+	for (size_t i = 0; i < _cameras.size(); ++i) {
+		Menge::SceneGraph::GLCamera & cam = _cameras[i];
+		const Menge::Math::Vector3 pos = cam.getPosition();
+		const Menge::Math::Vector3 target = cam.getTarget();
+		cam.setPosition(static_cast<float>(pos._x + dx), static_cast<float>(pos._y + dy), pos._z);
+		cam.setTarget(static_cast<float>(target._x + dx), static_cast<float>(target._y + dy), target._z);
+	}
+	const Menge::Math::Vector2 origin = _grid->getOrigin();
+	_grid->setOrigin(static_cast<float>(origin._x + dx), static_cast<float>(origin._y + dy));
+	_worldFrame.setOrigin(x, y);
+	cameraChanged();
+	update();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GLWidget::cameraChanged() {
+	_cameraDirty = true;
+	_pickBuffer->invalidate();
+	EventBus::instance()->post(Event(CAMERA_MOVED, this));
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void GLWidget::setViewDirection(int direction){
-	_isTopView = false;
 	if (direction > 0) {
 		switch (direction) {
 		case 1:	// +x
@@ -601,9 +947,9 @@ void GLWidget::setViewDirection(int direction){
 			break;
 		case 6: // -z
 			_cameras[_currCam].viewZAxis(false);
-			_isTopView = true;
 			break;
 		}
+		cameraChanged();
 		update();
 	}
 }
@@ -1,6 +1,9 @@
 #ifndef GLWIDGET_H
 #define GLWIDGET_H
 
+#include "EventBus.hpp"
+#include "WorldFrame.h"
+
 #include <QtWidgets/QOpenGLWidget>
 #include <QtGui/QOpenGLFunctions>
 #include <QtGui/QOpenGLVertexArrayObject>
@@ -8,6 +11,7 @@
 #include <QtGui/QMatrix4x4>
 
 #include <Math/Vector2.h>
+#include <Math/Vector3.h>
 
 #include <memory>
 
@@ -23,12 +27,18 @@ namespace Menge {
 
 class SceneViewer;
 class GridNode;
+class LiveObstacleSet;
+class PickBuffer;
 class QtContext;
+class ReferenceGrid;
+class TileLayer;
+class UnderlayNode;
+struct ProjectSettings;
 
 /*!
  *	@brief		The view that contains the open gl context.
  */
-class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions, public EventSubscriber
 {
     Q_OBJECT
 
@@ -86,27 +96,31 @@ public:
 	 */
 	void setCameraFarPlane(int i, float dist);
 
-	friend class SceneViewer;
-
-public slots:
 	/*!
-	 *	@brief		Cleans up the OpenGL state when the OpenGL context is lost.
+	 *	@brief		Returns the frame which relates the scene's coordinates to world
+	 *				coordinates.
 	 */
-    void cleanup();
+	const WorldFrame & getWorldFrame() const { return _worldFrame; }
+
+	friend class SceneViewer;
+
+	///////////////////////////////////////////////////////////////////////////////////
+	//			EventSubscriber interface
+	///////////////////////////////////////////////////////////////////////////////////
 
 	/*!
-	 *	@brief		Reports to the viewer that a new context has been activated.
+	 *	@brief		Redraws the view when the context stack, the geometry or a selection
+	 *				has changed.
 	 *
-	 *	@param		id		The identifier for the context.
+	 *	@param		events		The context stack, geometry and selection events.
 	 */
-	void activated(size_t id);
+	virtual void handleEvents(const std::vector<Event> & events);
 
+public slots:
 	/*!
-	*	@brief		Reports to the viewer that a context has been deactivated.
-	*
-	*	@param		id		The identifier for the context.
-	*/
-	void deactivated(size_t id);
+	 *	@brief		Cleans up the OpenGL state when the OpenGL context is lost.
+	 */
+    void cleanup();
 
 signals:
 	/*!
@@ -117,12 +131,27 @@ signals:
 	/*!
 	 *	@brief		Reports the "current" world position of the point under the mouse.
 	 *
-	 *	The world position lies on the simulation's x-y plane. 
+	 *	The world position lies on the simulation's x-y plane.  It is reported in world
+	 *	coordinates, i.e., with the origin of the scene's frame added (see WorldFrame).
 	 *	
 	 *	@param		x		The x-value of the position.
 	 *	@param		y		The y-value of the position.
 	 */
-	void currWorldPos(float x, float y);
+	void currWorldPos(double x, double y);
+
+	/*!
+	 *	@brief		Indicates that the user has finished moving the camera (a mouse button was
+	 *				released or the wheel turned with no button held).
+	 */
+	void viewSettled();
+
+	/*!
+	 *	@brief		Reports the element picked by a mouse click which was not otherwise
+	 *				handled.
+	 *
+	 *	@param		pickId		The pick identifier of the element (see PickBuffer).
+	 */
+	void picked(unsigned int pickId);
 
 protected:
 	/*!
@@ -229,41 +258,230 @@ protected:
 	 */
 	void toggleVerticalSnap(bool isActive);
 
+	/*!
+	 *	@brief		Toggles whether selection points are snapped to nearby obstacle vertices.
+	 *
+	 *	@param		isActive		True enables snapping, false disabled.
+	 */
+	void toggleVertexSnap(bool isActive);
+
+	/*!
+	 *	@brief		Toggles whether selection points are snapped to nearby obstacle edges.
+	 *
+	 *	@param		isActive		True enables snapping, false disabled.
+	 */
+	void toggleEdgeSnap(bool isActive);
+
+	/*!
+	 *	@brief		Toggles whether selection points are snapped to nearby crossings of
+	 *				obstacle edges.
+	 *
+	 *	@param		isActive		True enables snapping, false disabled.
+	 */
+	void toggleIntersectionSnap(bool isActive);
+
+	/*!
+	 *	@brief		Sets the obstacles selection points can snap to.
+	 *
+	 *	@param		obstacles		The obstacles (null disables snapping to geometry).
+	 */
+	void setSnapObstacles(const LiveObstacleSet * obstacles) { _snapObstacles = obstacles; }
+
+	/*!
+	 *	@brief		Sets the layer of streamed obstacles drawn under the scene's obstacles.  Its
+	 *				tiles are chosen by the view and selection points snap to them.
+	 *
+	 *	@param		layer		The layer; the view does *not* own it.  Null removes it.
+	 */
+	void setTileLayer(TileLayer * layer) { _tileLayer = layer; }
+
+	/*!
+	 *	@brief		Opens an image (e.g., a floor plan) and draws it under the scene, stretched
+	 *				over the reference grid (see UnderlayNode).
+	 *
+	 *	@param		path		The path to the image.
+	 *	@throws		MCException if the image can't be read.
+	 */
+	void openUnderlay(const QString & path);
+
+	/*!
+	 *	@brief		Stops drawing the underlay image.
+	 */
+	void closeUnderlay();
+
+	/*!
+	 *	@brief		Returns the underlay image's node.
+	 */
+	const UnderlayNode * getUnderlay() const { return _underlay; }
+
 public:
 
+	/*!
+	 *	@brief		Computes the ray in world space which passes through the given
+	 *				screen position.
+	 *
+	 *	The ray is computed from the cached inverse view-projection matrix of the current
+	 *	camera, so it is correct for any camera orientation and projection.
+	 *
+	 *	@param		screenPos		The position of the mouse in screen space.
+	 *	@param		origin			The origin of the ray (on the camera's near plane).
+	 *	@param		dir				The direction of the ray (not normalized); the ray reaches
+	 *								the camera's far plane at origin + dir.
+	 *	@returns	True if the ray could be computed, false otherwise (e.g., the scene has
+	 *				not yet been drawn).
+	 */
+	bool getWorldRay(const QPoint & screenPos, Menge::Math::Vector3 & origin, Menge::Math::Vector3 & dir) const;
+
 	/*!
 	 *	@brief		Returns the position under the mouse on the ground plane in
 	 *				world space.  
 	 *
+	 *	The position is the intersection of the ray under the mouse with the world's x-y
+	 *	plane.  It is in the scene's local frame; getWorldFrame() converts it to world
+	 *	coordinates without loss of precision.
+	 *
 	 *	@param		screenPos		The position of the mouse in screen space.
 	 *	@param		worldPos		The point on the world x-y plane under the mouse.
 	 *	@param		ignoreSnap		If set to true, the world position will ignore the
-	 *								snap-to-grid settings.
+	 *								snap settings.
 	 *	@returns	True if worldPos has been set (i.e., the value can be computed, false
-	 *				otherwise.)
+	 *				otherwise -- e.g., the ray under the mouse doesn't hit the ground plane.)
 	 */
 	bool getWorldPos(const QPoint & screenPos, Menge::Math::Vector2 & worldPos, bool ignoreSnap = false);
 
 	/*!
-	 *	@brief		Snaps the given world position to the grid (according to settings).
-	 *				
-	 *	If the settings have all snap settings turned off, the returned values will be
-	 *	equal to the input.
+	 *	@brief		Snaps the given world position to the obstacles or the grid (according to
+	 *				settings).
+	 *
+	 *	Obstacle features within GEOMETRY_SNAP_PIXELS of the position take precedence over
+	 *	the grid (see GeometrySnap).  The grid's lines are those of its active level.  If the
+	 *	settings have all snap settings turned off, the returned values will be equal to the
+	 *	input.
 	 *
-	 *	@param		pos		The position to snap (conditionally).
+	 *	@param		pos			The position to snap (conditionally).
+	 *	@param		skipId		The identifier of an obstacle whose features are ignored
+	 *							(e.g., the one being edited; zero for none).
 	 *	@returns	The snapped position.
 	 */
-	Menge::Math::Vector2 snap(const Menge::Math::Vector2 & pos);
+	Menge::Math::Vector2 snap(const Menge::Math::Vector2 & pos, size_t skipId = 0);
+
+	/*!
+	 *	@brief		Reports the reference grid -- if it is active.
+	 *
+	 *	@returns	A pointer to the reference grid.  Null if the grid is not active.
+	 */
+	const ReferenceGrid * getReferenceGrid() const;
 
 	/*!
 	 *	@brief		Given a length in screen space, returns the world space
 	 *				length based on current view parameters on the ground plane.
 	 *
+	 *	The length is measured at the center of the view.  For views which are not looking
+	 *	straight down, the scale varies across the ground plane; use the overload which
+	 *	takes a screen position.
+	 *
 	 *	@param		len		The length to scale.
 	 *	@returns	The len scaled to world space.
 	 */
 	float getWorldScale(float len);
 
+	/*!
+	 *	@brief		Given a length in screen space, returns the world space
+	 *				length on the ground plane at the given screen position.
+	 *
+	 *	@param		len				The length to scale.
+	 *	@param		screenPos		The screen position at which the length is measured.
+	 *	@returns	The len scaled to world space.  If the ground plane isn't visible at
+	 *				the screen position, the length is returned unchanged.
+	 */
+	float getWorldScale(float len, const QPoint & screenPos);
+
+	/*!
+	 *	@brief		Reports the identifier of the active context's element drawn nearest
+	 *				the given screen position.
+	 *
+	 *	The context's selectable elements are drawn into the pick buffer only if the camera
+	 *	or the geometry has changed since the last pick; otherwise this is a look up.  This
+	 *	works for any camera orientation and projection.
+	 *
+	 *	@param		screenPos		The position of the mouse in screen space.
+	 *	@param		radius			The distance (in pixels) from the position within
+	 *								which an element will be reported.
+	 *	@returns	The pick identifier of the nearest element (see PickBuffer).  If there is
+	 *				none, PickBuffer::NO_ID.
+	 */
+	unsigned int pick(const QPoint & screenPos, int radius = 0);
+
+	/*!
+	 *	@brief		Informs the view that the selectable elements have changed (e.g., the
+	 *				geometry has been edited) and the pick buffer must be redrawn.
+	 */
+	void invalidatePick();
+
+	/*!
+	 *	@brief		Writes the state of the current camera and the reference grid into the
+	 *				project settings.
+	 *
+	 *	@param		settings		The settings to write to.
+	 */
+	void getViewSettings(ProjectSettings & settings) const;
+
+	/*!
+	 *	@brief		Restores the state of the current camera and the reference grid from the
+	 *				project settings.
+	 *
+	 *	@param		settings		The settings to read from.
+	 */
+	void setViewSettings(const ProjectSettings & settings);
+
+	/*!
+	 *	@brief		Moves the current camera so that a region of the ground plane fills the
+	 *				view.  The camera keeps its view direction; it is moved toward or away
+	 *				from the region's center.
+	 *
+	 *	@param		minPt		The minimum corner of the region.
+	 *	@param		maxPt		The maximum corner of the region.
+	 */
+	void frameBounds(const Menge::Math::Vector2 & minPt, const Menge::Math::Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Computes the region of the ground plane in view.
+	 *
+	 *	@param		minPt		The minimum corner of the region.
+	 *	@param		maxPt		The maximum corner of the region.
+	 *	@returns	True if the region was computed, false if the horizon is in view (or the
+	 *				camera has not yet been drawn).
+	 */
+	bool getVisibleRegion(Menge::Math::Vector2 & minPt, Menge::Math::Vector2 & maxPt);
+
+	/*!
+	 *	@brief		Reports the point the current camera looks at, projected on the ground
+	 *				plane.
+	 */
+	Menge::Math::Vector2 getViewTarget() const;
+
+	/*!
+	 *	@brief		Moves the origin of the scene's frame, shifting the cameras and the
+	 *				reference grid so they stay at the same world positions.
+	 *
+	 *	The scene's contents must be shifted by the caller (see SceneViewer::setWorldOrigin()).
+	 *
+	 *	@param		x		The x-position of the new origin in world coordinates.
+	 *	@param		y		The y-position of the new origin in world coordinates.
+	 */
+	void setWorldOrigin(double x, double y);
+
+	/*!
+	 *	@brief		The distance (in pixels) within which positions snap to obstacle features.
+	 */
+	static const float GEOMETRY_SNAP_PIXELS;
+
+	/*!
+	 *	@brief		When the horizon is in view, the tiles within this multiple of the camera's
+	 *				distance from its target are in view.
+	 */
+	static const float HORIZON_REACH;
+
 public slots:
 
 	/*!
@@ -284,11 +502,6 @@ protected:
 	 */
 	Menge::SceneGraph::GLScene *	_scene;
 
-	/*!
-	 *	@brief		The active context on the scene.  The view does *not* own the context.
-	 */
-	QtContext * _context;
-
 	/*!
 	 *	@brief		A set of cameras from which to draw the scene.
 	 */
@@ -332,9 +545,31 @@ protected:
 	bool	_vSnap;
 
 	/*!
-	 *	@brief		Reports if the camera is in a top-view configuration.
+	 *	@brief		The obstacle features the selection point snaps to (a combination of
+	 *				GeometrySnap::Feature flags).
+	 */
+	int	_geometrySnap;
+
+	/*!
+	 *	@brief		The obstacles the selection point can snap to.
+	 */
+	const LiveObstacleSet * _snapObstacles;
+
+	/*!
+	 *	@brief		The layer of streamed obstacles (may be null).
+	 */
+	TileLayer * _tileLayer;
+
+	/*!
+	 *	@brief		The size of a pixel on the ground plane at the center of the view, measured
+	 *				when the camera was last drawn.
 	 */
-	bool	_isTopView;
+	float	_worldPerPixel;
+
+	/*!
+	 *	@brief		The frame which relates the scene's coordinates to world coordinates.
+	 */
+	WorldFrame	_worldFrame;
 
 	/*!
 	 *	@brief		The reference grid for the scene.  The viewer does *not* own this pointer.
@@ -343,6 +578,78 @@ protected:
 	 */
 	GridNode * _grid;
 
+	/*!
+	 *	@brief		The image drawn under the scene, over the reference grid.  Like the grid,
+	 *				it is added to the scene and managed by the scene.
+	 */
+	UnderlayNode * _underlay;
+
+	/*!
+	 *	@brief		The buffer of element identifiers used for picking.
+	 */
+	PickBuffer * _pickBuffer;
+
+	/*!
+	 *	@brief		The projection matrix of the current camera, captured when the camera
+	 *				was last drawn.
+	 */
+	QMatrix4x4	_projMatrix;
+
+	/*!
+	 *	@brief		The view (modelview) matrix of the current camera, captured when the
+	 *				camera was last drawn.
+	 */
+	QMatrix4x4	_viewMatrix;
+
+	/*!
+	 *	@brief		The inverse of the current camera's combined view-projection matrix.
+	 *				It maps normalized device coordinates back into world space.
+	 */
+	QMatrix4x4	_invViewProjMatrix;
+
+	/*!
+	 *	@brief		Reports if the camera has changed since its matrices were captured.
+	 */
+	bool	_cameraDirty;
+
+	/*!
+	 *	@brief		Reports if the camera matrices have ever been captured (and are
+	 *				invertible).
+	 */
+	bool	_hasCameraMatrices;
+
+	/*!
+	 *	@brief		Reports if the current camera uses a perspective projection.
+	 */
+	bool	_perspective;
+
+	/*!
+	 *	@brief		Records that the current camera has changed in some way (and posts
+	 *				CAMERA_MOVED).
+	 */
+	void cameraChanged();
+
+	/*!
+	 *	@brief		Adapts the reference grid to the current camera (see GridNode::setView()).
+	 *
+	 *	@returns	True if the grid has to be drawn again.
+	 */
+	bool updateGridView();
+
+	/*!
+	 *	@brief		Reports the current camera's view to the tile layer (see
+	 *				TileLayer::setView()).
+	 */
+	void updateTileView();
+
+	/*!
+	 *	@brief		Reports the reference grid's rectangle and the current camera's view to
+	 *				the underlay image (see UnderlayNode::setView()).
+	 *
+	 *	@returns	True if the underlay has to be drawn again.
+	 */
+	bool updateUnderlayView();
+
 	/*!
 	 *	@brief		Initizlies the OpenGL lighting based on the set of lights.
 	 */
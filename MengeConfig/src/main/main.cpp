@@ -4,9 +4,28 @@
 #include <QtGui/QSurfaceFormat>
 
 #include "mainwindow.hpp"
+#include "MapBenchmark.h"
+#include "SceneValidator.h"
+#include "SelfCheck.h"
+
+#include <iostream>
 
 int main(int argc, char *argv[])
 {
+	// Pre-flight validation (e.g., in a pipeline) runs without any GUI.
+	if (argc > 1 && QString(argv[1]) == "--validate") {
+		QCoreApplication app(argc, argv);
+		return SceneValidator::runCommandLine(app.arguments().mid(1), std::cout);
+	}
+	if (argc > 1 && QString(argv[1]) == "--self-check") {
+		QCoreApplication app(argc, argv);
+		return SelfCheck::runCommandLine(app.arguments().mid(1), std::cout);
+	}
+	if (argc > 1 && QString(argv[1]) == "--benchmark-import") {
+		QCoreApplication app(argc, argv);
+		return MapBenchmark::runCommandLine(app.arguments().mid(1), std::cout);
+	}
+
     QApplication app(argc, argv);
 
     QSurfaceFormat fmt;
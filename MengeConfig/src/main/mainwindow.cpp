@@ -1,13 +1,15 @@
 #include "mainwindow.hpp"
 
 #include "AppLogger.hpp"
-#include "ContextManager.hpp"
 #include "FSMViewer.hpp"
+#include "ProjectManager.hpp"
 #include "SceneHierarchy.hpp"
 #include "SceneViewer.hpp"
 #include "SceneHierarchy.hpp"
+#include "SceneValidator.h"
 #include "ToolProperties.hpp"
 
+#include <QtGui/QCloseEvent>
 #include <QtWidgets\qboxlayout.h>
 #include <QtWidgets/qdockwidget.h>
 #include <QtWidgets/QMenuBar>
@@ -38,12 +40,14 @@ MainWindow::MainWindow()
 
 	vSplitter->addWidget(splitter);
 	setCentralWidget(vSplitter);
-	
-	buildMenu();
 
 	// Docked elements
 	_hierarchyDock = new QDockWidget(tr("Scene Hierarchy"), this);
 	_hierarchy = new SceneHierarchy();
+	_hierarchy->setObstacleSet(_sceneViewer->getObstacleSet());
+	connect(_hierarchy, &SceneHierarchy::frameRequested, _sceneViewer, &SceneViewer::frameBounds);
+	connect(_hierarchy, &SceneHierarchy::stateRequested, _fsmViewer, &FSMViewer::showState);
+	connect(_fsmViewer, &FSMViewer::behaviorChanged, this, [=]() { _hierarchy->setBehavior(_fsmViewer->getBehavior()); });
 	_hierarchyDock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
 	_hierarchyDock->setWidget(_hierarchy);
 	addDockWidget(Qt::RightDockWidgetArea, _hierarchyDock);
@@ -55,16 +59,31 @@ MainWindow::MainWindow()
 	_toolPropDock->setWidget(_toolProperties);
 	addDockWidget(Qt::LeftDockWidgetArea, _toolPropDock);
 	connect(_toolPropDock, &QDockWidget::visibilityChanged, this, &MainWindow::toggleToolProperties);
-
-	ContextManager * mgr = ContextManager::instance();
-	connect(mgr, &ContextManager::activated, _toolProperties, &ToolPropertyWidget::activated);
-	connect(mgr, &ContextManager::deactivated, _toolProperties, &ToolPropertyWidget::deactivated);
 	
 	// Set up the logger
 	_logger = new AppLogger(this);
 	_logger->setVisible(false);
 	vSplitter->addWidget(_logger);
+	connect(_logger, &AppLogger::frameRequested, _sceneViewer, &SceneViewer::frameBounds);
+	connect(_logger, &AppLogger::stateRequested, _fsmViewer, &FSMViewer::showState);
+
+	// The project manager reports to the logger.
+	_project = new ProjectManager(_sceneViewer, this);
 
+	buildMenu();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::closeEvent(QCloseEvent * event) {
+	// Writes whatever changed since the last autosave; an unnamed project is offered to be
+	//	saved before its recovery file is removed.
+	if (_project->confirmClose()) {
+		event->accept();
+	}
+	else {
+		event->ignore();
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -72,6 +91,33 @@ MainWindow::MainWindow()
 void MainWindow::buildMenu() {
 	QMenuBar *menuBar = new QMenuBar;
 
+	// File menu
+	QMenu * menuFile = menuBar->addMenu(tr("&File"));
+
+	QAction * newAct = new QAction(menuFile);
+	newAct->setText(tr("&New Project"));
+	newAct->setShortcut(QKeySequence::New);
+	menuFile->addAction(newAct);
+	connect(newAct, &QAction::triggered, _project, &ProjectManager::newProject);
+
+	QAction * openAct = new QAction(menuFile);
+	openAct->setText(tr("&Open Project..."));
+	openAct->setShortcut(QKeySequence::Open);
+	menuFile->addAction(openAct);
+	connect(openAct, &QAction::triggered, _project, static_cast<void (ProjectManager::*)()>(&ProjectManager::openProject));
+
+	QAction * saveAct = new QAction(menuFile);
+	saveAct->setText(tr("&Save Project"));
+	saveAct->setShortcut(QKeySequence::Save);
+	menuFile->addAction(saveAct);
+	connect(saveAct, &QAction::triggered, _project, &ProjectManager::saveProject);
+
+	QAction * saveAsAct = new QAction(menuFile);
+	saveAsAct->setText(tr("Save Project &As..."));
+	saveAsAct->setShortcut(QKeySequence::SaveAs);
+	menuFile->addAction(saveAsAct);
+	connect(saveAsAct, &QAction::triggered, _project, &ProjectManager::saveProjectAs);
+
 	// Obstacles menu
 	QMenu * menuObst = menuBar->addMenu(tr("&Obstacles"));
 
@@ -80,6 +126,64 @@ void MainWindow::buildMenu() {
 	menuObst->addAction(_drawObstacleAct);
 	connect(_drawObstacleAct, &QAction::triggered, _sceneViewer, &SceneViewer::drawObstacle);
 
+	QAction * simplifyAct = new QAction(menuObst);
+	simplifyAct->setText(tr("&Simplify Obstacles..."));
+	menuObst->addAction(simplifyAct);
+	connect(simplifyAct, &QAction::triggered, _sceneViewer, &SceneViewer::simplifyObstacles);
+
+	menuObst->addSeparator();
+	QAction * importMapAct = new QAction(menuObst);
+	importMapAct->setText(tr("&Import Map..."));
+	menuObst->addAction(importMapAct);
+	connect(importMapAct, &QAction::triggered, _sceneViewer, &SceneViewer::importMap);
+
+	QAction * openTilesAct = new QAction(menuObst);
+	openTilesAct->setText(tr("Open &Tiled Map..."));
+	menuObst->addAction(openTilesAct);
+	connect(openTilesAct, &QAction::triggered, _sceneViewer, &SceneViewer::openTiledMap);
+
+	QAction * exportTilesAct = new QAction(menuObst);
+	exportTilesAct->setText(tr("&Export Tiled Map..."));
+	menuObst->addAction(exportTilesAct);
+	connect(exportTilesAct, &QAction::triggered, _sceneViewer, &SceneViewer::exportTiledMap);
+
+	QAction * closeTilesAct = new QAction(menuObst);
+	closeTilesAct->setText(tr("&Close Tiled Map"));
+	menuObst->addAction(closeTilesAct);
+	connect(closeTilesAct, &QAction::triggered, _sceneViewer, &SceneViewer::closeTiledMap);
+
+	// Agents menu
+	QMenu * menuAgents = menuBar->addMenu(tr("&Agents"));
+
+	_placeAgentsAct = new QAction(menuAgents);
+	_placeAgentsAct->setText(tr("&Place Agents"));
+	menuAgents->addAction(_placeAgentsAct);
+	connect(_placeAgentsAct, &QAction::triggered, _sceneViewer, &SceneViewer::placeAgents);
+
+	// Scene menu
+	QMenu * menuScene = menuBar->addMenu(tr("&Scene"));
+
+	_validateAct = new QAction(menuScene);
+	_validateAct->setText(tr("&Validate Scene"));
+	_validateAct->setShortcut(Qt::Key_F7);
+	menuScene->addAction(_validateAct);
+	connect(_validateAct, &QAction::triggered, this, &MainWindow::validateScene);
+
+	QAction * centerOriginAct = new QAction(menuScene);
+	centerOriginAct->setText(tr("Center &Origin on View"));
+	menuScene->addAction(centerOriginAct);
+	connect(centerOriginAct, &QAction::triggered, _sceneViewer, &SceneViewer::centerOrigin);
+
+	menuScene->addSeparator();
+	QAction * openUnderlayAct = new QAction(menuScene);
+	openUnderlayAct->setText(tr("Open &Underlay Image..."));
+	menuScene->addAction(openUnderlayAct);
+	connect(openUnderlayAct, &QAction::triggered, _sceneViewer, &SceneViewer::openUnderlay);
+
+	QAction * closeUnderlayAct = new QAction(menuScene);
+	closeUnderlayAct->setText(tr("Close Under&lay Image"));
+	menuScene->addAction(closeUnderlayAct);
+	connect(closeUnderlayAct, &QAction::triggered, _sceneViewer, &SceneViewer::closeUnderlay);
 
 	// View menu
 	QMenu *menuView = menuBar->addMenu(tr("&View"));
@@ -169,4 +273,18 @@ void MainWindow::toggleFSMViewer(bool state) {
 
 void MainWindow::toggleLog(bool state) {
 	_logger->setVisible(state);
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::validateScene() {
+	SceneValidator validator;
+	validator.setObstacles(_sceneViewer->getObstacleSet());
+	validator.setAgents(&_sceneViewer->getAgentPositions());
+	validator.setReferenceGrid(_sceneViewer->getReferenceGrid());
+	validator.setBehavior(&_fsmViewer->getBehavior());
+	validator.validate();
+	validator.log();
+	_toggleLogVis->setChecked(true);
+	toggleLog(true);
+}
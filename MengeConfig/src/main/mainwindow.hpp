@@ -7,6 +7,7 @@ class SceneHierarchy;
 class SceneViewer;
 class FSMViewer;
 class AppLogger;
+class ProjectManager;
 class ToolPropertyWidget;
 
 /*!
@@ -22,6 +23,15 @@ public:
 	 */
     MainWindow();
 
+protected:
+	/*!
+	 *	@brief		Autosaves the project before the window closes (or keeps it open if the
+	 *				user cancels saving an unnamed project).
+	 *
+	 *	@param		event		The close event.
+	 */
+	void closeEvent(QCloseEvent * event) Q_DECL_OVERRIDE;
+
 private:
 	
 	///////////////////////////////////////////////////////////////////////////
@@ -66,6 +76,11 @@ private:
 	 */
 	AppLogger * _logger;
 
+	/*!
+	 *	@brief		The manager of the current project (saving, loading and autosaving).
+	 */
+	ProjectManager * _project;
+
 	///////////////////////////////////////////////////////////////////////////
 	//				Menu items
 	///////////////////////////////////////////////////////////////////////////
@@ -80,6 +95,21 @@ private:
 	*/
 	QAction *	_drawObstacleAct;
 
+	/*!
+	 *	@brief		Enters the mode for placing agents.
+	 */
+	QAction *	_placeAgentsAct;
+
+	/*!
+	 *	@brief		Validates the scene.
+	 */
+	QAction *	_validateAct;
+
+	/*!
+	 *	@brief		Runs the scene validation checks and shows their results in the log.
+	 */
+	void validateScene();
+
 	/*!
 	 *	@brief		The toggle for showing/hiding the scene viewer.
 	 */